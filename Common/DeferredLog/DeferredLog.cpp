@@ -0,0 +1,99 @@
+// Common/DeferredLog/DeferredLog.cpp
+
+#include "DeferredLog.h"
+
+// The slot sequence numbers follow the classic bounded MPMC queue scheme:
+// a slot is free for the writer at position N when its sequence equals N,
+// and holds a record for the reader at position N when it equals N + 1.
+
+DeferredLog deferredLog;
+
+DeferredLog::DeferredLog() {
+  for (uint32_t i = 0; i < CAPACITY; i++) {
+    _slots[i].sequence.store(i, std::memory_order_relaxed);
+  }
+  _writePos.store(0, std::memory_order_relaxed);
+  _readPos.store(0, std::memory_order_relaxed);
+  _pendingDropped.store(0, std::memory_order_relaxed);
+  _totalDropped.store(0, std::memory_order_relaxed);
+}
+
+void DeferredLog::write(uint16_t formatId, uint8_t argCount, const uint32_t *args) {
+  uint32_t pos = _writePos.load(std::memory_order_relaxed);
+  Slot *slot;
+  for (;;) {
+    slot = &_slots[pos & (CAPACITY - 1)];
+    uint32_t sequence = slot->sequence.load(std::memory_order_acquire);
+    int32_t diff = (int32_t)(sequence - pos);
+    if (diff == 0) {
+      if (_writePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+    } else if (diff < 0) {
+      // Buffer full: drop this record rather than wait for the drain.
+      _pendingDropped.fetch_add(1, std::memory_order_relaxed);
+      _totalDropped.fetch_add(1, std::memory_order_relaxed);
+      return;
+    } else {
+      pos = _writePos.load(std::memory_order_relaxed);
+    }
+  }
+
+  LogRecord &record = slot->record;
+  record.timestampUs = (uint32_t)micros();
+  record.formatId = formatId;
+  record.argCount = argCount;
+  record.reserved = 0;
+  for (int i = 0; i < LOG_MAX_ARGS; i++) {
+    record.args[i] = i < argCount ? args[i] : 0;
+  }
+  slot->sequence.store(pos + 1, std::memory_order_release);
+}
+
+bool DeferredLog::_sendRecord(Print &out, const LogRecord &record) {
+#if ICU_DEFERRED_LOG_TEXT
+  char line[160];
+  int len = snprintf(line, sizeof(line), "[%10lu] ", (unsigned long)record.timestampUs);
+  len += formatLogRecord(record, line + len, sizeof(line) - len - 1);
+  line[len++] = '\n';
+  if (out.availableForWrite() < len) return false;
+  out.write((const uint8_t *)line, len);
+#else
+  const int frameSize = 2 + sizeof(LogRecord);
+  if (out.availableForWrite() < frameSize) return false;
+  uint8_t frame[frameSize];
+  frame[0] = LOG_SYNC_0;
+  frame[1] = LOG_SYNC_1;
+  memcpy(frame + 2, &record, sizeof(LogRecord));
+  out.write(frame, frameSize);
+#endif
+  return true;
+}
+
+size_t DeferredLog::drain(Print &out) {
+  size_t sent = 0;
+
+  uint32_t dropped = _pendingDropped.load(std::memory_order_relaxed);
+  if (dropped > 0) {
+    LogRecord notice = {};
+    notice.timestampUs = (uint32_t)micros();
+    notice.formatId = LOG_DROPPED;
+    notice.argCount = 1;
+    notice.args[0] = dropped;
+    if (!_sendRecord(out, notice)) return 0;
+    _pendingDropped.fetch_sub(dropped, std::memory_order_relaxed);
+    sent++;
+  }
+
+  for (;;) {
+    uint32_t pos = _readPos.load(std::memory_order_relaxed);
+    Slot &slot = _slots[pos & (CAPACITY - 1)];
+    if (slot.sequence.load(std::memory_order_acquire) != pos + 1) break; // Empty
+
+    // Only release the slot once the record is actually out, so a full
+    // TX buffer just leaves it queued for the next idle pass.
+    if (!_sendRecord(out, slot.record)) break;
+    _readPos.store(pos + 1, std::memory_order_relaxed);
+    slot.sequence.store(pos + CAPACITY, std::memory_order_release);
+    sent++;
+  }
+  return sent;
+}
@@ -0,0 +1,62 @@
+// Common/DeferredLog/DeferredLog.h
+
+#ifndef DEFERRED_LOG_H
+#define DEFERRED_LOG_H
+
+#include <Arduino.h>
+#include <atomic>
+#include "LogRecord.h"
+
+// Build with -D ICU_DEFERRED_LOG_TEXT=1 to have drain() print readable text
+// instead of binary records, so a plain serial monitor works without the decoder.
+#ifndef ICU_DEFERRED_LOG_TEXT
+#define ICU_DEFERRED_LOG_TEXT 0
+#endif
+
+// A lock-free RAM ring buffer of compact log records.
+//
+// log() is what the hot paths call: it stores a format ID, a timestamp and
+// the raw arguments (a few hundred cycles, never blocks, never allocates).
+// drain() is called from idle time and writes as many records as the serial
+// TX buffer can take without blocking. If the buffer fills up, new records
+// are dropped and counted instead of stalling the caller.
+//
+// Any number of tasks may call log(); only one may call drain().
+class DeferredLog {
+public:
+  static const uint32_t CAPACITY = 128; // Must be a power of two
+
+  DeferredLog();
+
+  template <typename... Args>
+  void log(LogFormatId id, Args... args) {
+    static_assert(sizeof...(Args) <= LOG_MAX_ARGS, "Too many log arguments");
+    uint32_t raw[LOG_MAX_ARGS + 1] = {logArg(args)..., 0};
+    write((uint16_t)id, sizeof...(Args), raw);
+  }
+
+  void write(uint16_t formatId, uint8_t argCount, const uint32_t *args);
+
+  // Sends buffered records to 'out' until it would block. Returns records sent.
+  size_t drain(Print &out);
+
+  uint32_t droppedCount() const { return _totalDropped.load(std::memory_order_relaxed); }
+
+private:
+  struct Slot {
+    std::atomic<uint32_t> sequence;
+    LogRecord record;
+  };
+
+  bool _sendRecord(Print &out, const LogRecord &record);
+
+  Slot _slots[CAPACITY];
+  std::atomic<uint32_t> _writePos;
+  std::atomic<uint32_t> _readPos;
+  std::atomic<uint32_t> _pendingDropped; // Dropped since the last DROPPED record was sent
+  std::atomic<uint32_t> _totalDropped;
+};
+
+extern DeferredLog deferredLog;
+
+#endif // DEFERRED_LOG_H
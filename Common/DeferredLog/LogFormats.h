@@ -0,0 +1,62 @@
+// Common/DeferredLog/LogFormats.h
+
+#ifndef LOG_FORMATS_H
+#define LOG_FORMATS_H
+
+// Every deferred log message, for both boards, lives in this one table.
+// The firmware only ever sends the ID and the raw arguments; the format
+// string is applied later, either by the drain in text mode or by the
+// host-side decoder (tools/dlog_decode.cpp), which includes this same file.
+//
+// Arguments are 32-bit. Use %d/%u/%x for integers and %f for floats.
+// Always ADD new entries at the end so old captures still decode.
+#define ICU_LOG_FORMATS(X)                                                             \
+  X(DROPPED,              "DeferredLog: %u records dropped (buffer full)")             \
+  X(LED_NEW_STATE,        "LedController: Received new state request -> %d")           \
+  X(LED_ALREADY_ACTIVE,   "LedController: Command %d already active, nothing to send") \
+  X(LED_SENDING,          "LedController: Mapping to command number %d and sending pulses...") \
+  X(LED_SENT,             "LedController: Command %d sent.")                           \
+  X(SERVO_NEW_STATE,      "ServoController: New State -> %d")                          \
+  X(MAIN_SERVOS_ONLINE,   "All components online. Performing awakening sequence...")   \
+  X(MAIN_AWAKE,           "Awakening complete.")                                       \
+  X(MAIN_WAKE_COMPLETE,   "WAKE_UP state is fully complete. Transitioning to SCANNING.") \
+  X(DEMO_SCAN_1_DONE,     "DEMO: Scan 1 complete. Napping...")                         \
+  X(DEMO_DETECT_DONE,     "DEMO: Detection hold finished. Resuming scan...")           \
+  X(DEMO_SCAN_3_DONE,     "DEMO: Final scan complete. Going to sleep.")                \
+  X(DEMO_SLEEP_DONE,      "DEMO: Sleep period over. Restarting cycle.")                \
+  X(XIAO_HEARTBEAT_SENT,  "Sent: Heartbeat")                                           \
+  X(XIAO_DETECTION_SENT,  "Sent Detection: %d,%d,%d,%d")                               \
+  X(XIAO_CAPTURE_FAILED,  "Camera frame capture failed")                               \
+  X(XIAO_GATE_IDLE,       "MotionGate: Scene still, throttling inference")             \
+  X(XIAO_GATE_ACTIVE,     "MotionGate: Motion, full rate (%u frames skipped this heartbeat)") \
+  X(LINK_DOWN,            "XiaoFaceDetector: No heartbeat for %u ms, link down")       \
+  X(LINK_UP,              "XiaoFaceDetector: Heartbeat received, link up")             \
+  X(MAIN_FACE_CONFIRMED,  "Presence: Face confirmed (%d hit slots), DETECTION")        \
+  X(MAIN_FACE_LOST,       "Presence: No face for %u ms, back to SCANNING")             \
+  X(POWER_STATE,          "PowerManager: Power state %d -> %d")                        \
+  X(MAIN_FACE_NAP,        "Presence: No face for %u ms, NAPPING")                      \
+  X(XIAO_POWER_MODE,      "CameraPower: Power mode %d -> %d")                          \
+  X(HEAP_REPORT,          "Heap: free %u, low-water %u, largest block %u, steady-state allocations %u") \
+  X(MAIN_FACE_IDENTITY,   "Presence: Track %u is person %d")                           \
+  X(LINK_SETTING_REFUSED, "XiaoFaceDetector: XIAO refused detector setting %d") \
+  X(TELEMETRY_BOOT,       "Telemetry: Boot, reset reason %d")                          \
+  X(TELEMETRY_STATE,      "Telemetry: State %d -> %d")                                 \
+  X(TELEMETRY_SAMPLE,     "Telemetry: %u detections, %u faces confirmed, longest loop %u us, free heap %u") \
+  X(TELEMETRY_XIAO,       "Telemetry: XIAO %.1f fps, hit rate %.2f, inference p99 %u us, heartbeat %d s ago") \
+  X(LED_PROGRAM,          "LedController: Ring %u program: pattern %u, period %u ms, phase %u/256") \
+  X(SERVO_SCAN_HEAT,      "ServoController: Scan heatmap saved, %.1f faces, bias %.2f")
+
+enum LogFormatId {
+#define ICU_LOG_FORMAT_ENUM(id, fmt) LOG_##id,
+  ICU_LOG_FORMATS(ICU_LOG_FORMAT_ENUM)
+#undef ICU_LOG_FORMAT_ENUM
+  LOG_FORMAT_COUNT
+};
+
+static const char *const logFormatStrings[] = {
+#define ICU_LOG_FORMAT_STRING(id, fmt) fmt,
+  ICU_LOG_FORMATS(ICU_LOG_FORMAT_STRING)
+#undef ICU_LOG_FORMAT_STRING
+};
+
+#endif // LOG_FORMATS_H
@@ -0,0 +1,98 @@
+// Common/DeferredLog/LogRecord.h
+
+#ifndef LOG_RECORD_H
+#define LOG_RECORD_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "LogFormats.h"
+
+// One deferred log entry. It is written to the wire exactly as it sits in
+// memory (both the ESP32-S3 and a PC are little-endian), prefixed by the two
+// sync bytes below so the decoder can find records between plain text lines.
+const int LOG_MAX_ARGS = 4;
+const uint8_t LOG_SYNC_0 = 0xA5;
+const uint8_t LOG_SYNC_1 = 0x5A;
+
+struct LogRecord {
+  uint32_t timestampUs;
+  uint16_t formatId;
+  uint8_t argCount;
+  uint8_t reserved;
+  uint32_t args[LOG_MAX_ARGS];
+};
+static_assert(sizeof(LogRecord) == 24, "LogRecord is part of the wire format");
+
+// Converts a log argument to its raw 32-bit slot; floats keep their bit pattern.
+inline uint32_t logArg(int v) { return (uint32_t)v; }
+inline uint32_t logArg(unsigned v) { return v; }
+inline uint32_t logArg(long v) { return (uint32_t)v; }
+inline uint32_t logArg(unsigned long v) { return (uint32_t)v; }
+inline uint32_t logArg(float v) {
+  uint32_t raw;
+  memcpy(&raw, &v, sizeof(raw));
+  return raw;
+}
+inline uint32_t logArg(double v) { return logArg((float)v); }
+
+// Renders a record into text using its format string. Returns the length written.
+// Shared by the on-device text drain and the host-side decoder.
+inline int formatLogRecord(const LogRecord &record, char *out, size_t outSize) {
+  if (outSize == 0) return 0;
+  if (record.formatId >= LOG_FORMAT_COUNT) {
+    return snprintf(out, outSize, "<unknown log format %u>", (unsigned)record.formatId);
+  }
+
+  const char *fmt = logFormatStrings[record.formatId];
+  size_t len = 0;
+  int argIndex = 0;
+  while (*fmt && len + 1 < outSize) {
+    if (*fmt != '%') {
+      out[len++] = *fmt++;
+      continue;
+    }
+    if (fmt[1] == '%') {
+      out[len++] = '%';
+      fmt += 2;
+      continue;
+    }
+
+    // Copy one conversion spec (flags, width, precision), dropping length modifiers.
+    char spec[16];
+    size_t specLen = 0;
+    spec[specLen++] = *fmt++;
+    while (*fmt && strchr("-+ #0123456789.lhz", *fmt)) {
+      if (!strchr("lhz", *fmt) && specLen < sizeof(spec) - 2) spec[specLen++] = *fmt;
+      fmt++;
+    }
+    char conversion = *fmt ? *fmt++ : 'd';
+    spec[specLen++] = conversion;
+    spec[specLen] = '\0';
+
+    uint32_t raw = argIndex < record.argCount ? record.args[argIndex] : 0;
+    argIndex++;
+    int written;
+    switch (conversion) {
+      case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': {
+        float value;
+        memcpy(&value, &raw, sizeof(value));
+        written = snprintf(out + len, outSize - len, spec, (double)value);
+        break;
+      }
+      case 'u': case 'x': case 'X': case 'o':
+        written = snprintf(out + len, outSize - len, spec, (unsigned)raw);
+        break;
+      default:
+        written = snprintf(out + len, outSize - len, spec, (int)(int32_t)raw);
+        break;
+    }
+    if (written < 0) break;
+    len += (size_t)written;
+    if (len >= outSize) len = outSize - 1;
+  }
+  out[len] = '\0';
+  return (int)len;
+}
+
+#endif // LOG_RECORD_H
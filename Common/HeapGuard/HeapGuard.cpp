@@ -0,0 +1,117 @@
+// Common/HeapGuard/HeapGuard.cpp
+
+#include "HeapGuard.h"
+#include "esp_heap_caps.h"
+#include "esp_rom_sys.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "DeferredLog.h"
+
+const unsigned long HEAP_REPORT_INTERVAL = 60000; // ms
+
+static const char* const SUBSYSTEM_NAMES[] = {
+    "other", "screen", "servo", "led", "link", "camera", "inference", "heartbeat", "commands"};
+
+HeapGuard heapGuard;
+
+HeapGuard::HeapGuard() {
+  _current = HeapSubsystem::OTHER;
+  _loopTask = nullptr;
+  _steady = false;
+  _lastReport = 0;
+  for (int i = 0; i < (int)HeapSubsystem::COUNT; i++) {
+    _allocations[i] = 0;
+    _bytes[i] = 0;
+  }
+  _otherTasks = 0;
+}
+
+void HeapGuard::begin() {
+  _loopTask = xTaskGetCurrentTaskHandle();
+}
+
+void HeapGuard::setSteady(bool steady) {
+  _steady = steady;
+}
+
+uint32_t HeapGuard::largestFreeBlock() {
+  return heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+}
+
+uint32_t HeapGuard::minFreeHeap() {
+  return heap_caps_get_minimum_free_size(MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+}
+
+uint32_t HeapGuard::steadyAllocations() const {
+  uint32_t total = 0;
+  for (int i = 0; i < (int)HeapSubsystem::COUNT; i++) total += _allocations[i];
+  return total;
+}
+
+void HeapGuard::update() {
+  if (millis() - _lastReport < HEAP_REPORT_INTERVAL) return;
+  _lastReport = millis();
+  deferredLog.log(LOG_HEAP_REPORT, (uint32_t)heap_caps_get_free_size(MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT),
+                  minFreeHeap(), largestFreeBlock(), steadyAllocations());
+}
+
+// Runs inside malloc: it must not allocate, and must not print through Serial.
+void HeapGuard::onAllocation(size_t size) {
+  if (!_steady) return;
+  if (xTaskGetCurrentTaskHandle() != _loopTask) {
+    _otherTasks++;
+    return;
+  }
+  int subsystem = (int)_current;
+  _allocations[subsystem]++;
+  _bytes[subsystem] += size;
+#if ICU_HEAP_GUARD >= 2
+  if (_current != HeapSubsystem::INFERENCE && _current != HeapSubsystem::COMMANDS) {
+    esp_rom_printf("HeapGuard: %u byte allocation in steady state (%s)\n", (unsigned)size, SUBSYSTEM_NAMES[subsystem]);
+    abort();
+  }
+#endif
+}
+
+void HeapGuard::dump(Print& out) {
+  out.printf("HEAP internal free=%lu min=%lu largest=%lu psram free=%lu\n",
+             (unsigned long)heap_caps_get_free_size(MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT),
+             (unsigned long)minFreeHeap(), (unsigned long)largestFreeBlock(),
+             (unsigned long)heap_caps_get_free_size(MALLOC_CAP_SPIRAM));
+#if ICU_HEAP_GUARD
+  out.printf("HEAP steady=%d other_tasks=%lu\n", _steady, (unsigned long)_otherTasks);
+  for (int i = 0; i < (int)HeapSubsystem::COUNT; i++) {
+    out.printf("HEAP %-9s allocs=%lu bytes=%lu\n", SUBSYSTEM_NAMES[i], (unsigned long)_allocations[i],
+               (unsigned long)_bytes[i]);
+  }
+#else
+  out.println("HEAP allocation tracking is compiled out. Build the *_heapguard environment.");
+#endif
+}
+
+#if ICU_HEAP_GUARD
+
+// Linked in place of the C library's allocators with -Wl,--wrap=<name>.
+// operator new calls malloc, so C++ allocations are seen too.
+extern "C" {
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t count, size_t size);
+void* __real_realloc(void* ptr, size_t size);
+
+void* __wrap_malloc(size_t size) {
+  heapGuard.onAllocation(size);
+  return __real_malloc(size);
+}
+
+void* __wrap_calloc(size_t count, size_t size) {
+  heapGuard.onAllocation(count * size);
+  return __real_calloc(count, size);
+}
+
+void* __wrap_realloc(void* ptr, size_t size) {
+  if (size > 0) heapGuard.onAllocation(size);
+  return __real_realloc(ptr, size);
+}
+}
+
+#endif // ICU_HEAP_GUARD
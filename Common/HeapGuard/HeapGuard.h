@@ -0,0 +1,95 @@
+// Common/HeapGuard/HeapGuard.h
+
+#ifndef HEAP_GUARD_H
+#define HEAP_GUARD_H
+
+#include <Arduino.h>
+
+// Build with -D ICU_HEAP_GUARD=1 to count every heap allocation the loop
+// makes once the firmware is in its steady state, per subsystem, or with
+// -D ICU_HEAP_GUARD=2 to also abort on the first one (with a backtrace
+// pointing at the caller). Either needs malloc, calloc and realloc wrapped
+// at link time; the *_heapguard environments in platformio.ini do both.
+// When it is off, HEAP_SCOPE expands to nothing and nothing is wrapped.
+//
+// The periodic heap report (free, low-water mark, largest free block) is
+// always on.
+#ifndef ICU_HEAP_GUARD
+#define ICU_HEAP_GUARD 0
+#endif
+
+// What the loop is doing when it allocates. One table for both boards.
+// Keep HeapGuard.cpp's names in the same order.
+enum class HeapSubsystem : uint8_t {
+  OTHER,     // Loop code outside any scope
+  SCREEN,
+  SERVO,
+  LED,
+  LINK,      // Either end of the UART link
+  CAMERA,
+  INFERENCE, // ESP-DL allocates its results every frame; counted, never fatal
+  HEARTBEAT,
+  COMMANDS,  // Serial debug commands print through Print::printf; counted, never fatal
+  COUNT
+};
+
+class HeapGuard {
+public:
+  HeapGuard();
+
+  // Call from setup(): allocations from other tasks are counted apart.
+  void begin();
+  // Steady state starts (and allocations start to count) once setup work
+  // is done. Pass false around work that is allowed to allocate, such as
+  // rerunning the start-up sequence.
+  void setSteady(bool steady);
+
+  // Call every loop; logs the heap report every HEAP_REPORT_INTERVAL.
+  void update();
+
+  uint32_t steadyAllocations() const; // From the loop task, every subsystem
+  static uint32_t largestFreeBlock();
+  static uint32_t minFreeHeap();
+
+  // Prints the heap report and the allocations per subsystem.
+  void dump(Print& out);
+
+  // Called by the malloc wrappers
+  void onAllocation(size_t size);
+
+private:
+  friend class HeapScope;
+
+  HeapSubsystem _current; // Set by HeapScope
+  void* _loopTask;
+  bool _steady;
+  unsigned long _lastReport;
+  uint32_t _allocations[(int)HeapSubsystem::COUNT];
+  uint32_t _bytes[(int)HeapSubsystem::COUNT];
+  uint32_t _otherTasks; // Not attributed: other tasks share no subsystem state
+};
+
+extern HeapGuard heapGuard;
+
+#if ICU_HEAP_GUARD
+
+// Attributes the loop's allocations within the enclosing scope to a
+// subsystem, and restores the outer one when it exits.
+class HeapScope {
+public:
+  explicit HeapScope(HeapSubsystem subsystem) : _outer(heapGuard._current) { heapGuard._current = subsystem; }
+  ~HeapScope() { heapGuard._current = _outer; }
+
+private:
+  HeapSubsystem _outer;
+};
+
+#define HEAP_SCOPE(subsystem) HeapScope _heapScope(subsystem)
+
+#else
+
+#define HEAP_SCOPE(subsystem) do {} while (0)
+
+#endif // ICU_HEAP_GUARD
+
+#endif // HEAP_GUARD_H
@@ -0,0 +1,94 @@
+// Common/JsonArena/JsonArena.cpp
+
+#include "JsonArena.h"
+#include <string.h>
+
+JsonArena::JsonArena(uint8_t* buffer, size_t size) {
+  _buffer = buffer;
+  _size = size;
+  _top = 0;
+  _last = 0;
+  _live = 0;
+  _highWater = 0;
+  _failures = 0;
+}
+
+size_t JsonArena::_align(size_t size) {
+  return (size + 7) & ~(size_t)7;
+}
+
+JsonArena::Header* JsonArena::_header(void* pointer) const {
+  return (Header*)((uint8_t*)pointer - sizeof(Header));
+}
+
+void* JsonArena::allocate(size_t size) {
+  size_t need = sizeof(Header) + _align(size);
+  if (need > _size - _top) {
+    _failures++;
+    return nullptr;
+  }
+  Header* header = (Header*)(_buffer + _top);
+  header->size = size;
+  header->previous = _live > 0 ? _last : _top;
+  _last = _top;
+  _top += need;
+  _live++;
+  if (_top > _highWater) _highWater = _top;
+  return header + 1;
+}
+
+// A freed block only gives its space back if it is the last one; the rest
+// comes back together when the last block goes.
+void JsonArena::deallocate(void* pointer) {
+  if (!pointer || _live == 0) return;
+  if (--_live == 0) {
+    _top = 0;
+    return;
+  }
+  Header* header = _header(pointer);
+  if ((uint8_t*)header - _buffer == (ptrdiff_t)_last) {
+    _top = _last;
+    _last = header->previous;
+  }
+}
+
+void* JsonArena::reallocate(void* pointer, size_t newSize) {
+  if (!pointer) return allocate(newSize);
+  Header* header = _header(pointer);
+
+  if ((uint8_t*)header - _buffer == (ptrdiff_t)_last) {
+    // The last block grows or shrinks where it is
+    size_t top = _last + sizeof(Header) + _align(newSize);
+    if (top > _size) {
+      _failures++;
+      return nullptr;
+    }
+    header->size = newSize;
+    _top = top;
+    if (_top > _highWater) _highWater = _top;
+    return pointer;
+  }
+
+  size_t oldSize = header->size;
+  if (newSize <= oldSize) {
+    header->size = newSize;
+    return pointer;
+  }
+  void* moved = allocate(newSize);
+  if (!moved) return nullptr;
+  memcpy(moved, pointer, oldSize);
+  deallocate(pointer);
+  return moved;
+}
+
+size_t JsonArena::capacity() const {
+  return _size;
+}
+
+size_t JsonArena::highWater() const {
+  return _highWater;
+}
+
+uint32_t JsonArena::failures() const {
+  return _failures;
+}
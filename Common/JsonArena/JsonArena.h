@@ -0,0 +1,62 @@
+// Common/JsonArena/JsonArena.h
+
+#ifndef JSON_ARENA_H
+#define JSON_ARENA_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <ArduinoJson.h>
+
+// An ArduinoJson allocator over a fixed buffer, so a JsonDocument that is
+// refilled for every message never touches the heap.
+//
+// A document only ever grows its pools and strings and then frees all of
+// them when it is cleared, which is what a bump allocator is good at: each
+// block goes on the end, the last block can grow or shrink in place, and
+// the arena starts over once nothing is left outstanding. If a message
+// does not fit, allocate() fails and ArduinoJson reports NoMemory (or an
+// overflowed document when building), which the caller already handles.
+//
+// Give each document its own arena. No Arduino dependencies beyond
+// ArduinoJson, so tools/link_replay builds it with the ProS3 parser.
+class JsonArena : public ArduinoJson::Allocator {
+public:
+  JsonArena(uint8_t* buffer, size_t size);
+
+  void* allocate(size_t size) override;
+  void deallocate(void* pointer) override;
+  void* reallocate(void* pointer, size_t newSize) override;
+
+  size_t capacity() const;
+  size_t highWater() const;     // Most bytes in use at once, headers included
+  uint32_t failures() const;    // Allocations that did not fit
+
+private:
+  struct Header {
+    uint32_t size;
+    uint32_t previous; // Offset of the block before this one
+  };
+
+  static size_t _align(size_t size);
+  Header* _header(void* pointer) const;
+
+  uint8_t* _buffer;
+  size_t _size;
+  size_t _top;        // Offset of the first free byte
+  size_t _last;       // Offset of the last block's header, valid while _live > 0
+  uint32_t _live;     // Blocks allocated and not yet freed
+  size_t _highWater;
+  uint32_t _failures;
+};
+
+// Declares a JsonArena together with its storage.
+template <size_t SIZE>
+class StaticJsonArena : public JsonArena {
+public:
+  StaticJsonArena() : JsonArena(_storage, SIZE) {}
+
+private:
+  alignas(8) uint8_t _storage[SIZE];
+};
+
+#endif // JSON_ARENA_H
@@ -0,0 +1,118 @@
+// Common/LinkProtocol/LinkProtocol.h
+
+#ifndef LINK_PROTOCOL_H
+#define LINK_PROTOCOL_H
+
+#include <string.h>
+
+// Settings both ends of the ProS3 <-> XIAO UART link must agree on.
+// Every message is one line of JSON: {"action":"...","data":...}\n
+
+// Both boards boot at the default rate. The ProS3 then asks for the fast rate
+// with {"action":"baud","data":"<rate>"}; the XIAO answers with "baud_ack" at
+// the old rate and switches, and the ProS3 switches when it sees the ack.
+// If either side sees garbage at the fast rate it falls back to the default.
+const unsigned long LINK_DEFAULT_BAUD = 115200;
+const unsigned long LINK_FAST_BAUD = 921600;
+
+// The XIAO sends {"action":"alive",...} this often, whatever else it is
+// doing. The ProS3 counts the link as down when these stop.
+const unsigned long LINK_HEARTBEAT_INTERVAL_MS = 30000;
+// Heartbeats that may go missing before the link counts as down. The timeout
+// is this many intervals plus one, so a late heartbeat is not a missed one.
+const unsigned long LINK_HEARTBEATS_MISSED = 2;
+const unsigned long LINK_DOWN_TIMEOUT_MS = (LINK_HEARTBEATS_MISSED + 1) * LINK_HEARTBEAT_INTERVAL_MS;
+
+// Power modes, matching the ProS3's own power state. The ProS3 asks with
+// {"action":"power","data":"<name>"} and the XIAO reports the mode it is in
+// under "pwr" in every heartbeat.
+//   active   full frame rate
+//   low      a low frame rate while the scene is still, full rate on motion
+//   standby  camera sensor powered down, no frames at all
+enum LinkPowerMode {
+  LINK_POWER_ACTIVE,
+  LINK_POWER_LOW,
+  LINK_POWER_STANDBY,
+  LINK_POWER_MODE_COUNT
+};
+static const char* const LINK_POWER_MODE_NAMES[LINK_POWER_MODE_COUNT] = {"active", "low", "standby"};
+
+// Unknown names are taken as active, so a bad request never blinds the camera.
+inline LinkPowerMode linkPowerModeFromName(const char* name) {
+  for (int i = 0; i < LINK_POWER_MODE_COUNT; i++) {
+    if (strcmp(name, LINK_POWER_MODE_NAMES[i]) == 0) return (LinkPowerMode)i;
+  }
+  return LINK_POWER_ACTIVE;
+}
+
+// Detector settings the ProS3 can change at run time. It sends
+// {"action":"set","data":"<seq>,<name>,<value>"} and the XIAO answers every
+// one with {"action":"set_ack","data":"<seq>,<status>"}, where the status is
+// "ok", "unknown" (no such setting) or "range" (value outside min..max).
+// The XIAO reports the last seq it answered as "cfg" in every heartbeat;
+// a mismatch means one of the two restarted, and the ProS3 sends all of
+// its settings again.
+enum LinkSetting {
+  LINK_SET_MSR_SCORE,  // MSR01 candidate score threshold
+  LINK_SET_MSR_NMS,    // MSR01 non-maximum suppression overlap
+  LINK_SET_MSR_TOP_K,  // MSR01 candidates kept
+  LINK_SET_MSR_RESIZE, // MSR01 input scale: smaller is faster but misses small faces
+  LINK_SET_MNP_SCORE,  // MNP01 refinement score threshold
+  LINK_SET_MNP_NMS,    // MNP01 non-maximum suppression overlap
+  LINK_SET_MNP_TOP_K,  // MNP01 faces kept
+  LINK_SET_MAX_FPS,    // Frame rate cap, 0 for as fast as possible
+  LINK_SET_CAPTURE,    // 0 adapts the frame size to the face, 1 always captures the full field
+  LINK_SET_PAUSE_MS,   // Skip inference for this long (a blink), 0 to resume now
+  LINK_SET_EMIT_PX,    // Smallest box change worth a message, in pixels; 0 sends every frame
+  LINK_SET_EMIT_KEEP,  // Longest gap between messages (ms) while a face holds still
+  LINK_SET_EMIT_HZ,    // Detection message rate cap; a new face and a lost one go straight out
+  LINK_SET_THUMB_HZ,   // Camera thumbnail messages per second, 0 for none (see below)
+  LINK_SETTING_COUNT
+};
+
+struct LinkSettingInfo {
+  const char* name;
+  float min;
+  float max;
+  float defaultValue;
+};
+
+// The defaults are the values the XIAO's detector was built with.
+static const LinkSettingInfo LINK_SETTINGS[LINK_SETTING_COUNT] = {
+  {"msr_score",  0.01f, 1.0f,    0.1f},
+  {"msr_nms",    0.05f, 1.0f,    0.5f},
+  {"msr_top_k",  1.0f,  50.0f,   10.0f},
+  {"msr_resize", 0.05f, 1.0f,    0.2f},
+  {"mnp_score",  0.01f, 1.0f,    0.5f},
+  {"mnp_nms",    0.05f, 1.0f,    0.3f},
+  {"mnp_top_k",  1.0f,  20.0f,   5.0f},
+  {"max_fps",    0.0f,  60.0f,   0.0f},
+  {"capture",    0.0f,  1.0f,    0.0f},
+  {"pause_ms",   0.0f,  2000.0f, 0.0f},
+  {"emit_px",    0.0f,  32.0f,   2.0f},
+  {"emit_keep",  50.0f, 1000.0f, 250.0f},
+  {"emit_hz",    1.0f,  60.0f,   20.0f},
+  {"thumb_hz",   0.0f,  15.0f,   0.0f},
+};
+
+// Returns LINK_SETTING_COUNT for a name that is not a setting.
+inline LinkSetting linkSettingFromName(const char* name) {
+  for (int i = 0; i < LINK_SETTING_COUNT; i++) {
+    if (strcmp(name, LINK_SETTINGS[i].name) == 0) return (LinkSetting)i;
+  }
+  return LINK_SETTING_COUNT;
+}
+
+// While thumb_hz is above 0 the XIAO also sends what its camera sees, as
+// {"action":"thumb","data":"<seq>,<flags>,<start>,<x>,<y>,<w>,<h>,<base64>"}
+// with the last face box (w = 0 for none) in thumbnail pixels and the
+// changes encoded by Common/ThumbCodec. The thumbnail always covers the full
+// field of view: while the camera reads a sensor window, only the window's
+// part of it is refreshed.
+
+// Longest line either side will accept; anything longer is dropped.
+// Thumbnails and the XIAO heartbeat report are the longest messages, at
+// under 600 characters.
+const int LINK_MAX_LINE = 768;
+
+#endif // LINK_PROTOCOL_H
@@ -0,0 +1,72 @@
+// Common/Log2Histogram/Log2Histogram.h
+
+#ifndef LOG2_HISTOGRAM_H
+#define LOG2_HISTOGRAM_H
+
+#include <stdint.h>
+
+// A tiny fixed-size histogram with one bucket per power of two.
+// Bucket N counts samples in the range [2^(N-1), 2^N), bucket 0 counts zeros.
+// Recording a sample is a count-leading-zeros and an increment, so it is cheap
+// enough to sit on hot paths. Percentiles are reported as the upper edge of the
+// bucket they fall in (clamped to the real min/max), which is plenty to tell
+// "a few microseconds" from "a blocking delay()".
+//
+// This header has no Arduino dependencies, so tools/link_replay and ring_clock_sim use it too.
+class Log2Histogram {
+public:
+  static const int NUM_BUCKETS = 33;
+
+  Log2Histogram() { reset(); }
+
+  void reset() {
+    for (int i = 0; i < NUM_BUCKETS; i++) _buckets[i] = 0;
+    _count = 0;
+    _sum = 0;
+    _min = UINT32_MAX;
+    _max = 0;
+  }
+
+  void record(uint32_t value) {
+    int bucket = (value == 0) ? 0 : (32 - __builtin_clz(value));
+    _buckets[bucket]++;
+    _count++;
+    _sum += value;
+    if (value < _min) _min = value;
+    if (value > _max) _max = value;
+  }
+
+  uint32_t count() const { return _count; }
+  uint32_t min() const { return _count ? _min : 0; }
+  uint32_t max() const { return _max; }
+  uint32_t mean() const { return _count ? (uint32_t)(_sum / _count) : 0; }
+  uint64_t sum() const { return _sum; }
+  uint32_t bucketCount(int bucket) const { return _buckets[bucket]; }
+
+  // Returns an upper bound for the given percentile (0-100).
+  uint32_t percentile(uint32_t pct) const {
+    if (_count == 0) return 0;
+    uint64_t target = ((uint64_t)_count * pct + 99) / 100;
+    if (target == 0) target = 1;
+    uint64_t seen = 0;
+    for (int i = 0; i < NUM_BUCKETS; i++) {
+      seen += _buckets[i];
+      if (seen >= target) {
+        uint32_t upper = (i == 0) ? 0 : (i >= 32 ? UINT32_MAX : ((1UL << i) - 1));
+        if (upper > _max) upper = _max;
+        if (upper < _min) upper = _min;
+        return upper;
+      }
+    }
+    return _max;
+  }
+
+private:
+  uint32_t _buckets[NUM_BUCKETS];
+  uint32_t _count;
+  uint64_t _sum;
+  uint32_t _min;
+  uint32_t _max;
+};
+
+#endif // LOG2_HISTOGRAM_H
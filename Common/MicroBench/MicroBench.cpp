@@ -0,0 +1,68 @@
+// Common/MicroBench/MicroBench.cpp
+
+#include "MicroBench.h"
+#include "esp_heap_caps.h"
+
+const size_t MEMCPY_BYTES = 32 * 1024;  // Internal buffers: fit twice in internal RAM next to everything else
+const size_t PSRAM_BYTES = 512 * 1024;  // Far more than the data cache holds, so PSRAM itself is timed
+const int MEMCPY_REPEATS = 64;          // Internal to internal
+const int PSRAM_PASSES = 8;             // Over the whole PSRAM buffer
+
+void writeBoardInfo(JsonObject data, const char* board) {
+  data["board"] = board;
+  data["chip"] = ESP.getChipModel();
+  data["rev"] = ESP.getChipRevision();
+  data["cpu_mhz"] = getCpuFrequencyMhz();
+  data["flash_mhz"] = ESP.getFlashChipSpeed() / 1000000;
+  data["psram"] = ESP.getPsramSize();
+  data["heap"] = ESP.getFreeHeap();
+  data["sdk"] = ESP.getSdkVersion();
+}
+
+// Returns MB/s, or 0 if either buffer could not be had. A PSRAM buffer is
+// PSRAM_BYTES, walked MEMCPY_BYTES at a time, and nothing is warmed first:
+// every copy reaches PSRAM rather than lines the cache still holds. The
+// writes the cache holds back at the end are at most its size, a small
+// part of what is copied.
+static float memcpyMBps(uint32_t dstCaps, uint32_t srcCaps) {
+  bool psram = (dstCaps | srcCaps) & MALLOC_CAP_SPIRAM;
+  size_t dstBytes = (dstCaps & MALLOC_CAP_SPIRAM) ? PSRAM_BYTES : MEMCPY_BYTES;
+  size_t srcBytes = (srcCaps & MALLOC_CAP_SPIRAM) ? PSRAM_BYTES : MEMCPY_BYTES;
+  uint8_t* dst = (uint8_t*)heap_caps_malloc(dstBytes, dstCaps);
+  uint8_t* src = (uint8_t*)heap_caps_malloc(srcBytes, srcCaps);
+  float mbps = 0;
+  if (dst && src) {
+    memset(src, 0x5a, srcBytes);
+    size_t span = max(dstBytes, srcBytes);
+    int passes = psram ? PSRAM_PASSES : MEMCPY_REPEATS;
+    if (!psram) memcpy(dst, src, MEMCPY_BYTES); // Warm the TLB
+    unsigned long start = micros();
+    for (int pass = 0; pass < passes; pass++) {
+      for (size_t offset = 0; offset < span; offset += MEMCPY_BYTES) {
+        memcpy(dst + offset % dstBytes, src + offset % srcBytes, MEMCPY_BYTES);
+      }
+    }
+    unsigned long elapsed = micros() - start;
+    mbps = elapsed ? (float)span * passes / elapsed : 0; // bytes/us == MB/s
+  }
+  heap_caps_free(dst);
+  heap_caps_free(src);
+  return roundf(mbps * 10.0f) / 10.0f;
+}
+
+void benchMemcpy(JsonObject data) {
+  const uint32_t internal = MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT;
+  const uint32_t psram = MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT;
+  data["bytes"] = MEMCPY_BYTES;
+  data["psram_bytes"] = PSRAM_BYTES;
+  data["int_to_int"] = memcpyMBps(internal, internal);
+  data["psram_to_psram"] = memcpyMBps(psram, psram);
+  data["int_to_psram"] = memcpyMBps(psram, internal);
+  data["psram_to_int"] = memcpyMBps(internal, psram);
+}
+
+void printBenchReport(JsonDocument& report, Print& out) {
+  out.print("BENCH ");
+  serializeJson(report, out);
+  out.println();
+}
@@ -0,0 +1,27 @@
+// Common/MicroBench/MicroBench.h
+
+#ifndef MICRO_BENCH_H
+#define MICRO_BENCH_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+// Pieces shared by the benchmark firmware of both boards (src/bench/ in
+// each project, built by the *_bench environments in platformio.ini).
+//
+// Every benchmark writes into one JSON document, and printBenchReport()
+// prints it as a single line starting with "BENCH ", so results from
+// different boards, clocks and build flags can be collected with grep and
+// compared with any JSON tool.
+
+// Board, chip, clocks and memory sizes, so a report says what it measured.
+void writeBoardInfo(JsonObject data, const char* board);
+
+// memcpy() bandwidth in MB/s between internal RAM and PSRAM, all four ways.
+// The PSRAM buffers are much bigger than the data cache, so the figures
+// with PSRAM in them are PSRAM's and not the cache's.
+void benchMemcpy(JsonObject data);
+
+void printBenchReport(JsonDocument& report, Print& out);
+
+#endif // MICRO_BENCH_H
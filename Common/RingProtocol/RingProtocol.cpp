@@ -0,0 +1,179 @@
+// Common/RingProtocol/RingProtocol.cpp
+
+#include "RingProtocol.h"
+
+// The first rate measured is taken whole; after that each sync corrects a
+// quarter of the rate error it saw, which averages out millis() resolution.
+const int32_t TRIM_GAIN_SHIFT = 2;
+
+// CRC-8, polynomial 0x07
+static uint8_t crc8(const uint8_t *data, int length) {
+  uint8_t crc = 0;
+  for (int i = 0; i < length; i++) {
+    crc ^= data[i];
+    for (int bit = 0; bit < 8; bit++) {
+      crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x07) : (uint8_t)(crc << 1);
+    }
+  }
+  return crc;
+}
+
+static int finishFrame(uint8_t *out, int length) {
+  out[length] = crc8(out + 1, length - 1);
+  return length + 1;
+}
+
+bool operator==(const RingProgram &a, const RingProgram &b) {
+  return a.pattern == b.pattern && a.red == b.red && a.green == b.green && a.blue == b.blue &&
+         a.periodMs == b.periodMs && a.phase == b.phase;
+}
+
+int ringEncodeProgram(uint8_t address, const RingProgram &program, uint8_t *out) {
+  out[0] = RING_FRAME_START;
+  out[1] = (uint8_t)((RING_FRAME_PROGRAM << 4) | (address & 0x0F));
+  out[2] = program.pattern;
+  out[3] = program.red;
+  out[4] = program.green;
+  out[5] = program.blue;
+  out[6] = (uint8_t)(program.periodMs & 0xFF);
+  out[7] = (uint8_t)(program.periodMs >> 8);
+  out[8] = program.phase;
+  return finishFrame(out, 9);
+}
+
+int ringEncodeSync(uint32_t masterMs, uint8_t *out) {
+  out[0] = RING_FRAME_START;
+  out[1] = (uint8_t)((RING_FRAME_SYNC << 4) | RING_BROADCAST);
+  for (int i = 0; i < 4; i++) out[2 + i] = (uint8_t)(masterMs >> (8 * i));
+  return finishFrame(out, 6);
+}
+
+uint8_t ringPosition(const RingProgram &program, uint32_t masterMs) {
+  uint32_t period = program.periodMs;
+  if (period == 0) return 0;
+  uint32_t offset = (uint32_t)program.phase * period / 256;
+  uint32_t at = (masterMs % period + offset) % period;
+  return (uint8_t)(at * 256 / period);
+}
+
+RingFrameParser::RingFrameParser() {
+  _length = 0;
+  _expected = 0;
+  _syncMs = 0;
+  _badFrames = 0;
+}
+
+bool RingFrameParser::feed(uint8_t byte) {
+  if (_length == 0) {
+    if (byte == RING_FRAME_START) _buffer[_length++] = byte;
+    return false;
+  }
+  _buffer[_length++] = byte;
+  if (_length == 2) {
+    switch (byte >> 4) {
+      case RING_FRAME_PROGRAM: _expected = RING_PROGRAM_FRAME_BYTES; break;
+      case RING_FRAME_SYNC:    _expected = RING_SYNC_FRAME_BYTES; break;
+      default:
+        _badFrames++;
+        _length = 0;
+        return false;
+    }
+    return false;
+  }
+  if (_length < _expected) return false;
+
+  _length = 0;
+  if (crc8(_buffer + 1, _expected - 2) != _buffer[_expected - 1]) {
+    _badFrames++;
+    return false;
+  }
+  if (type() == RING_FRAME_PROGRAM) {
+    _program.pattern = _buffer[2];
+    _program.red = _buffer[3];
+    _program.green = _buffer[4];
+    _program.blue = _buffer[5];
+    _program.periodMs = (uint16_t)(_buffer[6] | (_buffer[7] << 8));
+    _program.phase = _buffer[8];
+  } else {
+    _syncMs = 0;
+    for (int i = 0; i < 4; i++) _syncMs |= (uint32_t)_buffer[2 + i] << (8 * i);
+  }
+  return true;
+}
+
+RingFrameType RingFrameParser::type() const {
+  return (RingFrameType)(_buffer[1] >> 4);
+}
+
+uint8_t RingFrameParser::address() const {
+  return _buffer[1] & 0x0F;
+}
+
+const RingProgram &RingFrameParser::program() const {
+  return _program;
+}
+
+uint32_t RingFrameParser::syncMs() const {
+  return _syncMs;
+}
+
+uint32_t RingFrameParser::badFrames() const {
+  return _badFrames;
+}
+
+RingClock::RingClock() {
+  _synced = false;
+  _trimmed = false;
+  _syncMs = 0;
+  _syncLocalUs = 0;
+  _trimPpm = 0;
+  _lastErrorUs = 0;
+}
+
+int64_t RingClock::_elapsedUs(uint32_t localUs) const {
+  int64_t raw = (uint32_t)(localUs - _syncLocalUs);
+  return raw + raw * _trimPpm / 1000000;
+}
+
+// Both the last and this sync were written RING_SYNC_DELAY_US before they
+// arrived, so the delay cancels out of the error.
+void RingClock::onSync(uint32_t masterMs, uint32_t localUs) {
+  if (_synced) {
+    int64_t raw = (uint32_t)(localUs - _syncLocalUs);
+    int64_t errorUs = (int64_t)(int32_t)(masterMs - _syncMs) * 1000 - _elapsedUs(localUs);
+    if (errorUs > STEP_LIMIT_US || errorUs < -STEP_LIMIT_US) {
+      _trimPpm = 0; // A restarted ProS3, or a ring that missed too much to trust
+      _trimmed = false;
+    } else if (raw > 0) {
+      int64_t rateErrorPpm = errorUs * 1000000 / raw;
+      int64_t trim = _trimPpm + (_trimmed ? rateErrorPpm >> TRIM_GAIN_SHIFT : rateErrorPpm);
+      _trimmed = true;
+      if (trim > MAX_TRIM_PPM) trim = MAX_TRIM_PPM;
+      if (trim < -MAX_TRIM_PPM) trim = -MAX_TRIM_PPM;
+      _trimPpm = (int32_t)trim;
+    }
+    _lastErrorUs = (int32_t)(errorUs > INT32_MAX ? INT32_MAX : errorUs < INT32_MIN ? INT32_MIN : errorUs);
+  }
+  _synced = true;
+  _syncMs = masterMs;
+  _syncLocalUs = localUs;
+}
+
+// The sync carried millis(), which is on average half a millisecond behind
+// the moment it was written.
+uint32_t RingClock::masterMs(uint32_t localUs) const {
+  if (!_synced) return localUs / 1000;
+  return _syncMs + (uint32_t)((_elapsedUs(localUs) + RING_SYNC_DELAY_US + 500) / 1000);
+}
+
+bool RingClock::isSynced() const {
+  return _synced;
+}
+
+int32_t RingClock::trimPpm() const {
+  return _trimPpm;
+}
+
+int32_t RingClock::lastErrorUs() const {
+  return _lastErrorUs;
+}
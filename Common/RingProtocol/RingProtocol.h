@@ -0,0 +1,140 @@
+// Common/RingProtocol/RingProtocol.h
+
+#ifndef RING_PROTOCOL_H
+#define RING_PROTOCOL_H
+
+#include <stdint.h>
+
+// The ProS3 drives the three LED rings' ATTiny85s over one shared signal
+// line, as 8N1 serial at RING_BAUD (idle high, like the old pulse train).
+// Every ring is built with its own address and sees every frame:
+//
+//   0xA5, (type << 4) | address, payload..., CRC-8 of everything after 0xA5
+//
+//   PROGRAM  pattern, red, green, blue, period (ms, 16-bit little-endian), phase
+//            Sent once per change; the ring animates on its own from then on.
+//   SYNC     the ProS3's millis(), 32-bit little-endian, always broadcast
+//            Sent every second or so. Every ring runs its animation off its
+//            estimate of that clock (see RingClock), so the rings stay in
+//            phase with no traffic per animation frame.
+const int RING_COUNT = 3;
+const uint8_t RING_BROADCAST = 0x0F; // Address every ring answers to
+const unsigned long RING_BAUD = 9600; // Slow enough for a software UART on the ATTiny85's RC clock
+const uint8_t RING_FRAME_START = 0xA5;
+
+enum RingFrameType {
+  RING_FRAME_PROGRAM = 1,
+  RING_FRAME_SYNC = 2
+};
+
+const int RING_PROGRAM_PAYLOAD = 7;
+const int RING_SYNC_PAYLOAD = 4;
+const int RING_PROGRAM_FRAME_BYTES = 3 + RING_PROGRAM_PAYLOAD;
+const int RING_SYNC_FRAME_BYTES = 3 + RING_SYNC_PAYLOAD;
+const int RING_MAX_FRAME_BYTES = RING_PROGRAM_FRAME_BYTES;
+// One byte on the line: start bit, 8 data bits, stop bit
+const uint32_t RING_BYTE_US = 10 * 1000000UL / RING_BAUD;
+// The ProS3 writes the sync time as the frame starts; a ring timestamps it
+// when the last byte is in, this much later.
+const uint32_t RING_SYNC_DELAY_US = RING_SYNC_FRAME_BYTES * RING_BYTE_US;
+// A ring cannot trim its rate until its second sync, so the first few come
+// quickly after the ProS3 starts; from then on one a second is plenty.
+const unsigned long RING_SYNC_INTERVAL_MS = 1000;
+const unsigned long RING_STARTUP_SYNC_INTERVAL_MS = 100;
+const int RING_STARTUP_SYNCS = 10;
+
+// Where a pattern is in its period is ringPosition(); what that looks like:
+//   off      all LEDs dark
+//   solid    the colour, steady
+//   breathe  the colour fading up and down once per period
+//   spin     a lit segment going once round the ring per period
+//   blink    the colour for the first half of the period, dark for the second
+enum RingPattern : uint8_t {
+  RING_OFF,
+  RING_SOLID,
+  RING_BREATHE,
+  RING_SPIN,
+  RING_BLINK,
+  RING_PATTERN_COUNT
+};
+
+struct RingProgram {
+  uint8_t pattern = RING_OFF;
+  uint8_t red = 0, green = 0, blue = 0;
+  uint16_t periodMs = 1000;
+  uint8_t phase = 0; // Offset into the period, in 1/256ths: rings 85 apart chase each other
+};
+
+bool operator==(const RingProgram &a, const RingProgram &b);
+inline bool operator!=(const RingProgram &a, const RingProgram &b) { return !(a == b); }
+
+// Both return the frame length written to 'out' (RING_MAX_FRAME_BYTES is enough).
+int ringEncodeProgram(uint8_t address, const RingProgram &program, uint8_t *out);
+int ringEncodeSync(uint32_t masterMs, uint8_t *out);
+
+// 0-255 through the program's period at the given master time, with its
+// phase applied. Every ring that computes this from the same clock agrees.
+uint8_t ringPosition(const RingProgram &program, uint32_t masterMs);
+
+// The receiving end, one byte at a time as they come off the line. A bad
+// CRC drops the frame, and the parser waits for the next start byte.
+//
+// No Arduino dependencies, so it fits the ATTiny85; tools/ring_clock_sim runs
+// one per simulated ring.
+class RingFrameParser {
+public:
+  RingFrameParser();
+  // True when 'byte' completed a valid frame; read it with the accessors
+  // below before feeding the next byte.
+  bool feed(uint8_t byte);
+
+  RingFrameType type() const;
+  uint8_t address() const;
+  const RingProgram &program() const; // PROGRAM frames
+  uint32_t syncMs() const;            // SYNC frames
+  uint32_t badFrames() const;
+
+private:
+  uint8_t _buffer[RING_MAX_FRAME_BYTES];
+  int _length;   // Bytes of the current frame so far, 0 while waiting for a start
+  int _expected; // Its full length, once the header is in
+  RingProgram _program;
+  uint32_t _syncMs;
+  uint32_t _badFrames;
+};
+
+// A ring's estimate of the ProS3's millis(), from SYNC frames and its own
+// micros(). Each sync sets the clock, and the error it corrected also trims
+// the ring's rate, so the RC oscillator's percent-level error (and its
+// drift with temperature) shrinks to what a second's free-running adds
+// between syncs. A few lost syncs only let the error grow slowly.
+//
+// tools/ring_clock_sim runs one per simulated ring, against a drifting clock.
+class RingClock {
+public:
+  static const int32_t MAX_TRIM_PPM = 50000;   // Further off than this, the UART would not work anyway
+  static const int32_t STEP_LIMIT_US = 100000; // Larger corrections restart the estimate instead of trimming
+
+  RingClock();
+
+  // Call with a SYNC frame's time and micros() when its last byte arrived.
+  void onSync(uint32_t masterMs, uint32_t localUs);
+  // The ProS3's millis() at local time 'localUs'.
+  uint32_t masterMs(uint32_t localUs) const;
+
+  bool isSynced() const;
+  int32_t trimPpm() const;
+  int32_t lastErrorUs() const; // Correction made by the last sync
+
+private:
+  int64_t _elapsedUs(uint32_t localUs) const; // Since the last sync, trimmed
+
+  bool _synced;
+  bool _trimmed; // The rate has been measured at least once since the last restart
+  uint32_t _syncMs;
+  uint32_t _syncLocalUs;
+  int32_t _trimPpm;
+  int32_t _lastErrorUs;
+};
+
+#endif // RING_PROTOCOL_H
@@ -0,0 +1,310 @@
+// Common/ThumbCodec/ThumbCodec.cpp
+
+#include "ThumbCodec.h"
+#include <string.h>
+
+const int MAX_RUN = 128;   // Pixels per token
+const int MAX_BRIDGE = 2;  // Unchanged pixels sent as literals rather than ending a run
+const uint8_t NOT_SHOWN = 0xFF; // Differs from every level, so the pixel is resent
+
+// Approximate BT.601 luma of one big-endian RGB565 pixel, in integers only.
+static inline uint32_t luma(const uint8_t *pixel) {
+  uint32_t r = pixel[0] & 0xF8;
+  uint32_t g = ((pixel[0] & 0x07) << 5) | ((pixel[1] & 0xE0) >> 3);
+  uint32_t b = (pixel[1] & 0x1F) << 3;
+  return (77 * r + 150 * g + 29 * b) >> 8;
+}
+
+void thumbFromRgb565(const uint8_t *rgb565, int width, int height, uint8_t *pixels) {
+  int nearX[THUMB_SIZE], farX[THUMB_SIZE];
+  for (int i = 0; i < THUMB_SIZE; i++) {
+    int first = i * width / THUMB_SIZE;
+    int last = (i + 1) * width / THUMB_SIZE - 1;
+    nearX[i] = (first + (last - first) / 4) * 2;
+    farX[i] = (last - (last - first) / 4) * 2;
+  }
+  size_t stride = (size_t)width * 2;
+  uint8_t *out = pixels;
+  for (int gy = 0; gy < THUMB_SIZE; gy++) {
+    int first = gy * height / THUMB_SIZE;
+    int last = (gy + 1) * height / THUMB_SIZE - 1;
+    const uint8_t *top = rgb565 + (size_t)(first + (last - first) / 4) * stride;
+    const uint8_t *bottom = rgb565 + (size_t)(last - (last - first) / 4) * stride;
+    for (int gx = 0; gx < THUMB_SIZE; gx++) {
+      uint32_t sum = luma(top + nearX[gx]) + luma(top + farX[gx]) + luma(bottom + nearX[gx]) + luma(bottom + farX[gx]);
+      *out++ = (uint8_t)(sum >> 6); // Average of four, then 8 bits down to 4
+    }
+  }
+}
+
+// The frame pixels of the near and far sample points of every thumbnail
+// cell the window covers along one axis, and the range of those cells.
+// Returns false if it covers none.
+static bool windowSamples(int windowStart, int windowSize, int fieldSize, int framePixels, int *near, int *far,
+                          int &firstCell, int &lastCell) {
+  firstCell = (windowStart * THUMB_SIZE + fieldSize - 1) / fieldSize;
+  lastCell = (windowStart + windowSize) * THUMB_SIZE / fieldSize - 1;
+  if (firstCell < 0) firstCell = 0;
+  if (lastCell > THUMB_SIZE - 1) lastCell = THUMB_SIZE - 1;
+  for (int i = firstCell; i <= lastCell; i++) {
+    int first = i * fieldSize / THUMB_SIZE;
+    int last = (i + 1) * fieldSize / THUMB_SIZE - 1;
+    int nearPixel = (first + (last - first) / 4 - windowStart) * framePixels / windowSize;
+    int farPixel = (last - (last - first) / 4 - windowStart) * framePixels / windowSize;
+    near[i] = nearPixel < 0 ? 0 : nearPixel >= framePixels ? framePixels - 1 : nearPixel;
+    far[i] = farPixel < 0 ? 0 : farPixel >= framePixels ? framePixels - 1 : farPixel;
+  }
+  return firstCell <= lastCell;
+}
+
+void thumbFromRgb565Window(const uint8_t *rgb565, int width, int height, int windowX, int windowY, int windowSize,
+                           int fieldSize, uint8_t *pixels) {
+  if (windowSize <= 0 || fieldSize <= 0) return;
+  int nearX[THUMB_SIZE], farX[THUMB_SIZE], nearY[THUMB_SIZE], farY[THUMB_SIZE];
+  int firstX, lastX, firstY, lastY;
+  if (!windowSamples(windowX, windowSize, fieldSize, width, nearX, farX, firstX, lastX) ||
+      !windowSamples(windowY, windowSize, fieldSize, height, nearY, farY, firstY, lastY)) {
+    return;
+  }
+  size_t stride = (size_t)width * 2;
+  for (int gy = firstY; gy <= lastY; gy++) {
+    const uint8_t *top = rgb565 + (size_t)nearY[gy] * stride;
+    const uint8_t *bottom = rgb565 + (size_t)farY[gy] * stride;
+    uint8_t *out = pixels + gy * THUMB_SIZE;
+    for (int gx = firstX; gx <= lastX; gx++) {
+      uint32_t sum = luma(top + nearX[gx] * 2) + luma(top + farX[gx] * 2) + luma(bottom + nearX[gx] * 2) +
+                     luma(bottom + farX[gx] * 2);
+      out[gx] = (uint8_t)(sum >> 6);
+    }
+  }
+}
+
+ThumbEncoder::ThumbEncoder(int tolerance, int keyInterval) {
+  _tolerance = tolerance;
+  _keyInterval = keyInterval;
+  _seq = 0;
+  reset();
+}
+
+void ThumbEncoder::reset() {
+  _sinceKey = _keyInterval;
+  _next = 0;
+}
+
+int ThumbEncoder::encode(const uint8_t *pixels, uint8_t *out, int maxBytes, ThumbHeader &header) {
+  bool key = _sinceKey >= _keyInterval;
+  if (key) {
+    memset(_shown, NOT_SHOWN, sizeof(_shown));
+    _next = 0;
+    _sinceKey = 0;
+  }
+  header.flags = key ? THUMB_KEY : 0;
+  header.start = (uint16_t)_next;
+
+  auto at = [this](int walked) { return (_next + walked) % THUMB_PIXELS; };
+  auto changed = [&](int walked) {
+    int p = at(walked);
+    int difference = (int)pixels[p] - (int)_shown[p];
+    return difference > _tolerance || difference < -_tolerance;
+  };
+
+  int length = 0;
+  int walked = 0;
+  int skip = 0; // Unchanged pixels not yet written as skip tokens
+  bool full = false;
+  while (walked < THUMB_PIXELS && !full) {
+    if (!changed(walked)) {
+      skip++;
+      walked++;
+      continue;
+    }
+    // The skips, a run token and at least one byte of pixels must fit
+    int skipTokens = (skip + MAX_RUN - 1) / MAX_RUN;
+    if (length + skipTokens + 2 > maxBytes) break;
+    for (; skip > 0; skip -= MAX_RUN) {
+      out[length++] = (uint8_t)((skip < MAX_RUN ? skip : MAX_RUN) - 1);
+    }
+    skip = 0;
+
+    int token = length++;
+    int count = 0;
+    while (walked < THUMB_PIXELS && count < MAX_RUN) {
+      if (!changed(walked)) {
+        // Half a byte a pixel beats ending the run for a short gap
+        bool bridge = false;
+        for (int k = 1; k <= MAX_BRIDGE && walked + k < THUMB_PIXELS; k++) {
+          if (changed(walked + k)) {
+            bridge = true;
+            break;
+          }
+        }
+        if (!bridge) break;
+      }
+      int p = at(walked);
+      if (count % 2 == 0) {
+        if (length >= maxBytes) {
+          full = true;
+          break;
+        }
+        out[length++] = (uint8_t)(pixels[p] << 4);
+      } else {
+        out[length - 1] |= pixels[p];
+      }
+      _shown[p] = pixels[p];
+      count++;
+      walked++;
+    }
+    out[token] = (uint8_t)(0x80 | (count - 1));
+  }
+
+  if (length == 0 && !key) return 0; // Nothing changed: no message, no sequence number
+  header.seq = ++_seq;
+  _sinceKey++;
+  if (walked >= THUMB_PIXELS) {
+    header.flags |= THUMB_COMPLETE;
+  } else {
+    _next = at(walked);
+  }
+  return length;
+}
+
+ThumbDecoder::ThumbDecoder() {
+  memset(_pixels, 0, sizeof(_pixels));
+  _synced = false;
+  _lastSeq = 0;
+  _dirtyFirst = THUMB_SIZE;
+  _dirtyLast = -1;
+  _applied = 0;
+  _completed = 0;
+  _resyncs = 0;
+}
+
+bool ThumbDecoder::apply(const ThumbHeader &header, const uint8_t *data, int length) {
+  bool inOrder = header.seq == (uint16_t)(_lastSeq + 1);
+  _lastSeq = header.seq;
+  if (header.flags & THUMB_KEY) {
+    _synced = true;
+  } else if (!_synced) {
+    return false;
+  } else if (!inOrder) {
+    _synced = false;
+    _resyncs++;
+    return false;
+  }
+  if (header.start >= THUMB_PIXELS) {
+    _synced = false;
+    return false;
+  }
+
+  int walked = 0;
+  for (int i = 0; i < length;) {
+    uint8_t token = data[i++];
+    int count = (token & 0x7F) + 1;
+    if (walked + count > THUMB_PIXELS) {
+      _synced = false;
+      return false;
+    }
+    if (!(token & 0x80)) {
+      walked += count;
+      continue;
+    }
+    if (i + (count + 1) / 2 > length) {
+      _synced = false;
+      return false;
+    }
+    for (int k = 0; k < count; k++) {
+      uint8_t packed = data[i + k / 2];
+      _pixels[(header.start + walked) % THUMB_PIXELS] = k % 2 == 0 ? packed >> 4 : packed & 0x0F;
+      walked++;
+    }
+    i += (count + 1) / 2;
+    // A run wraps at most once, from the last row back to the first
+    int firstRow = (header.start + walked - count) % THUMB_PIXELS / THUMB_SIZE;
+    int lastRow = (header.start + walked - 1) % THUMB_PIXELS / THUMB_SIZE;
+    if (lastRow < firstRow) {
+      _dirtyFirst = 0;
+      _dirtyLast = THUMB_SIZE - 1;
+    } else {
+      if (firstRow < _dirtyFirst) _dirtyFirst = firstRow;
+      if (lastRow > _dirtyLast) _dirtyLast = lastRow;
+    }
+  }
+  _applied++;
+  if (header.flags & THUMB_COMPLETE) _completed++;
+  return true;
+}
+
+bool ThumbDecoder::takeDirtyRows(int &first, int &last) {
+  if (_dirtyLast < _dirtyFirst) return false;
+  first = _dirtyFirst;
+  last = _dirtyLast;
+  _dirtyFirst = THUMB_SIZE;
+  _dirtyLast = -1;
+  return true;
+}
+
+bool ThumbDecoder::isSynced() const {
+  return _synced;
+}
+
+const uint8_t *ThumbDecoder::pixels() const {
+  return _pixels;
+}
+
+uint32_t ThumbDecoder::applied() const {
+  return _applied;
+}
+
+uint32_t ThumbDecoder::completed() const {
+  return _completed;
+}
+
+uint32_t ThumbDecoder::resyncs() const {
+  return _resyncs;
+}
+
+static const char BASE64_ALPHABET[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+int thumbBase64Encode(const uint8_t *data, int length, char *out, int outSize) {
+  int needed = (length + 2) / 3 * 4;
+  if (needed + 1 > outSize) return -1;
+  char *p = out;
+  for (int i = 0; i < length; i += 3) {
+    uint32_t group = (uint32_t)data[i] << 16;
+    if (i + 1 < length) group |= (uint32_t)data[i + 1] << 8;
+    if (i + 2 < length) group |= data[i + 2];
+    *p++ = BASE64_ALPHABET[(group >> 18) & 0x3F];
+    *p++ = BASE64_ALPHABET[(group >> 12) & 0x3F];
+    *p++ = i + 1 < length ? BASE64_ALPHABET[(group >> 6) & 0x3F] : '=';
+    *p++ = i + 2 < length ? BASE64_ALPHABET[group & 0x3F] : '=';
+  }
+  *p = '\0';
+  return needed;
+}
+
+static int base64Value(char c) {
+  if (c >= 'A' && c <= 'Z') return c - 'A';
+  if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+  if (c >= '0' && c <= '9') return c - '0' + 52;
+  if (c == '+') return 62;
+  if (c == '/') return 63;
+  return -1;
+}
+
+int thumbBase64Decode(const char *text, uint8_t *out, int outSize) {
+  int length = 0;
+  uint32_t group = 0;
+  int bits = 0;
+  for (const char *p = text; *p && *p != '='; p++) {
+    int value = base64Value(*p);
+    if (value < 0) return -1;
+    group = (group << 6) | (uint32_t)value;
+    bits += 6;
+    if (bits >= 8) {
+      bits -= 8;
+      if (length >= outSize) return -1;
+      out[length++] = (uint8_t)(group >> bits);
+    }
+  }
+  return length;
+}
@@ -0,0 +1,111 @@
+// Common/ThumbCodec/ThumbCodec.h
+
+#ifndef THUMB_CODEC_H
+#define THUMB_CODEC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// The camera thumbnail the XIAO streams to the ProS3: THUMB_SIZE square,
+// 16 grey levels, sent as changes against what the ProS3 already shows.
+const int THUMB_SIZE = 48;
+const int THUMB_PIXELS = THUMB_SIZE * THUMB_SIZE;
+const int THUMB_LEVELS = 16;
+// Encoded bytes per message. Base64 makes it 512 characters, which leaves
+// room for the header inside LINK_MAX_LINE.
+const int THUMB_MAX_BYTES = 384;
+
+// Message flags
+const uint8_t THUMB_KEY = 0x01;      // Every pixel is resent from here on; a decoder out of sync rejoins
+const uint8_t THUMB_COMPLETE = 0x02; // The scan reached every pixel: a whole thumbnail is up to date
+
+// The encoded stream is a sequence of tokens, walking the pixels from the
+// message's start position in raster order (wrapping at the end):
+//   0x00-0x7F  n + 1 pixels unchanged
+//   0x80-0xFF  n + 1 new pixels follow, two per byte, high nibble first
+// Pixels not reached by the tokens are unchanged.
+struct ThumbHeader {
+  uint16_t seq = 0;
+  uint8_t flags = 0;
+  uint16_t start = 0; // First pixel the tokens describe
+};
+
+// Samples a big-endian RGB565 frame down to THUMB_SIZE square, one luma
+// level (0-15) per pixel, averaging four points in each cell.
+void thumbFromRgb565(const uint8_t *rgb565, int width, int height, uint8_t *pixels);
+// The same for a frame that only shows a square window of a fieldSize
+// square field of view (a sensor window, say): the thumbnail still covers the
+// whole field, and only the cells inside the window are sampled. The rest
+// keep what 'pixels' had, the last time the camera saw them.
+void thumbFromRgb565Window(const uint8_t *rgb565, int width, int height, int windowX, int windowY, int windowSize,
+                           int fieldSize, uint8_t *pixels);
+
+// Keeps a copy of what the decoder shows and sends only the pixels that
+// differ from it by more than 'tolerance' levels, so sensor noise costs
+// nothing. A message stops at its byte budget; the next one starts where it
+// stopped, so a busy scene is refreshed over several messages instead of
+// overrunning the link. Every keyInterval messages a key starts a full
+// refresh: every pixel is resent, over as many messages as that takes, which
+// also resynchronises a decoder after a lost line. The decoder keeps its
+// image meanwhile, so nothing goes black while the refresh catches up.
+//
+// tools/thumb_codec_test checks it against ThumbDecoder on the host.
+class ThumbEncoder {
+public:
+  ThumbEncoder(int tolerance = 1, int keyInterval = 40);
+
+  // Makes the next message a key.
+  void reset();
+  // Encodes the changes from 'pixels' (THUMB_PIXELS levels) into 'out'.
+  // Returns the bytes written, at most maxBytes.
+  int encode(const uint8_t *pixels, uint8_t *out, int maxBytes, ThumbHeader &header);
+
+private:
+  uint8_t _shown[THUMB_PIXELS];
+  int _tolerance;
+  int _keyInterval;
+  int _sinceKey;
+  int _next; // Where the next message starts
+  uint16_t _seq;
+};
+
+// Applies messages to its image. After a gap in the sequence numbers the
+// image can no longer be trusted, so messages are ignored until a key; the
+// key's refresh then overwrites the stale pixels as it goes.
+//
+// On the host, tools/thumb_codec_test checks it, and link_replay and
+// screen_bench decode with it.
+class ThumbDecoder {
+public:
+  ThumbDecoder();
+
+  // Returns false if the message was ignored (out of sync, or malformed).
+  bool apply(const ThumbHeader &header, const uint8_t *data, int length);
+  bool isSynced() const;
+  // THUMB_PIXELS levels, 0-15
+  const uint8_t *pixels() const;
+  // The rows changed since the last call, so a display only redraws those.
+  // Returns false if none did.
+  bool takeDirtyRows(int &first, int &last);
+
+  uint32_t applied() const;
+  uint32_t completed() const; // Messages that finished a whole thumbnail
+  uint32_t resyncs() const;   // Gaps that cost a wait for the next key
+
+private:
+  uint8_t _pixels[THUMB_PIXELS];
+  bool _synced;
+  uint16_t _lastSeq;
+  int _dirtyFirst; // THUMB_SIZE when nothing changed
+  int _dirtyLast;
+  uint32_t _applied;
+  uint32_t _completed;
+  uint32_t _resyncs;
+};
+
+// Base64, for carrying the encoded bytes in a JSON string. Both return the
+// length written, or -1 if 'out' is too small (or the input not base64).
+int thumbBase64Encode(const uint8_t *data, int length, char *out, int outSize);
+int thumbBase64Decode(const char *text, uint8_t *out, int outSize);
+
+#endif // THUMB_CODEC_H
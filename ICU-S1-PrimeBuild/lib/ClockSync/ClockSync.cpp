@@ -0,0 +1,134 @@
+// lib/ClockSync/ClockSync.cpp
+
+#include "ClockSync.h"
+
+// The drift fit needs the filtered points to span at least this long,
+// otherwise the noise in each point dominates the slope.
+const int64_t MIN_DRIFT_SPAN_US = 20000000; // 20 seconds
+
+// No real drift moves the offset this far, so a jump this big means the XIAO restarted.
+const int64_t RESTART_JUMP_US = 1000000;
+
+ClockSync::ClockSync() {
+  reset();
+}
+
+void ClockSync::reset() {
+  _windowCount = 0;
+  _windowNext = 0;
+  _trendCount = 0;
+  _trendNext = 0;
+  _best = {0, 0, 0};
+  _drift = 0;
+  _lastXiaoUs = 0;
+  _lastRttUs = 0;
+  _samples = 0;
+}
+
+void ClockSync::addSample(int64_t t1, uint32_t t2, uint32_t t3, int64_t t4) {
+  int64_t x2 = _unwrap(t2);
+  int64_t x3 = x2 + (int32_t)(t3 - t2);
+  int64_t offset = ((x2 - t1) + (x3 - t4)) / 2;
+
+  if (_samples > 0) {
+    int64_t expected = _best.offsetUs + (int64_t)(_drift * (double)(t1 - _best.localUs));
+    int64_t jump = offset - expected;
+    if (jump > RESTART_JUMP_US || jump < -RESTART_JUMP_US) {
+      reset();
+      x2 = t2;
+      x3 = x2 + (int32_t)(t3 - t2);
+      offset = ((x2 - t1) + (x3 - t4)) / 2;
+    }
+  }
+  _lastXiaoUs = x3;
+
+  int64_t rtt = (t4 - t1) - (x3 - x2);
+  if (rtt < 0) rtt = 0;
+
+  Point point;
+  point.localUs = (t1 + t4) / 2;
+  point.offsetUs = offset;
+  point.rttUs = (uint32_t)rtt;
+  _lastRttUs = point.rttUs;
+  _samples++;
+
+  _window[_windowNext] = point;
+  _windowNext = (_windowNext + 1) % WINDOW;
+  if (_windowCount < WINDOW) _windowCount++;
+
+  // Trust the quickest exchange in the window
+  _best = _window[0];
+  for (int i = 1; i < _windowCount; i++) {
+    if (_window[i].rttUs < _best.rttUs) _best = _window[i];
+  }
+
+  // Once per full window, its best point becomes one point of the drift fit
+  if (_samples % WINDOW == 0) {
+    _trend[_trendNext] = _best;
+    _trendNext = (_trendNext + 1) % TREND;
+    if (_trendCount < TREND) _trendCount++;
+    _fitDrift();
+  }
+}
+
+// Least-squares slope of offset against our time over the filtered points.
+void ClockSync::_fitDrift() {
+  if (_trendCount < 3) return;
+
+  int64_t first = _trend[0].localUs, last = _trend[0].localUs;
+  double meanT = 0, meanO = 0;
+  for (int i = 0; i < _trendCount; i++) {
+    if (_trend[i].localUs < first) first = _trend[i].localUs;
+    if (_trend[i].localUs > last) last = _trend[i].localUs;
+    meanT += (double)(_trend[i].localUs - _best.localUs);
+    meanO += (double)(_trend[i].offsetUs - _best.offsetUs);
+  }
+  if (last - first < MIN_DRIFT_SPAN_US) return;
+  meanT /= _trendCount;
+  meanO /= _trendCount;
+
+  double num = 0, den = 0;
+  for (int i = 0; i < _trendCount; i++) {
+    double dt = (double)(_trend[i].localUs - _best.localUs) - meanT;
+    double dOffset = (double)(_trend[i].offsetUs - _best.offsetUs) - meanO;
+    num += dt * dOffset;
+    den += dt * dt;
+  }
+  if (den > 0) _drift = num / den;
+}
+
+int64_t ClockSync::_unwrap(uint32_t xiaoUs) const {
+  if (_samples == 0 && _lastXiaoUs == 0) return xiaoUs;
+  return _lastXiaoUs + (int32_t)(xiaoUs - (uint32_t)_lastXiaoUs);
+}
+
+bool ClockSync::isSynced() const {
+  return _samples > 0;
+}
+
+int64_t ClockSync::xiaoToLocal(uint32_t xiaoUs) const {
+  int64_t xiao = _unwrap(xiaoUs);
+  int64_t local = xiao - _best.offsetUs;
+  int64_t offset = _best.offsetUs + (int64_t)(_drift * (double)(local - _best.localUs));
+  return xiao - offset;
+}
+
+int64_t ClockSync::offsetUs() const {
+  return _best.offsetUs;
+}
+
+double ClockSync::driftPpm() const {
+  return _drift * 1e6;
+}
+
+uint32_t ClockSync::lastRttUs() const {
+  return _lastRttUs;
+}
+
+uint32_t ClockSync::bestRttUs() const {
+  return _best.rttUs;
+}
+
+uint32_t ClockSync::sampleCount() const {
+  return _samples;
+}
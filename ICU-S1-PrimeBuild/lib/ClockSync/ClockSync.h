@@ -0,0 +1,67 @@
+// lib/ClockSync/ClockSync.h
+
+#ifndef CLOCK_SYNC_H
+#define CLOCK_SYNC_H
+
+#include <stdint.h>
+
+// Estimates how the XIAO's clock relates to ours from ping/pong exchanges.
+//
+// Each exchange gives four timestamps, NTP style:
+//   t1  we send the ping            (our clock)
+//   t2  the XIAO receives it         (XIAO clock, 32-bit micros)
+//   t3  the XIAO sends the pong      (XIAO clock, 32-bit micros)
+//   t4  we receive the pong          (our clock)
+// offset = ((t2 - t1) + (t3 - t4)) / 2 and round trip = (t4 - t1) - (t3 - t2).
+//
+// Exchanges that were delayed on the way (a busy loop on either side) have
+// a long round trip and a skewed offset, so only the fastest exchange of
+// each window is trusted. Those filtered points are fitted with a line to
+// follow the drift between the two crystals.
+class ClockSync {
+public:
+  ClockSync();
+
+  // Adds one exchange. An offset far from the current estimate means the
+  // XIAO restarted, and the estimate starts over from this exchange.
+  void addSample(int64_t t1, uint32_t t2, uint32_t t3, int64_t t4);
+  void reset();
+
+  bool isSynced() const;
+  // Converts a XIAO timestamp (within ~35 minutes of the last exchange) to our clock.
+  int64_t xiaoToLocal(uint32_t xiaoUs) const;
+
+  int64_t offsetUs() const;   // XIAO clock minus ours, at the best sample
+  double driftPpm() const;    // How much faster the XIAO's clock runs
+  uint32_t lastRttUs() const;
+  uint32_t bestRttUs() const; // Round trip of the sample currently trusted
+  uint32_t sampleCount() const;
+
+private:
+  struct Point {
+    int64_t localUs;  // Midpoint of the exchange, our clock
+    int64_t offsetUs;
+    uint32_t rttUs;
+  };
+
+  static const int WINDOW = 8; // Exchanges per filtering window
+  static const int TREND = 16; // Filtered points kept for the drift fit
+
+  int64_t _unwrap(uint32_t xiaoUs) const;
+  void _fitDrift();
+
+  Point _window[WINDOW];
+  int _windowCount;
+  int _windowNext;
+  Point _trend[TREND];
+  int _trendCount;
+  int _trendNext;
+
+  Point _best;
+  double _drift;         // Offset change per microsecond of our clock
+  int64_t _lastXiaoUs;   // Unwrapped XIAO time of the last exchange
+  uint32_t _lastRttUs;
+  uint32_t _samples;
+};
+
+#endif // CLOCK_SYNC_H
@@ -0,0 +1,71 @@
+// lib/FaceFollower/FaceFollower.cpp
+
+#include "FaceFollower.h"
+#include "PowerPolicy.h"
+
+const int FACE_CONFIRM_HITS = 3;         // Slots with a detection, out of...
+const int FACE_CONFIRM_WINDOW = 5;       // ...the last this many, to confirm a face
+const uint32_t FACE_SLOT_MS = 100;       // About one XIAO frame
+const uint32_t FACE_LOSS_TIMEOUT = 3000; // No detection for this long and the face is gone
+const uint32_t FACE_HOLD_KEEPALIVES = 2; // Keep-alive periods a face held back by the XIAO still counts as seen
+
+FaceFollower::FaceFollower() : _presence(FACE_CONFIRM_HITS, FACE_CONFIRM_WINDOW, FACE_SLOT_MS, FACE_LOSS_TIMEOUT) {
+  _faceHeld = false;
+  _faceHeldUntil = 0;
+  _lastFaceMs = 0;
+}
+
+void FaceFollower::start(uint32_t nowMs) {
+  _presence.reset();
+  _faceHeld = false;
+  _lastFaceMs = nowMs;
+}
+
+void FaceFollower::onDetection(uint32_t nowMs, uint32_t keepAliveMs) {
+  _presence.onDetection(nowMs);
+  _faceHeld = true;
+  _faceHeldUntil = nowMs + FACE_HOLD_KEEPALIVES * keepAliveMs;
+}
+
+void FaceFollower::onFaceLost() {
+  _faceHeld = false;
+}
+
+FaceEvent FaceFollower::update(SystemState state, bool linkUp, uint32_t nowMs) {
+  if (!linkUp) {
+    _presence.reset();
+    _faceHeld = false;
+    return state == SystemState::DETECTION ? FaceEvent::LINK_DOWN : FaceEvent::NONE;
+  }
+
+  if (_faceHeld && _presence.isPresent() && (int32_t)(nowMs - _faceHeldUntil) < 0) {
+    _presence.onDetection(nowMs);
+  } else {
+    _faceHeld = false;
+  }
+
+  switch (_presence.update(nowMs)) {
+    case PresenceEvent::CONFIRMED:
+      _lastFaceMs = nowMs;
+      // The XIAO keeps watching at a low frame rate while we nap
+      return state == SystemState::SCANNING || state == SystemState::NAPPING ? FaceEvent::CONFIRMED
+                                                                             : FaceEvent::NONE;
+    case PresenceEvent::LOST:
+      _lastFaceMs = nowMs;
+      return state == SystemState::DETECTION ? FaceEvent::LOST : FaceEvent::NONE;
+    default:
+      return shouldNap(state, _presence.isPresent(), nowMs, _lastFaceMs) ? FaceEvent::NAP : FaceEvent::NONE;
+  }
+}
+
+int FaceFollower::recentHits() const {
+  return _presence.recentHits();
+}
+
+uint32_t FaceFollower::lossTimeout() const {
+  return _presence.lossTimeout();
+}
+
+uint32_t FaceFollower::lastFaceMs() const {
+  return _lastFaceMs;
+}
@@ -0,0 +1,52 @@
+// lib/FaceFollower/FaceFollower.h
+
+#ifndef FACE_FOLLOWER_H
+#define FACE_FOLLOWER_H
+
+#include <stdint.h>
+#include "ProjectState.h"
+#include "PresenceTracker.h"
+
+// What production mode should do about faces on this loop pass.
+enum class FaceEvent {
+  NONE,
+  CONFIRMED, // SCANNING or NAPPING -> DETECTION, looking at the face
+  LOST,      // DETECTION -> SCANNING
+  LINK_DOWN, // DETECTION -> SCANNING: a silent link says nothing about the face
+  NAP        // SCANNING -> NAPPING, after NAP_AFTER with no face
+};
+
+// Production mode's decisions from the XIAO's detections to the system
+// state, for main.cpp to act on and tools/link_replay.cpp to print.
+//
+// PresenceTracker confirms and loses faces. Once a face is confirmed, the
+// XIAO only sends it again when it moves or a keep-alive is due, and says
+// when it is gone; until then it is still there, every slot. Before that,
+// only the detections that arrive count (the XIAO sends every frame of a
+// new face), so one false frame cannot confirm one.
+class FaceFollower {
+public:
+  FaceFollower();
+
+  // SCANNING begins: forget any face, and start the nap timer.
+  void start(uint32_t nowMs);
+  // A detection. 'keepAliveMs' is the XIAO's LINK_SET_EMIT_KEEP setting.
+  void onDetection(uint32_t nowMs, uint32_t keepAliveMs);
+  // The XIAO says the face is gone.
+  void onFaceLost();
+  // Call every loop, after the messages received so far. Returns what to do
+  // from 'state'.
+  FaceEvent update(SystemState state, bool linkUp, uint32_t nowMs);
+
+  int recentHits() const;
+  uint32_t lossTimeout() const;
+  uint32_t lastFaceMs() const; // When a face was last confirmed or lost, or start()
+
+private:
+  PresenceTracker _presence;
+  bool _faceHeld;
+  uint32_t _faceHeldUntil;
+  uint32_t _lastFaceMs;
+};
+
+#endif // FACE_FOLLOWER_H
@@ -0,0 +1,284 @@
+// lib/FlashLog/FlashLog.cpp
+
+#include "FlashLog.h"
+
+const char *const PARTITION_LABEL = "telemetry";
+const int WRITER_TASK_STACK_SIZE = 3072;
+const int WRITER_TASK_PRIORITY = 1;         // Below the loop: flash work fills idle time
+const unsigned long ERASE_RETRY_MS = 100;   // How often a writer waiting to erase looks again
+const unsigned long DUMP_WAIT_MS = 2000;    // Longest dump() waits for queued pages
+const uint32_t DUMP_CHUNK_BYTES = 256;
+
+FlashLog flashLog;
+
+FlashLog::FlashLog() {
+  _partition = nullptr;
+  _sectors = 0;
+  _bootCount = 0;
+  _sector = 0;
+  _slot = 0;
+  _sequence = 0;
+  _nextErased = false;
+  _fill = nullptr;
+  _fillStarted = 0;
+  _fullPages = nullptr;
+  _freePages = nullptr;
+  _eraseAllowed.store(true);
+  _pagesPending.store(0);
+  _recordsWritten.store(0);
+  _erases.store(0);
+  _writeErrors.store(0);
+  _dropped = 0;
+  _pendingDropped = 0;
+}
+
+bool FlashLog::begin() {
+  if (_partition) return true;
+  const esp_partition_t *partition =
+      esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, PARTITION_LABEL);
+  if (!partition) {
+    partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_DATA_SPIFFS, nullptr);
+  }
+  if (!partition) {
+    partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_DATA_FAT, nullptr);
+  }
+  if (!partition || partition->size < 2 * FLASH_LOG_SECTOR_BYTES) {
+    Serial.println("FlashLog: No data partition to log into.");
+    return false;
+  }
+  _partition = partition;
+  _sectors = partition->size / FLASH_LOG_SECTOR_BYTES;
+  _scan();
+
+  _fullPages = xQueueCreate(PAGE_BUFFERS, sizeof(Page *));
+  _freePages = xQueueCreate(PAGE_BUFFERS, sizeof(Page *));
+  for (int i = 0; i < PAGE_BUFFERS; i++) {
+    Page *page = &_pages[i];
+    page->count = 0;
+    xQueueSend(_freePages, &page, 0);
+  }
+  xTaskCreatePinnedToCore(_writerTask, "flashLog", WRITER_TASK_STACK_SIZE, this, WRITER_TASK_PRIORITY, nullptr, 0);
+  Serial.printf("FlashLog: Logging to '%s' (%lu sectors), boot %u.\n", partition->label, (unsigned long)_sectors,
+                (unsigned)_bootCount);
+  return true;
+}
+
+bool FlashLog::isReady() const {
+  return _partition != nullptr;
+}
+
+// Finds the newest sector and the first free slot in it. Slots after a
+// torn write are left alone: the record after it goes into the next
+// erased slot, and the decoder skips the one that fails its check.
+void FlashLog::_scan() {
+  bool found = false;
+  uint32_t newest = 0;
+  uint16_t lastBoot = 0;
+  for (uint32_t sector = 0; sector < _sectors; sector++) {
+    FlashLogSectorHeader header;
+    if (esp_partition_read(_partition, _sectorAddress(sector), &header, sizeof(header)) != ESP_OK) continue;
+    if (!flashLogHeaderValid(header)) continue;
+    if (!found || (int32_t)(header.sequence - _sequence) > 0) {
+      found = true;
+      newest = sector;
+      _sequence = header.sequence;
+      lastBoot = header.bootCount;
+    }
+  }
+
+  if (!found) {
+    // A new log: the first record starts sector 0
+    _sector = _sectors - 1;
+    _slot = FLASH_LOG_SLOTS;
+    _sequence = 0;
+    _bootCount = 1;
+    return;
+  }
+
+  _sector = newest;
+  _slot = FLASH_LOG_FIRST_RECORD_SLOT;
+  for (uint32_t slot = FLASH_LOG_FIRST_RECORD_SLOT; slot < FLASH_LOG_SLOTS; slot++) {
+    FlashLogRecord record;
+    esp_partition_read(_partition, _sectorAddress(newest) + slot * FLASH_LOG_SLOT_BYTES, &record, sizeof(record));
+    if (flashLogSlotErased(&record)) continue;
+    _slot = slot + 1;
+    if (record.check == flashLogCheck(record)) lastBoot = record.bootCount;
+  }
+  _bootCount = lastBoot + 1;
+  // What follows the newest sector is the oldest data, or a sector erased
+  // just before a reset; erase it again either way.
+  _nextErased = false;
+}
+
+void FlashLog::write(uint16_t formatId, uint8_t argCount, const uint32_t *args) {
+  if (!_partition) return;
+  if (!_fill) {
+    if (xQueueReceive(_freePages, &_fill, 0) != pdTRUE) {
+      _fill = nullptr;
+      _dropped++;
+      _pendingDropped++;
+      return;
+    }
+    _fillStarted = millis();
+  }
+
+  // Say how many went missing before the first record that made it
+  if (_pendingDropped > 0 && _fill->count < PAGE_RECORDS - 1) {
+    uint32_t dropped = _pendingDropped;
+    _pendingDropped = 0;
+    write(LOG_DROPPED, 1, &dropped);
+  }
+
+  FlashLogRecord &entry = _fill->records[_fill->count++];
+  entry.uptimeMs = millis();
+  entry.bootCount = _bootCount;
+  entry.record.timestampUs = (uint32_t)micros();
+  entry.record.formatId = formatId;
+  entry.record.argCount = argCount;
+  entry.record.reserved = 0;
+  for (int i = 0; i < LOG_MAX_ARGS; i++) {
+    entry.record.args[i] = i < argCount ? args[i] : 0;
+  }
+  entry.check = flashLogCheck(entry);
+
+  if (_fill->count == PAGE_RECORDS) flush();
+}
+
+void FlashLog::update() {
+  if (_fill && _fill->count > 0 && millis() - _fillStarted >= FLUSH_AFTER_MS) flush();
+}
+
+void FlashLog::flush() {
+  if (!_fill || _fill->count == 0) return;
+  _pagesPending.fetch_add(1);
+  xQueueSend(_fullPages, &_fill, 0); // Never full: it holds every page
+  _fill = nullptr;
+}
+
+void FlashLog::setEraseAllowed(bool allowed) {
+  _eraseAllowed.store(allowed);
+}
+
+bool FlashLog::isWriting() const {
+  return _pagesPending.load() > 0;
+}
+
+void FlashLog::_writerTask(void *arg) {
+  FlashLog *self = (FlashLog *)arg;
+  for (;;) {
+    Page *page;
+    if (xQueueReceive(self->_fullPages, &page, portMAX_DELAY) != pdTRUE) continue;
+    self->_writePage(*page);
+    page->count = 0;
+    xQueueSend(self->_freePages, &page, 0);
+    self->_pagesPending.fetch_sub(1);
+  }
+}
+
+void FlashLog::_writePage(const Page &page) {
+  int written = 0;
+  while (written < page.count) {
+    if (_slot >= FLASH_LOG_SLOTS) {
+      while (!_startNextSector()) {
+        vTaskDelay(pdMS_TO_TICKS(ERASE_RETRY_MS));
+      }
+    }
+    // Up to the end of the flash page: a write across the boundary is two
+    // program operations, and a reset between them tears both pages
+    uint32_t pageLeft = FLASH_LOG_PAGE_SLOTS - _slot % FLASH_LOG_PAGE_SLOTS;
+    uint32_t run = page.count - written;
+    if (run > pageLeft) run = pageLeft;
+    uint32_t address = _sectorAddress(_sector) + _slot * FLASH_LOG_SLOT_BYTES;
+    if (esp_partition_write(_partition, address, &page.records[written], run * FLASH_LOG_SLOT_BYTES) != ESP_OK) {
+      _writeErrors.fetch_add(1);
+    }
+    _slot += run;
+    written += run;
+    _recordsWritten.fetch_add(run);
+  }
+  // Erase one ahead, so moving to the next sector never waits for it
+  if (!_nextErased) _eraseNextSector();
+}
+
+bool FlashLog::_startNextSector() {
+  if (!_nextErased && !_eraseNextSector()) return false;
+  _sector = _nextSector(_sector);
+  _sequence++;
+  _slot = FLASH_LOG_FIRST_RECORD_SLOT;
+  _nextErased = false;
+
+  FlashLogSectorHeader header;
+  memset(&header, 0xFF, sizeof(header));
+  header.magic = FLASH_LOG_MAGIC;
+  header.sequence = _sequence;
+  header.version = FLASH_LOG_VERSION;
+  header.bootCount = _bootCount;
+  if (esp_partition_write(_partition, _sectorAddress(_sector), &header, sizeof(header)) != ESP_OK) {
+    _writeErrors.fetch_add(1);
+  }
+  return true;
+}
+
+bool FlashLog::_eraseNextSector() {
+  if (!_eraseAllowed.load()) return false;
+  if (esp_partition_erase_range(_partition, _sectorAddress(_nextSector(_sector)), FLASH_LOG_SECTOR_BYTES) != ESP_OK) {
+    _writeErrors.fetch_add(1);
+    return false;
+  }
+  _erases.fetch_add(1);
+  _nextErased = true;
+  return true;
+}
+
+uint32_t FlashLog::_sectorAddress(uint32_t sector) const {
+  return sector * FLASH_LOG_SECTOR_BYTES;
+}
+
+uint32_t FlashLog::_nextSector(uint32_t sector) const {
+  return sector + 1 < _sectors ? sector + 1 : 0;
+}
+
+void FlashLog::dumpStats(Print &out) {
+  if (!_partition) {
+    out.println("FLASHLOG no partition");
+    return;
+  }
+  out.printf("FLASHLOG partition=%s sectors=%lu boot=%u sector=%lu seq=%lu laps=%lu written=%lu dropped=%lu "
+             "erases=%lu errors=%lu pending=%lu\n",
+             _partition->label, (unsigned long)_sectors, (unsigned)_bootCount, (unsigned long)_sector,
+             (unsigned long)_sequence, (unsigned long)(_sequence / _sectors), (unsigned long)_recordsWritten.load(),
+             (unsigned long)_dropped, (unsigned long)_erases.load(), (unsigned long)_writeErrors.load(),
+             (unsigned long)_pagesPending.load());
+}
+
+void FlashLog::dump(Print &out) {
+  dumpStats(out);
+  if (!_partition) return;
+  flush();
+  unsigned long start = millis();
+  while (isWriting() && millis() - start < DUMP_WAIT_MS) {
+    delay(10);
+  }
+
+  // Oldest first: the ring runs on from the sector after the newest one
+  uint32_t inUse = 0;
+  for (uint32_t sector = 0; sector < _sectors; sector++) {
+    FlashLogSectorHeader header;
+    esp_partition_read(_partition, _sectorAddress(sector), &header, sizeof(header));
+    if (flashLogHeaderValid(header)) inUse++;
+  }
+  out.printf("%s %lu\n", FLASH_LOG_DUMP_BEGIN, (unsigned long)inUse);
+  uint32_t sector = _sector;
+  for (uint32_t i = 0; i < _sectors; i++) {
+    sector = _nextSector(sector);
+    FlashLogSectorHeader header;
+    esp_partition_read(_partition, _sectorAddress(sector), &header, sizeof(header));
+    if (!flashLogHeaderValid(header)) continue;
+    uint8_t chunk[DUMP_CHUNK_BYTES];
+    for (uint32_t offset = 0; offset < FLASH_LOG_SECTOR_BYTES; offset += DUMP_CHUNK_BYTES) {
+      esp_partition_read(_partition, _sectorAddress(sector) + offset, chunk, sizeof(chunk));
+      out.write(chunk, sizeof(chunk));
+    }
+  }
+  out.println(FLASH_LOG_DUMP_END);
+}
@@ -0,0 +1,111 @@
+// lib/FlashLog/FlashLog.h
+
+#ifndef FLASH_LOG_H
+#define FLASH_LOG_H
+
+#include <Arduino.h>
+#include <atomic>
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "esp_partition.h"
+#include "FlashLogFormat.h"
+
+// An append-only telemetry log in a raw flash partition that survives
+// reboots and power cuts, for deployments too long to watch over serial.
+//
+// log() takes the same format IDs and arguments as the DeferredLog and
+// only copies the record into a RAM page; full pages (one 256-byte flash
+// page each) go to a writer task, so the loop never waits on flash. If
+// every page is still waiting to be written, new records are dropped and
+// counted instead. A record a reset must not lose (a boot, a state change)
+// should be followed by flush(), rather than wait up to FLUSH_AFTER_MS in
+// RAM. The writer never lets one write cross a flash page boundary, so
+// after a part page the next one goes out in two writes.
+//
+// A flash write or erase pauses the instruction cache on both cores: about
+// a millisecond per page, and tens of milliseconds per sector erase, once
+// every FLASH_LOG_SLOTS - FLASH_LOG_FIRST_RECORD_SLOT records. setEraseAllowed() keeps erases away
+// from moments where a stall would show; pages still go out into the
+// sector already erased ahead of the writer.
+//
+// The log lives in the partition labelled "telemetry", or failing that the
+// one the partition table reserves for SPIFFS or FAT (nothing on the ProS3
+// mounts a filesystem). See FlashLogFormat.h for the layout.
+//
+// Only the loop task may call log(), flush() and dump().
+class FlashLog {
+public:
+  static const int PAGE_RECORDS = FLASH_LOG_PAGE_SLOTS; // One 256-byte flash page
+  static const int PAGE_BUFFERS = 4;
+  static const unsigned long FLUSH_AFTER_MS = 300000;   // A part-filled page is written after this long
+
+  FlashLog();
+  // Finds the partition and where the last boot stopped, and starts the
+  // writer. Returns false if there is no partition to log into.
+  bool begin();
+  bool isReady() const;
+
+  template <typename... Args>
+  void log(LogFormatId id, Args... args) {
+    static_assert(sizeof...(Args) <= LOG_MAX_ARGS, "Too many log arguments");
+    uint32_t raw[LOG_MAX_ARGS + 1] = {logArg(args)..., 0};
+    write((uint16_t)id, sizeof...(Args), raw);
+  }
+  void write(uint16_t formatId, uint8_t argCount, const uint32_t *args);
+
+  // Call every loop: writes out a part-filled page once it is FLUSH_AFTER_MS old.
+  void update();
+  // Hands the part-filled page to the writer now.
+  void flush();
+  void setEraseAllowed(bool allowed);
+  // True while pages are queued or being written; stay out of light sleep.
+  bool isWriting() const;
+
+  // Writes the statistics, then every sector in use, oldest first, framed
+  // for tools/tlog_decode. Blocks until the writer is done.
+  void dump(Print &out);
+  void dumpStats(Print &out);
+
+private:
+  struct Page {
+    uint8_t count;
+    FlashLogRecord records[PAGE_RECORDS];
+  };
+
+  static void _writerTask(void *arg);
+  void _scan();
+  void _writePage(const Page &page);
+  bool _startNextSector();
+  bool _eraseNextSector();
+  uint32_t _sectorAddress(uint32_t sector) const;
+  uint32_t _nextSector(uint32_t sector) const;
+
+  const esp_partition_t *_partition;
+  uint32_t _sectors;
+  uint16_t _bootCount;
+
+  // Writer task state
+  uint32_t _sector;       // Sector being filled
+  uint32_t _slot;         // Next free slot in it
+  uint32_t _sequence;     // Its sequence number
+  bool _nextErased;       // The sector after it is erased and ready
+
+  // Loop task state
+  Page _pages[PAGE_BUFFERS];
+  Page *_fill;            // Page being filled, if any
+  unsigned long _fillStarted;
+  QueueHandle_t _fullPages;
+  QueueHandle_t _freePages;
+
+  std::atomic<bool> _eraseAllowed;
+  std::atomic<uint32_t> _pagesPending; // Handed to the writer and not written yet
+  std::atomic<uint32_t> _recordsWritten;
+  std::atomic<uint32_t> _erases;
+  std::atomic<uint32_t> _writeErrors;
+  uint32_t _dropped;
+  uint32_t _pendingDropped; // Dropped since the last DROPPED record was logged
+};
+
+extern FlashLog flashLog;
+
+#endif // FLASH_LOG_H
@@ -0,0 +1,79 @@
+// lib/FlashLog/FlashLogFormat.h
+
+#ifndef FLASH_LOG_FORMAT_H
+#define FLASH_LOG_FORMAT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "LogRecord.h"
+
+// The on-flash layout of the telemetry log, shared by FlashLog and
+// tools/tlog_decode.cpp. Both ends are little-endian.
+//
+// The partition is a ring of 4 KB erase sectors, filled in order and
+// erased one ahead of the writer, so every sector is erased exactly once
+// per lap round the ring. Each sector is FLASH_LOG_SLOTS 32-byte slots.
+// The first 256-byte flash page is the header area: slot 0 holds the
+// sector header and the rest stay erased, so the records, from
+// FLASH_LOG_FIRST_RECORD_SLOT on, start on a flash page boundary and eight
+// of them fill one flash page exactly. The sector with the highest
+// sequence number is the newest; an erased record slot (all 0xFF) marks
+// where writing stopped.
+const uint32_t FLASH_LOG_SECTOR_BYTES = 4096;
+const uint32_t FLASH_LOG_PAGE_BYTES = 256; // What the flash programs in one go
+const uint32_t FLASH_LOG_SLOT_BYTES = 32;
+const uint32_t FLASH_LOG_SLOTS = FLASH_LOG_SECTOR_BYTES / FLASH_LOG_SLOT_BYTES;
+const uint32_t FLASH_LOG_PAGE_SLOTS = FLASH_LOG_PAGE_BYTES / FLASH_LOG_SLOT_BYTES;
+const uint32_t FLASH_LOG_FIRST_RECORD_SLOT = FLASH_LOG_PAGE_SLOTS; // After the header area
+const uint32_t FLASH_LOG_MAGIC = 0x474c5449; // "ITLG"
+const uint16_t FLASH_LOG_VERSION = 2;        // 1 had records straight after the header
+
+struct FlashLogSectorHeader {
+  uint32_t magic;
+  uint32_t sequence;  // Sectors started since the log was created
+  uint16_t version;
+  uint16_t bootCount; // The boot that started the sector
+  uint32_t reserved[5];
+};
+static_assert(sizeof(FlashLogSectorHeader) == FLASH_LOG_SLOT_BYTES, "The header fills slot 0");
+
+struct FlashLogRecord {
+  uint32_t uptimeMs;  // millis(); wraps after 49 days
+  uint16_t bootCount;
+  uint16_t check;     // flashLogCheck() of everything else, to spot torn writes
+  LogRecord record;   // Same format IDs and arguments as the DeferredLog
+};
+static_assert(sizeof(FlashLogRecord) == FLASH_LOG_SLOT_BYTES, "Records are one slot");
+
+// Fletcher-16 over the record with 'check' left out.
+inline uint16_t flashLogCheck(const FlashLogRecord &record) {
+  uint8_t bytes[sizeof(FlashLogRecord)];
+  memcpy(bytes, &record, sizeof(bytes));
+  uint32_t sum1 = 0, sum2 = 0;
+  for (size_t i = 0; i < sizeof(bytes); i++) {
+    if (i == offsetof(FlashLogRecord, check) || i == offsetof(FlashLogRecord, check) + 1) continue;
+    sum1 = (sum1 + bytes[i]) % 255;
+    sum2 = (sum2 + sum1) % 255;
+  }
+  return (uint16_t)((sum2 << 8) | sum1);
+}
+
+inline bool flashLogSlotErased(const void *slot) {
+  const uint8_t *bytes = (const uint8_t *)slot;
+  for (uint32_t i = 0; i < FLASH_LOG_SLOT_BYTES; i++) {
+    if (bytes[i] != 0xFF) return false;
+  }
+  return true;
+}
+
+inline bool flashLogHeaderValid(const FlashLogSectorHeader &header) {
+  return header.magic == FLASH_LOG_MAGIC && header.version == FLASH_LOG_VERSION;
+}
+
+// FlashLog::dump() frames the raw sectors, oldest first, between these lines:
+//   FLASHLOG BEGIN <sectors>\n  <sectors * 4096 bytes>  FLASHLOG END\n
+#define FLASH_LOG_DUMP_BEGIN "FLASHLOG BEGIN"
+#define FLASH_LOG_DUMP_END "FLASHLOG END"
+
+#endif // FLASH_LOG_FORMAT_H
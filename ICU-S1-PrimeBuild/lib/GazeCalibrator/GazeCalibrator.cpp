@@ -0,0 +1,102 @@
+// lib/GazeCalibrator/GazeCalibrator.cpp
+
+#include "GazeCalibrator.h"
+
+const unsigned long TARGET_PRINT_INTERVAL = 500; // ms between live target position prints
+
+GazeCalibrator::GazeCalibrator(ServoController& servos) : _servos(servos) {
+  _active = false;
+  _point = 0;
+  _pulseX = 0;
+  _pulseY = 0;
+  _lastTargetPrint = 0;
+}
+
+bool GazeCalibrator::isActive() const {
+  return _active;
+}
+
+void GazeCalibrator::start(Print& out) {
+  if (!_servos.isInitialized()) {
+    out.println("GAZE: Servos are not online yet.");
+    return;
+  }
+
+  // Start from the current calibration, so each point begins close to right.
+  memcpy(_points, _servos.getGazeCalibration(), sizeof(_points));
+  _servos.holdForCalibration(true); // Eyelids open, no scanning moves
+  _active = true;
+  _point = 0;
+  out.println("GAZE: Calibration started. a/d/A/D move X, w/s/W/S move Y, space records, b goes back, q quits.");
+  _showPoint(out);
+}
+
+void GazeCalibrator::_showPoint(Print& out) {
+  _pulseX = _points[_point].x;
+  _pulseY = _points[_point].y;
+  _servos.moveEyeTo(_pulseX, _pulseY);
+  out.printf("GAZE: Point %d/%d at image (%d, %d), pulses X=%d Y=%d\n", _point + 1, GAZE_CAL_POINTS,
+             GazeTable::calibrationCoordinate(_point % GAZE_CAL_GRID),
+             GazeTable::calibrationCoordinate(_point / GAZE_CAL_GRID), _pulseX, _pulseY);
+}
+
+void GazeCalibrator::handleKey(char key, Print& out) {
+  if (!_active) return;
+
+  switch (key) {
+    case 'a': _pulseX -= 1; break;
+    case 'd': _pulseX += 1; break;
+    case 'A': _pulseX -= 5; break;
+    case 'D': _pulseX += 5; break;
+    case 'w': _pulseY += 1; break;
+    case 's': _pulseY -= 1; break;
+    case 'W': _pulseY += 5; break;
+    case 'S': _pulseY -= 5; break;
+
+    case ' ':
+      _points[_point] = {(uint16_t)_pulseX, (uint16_t)_pulseY};
+      if (++_point == GAZE_CAL_POINTS) {
+        _finish(out);
+      } else {
+        _showPoint(out);
+      }
+      return;
+
+    case 'b':
+      if (_point > 0) _point--;
+      _showPoint(out);
+      return;
+
+    case 'q':
+      _active = false;
+      _servos.holdForCalibration(false);
+      out.println("GAZE: Calibration abandoned, the stored table is unchanged.");
+      return;
+
+    default:
+      return; // Newlines from the serial monitor and anything unknown
+  }
+
+  _servos.moveEyeTo(_pulseX, _pulseY);
+  out.printf("GAZE: X=%d Y=%d\n", _pulseX, _pulseY);
+}
+
+void GazeCalibrator::onDetection(const XiaoMessage& detection, Print& out) {
+  if (!_active || millis() - _lastTargetPrint < TARGET_PRINT_INTERVAL) return;
+  _lastTargetPrint = millis();
+  out.printf("GAZE: Target seen at (%d, %d), want (%d, %d)\n",
+             detection.x + detection.w / 2, detection.y + detection.h / 2,
+             GazeTable::calibrationCoordinate(_point % GAZE_CAL_GRID),
+             GazeTable::calibrationCoordinate(_point / GAZE_CAL_GRID));
+}
+
+void GazeCalibrator::_finish(Print& out) {
+  _active = false;
+  bool saved = _servos.saveGazeCalibration(_points);
+  out.println(saved ? "GAZE: Calibration saved to NVS." : "GAZE: Table updated, but saving to NVS failed.");
+
+  // Back to what the robot was doing, with a quick sanity check first: look
+  // at the centre of the image until the state moves the eye on.
+  _servos.holdForCalibration(false);
+  _servos.lookAt(GAZE_IMAGE_SIZE / 2, GAZE_IMAGE_SIZE / 2);
+}
@@ -0,0 +1,47 @@
+// lib/GazeCalibrator/GazeCalibrator.h
+
+#ifndef GAZE_CALIBRATOR_H
+#define GAZE_CALIBRATOR_H
+
+#include <Arduino.h>
+#include "GazeTable.h"
+#include "ServoController.h"
+#include "XiaoMessageParser.h"
+
+// Interactive gaze calibration over the serial monitor.
+//
+// It walks through the GAZE_CAL_GRID x GAZE_CAL_GRID image points. For each
+// one, put a face (or a photo of one) where the XIAO sees it at the
+// requested image position (the live detection is printed to help),
+// jog the eye with the keys until it looks straight at it, and record.
+// After the last point the gaze table is regenerated and saved to NVS.
+//
+//   a / d   X pulse -1 / +1      A / D   X pulse -5 / +5
+//   w / s   Y pulse +1 / -1      W / S   Y pulse +5 / -5
+//   space   record this point    b       go back one point
+//   q       quit without saving
+class GazeCalibrator {
+public:
+  explicit GazeCalibrator(ServoController& servos);
+
+  void start(Print& out);
+  bool isActive() const;
+
+  void handleKey(char key, Print& out);
+  // Detections from the XIAO, to show where the target currently is.
+  void onDetection(const XiaoMessage& detection, Print& out);
+
+private:
+  void _showPoint(Print& out);
+  void _finish(Print& out);
+
+  ServoController& _servos;
+  bool _active;
+  int _point;
+  int _pulseX;
+  int _pulseY;
+  GazePulse _points[GAZE_CAL_POINTS];
+  unsigned long _lastTargetPrint;
+};
+
+#endif // GAZE_CALIBRATOR_H
@@ -0,0 +1,137 @@
+// lib/GazeTable/GazeTable.cpp
+
+#include "GazeTable.h"
+
+// Catmull-Rom through p1 and p2, with p0 and p3 as the neighbours either side.
+static float catmullRom(float p0, float p1, float p2, float p3, float t) {
+  float t2 = t * t;
+  float t3 = t2 * t;
+  return 0.5f * ((2.0f * p1) + (p2 - p0) * t + (2.0f * p0 - 5.0f * p1 + 4.0f * p2 - p3) * t2 +
+                 (3.0f * p1 - p0 - 3.0f * p2 + p3) * t3);
+}
+
+// Samples one row or column of calibration values at 'position' (in grid
+// units). The points beyond each end are extrapolated linearly, so the
+// surface does not bend back at the edges of the image.
+static float sampleLine(const float* values, float position) {
+  int i = (int)position;
+  if (i > GAZE_CAL_GRID - 2) i = GAZE_CAL_GRID - 2;
+  float t = position - i;
+
+  float p1 = values[i];
+  float p2 = values[i + 1];
+  float p0 = i > 0 ? values[i - 1] : 2.0f * p1 - p2;
+  float p3 = i + 2 < GAZE_CAL_GRID ? values[i + 2] : 2.0f * p2 - p1;
+  return catmullRom(p0, p1, p2, p3, t);
+}
+
+static uint16_t clampPulse(float value, float low, float high) {
+  if (value < low) value = low;
+  if (value > high) value = high;
+  return (uint16_t)(value + 0.5f);
+}
+
+// Arduino's map(), in the same integer maths
+static int mapRange(int value, int fromLow, int fromHigh, int toLow, int toHigh) {
+  return (long)(value - fromLow) * (toHigh - toLow) / (fromHigh - fromLow) + toLow;
+}
+
+GazeTable::GazeTable() {
+  for (int i = 0; i < GAZE_LUT_NODES * GAZE_LUT_NODES; i++) {
+    _nodes[i] = {0, 0};
+  }
+}
+
+int GazeTable::calibrationCoordinate(int index) {
+  return index * GAZE_IMAGE_SIZE / (GAZE_CAL_GRID - 1);
+}
+
+void GazeTable::defaultCalibration(GazePulse* points) {
+  const int middle = (GAZE_CAL_GRID - 1) / 2;
+  for (int row = 0; row < GAZE_CAL_GRID; row++) {
+    for (int column = 0; column < GAZE_CAL_GRID; column++) {
+      int x = column <= middle ? mapRange(column, 0, middle, PULSE_EYE_X_LEFT, PULSE_EYE_X_MIDDLE)
+                               : mapRange(column, middle, GAZE_CAL_GRID - 1, PULSE_EYE_X_MIDDLE, PULSE_EYE_X_RIGHT);
+      int y = row <= middle ? mapRange(row, 0, middle, PULSE_EYE_Y_UP, PULSE_EYE_Y_MIDDLE)
+                            : mapRange(row, middle, GAZE_CAL_GRID - 1, PULSE_EYE_Y_MIDDLE, PULSE_EYE_Y_DOWN);
+      points[row * GAZE_CAL_GRID + column] = {(uint16_t)x, (uint16_t)y};
+    }
+  }
+}
+
+void GazeTable::generate(const GazePulse* points) {
+  // Never go past the pulses that were actually calibrated: an overshooting
+  // spline at the edge would drive the linkage into its end stops.
+  float lowX = points[0].x, highX = points[0].x, lowY = points[0].y, highY = points[0].y;
+  for (int i = 1; i < GAZE_CAL_POINTS; i++) {
+    if (points[i].x < lowX) lowX = points[i].x;
+    if (points[i].x > highX) highX = points[i].x;
+    if (points[i].y < lowY) lowY = points[i].y;
+    if (points[i].y > highY) highY = points[i].y;
+  }
+
+  const float scale = (float)(GAZE_CAL_GRID - 1) / GAZE_LUT_CELLS;
+  for (int row = 0; row < GAZE_LUT_NODES; row++) {
+    float gridRow = row * scale;
+
+    // Interpolate every calibration column down to this row first...
+    float columnX[GAZE_CAL_GRID], columnY[GAZE_CAL_GRID];
+    for (int column = 0; column < GAZE_CAL_GRID; column++) {
+      float valuesX[GAZE_CAL_GRID], valuesY[GAZE_CAL_GRID];
+      for (int r = 0; r < GAZE_CAL_GRID; r++) {
+        valuesX[r] = points[r * GAZE_CAL_GRID + column].x;
+        valuesY[r] = points[r * GAZE_CAL_GRID + column].y;
+      }
+      columnX[column] = sampleLine(valuesX, gridRow);
+      columnY[column] = sampleLine(valuesY, gridRow);
+    }
+
+    // ...then along the row.
+    for (int column = 0; column < GAZE_LUT_NODES; column++) {
+      float gridColumn = column * scale;
+      GazePulse& node = _nodes[row * GAZE_LUT_NODES + column];
+      node.x = clampPulse(sampleLine(columnX, gridColumn), lowX, highX);
+      node.y = clampPulse(sampleLine(columnY, gridColumn), lowY, highY);
+    }
+  }
+}
+
+GazePulse GazeTable::lookup(int imageX, int imageY) const {
+  if (imageX < 0) imageX = 0;
+  if (imageX > GAZE_IMAGE_SIZE) imageX = GAZE_IMAGE_SIZE;
+  if (imageY < 0) imageY = 0;
+  if (imageY > GAZE_IMAGE_SIZE) imageY = GAZE_IMAGE_SIZE;
+
+  // Table position in 8.8 fixed point
+  uint32_t u = (uint32_t)imageX * (GAZE_LUT_CELLS << 8) / GAZE_IMAGE_SIZE;
+  uint32_t v = (uint32_t)imageY * (GAZE_LUT_CELLS << 8) / GAZE_IMAGE_SIZE;
+  uint32_t column = u >> 8;
+  uint32_t row = v >> 8;
+  if (column >= GAZE_LUT_CELLS) column = GAZE_LUT_CELLS - 1;
+  if (row >= GAZE_LUT_CELLS) row = GAZE_LUT_CELLS - 1;
+  uint32_t fu = u - (column << 8);
+  uint32_t fv = v - (row << 8);
+
+  const GazePulse& a = _nodes[row * GAZE_LUT_NODES + column];
+  const GazePulse& b = _nodes[row * GAZE_LUT_NODES + column + 1];
+  const GazePulse& c = _nodes[(row + 1) * GAZE_LUT_NODES + column];
+  const GazePulse& d = _nodes[(row + 1) * GAZE_LUT_NODES + column + 1];
+
+  uint32_t topX = a.x * (256 - fu) + b.x * fu;
+  uint32_t bottomX = c.x * (256 - fu) + d.x * fu;
+  uint32_t topY = a.y * (256 - fu) + b.y * fu;
+  uint32_t bottomY = c.y * (256 - fu) + d.y * fu;
+
+  GazePulse pulse;
+  pulse.x = (uint16_t)((topX * (256 - fv) + bottomX * fv + 32768) >> 16);
+  pulse.y = (uint16_t)((topY * (256 - fv) + bottomY * fv + 32768) >> 16);
+  return pulse;
+}
+
+const GazePulse* GazeTable::nodes() const {
+  return _nodes;
+}
+
+GazePulse* GazeTable::nodes() {
+  return _nodes;
+}
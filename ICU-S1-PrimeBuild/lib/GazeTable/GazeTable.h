@@ -0,0 +1,63 @@
+// lib/GazeTable/GazeTable.h
+
+#ifndef GAZE_TABLE_H
+#define GAZE_TABLE_H
+
+#include <stdint.h>
+
+// Image space is the XIAO's full-field box coordinate system, 240x240.
+const int GAZE_IMAGE_SIZE = 240;
+// Calibration records the servo pulses that aim the eye at a 5x5 grid of
+// evenly spaced image points, corners included.
+const int GAZE_CAL_GRID = 5;
+const int GAZE_CAL_POINTS = GAZE_CAL_GRID * GAZE_CAL_GRID;
+// The lookup table has 17x17 nodes, one every 15 image pixels.
+const int GAZE_LUT_CELLS = 16;
+const int GAZE_LUT_NODES = GAZE_LUT_CELLS + 1;
+
+struct GazePulse {
+  uint16_t x;
+  uint16_t y;
+};
+
+// Hand-tuned eye servo pulses at the middle and the ends of its travel.
+const int PULSE_EYE_X_MIDDLE = 370;
+const int PULSE_EYE_X_LEFT   = 420;
+const int PULSE_EYE_X_RIGHT  = 350;
+const int PULSE_EYE_Y_MIDDLE = 370;
+const int PULSE_EYE_Y_UP     = 383;
+const int PULSE_EYE_Y_DOWN   = 315;
+
+// Turns an image position into eye servo pulses.
+//
+// generate() fits a Catmull-Rom surface through the calibration points,
+// which follows the bend of the eye linkage rather than just joining the
+// points with straight lines, and samples it into the dense table.
+// lookup() is then a bilinear blend of four table nodes in integer maths:
+// constant time, no floats on the hot path.
+//
+// tools/gaze_table_test checks it on the host, and scan_sim, link_replay and
+// screen_bench aim with it.
+class GazeTable {
+public:
+  GazeTable();
+
+  // 'points' holds GAZE_CAL_POINTS pulses, row by row from the top left.
+  void generate(const GazePulse* points);
+  GazePulse lookup(int imageX, int imageY) const;
+
+  // Image coordinate of calibration grid column/row 'index'
+  static int calibrationCoordinate(int index);
+  // The calibration to use until the eye is calibrated: the hand-tuned
+  // limits spread over the image, left edge to PULSE_EYE_X_LEFT, top to
+  // PULSE_EYE_Y_UP, through the middle pulses.
+  static void defaultCalibration(GazePulse* points);
+
+  const GazePulse* nodes() const; // GAZE_LUT_NODES * GAZE_LUT_NODES, row by row
+  GazePulse* nodes();
+
+private:
+  GazePulse _nodes[GAZE_LUT_NODES * GAZE_LUT_NODES];
+};
+
+#endif // GAZE_TABLE_H
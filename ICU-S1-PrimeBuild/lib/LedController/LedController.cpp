@@ -1,28 +1,53 @@
 #include "LedController.h"
 #include <Arduino.h>
+#include "LoopProfiler.h"
+#include "HeapGuard.h"
+#include "DeferredLog.h"
 
 // =================================================================
 // == LED RING CONFIGURATION                                     ==
 // =================================================================
-const int SIGNAL_PIN = 6;
-
-// Command Definitions that MUST match the ATTiny85 sketch
-#define CMD_WAKE_UP 1
-#define CMD_SCANNING 2
-#define CMD_DETECTION 3
-#define CMD_NAPPING 4
-#define CMD_FULL_ASLEEP 5
-#define CMD_ERROR 6
-
-int currentLEDCommand = -1;
-// Pulse Timing Configuration
-const int PULSE_WIDTH_MS = 20;
-const int PULSE_SPACING_MS = 50;
+// A UART of its own drives the signal line, TX only
+const int RING_UART = 2;
+const int RING_TX_BUFFER_SIZE = 256; // Every ring's program and a sync, with room to spare
+// A ring that browned out or missed its program gets it again: one ring
+// every this often, so the line stays nearly idle.
+const unsigned long PROGRAM_REFRESH_INTERVAL = 10000;
+
+// What each ring shows in each state, in SystemState order. Rings 85/256
+// of a period apart chase each other round the robot; equal phases move
+// together.
+const RingProgram STATE_PROGRAMS[][RING_COUNT] = {
+  // WAKE_UP: white, spinning up in turn
+  {{RING_SPIN, 255, 255, 255, 1500, 0}, {RING_SPIN, 255, 255, 255, 1500, 85}, {RING_SPIN, 255, 255, 255, 1500, 170}},
+  // SCANNING: cyan sweep, chasing
+  {{RING_SPIN, 0, 180, 255, 2000, 0}, {RING_SPIN, 0, 180, 255, 2000, 85}, {RING_SPIN, 0, 180, 255, 2000, 170}},
+  // DETECTION: red, all three blinking together
+  {{RING_BLINK, 255, 0, 0, 400, 0}, {RING_BLINK, 255, 0, 0, 400, 0}, {RING_BLINK, 255, 0, 0, 400, 0}},
+  // NAPPING: slow dim blue breathing, together
+  {{RING_BREATHE, 0, 0, 80, 4000, 0}, {RING_BREATHE, 0, 0, 80, 4000, 0}, {RING_BREATHE, 0, 0, 80, 4000, 0}},
+  // FULL_ASLEEP: dark
+  {{RING_OFF, 0, 0, 0, 1000, 0}, {RING_OFF, 0, 0, 0, 1000, 0}, {RING_OFF, 0, 0, 0, 1000, 0}},
+  // ERROR: red, the middle ring alternating with the outer two
+  {{RING_BLINK, 255, 0, 0, 1000, 0}, {RING_BLINK, 255, 0, 0, 1000, 128}, {RING_BLINK, 255, 0, 0, 1000, 0}},
+};
+const int STATE_PROGRAM_COUNT = sizeof(STATE_PROGRAMS) / sizeof(STATE_PROGRAMS[0]);
+
+#if ICU_LED_RINGS
+HardwareSerial ringSerial(RING_UART);
+#endif
 // =================================================================
 
 LedController::LedController()
 {
   _isInitialized = false;
+  _state = SystemState::WAKE_UP;
+  _hasState = false;
+  _lastSync = 0;
+  _syncsSent = 0;
+  _lastRefresh = 0;
+  _nextRefresh = 0;
+  _lineBusyUntil = 0;
 }
 
 bool LedController::isInitialized()
@@ -30,102 +55,112 @@ bool LedController::isInitialized()
   return _isInitialized;
 }
 
+void LedController::_send(const uint8_t* frame, int length)
+{
+  uint32_t now = micros();
+  // Frames queue behind whatever is still going out
+  uint32_t start = (int32_t)(_lineBusyUntil - now) > 0 ? _lineBusyUntil : now;
+  _lineBusyUntil = start + length * RING_BYTE_US;
+#if ICU_LED_RINGS
+  ringSerial.write(frame, length);
+#endif
+}
 
-
-// The simple, proven, blocking pulse sender from your original test sketch.
-void LedController::_sendCommand(int commandNum)
+void LedController::_sendProgram(uint8_t ring)
 {
+  uint8_t frame[RING_MAX_FRAME_BYTES];
+  _send(frame, ringEncodeProgram(ring, _programs[ring], frame));
+}
 
-  return;
-  
-  // --- START OF CRITICAL SECTION ---
-  // Disable all interrupts to guarantee precise timing for the pulse train.
-  noInterrupts();
+bool LedController::begin()
+{
+#if ICU_LED_RINGS
+  Serial.printf("LedController: Driving the rings on GPIO %d.\n", ICU_LED_SIGNAL_PIN);
+  ringSerial.setTxBufferSize(RING_TX_BUFFER_SIZE);
+  ringSerial.begin(RING_BAUD, SERIAL_8N1, -1, ICU_LED_SIGNAL_PIN);
+#else
+  Serial.println("LedController: Ring line disabled (build with -D ICU_LED_RINGS=1).");
+#endif
+  _syncsSent = 0;
+  _lastSync = millis() - RING_SYNC_INTERVAL_MS; // First sync on the next update()
+  _lastRefresh = millis();
+  _isInitialized = true;
+  return true;
+}
 
-  for (int i = 0; i < commandNum; i++)
+void LedController::setProgram(uint8_t ring, const RingProgram& program)
+{
+  if (ring == RING_BROADCAST)
   {
-    digitalWrite(SIGNAL_PIN, LOW);
-    delay(PULSE_WIDTH_MS);
-    digitalWrite(SIGNAL_PIN, HIGH);
-    if (i < commandNum - 1)
-    {
-      delay(PULSE_SPACING_MS);
-    }
+    for (uint8_t i = 0; i < RING_COUNT; i++)
+      setProgram(i, program);
+    return;
   }
+  if (ring >= RING_COUNT || _programs[ring] == program)
+    return;
 
-  // --- END OF CRITICAL SECTION ---
-  // Re-enable interrupts so the rest of the system can function normally.
-  interrupts();
+  _programs[ring] = program;
+  deferredLog.log(LOG_LED_PROGRAM, ring, program.pattern, program.periodMs, program.phase);
+  if (_isInitialized)
+    _sendProgram(ring);
 }
 
-bool LedController::begin()
+const RingProgram& LedController::program(uint8_t ring) const
 {
-  Serial.println("LedController: Initializing GPIO 6.");
-  pinMode(SIGNAL_PIN, OUTPUT);
-  digitalWrite(SIGNAL_PIN, HIGH); // Set to idle state
-  _isInitialized = true;
-  return true;
+  return _programs[ring < RING_COUNT ? ring : 0];
 }
 
 void LedController::setState(SystemState newState)
 {
+  PROFILE_SCOPE(ProfileSite::LED_SET_STATE);
+  HEAP_SCOPE(HeapSubsystem::LED);
   if (!_isInitialized)
     return;
 
-  Serial.print("LedController: Received new state request -> ");
-  Serial.println((int)newState);
-
-  int commandNum = 0;
+  deferredLog.log(LOG_LED_NEW_STATE, (int)newState);
 
-  // --- THIS IS THE CRITICAL, EXPLICIT MAPPING ---
-  // It translates the 0-indexed SystemState enum to the 1-indexed command protocol.
-  switch (newState)
+  if (_hasState && _state == newState)
   {
-  case SystemState::WAKE_UP:
-    commandNum = CMD_WAKE_UP;
-    break; // 0 -> 1
-  case SystemState::SCANNING:
-    commandNum = CMD_SCANNING;
-    break; // 1 -> 2
-  case SystemState::DETECTION:
-    commandNum = CMD_DETECTION;
-    break; // 2 -> 3
-  case SystemState::NAPPING:
-    commandNum = CMD_NAPPING;
-    break; // 3 -> 4
-  case SystemState::FULL_ASLEEP:
-    commandNum = CMD_FULL_ASLEEP;
-    break; // 4 -> 5
-  case SystemState::ERROR:
-    commandNum = CMD_ERROR;
-    break; // 5 -> 6
-  }
-
-  if (currentLEDCommand == commandNum)
-  {
-    Serial.print("Current LED Command: ");
-    Serial.print(currentLEDCommand);
-    Serial.println(" and current commandNum ");
-    Serial.print(commandNum);
-
+    deferredLog.log(LOG_LED_ALREADY_ACTIVE, (int)newState);
     return;
   }
+  _state = newState;
+  _hasState = true;
 
-  currentLEDCommand = commandNum;
-
-  if (commandNum > 0)
-  {
-    Serial.print("LedController: Mapping to command number ");
-    Serial.print(commandNum);
-    Serial.println(" and sending pulses...");
-    _sendCommand(commandNum);
-    Serial.println("LedController: Command sent.");
-  }
+  int index = (int)newState;
+  if (index < 0 || index >= STATE_PROGRAM_COUNT)
+    return;
+  for (uint8_t ring = 0; ring < RING_COUNT; ring++)
+    setProgram(ring, STATE_PROGRAMS[index][ring]);
 }
 
-// update() is not needed for this simple controller, but is kept for consistency.
+// Keeps the rings' clocks on ours. A sync is only written to an idle line,
+// so the time it carries goes out straight away instead of waiting behind a
+// program.
 void LedController::update()
 {
+  PROFILE_SCOPE(ProfileSite::LED_UPDATE);
+  HEAP_SCOPE(HeapSubsystem::LED);
   if (!_isInitialized)
     return;
+
+  unsigned long now = millis();
+  unsigned long interval = _syncsSent < RING_STARTUP_SYNCS ? RING_STARTUP_SYNC_INTERVAL_MS : RING_SYNC_INTERVAL_MS;
+  if (now - _lastSync >= interval && (int32_t)(_lineBusyUntil - micros()) <= 0)
+  {
+    uint8_t frame[RING_MAX_FRAME_BYTES];
+    uint32_t masterMs = millis();
+    _send(frame, ringEncodeSync(masterMs, frame));
+    _lastSync = now;
+    if (_syncsSent < RING_STARTUP_SYNCS)
+      _syncsSent++;
+    return;
+  }
+
+  if (_hasState && now - _lastRefresh >= PROGRAM_REFRESH_INTERVAL)
+  {
+    _sendProgram(_nextRefresh);
+    _nextRefresh = (_nextRefresh + 1) % RING_COUNT;
+    _lastRefresh = now;
+  }
 }
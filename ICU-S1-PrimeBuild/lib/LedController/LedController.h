@@ -2,7 +2,22 @@
 #define LED_CONTROLLER_H
 
 #include <ProjectState.h>
+#include "RingProtocol.h"
 
+// Set to 1 once the rings' signal line has a pin of its own. GPIO 6 is also
+// the XIAO link's RX, so until then nothing is sent (as with the old pulse
+// sender) and the controller only keeps track of what the rings should show.
+#ifndef ICU_LED_RINGS
+#define ICU_LED_RINGS 0
+#endif
+#ifndef ICU_LED_SIGNAL_PIN
+#define ICU_LED_SIGNAL_PIN 6
+#endif
+
+// Drives the three LED rings over the shared signal line (see
+// Common/RingProtocol). Each state sets a program per ring, which is only
+// sent when it changes; update() then sends nothing but a sync a second,
+// and the rings animate in phase on their own.
 class LedController {
 public:
   LedController();
@@ -11,11 +26,25 @@ public:
   void setState(SystemState newState);
   bool isInitialized();
 
+  // Gives one ring (0 to RING_COUNT - 1), or every ring (RING_BROADCAST), a
+  // new program. Rings already running it are not sent it again.
+  void setProgram(uint8_t ring, const RingProgram& program);
+  const RingProgram& program(uint8_t ring) const;
+
 private:
-  // This is the simple, blocking pulse sender. It is safe because of our startup sequence.
-  void _sendCommand(int commandNum);
-  
+  // Queues a frame; the UART sends it while the loop carries on.
+  void _send(const uint8_t* frame, int length);
+  void _sendProgram(uint8_t ring);
+
   bool _isInitialized;
+  SystemState _state;
+  bool _hasState;
+  RingProgram _programs[RING_COUNT];
+  unsigned long _lastSync;
+  int _syncsSent;
+  unsigned long _lastRefresh;
+  uint8_t _nextRefresh;    // Ring whose program is resent next
+  uint32_t _lineBusyUntil; // micros() when the queued frames are all on the line
 };
 
-#endif // LED_CONTROLLER_H
\ No newline at end of file
+#endif // LED_CONTROLLER_H
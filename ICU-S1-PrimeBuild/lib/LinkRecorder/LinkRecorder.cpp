@@ -0,0 +1,121 @@
+// lib/LinkRecorder/LinkRecorder.cpp
+
+#include "LinkRecorder.h"
+
+LinkRecorder::LinkRecorder() {
+  _buffer = nullptr;
+  _capacity = 0;
+  _recording = false;
+  clear();
+}
+
+bool LinkRecorder::begin(size_t capacityBytes) {
+  if (_buffer) return true;
+  _buffer = (uint8_t *)ps_malloc(capacityBytes);
+  if (!_buffer) {
+    // No PSRAM: fall back to a small internal RAM buffer.
+    capacityBytes = 16 * 1024;
+    _buffer = (uint8_t *)malloc(capacityBytes);
+  }
+  if (!_buffer) {
+    Serial.println("LinkRecorder: Could not allocate capture buffer.");
+    return false;
+  }
+  _capacity = capacityBytes;
+  clear();
+  return true;
+}
+
+void LinkRecorder::start() {
+  if (_buffer) _recording = true;
+}
+
+void LinkRecorder::stop() {
+  _recording = false;
+}
+
+bool LinkRecorder::isRecording() const {
+  return _recording;
+}
+
+void LinkRecorder::clear() {
+  _head = 0;
+  _tail = 0;
+  _used = 0;
+  _chunks = 0;
+  _overwritten = 0;
+}
+
+void LinkRecorder::record(uint32_t timestampUs, const uint8_t *data, size_t length) {
+  if (!_recording || length == 0) return;
+  if (length > 0xFFFF) length = 0xFFFF;
+  size_t needed = CHUNK_HEADER_SIZE + length;
+  if (needed > _capacity) return;
+
+  while (_capacity - _used < needed) {
+    _dropOldest();
+  }
+
+  uint8_t header[CHUNK_HEADER_SIZE];
+  memcpy(header, &timestampUs, 4);
+  uint16_t length16 = (uint16_t)length;
+  memcpy(header + 4, &length16, 2);
+  _put(_head, header, CHUNK_HEADER_SIZE);
+  _put((_head + CHUNK_HEADER_SIZE) % _capacity, data, length);
+
+  _head = (_head + needed) % _capacity;
+  _used += needed;
+  _chunks++;
+}
+
+void LinkRecorder::dump(Print &out) {
+  out.printf("# LinkRecorder: %lu chunks, %lu bytes, %lu overwritten\n",
+             (unsigned long)_chunks, (unsigned long)_used, (unsigned long)_overwritten);
+
+  size_t offset = _tail;
+  for (uint32_t i = 0; i < _chunks; i++) {
+    uint8_t header[CHUNK_HEADER_SIZE];
+    _get(offset, header, CHUNK_HEADER_SIZE);
+    uint32_t timestampUs;
+    uint16_t length;
+    memcpy(&timestampUs, header, 4);
+    memcpy(&length, header + 4, 2);
+
+    out.printf("@%lu ", (unsigned long)timestampUs);
+    for (uint16_t j = 0; j < length; j++) {
+      uint8_t c = _buffer[(offset + CHUNK_HEADER_SIZE + j) % _capacity];
+      if (c == '\n') out.print("\\n");
+      else if (c == '\r') out.print("\\r");
+      else if (c == '\\') out.print("\\\\");
+      else if (c < 0x20 || c > 0x7E) out.printf("\\x%02X", c);
+      else out.write(c);
+    }
+    out.println();
+    offset = (offset + CHUNK_HEADER_SIZE + length) % _capacity;
+  }
+  out.println("# end");
+}
+
+void LinkRecorder::_put(size_t offset, const uint8_t *data, size_t length) {
+  size_t first = min(length, _capacity - offset);
+  memcpy(_buffer + offset, data, first);
+  memcpy(_buffer, data + first, length - first);
+}
+
+void LinkRecorder::_get(size_t offset, uint8_t *data, size_t length) const {
+  size_t first = min(length, _capacity - offset);
+  memcpy(data, _buffer + offset, first);
+  memcpy(data + first, _buffer, length - first);
+}
+
+void LinkRecorder::_dropOldest() {
+  uint8_t header[CHUNK_HEADER_SIZE];
+  _get(_tail, header, CHUNK_HEADER_SIZE);
+  uint16_t length;
+  memcpy(&length, header + 4, 2);
+  size_t chunkSize = CHUNK_HEADER_SIZE + length;
+  _tail = (_tail + chunkSize) % _capacity;
+  _used -= chunkSize;
+  _chunks--;
+  _overwritten++;
+}
@@ -0,0 +1,48 @@
+// lib/LinkRecorder/LinkRecorder.h
+
+#ifndef LINK_RECORDER_H
+#define LINK_RECORDER_H
+
+#include <Arduino.h>
+
+// A flight recorder for the XIAO link. While recording, every chunk of bytes
+// that reaches XiaoFaceDetector is stored with its arrival time in a RAM ring
+// buffer (PSRAM when available). When the buffer is full the oldest chunks are
+// overwritten, so it always holds the most recent stretch of traffic.
+//
+// dump() prints it as text that tools/link_replay.cpp can play back through
+// the same parser on a PC:
+//   @<arrival micros> <bytes, with \n \r \\ and \xNN escapes>
+class LinkRecorder {
+public:
+  LinkRecorder();
+
+  // Allocates the buffer. Returns false if no memory could be found.
+  bool begin(size_t capacityBytes = 256 * 1024);
+
+  void start();
+  void stop();
+  bool isRecording() const;
+  void clear();
+
+  void record(uint32_t timestampUs, const uint8_t *data, size_t length);
+  void dump(Print &out);
+
+private:
+  static const size_t CHUNK_HEADER_SIZE = 6; // uint32 timestamp + uint16 length
+
+  void _put(size_t offset, const uint8_t *data, size_t length);
+  void _get(size_t offset, uint8_t *data, size_t length) const;
+  void _dropOldest();
+
+  uint8_t *_buffer;
+  size_t _capacity;
+  size_t _head;       // Where the next chunk is written
+  size_t _tail;       // Start of the oldest chunk
+  size_t _used;
+  uint32_t _chunks;
+  uint32_t _overwritten;
+  bool _recording;
+};
+
+#endif // LINK_RECORDER_H
@@ -0,0 +1,73 @@
+// lib/LoopProfiler/LoopProfiler.cpp
+
+#include "LoopProfiler.h"
+
+#if ICU_LOOP_PROFILING
+
+// A loop pass longer than one 50 Hz servo period means the servos missed an update.
+const uint32_t STALL_THRESHOLD_US = 20000;
+
+const char *siteNames[] = {
+    "led.update", "screen.update", "servo.update",
+    "led.setState", "screen.setState", "servo.setState"};
+
+LoopProfiler loopProfiler;
+
+LoopProfiler::LoopProfiler() {
+  _lastLoopStart = 0;
+  _lastPeriod = 0;
+  _stallCount = 0;
+}
+
+void LoopProfiler::markLoopStart() {
+  uint32_t now = ESP.getCycleCount();
+  if (_lastLoopStart != 0) {
+    uint32_t period = now - _lastLoopStart;
+    _loopPeriod.record(period);
+    if (_lastPeriod != 0) {
+      _loopJitter.record(period > _lastPeriod ? period - _lastPeriod : _lastPeriod - period);
+    }
+    if (period > STALL_THRESHOLD_US * ESP.getCpuFreqMHz()) {
+      _stallCount++;
+    }
+    _lastPeriod = period;
+  }
+  _lastLoopStart = now;
+}
+
+void LoopProfiler::record(ProfileSite site, uint32_t cycles) {
+  _sites[(int)site].record(cycles);
+}
+
+// Prints one line per histogram, all values in microseconds.
+static void printHistogram(Print &out, const char *name, const Log2Histogram &h, uint32_t cyclesPerUs) {
+  out.printf("PROF %-16s n=%lu min=%lu p50=%lu p99=%lu max=%lu\n", name,
+             (unsigned long)h.count(),
+             (unsigned long)(h.min() / cyclesPerUs),
+             (unsigned long)(h.percentile(50) / cyclesPerUs),
+             (unsigned long)(h.percentile(99) / cyclesPerUs),
+             (unsigned long)(h.max() / cyclesPerUs));
+}
+
+void LoopProfiler::dump(Print &out) {
+  uint32_t cyclesPerUs = ESP.getCpuFreqMHz();
+  for (int i = 0; i < (int)ProfileSite::COUNT; i++) {
+    printHistogram(out, siteNames[i], _sites[i], cyclesPerUs);
+  }
+  printHistogram(out, "loop.period", _loopPeriod, cyclesPerUs);
+  printHistogram(out, "loop.jitter", _loopJitter, cyclesPerUs);
+  out.printf("PROF stalls>%lums=%lu\n", (unsigned long)(STALL_THRESHOLD_US / 1000), (unsigned long)_stallCount);
+}
+
+void LoopProfiler::reset() {
+  for (int i = 0; i < (int)ProfileSite::COUNT; i++) {
+    _sites[i].reset();
+  }
+  _loopPeriod.reset();
+  _loopJitter.reset();
+  _lastLoopStart = 0;
+  _lastPeriod = 0;
+  _stallCount = 0;
+}
+
+#endif // ICU_LOOP_PROFILING
@@ -0,0 +1,76 @@
+// lib/LoopProfiler/LoopProfiler.h
+
+#ifndef LOOP_PROFILER_H
+#define LOOP_PROFILER_H
+
+#include <Arduino.h>
+
+// Build with -D ICU_LOOP_PROFILING=1 to turn the instrumentation on.
+// When it is off, every PROFILE_* macro expands to nothing and the
+// profiler itself is not compiled in, so there is zero runtime cost.
+#ifndef ICU_LOOP_PROFILING
+#define ICU_LOOP_PROFILING 0
+#endif
+
+// Every place we measure. Keep LoopProfiler.cpp's site names in the same order.
+enum class ProfileSite : uint8_t {
+  LED_UPDATE,
+  SCREEN_UPDATE,
+  SERVO_UPDATE,
+  LED_SET_STATE,
+  SCREEN_SET_STATE,
+  SERVO_SET_STATE,
+  COUNT
+};
+
+#if ICU_LOOP_PROFILING
+
+#include "Log2Histogram.h"
+
+class LoopProfiler {
+public:
+  LoopProfiler();
+
+  // Call once at the very top of loop(); tracks loop period and jitter.
+  void markLoopStart();
+  // Adds one cycle-count sample to a site's histogram.
+  void record(ProfileSite site, uint32_t cycles);
+
+  // Prints a compact summary of every site and the loop period.
+  void dump(Print &out);
+  void reset();
+
+private:
+  Log2Histogram _sites[(int)ProfileSite::COUNT];
+  Log2Histogram _loopPeriod;
+  Log2Histogram _loopJitter; // |period - previous period|
+  uint32_t _lastLoopStart;
+  uint32_t _lastPeriod;
+  uint32_t _stallCount;      // Loop periods longer than one servo PWM period
+};
+
+extern LoopProfiler loopProfiler;
+
+// Times the enclosing scope and records it against a site when it exits,
+// so early returns inside update()/setState() are still measured.
+class ProfileScope {
+public:
+  explicit ProfileScope(ProfileSite site) : _site(site), _start(ESP.getCycleCount()) {}
+  ~ProfileScope() { loopProfiler.record(_site, ESP.getCycleCount() - _start); }
+
+private:
+  ProfileSite _site;
+  uint32_t _start;
+};
+
+#define PROFILE_SCOPE(site) ProfileScope _profileScope(site)
+#define PROFILE_LOOP_START() loopProfiler.markLoopStart()
+
+#else
+
+#define PROFILE_SCOPE(site) do {} while (0)
+#define PROFILE_LOOP_START() do {} while (0)
+
+#endif // ICU_LOOP_PROFILING
+
+#endif // LOOP_PROFILER_H
@@ -0,0 +1,72 @@
+// lib/PowerManager/PowerManager.cpp
+
+#include "PowerManager.h"
+#include "esp_sleep.h"
+#include "esp_timer.h"
+#include "DeferredLog.h"
+
+static const char* const POWER_STATE_NAMES[] = {"active", "nap", "asleep"};
+
+PowerManager::PowerManager() {
+  _state = PowerState::ACTIVE;
+  _stateSince = 0;
+  _awakeUntil = 0;
+  for (int i = 0; i < (int)PowerState::COUNT; i++) {
+    _msIn[i] = 0;
+    _sleptUs[i] = 0;
+  }
+  _sleeps = 0;
+}
+
+void PowerManager::setSystemState(SystemState state) {
+  PowerState next = powerStateFor(state);
+  if (next == _state) return;
+
+  _account();
+  deferredLog.log(LOG_POWER_STATE, (int)_state, (int)next);
+  _state = next;
+}
+
+PowerState PowerManager::state() const {
+  return _state;
+}
+
+LinkPowerMode PowerManager::xiaoMode() const {
+  return xiaoModeFor(_state);
+}
+
+void PowerManager::holdAwake(unsigned long ms) {
+  _awakeUntil = holdAwakeUntil(_awakeUntil, millis(), ms);
+}
+
+void PowerManager::idle(const SleepBlockers& blockers) {
+#if ICU_LIGHT_SLEEP
+  uint32_t intervalMs = lightSleepMs(_state, ICU_LIGHT_SLEEP, blockers, millis(), _awakeUntil);
+  if (intervalMs == 0) return;
+
+  esp_sleep_enable_timer_wakeup((uint64_t)intervalMs * 1000);
+  Serial.flush(); // Whatever is still in the USB buffer is lost otherwise
+
+  int64_t start = esp_timer_get_time();
+  esp_light_sleep_start();
+  _sleptUs[(int)_state] += esp_timer_get_time() - start;
+  _sleeps++;
+#endif
+}
+
+void PowerManager::_account() {
+  unsigned long now = millis();
+  _msIn[(int)_state] += now - _stateSince;
+  _stateSince = now;
+}
+
+void PowerManager::dumpStats(Print& out) {
+  _account();
+  out.printf("POWER state=%s sleeps=%lu light_sleep=%s\n", POWER_STATE_NAMES[(int)_state],
+             (unsigned long)_sleeps, ICU_LIGHT_SLEEP ? "on" : "off");
+  for (int i = 0; i < (int)PowerState::COUNT; i++) {
+    uint32_t sleptMs = (uint32_t)(_sleptUs[i] / 1000);
+    out.printf("POWER %-6s ms=%lu slept_ms=%lu slept_pct=%.1f\n", POWER_STATE_NAMES[i], (unsigned long)_msIn[i],
+               (unsigned long)sleptMs, _msIn[i] ? 100.0f * sleptMs / _msIn[i] : 0.0f);
+  }
+}
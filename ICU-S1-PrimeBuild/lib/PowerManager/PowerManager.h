@@ -0,0 +1,53 @@
+// lib/PowerManager/PowerManager.h
+
+#ifndef POWER_MANAGER_H
+#define POWER_MANAGER_H
+
+#include <Arduino.h>
+#include "PowerPolicy.h"
+
+// Set to 0 to keep the CPU running through NAPPING and FULL_ASLEEP (the
+// other power savings stay), e.g. to keep the USB serial port attached.
+#ifndef ICU_LIGHT_SLEEP
+#define ICU_LIGHT_SLEEP 1
+#endif
+
+// Follows the system state into a power state, and spends the idle part of
+// every loop pass in light sleep while napping or asleep (the decisions are
+// in PowerPolicy.h).
+//
+// idle() sleeps until the next scheduled wakeup: a short one while napping,
+// so a detection still gets a quick reaction, a longer one when asleep. The
+// XIAO link's UART also wakes us, and holdAwake() keeps us up long enough
+// to take in the rest of what the XIAO is sending. Time in each power state,
+// and how much of it was spent asleep, is kept for dumpStats().
+class PowerManager {
+public:
+  PowerManager();
+
+  void setSystemState(SystemState state);
+  PowerState state() const;
+  // The XIAO camera mode that goes with the current power state
+  LinkPowerMode xiaoMode() const;
+
+  // Stay awake for at least 'ms' from now, whatever the state.
+  void holdAwake(unsigned long ms);
+
+  // Call at the end of loop(), once everything for this pass has been sent;
+  // nothing happens while anything in 'blockers' is busy.
+  void idle(const SleepBlockers& blockers);
+
+  void dumpStats(Print& out);
+
+private:
+  void _account();
+
+  PowerState _state;
+  unsigned long _stateSince; // millis() of the last accounting
+  uint32_t _awakeUntil;
+  uint32_t _msIn[(int)PowerState::COUNT];
+  uint64_t _sleptUs[(int)PowerState::COUNT];
+  uint32_t _sleeps;
+};
+
+#endif // POWER_MANAGER_H
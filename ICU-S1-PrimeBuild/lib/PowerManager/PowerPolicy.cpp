@@ -0,0 +1,53 @@
+// lib/PowerManager/PowerPolicy.cpp
+
+#include "PowerPolicy.h"
+
+// Scheduled wakeups, in ms between loop passes: a short one while napping,
+// so a detection still gets a quick reaction, a longer one when asleep
+const uint32_t NAP_WAKE_INTERVAL = 200;
+const uint32_t ASLEEP_WAKE_INTERVAL = 1000;
+
+PowerState powerStateFor(SystemState state) {
+  switch (state) {
+    case SystemState::NAPPING:     return PowerState::NAP;
+    case SystemState::FULL_ASLEEP: return PowerState::ASLEEP;
+    default:                       return PowerState::ACTIVE;
+  }
+}
+
+LinkPowerMode xiaoModeFor(PowerState state) {
+  switch (state) {
+    case PowerState::NAP:    return LINK_POWER_LOW;
+    case PowerState::ASLEEP: return LINK_POWER_STANDBY;
+    default:                 return LINK_POWER_ACTIVE;
+  }
+}
+
+bool shouldNap(SystemState state, bool facePresent, uint32_t nowMs, uint32_t lastFaceMs) {
+  return state == SystemState::SCANNING && !facePresent && nowMs - lastFaceMs >= NAP_AFTER;
+}
+
+void transitionOrder(SystemState from, SystemState to, TransitionStep order[TRANSITION_STEPS]) {
+  bool poweringUp = (int)powerStateFor(to) < (int)powerStateFor(from);
+  int i = 0;
+  order[i++] = TransitionStep::RECORD;
+  order[i++] = poweringUp ? TransitionStep::POWER : TransitionStep::OUTPUTS;
+  order[i++] = poweringUp ? TransitionStep::OUTPUTS : TransitionStep::POWER;
+  order[i++] = TransitionStep::GUARDS;
+}
+
+uint32_t lightSleepMs(PowerState state, bool lightSleep, const SleepBlockers& blockers, uint32_t nowMs,
+                      uint32_t awakeUntilMs) {
+  if (!lightSleep || blockers.panelOn || blockers.flashWriting) return 0;
+  if ((int32_t)(awakeUntilMs - nowMs) > 0) return 0;
+  switch (state) {
+    case PowerState::NAP:    return NAP_WAKE_INTERVAL;
+    case PowerState::ASLEEP: return ASLEEP_WAKE_INTERVAL;
+    default:                 return 0;
+  }
+}
+
+uint32_t holdAwakeUntil(uint32_t awakeUntilMs, uint32_t nowMs, uint32_t holdMs) {
+  uint32_t until = nowMs + holdMs;
+  return (int32_t)(until - awakeUntilMs) > 0 ? until : awakeUntilMs;
+}
@@ -0,0 +1,67 @@
+// lib/PowerManager/PowerPolicy.h
+
+#ifndef POWER_POLICY_H
+#define POWER_POLICY_H
+
+#include <stdint.h>
+#include "ProjectState.h"
+#include "LinkProtocol.h"
+
+enum class PowerState {
+  ACTIVE, // Every state but the two below
+  NAP,    // NAPPING
+  ASLEEP, // FULL_ASLEEP
+  COUNT
+};
+
+// The decisions behind PowerManager: which power state and XIAO camera mode
+// go with each system state, when to nap, in what order a state change
+// reaches the rest of the robot, and how long the loop may light-sleep.
+//
+// tools/power_policy_test checks it on the host; link_replay reaches
+// shouldNap() through FaceFollower.
+
+const uint32_t NAP_AFTER = 300000;    // ms of SCANNING with no face, then NAPPING
+const uint32_t LINK_AWAKE_HOLD = 300; // ms to stay out of light sleep after a line from the XIAO
+
+PowerState powerStateFor(SystemState state);
+LinkPowerMode xiaoModeFor(PowerState state);
+
+// Whether to go from SCANNING to NAPPING: no face tracked, and none
+// confirmed or lost since 'lastFaceMs'. Times are millis(), and safe
+// across its wrap.
+bool shouldNap(SystemState state, bool facePresent, uint32_t nowMs, uint32_t lastFaceMs);
+
+// The steps of a system state change, taken by main.cpp's setGlobalState().
+enum class TransitionStep {
+  RECORD,  // Log the change to flash, and flush it
+  OUTPUTS, // Screen, servos and LEDs
+  POWER,   // PowerManager and the XIAO camera mode
+  GUARDS,  // What the heap guard and flash log allow in the new state
+};
+const int TRANSITION_STEPS = 4;
+
+// The order to take the steps in from 'from' to 'to'. The record always
+// goes first, since what the robot was doing is what a reset would most
+// need to show. Into a lower power state the outputs settle before the
+// power drops; out of one the power, and with it the XIAO's camera, comes
+// up before the eyelids start their slow opening.
+void transitionOrder(SystemState from, SystemState to, TransitionStep order[TRANSITION_STEPS]);
+
+// Whatever else has to be quiet before the loop may light-sleep.
+struct SleepBlockers {
+  bool panelOn;      // The panel is lit, or still fading out
+  bool flashWriting; // The telemetry log is halfway through a flash write
+};
+
+// How long to light-sleep at the end of a loop pass, in ms, or 0 to stay
+// awake: always while ACTIVE, with light sleep built out or while anything
+// in 'blockers' is busy, and until 'awakeUntilMs'. Times are millis(), and
+// safe across its wrap.
+uint32_t lightSleepMs(PowerState state, bool lightSleep, const SleepBlockers& blockers, uint32_t nowMs,
+                      uint32_t awakeUntilMs);
+// The stay-awake deadline after holding awake for 'holdMs' from 'nowMs'. A
+// later deadline already set is kept.
+uint32_t holdAwakeUntil(uint32_t awakeUntilMs, uint32_t nowMs, uint32_t holdMs);
+
+#endif // POWER_POLICY_H
@@ -0,0 +1,70 @@
+// lib/PresenceTracker/PresenceTracker.cpp
+
+#include "PresenceTracker.h"
+
+PresenceTracker::PresenceTracker(int hits, int window, uint32_t slotMs, uint32_t lossTimeoutMs) {
+  _window = window < 1 ? 1 : (window > MAX_WINDOW ? MAX_WINDOW : window);
+  _hits = hits < 1 ? 1 : (hits > _window ? _window : hits);
+  _slotMs = slotMs ? slotMs : 1;
+  _lossTimeoutMs = lossTimeoutMs;
+  reset();
+}
+
+void PresenceTracker::reset() {
+  _history = 0;
+  _slotStart = 0;
+  _started = false;
+  _present = false;
+  _lastSeen = 0;
+}
+
+void PresenceTracker::_advance(uint32_t nowMs) {
+  if (!_started) {
+    _started = true;
+    _slotStart = nowMs;
+    return;
+  }
+  uint32_t slots = (nowMs - _slotStart) / _slotMs;
+  if (slots == 0) return;
+  _history = slots >= 32 ? 0 : _history << slots;
+  _slotStart += slots * _slotMs;
+}
+
+void PresenceTracker::onDetection(uint32_t nowMs) {
+  _advance(nowMs);
+  _history |= 1;
+  _lastSeen = nowMs;
+}
+
+PresenceEvent PresenceTracker::update(uint32_t nowMs) {
+  _advance(nowMs);
+  if (!_present) {
+    if (recentHits() >= _hits) {
+      _present = true;
+      return PresenceEvent::CONFIRMED;
+    }
+  } else if (nowMs - _lastSeen >= _lossTimeoutMs) {
+    // Start the next confirmation from nothing
+    _present = false;
+    _history = 0;
+    return PresenceEvent::LOST;
+  }
+  return PresenceEvent::NONE;
+}
+
+bool PresenceTracker::isPresent() const {
+  return _present;
+}
+
+int PresenceTracker::recentHits() const {
+  uint32_t mask = _window >= 32 ? 0xFFFFFFFFu : (1u << _window) - 1;
+  return __builtin_popcount(_history & mask);
+}
+
+void PresenceTracker::setLossTimeout(uint32_t lossTimeoutMs) {
+  _lossTimeoutMs = lossTimeoutMs;
+}
+
+uint32_t PresenceTracker::lossTimeout() const {
+  return _lossTimeoutMs;
+}
@@ -0,0 +1,55 @@
+// lib/PresenceTracker/PresenceTracker.h
+
+#ifndef PRESENCE_TRACKER_H
+#define PRESENCE_TRACKER_H
+
+#include <stdint.h>
+
+enum class PresenceEvent {
+  NONE,
+  CONFIRMED, // Enough recent detections to believe someone is there
+  LOST       // No detection for the loss timeout
+};
+
+// Decides from the stream of XIAO detections whether a face is really there.
+//
+// The XIAO only sends a message when it finds a face, so time is cut into
+// slots of about one camera frame and a slot with at least one detection
+// is a hit. A face is confirmed once 'hits' of the last 'window' slots are
+// hits: one false positive never gets through, and a face that flickers in
+// and out of detection still does. Once confirmed, it is only lost when
+// nothing has been detected for the loss timeout.
+//
+// tools/link_replay runs it, through FaceFollower, on recorded link captures.
+class PresenceTracker {
+public:
+  static const int MAX_WINDOW = 32;
+
+  PresenceTracker(int hits, int window, uint32_t slotMs, uint32_t lossTimeoutMs);
+
+  void onDetection(uint32_t nowMs);
+  // Call every loop, after the detections received so far.
+  PresenceEvent update(uint32_t nowMs);
+  void reset();
+
+  bool isPresent() const;
+  int recentHits() const; // Hit slots in the current window
+  void setLossTimeout(uint32_t lossTimeoutMs);
+  uint32_t lossTimeout() const;
+
+private:
+  void _advance(uint32_t nowMs);
+
+  int _hits;
+  int _window;
+  uint32_t _slotMs;
+  uint32_t _lossTimeoutMs;
+
+  uint32_t _history;   // Bit 0 is the current slot, bit N the slot N ago
+  uint32_t _slotStart; // When the current slot began
+  bool _started;
+  bool _present;
+  uint32_t _lastSeen;
+};
+
+#endif // PRESENCE_TRACKER_H
@@ -0,0 +1,167 @@
+// lib/ScanPlanner/ScanPlanner.cpp
+
+#include "ScanPlanner.h"
+#include <math.h>
+#include <string.h>
+#include "GazeTable.h"
+
+// The sweep
+const int SCAN_MARGIN = 15;           // Image pixels kept clear of the edge, where the linkage is least accurate
+const int WAYPOINTS_PER_LAP = 48;     // Targets per lap of the figure
+const float LAP_SHIFT = 0.381966f;    // Of a horizontal sweep, per lap: the golden ratio never repeats a lap
+const uint32_t DWELL_MS = 450;        // Held on each target once there, for the XIAO to get a few frames
+const uint32_t HEAT_DWELL_MS = 450;   // Extra, on the warmest cell
+const uint32_t TRAVEL_MS = 80;        // Allowed for every move to start and settle...
+const float TRAVEL_MS_PER_PX = 1.2f;  // ...and for its length
+
+// The heatmap
+const float HEAT_BIAS = 0.5f;         // Largest share of targets that are visits to warm cells
+const float HEAT_CONFIDENCE = 5;      // Faces' worth of heat for half of that
+const uint32_t HEAT_AGE = 255;        // Every face keeps 255/256 of the rest: half-life about 180 faces
+
+// A triangle wave with period 1, from 0 up to 1 and back.
+static float triangle(float t) {
+  t -= floorf(t);
+  return t < 0.5f ? 2 * t : 2 - 2 * t;
+}
+
+ScanPlanner::ScanPlanner() {
+  memset(_heat, 0, sizeof(_heat));
+  memset(_credit, 0, sizeof(_credit));
+  _totalHeat = 0;
+  _maxHeat = 0;
+  _bias = 0;
+  _visitShare = 0;
+  _dirty = false;
+  _step = 0;
+  _nextMove = 0;
+  _lastX = GAZE_IMAGE_SIZE / 2;
+  _lastY = GAZE_IMAGE_SIZE / 2;
+}
+
+void ScanPlanner::restart(uint32_t nowMs) {
+  _nextMove = nowMs;
+}
+
+bool ScanPlanner::update(uint32_t nowMs, int& imageX, int& imageY) {
+  if ((int32_t)(nowMs - _nextMove) < 0) return false;
+
+  _visitShare += _bias;
+  if (_visitShare >= 1) {
+    _visitShare -= 1;
+    _nextWarmCell(imageX, imageY);
+  } else {
+    // Moving one wave against the other reshapes the figure, so each lap
+    // crosses the gaps between the last one's lines
+    float shift = (_step / WAYPOINTS_PER_LAP) * LAP_SHIFT;
+    float s = (float)(_step % WAYPOINTS_PER_LAP) / WAYPOINTS_PER_LAP;
+    const int span = GAZE_IMAGE_SIZE - 1 - 2 * SCAN_MARGIN;
+    imageX = SCAN_MARGIN + (int)lroundf(triangle(3 * s + 0.25f + (shift - floorf(shift)) / 3) * span);
+    imageY = SCAN_MARGIN + (int)lroundf(triangle(2 * s) * span);
+    _step++;
+  }
+
+  uint32_t hold = DWELL_MS + TRAVEL_MS + (uint32_t)(hypotf(imageX - _lastX, imageY - _lastY) * TRAVEL_MS_PER_PX);
+  if (_maxHeat > 0) {
+    int cell = (imageY * HEAT_GRID / GAZE_IMAGE_SIZE) * HEAT_GRID + imageX * HEAT_GRID / GAZE_IMAGE_SIZE;
+    hold += (uint32_t)(HEAT_DWELL_MS * (_bias / HEAT_BIAS) * _heat[cell] / _maxHeat);
+  }
+  _nextMove = nowMs + hold;
+  _lastX = imageX;
+  _lastY = imageY;
+  return true;
+}
+
+// A weighted round robin: every cell is owed its share of the heat each
+// visit, and the one owed most is visited. Over a run of visits each cell
+// gets its share, in an even order rather than a random one.
+void ScanPlanner::_nextWarmCell(int& imageX, int& imageY) {
+  int best = 0;
+  for (int i = 0; i < HEAT_CELLS; i++) {
+    _credit[i] += (float)_heat[i] / _totalHeat;
+    if (_credit[i] > _credit[best]) best = i;
+  }
+  _credit[best] -= 1;
+  const int cellSize = GAZE_IMAGE_SIZE / HEAT_GRID;
+  imageX = (best % HEAT_GRID) * cellSize + cellSize / 2;
+  imageY = (best / HEAT_GRID) * cellSize + cellSize / 2;
+  if (imageX < SCAN_MARGIN) imageX = SCAN_MARGIN;
+  if (imageY < SCAN_MARGIN) imageY = SCAN_MARGIN;
+  if (imageX > GAZE_IMAGE_SIZE - 1 - SCAN_MARGIN) imageX = GAZE_IMAGE_SIZE - 1 - SCAN_MARGIN;
+  if (imageY > GAZE_IMAGE_SIZE - 1 - SCAN_MARGIN) imageY = GAZE_IMAGE_SIZE - 1 - SCAN_MARGIN;
+}
+
+// Faces are only known to within a box, so a quarter of the heat goes to
+// each neighbouring cell.
+void ScanPlanner::recordFace(int imageX, int imageY) {
+  if (imageX < 0 || imageY < 0 || imageX >= GAZE_IMAGE_SIZE || imageY >= GAZE_IMAGE_SIZE) return;
+  for (int i = 0; i < HEAT_CELLS; i++) {
+    _heat[i] = (uint16_t)(_heat[i] * HEAT_AGE / 256);
+  }
+  int column = imageX * HEAT_GRID / GAZE_IMAGE_SIZE;
+  int row = imageY * HEAT_GRID / GAZE_IMAGE_SIZE;
+  const int offsets[5][3] = {{0, 0, HEAT_FACE}, {-1, 0, HEAT_FACE / 4}, {1, 0, HEAT_FACE / 4},
+                             {0, -1, HEAT_FACE / 4}, {0, 1, HEAT_FACE / 4}};
+  for (const auto& offset : offsets) {
+    int c = column + offset[0], r = row + offset[1];
+    if (c < 0 || r < 0 || c >= HEAT_GRID || r >= HEAT_GRID) continue;
+    uint32_t heat = _heat[r * HEAT_GRID + c] + offset[2];
+    _heat[r * HEAT_GRID + c] = (uint16_t)(heat > UINT16_MAX ? UINT16_MAX : heat);
+  }
+  _dirty = true;
+  _rebuild();
+}
+
+const uint16_t* ScanPlanner::heat() const {
+  return _heat;
+}
+
+bool ScanPlanner::load(const uint16_t* heat, int cells) {
+  if (cells != HEAT_CELLS) return false;
+  memcpy(_heat, heat, sizeof(_heat));
+  memset(_credit, 0, sizeof(_credit));
+  _dirty = false;
+  _rebuild();
+  return true;
+}
+
+bool ScanPlanner::isDirty() const {
+  return _dirty;
+}
+
+void ScanPlanner::clearDirty() {
+  _dirty = false;
+}
+
+float ScanPlanner::heatMass() const {
+  return _totalHeat / (2.0f * HEAT_FACE); // A face away from the edges adds twice HEAT_FACE
+}
+
+float ScanPlanner::bias() const {
+  return _bias;
+}
+
+// The share of visits grows with the faces seen, and with how much they
+// cluster: one minus the heat's entropy against an even spread, so faces
+// turning up anywhere at all leave the sweep to itself.
+void ScanPlanner::_rebuild() {
+  _totalHeat = 0;
+  _maxHeat = 0;
+  for (int i = 0; i < HEAT_CELLS; i++) {
+    _totalHeat += _heat[i];
+    if (_heat[i] > _maxHeat) _maxHeat = _heat[i];
+  }
+  if (_totalHeat == 0) {
+    _bias = 0;
+    return;
+  }
+  float entropy = 0;
+  for (int i = 0; i < HEAT_CELLS; i++) {
+    if (_heat[i] == 0) continue;
+    float p = (float)_heat[i] / _totalHeat;
+    entropy -= p * logf(p);
+  }
+  float clustering = 1 - entropy / logf((float)HEAT_CELLS);
+  float mass = heatMass();
+  _bias = HEAT_BIAS * clustering * mass / (mass + HEAT_CONFIDENCE);
+}
@@ -0,0 +1,68 @@
+// lib/ScanPlanner/ScanPlanner.h
+
+#ifndef SCAN_PLANNER_H
+#define SCAN_PLANNER_H
+
+#include <stdint.h>
+
+// Where the eye looks while SCANNING, in the same 240x240 image space as
+// GazeTable (so every target is reachable through the calibration).
+//
+// The targets follow a 3:2 Lissajous figure traced with triangle waves (a
+// billiard path), which crosses the whole field evenly without the clumps
+// and gaps of random picks. Each lap moves one wave against the other, so
+// the next lap crosses between the last one's lines.
+//
+// A heatmap of confirmed faces, aged by every new one, biases the sweep:
+// visits to warm cells are slipped in between its targets, each cell in
+// turn in proportion to its heat, and held longer. The more faces the map
+// has seen and the more they cluster, the bigger the share of visits, up
+// to HEAT_BIAS; the rest of the time the sweep carries on, so nowhere is
+// ever left out.
+//
+// tools/scan_sim compares it with the old random walk, and link_replay
+// prints its targets.
+class ScanPlanner {
+public:
+  static const int HEAT_GRID = 12; // Heatmap cells per side, 20 image pixels each
+  static const int HEAT_CELLS = HEAT_GRID * HEAT_GRID;
+  static const uint16_t HEAT_FACE = 1024; // Heat a face adds to its cell
+
+  ScanPlanner();
+
+  // Starts the sweep again, from wherever it had got to; call on entering SCANNING.
+  void restart(uint32_t nowMs);
+  // True when the eye should move on, with the new target in image pixels.
+  bool update(uint32_t nowMs, int& imageX, int& imageY);
+
+  // Call with the centre of every confirmed face, in image pixels.
+  void recordFace(int imageX, int imageY);
+
+  // The heatmap, for storing it; load() rejects a map of the wrong size.
+  const uint16_t* heat() const;
+  bool load(const uint16_t* heat, int cells);
+  bool isDirty() const; // Changed since load() or clearDirty()
+  void clearDirty();
+  float heatMass() const; // Faces' worth of heat in the map
+
+  // Share of targets that are visits to warm cells, 0 to HEAT_BIAS.
+  float bias() const;
+
+private:
+  void _rebuild();
+  void _nextWarmCell(int& imageX, int& imageY);
+
+  uint16_t _heat[HEAT_CELLS];
+  float _credit[HEAT_CELLS]; // Visits each cell is owed, for the round robin
+  uint32_t _totalHeat;
+  uint16_t _maxHeat;
+  float _bias;
+  float _visitShare; // Accumulates _bias per target; a visit is due at 1
+  bool _dirty;
+
+  uint32_t _step;     // Sweep targets since the figure started
+  uint32_t _nextMove; // nowMs when the current target has been held long enough
+  int _lastX, _lastY;
+};
+
+#endif // SCAN_PLANNER_H
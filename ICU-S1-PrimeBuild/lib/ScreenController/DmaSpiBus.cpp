@@ -0,0 +1,241 @@
+// lib/ScreenController/DmaSpiBus.cpp
+
+#include "DmaSpiBus.h"
+#include "driver/gpio.h"
+#include "esp_heap_caps.h"
+
+// Same clock Arduino_ESP32SPI uses by default, so the two buses can be
+// compared like for like. The GC9A01 usually takes 80 MHz over short wires:
+// try -D ICU_DISPLAY_SPI_HZ=80000000 and check the 'b' benchmark output.
+#ifndef ICU_DISPLAY_SPI_HZ
+#define ICU_DISPLAY_SPI_HZ 40000000
+#endif
+
+#define DISPLAY_SPI_HOST SPI2_HOST
+
+DmaSpiBus::DmaSpiBus(int8_t dc, int8_t cs, int8_t sck, int8_t mosi)
+    : _dc(dc), _cs(cs), _sck(sck), _mosi(mosi) {
+  _clockHz = ICU_DISPLAY_SPI_HZ;
+  _device = nullptr;
+  _queued = 0;
+  _done = 0;
+  for (int i = 0; i < BOUNCE_BUFFERS; i++) {
+    _bounce[i] = nullptr;
+    _bounceSequence[i] = 0;
+  }
+  _nextBounce = 0;
+  _fill = nullptr;
+  _fillColor = 0;
+  _fillSequence = 0;
+  _bytesSent = 0;
+  _stalls = 0;
+}
+
+bool DmaSpiBus::begin(int32_t speed, int8_t dataMode) {
+  if (_device) return true; // Already running; ScreenController::begin() runs on every wake-up
+
+  if (speed != GFX_NOT_DEFINED) _clockHz = speed;
+
+  // Kept across a failed begin(), for the next wake-up to try again with
+  for (int i = 0; i < BOUNCE_BUFFERS; i++) {
+    if (!_bounce[i]) _bounce[i] = (uint16_t*)heap_caps_malloc(CHUNK_PIXELS * 2, MALLOC_CAP_DMA);
+    if (!_bounce[i]) return false;
+  }
+  if (!_fill) _fill = (uint16_t*)heap_caps_malloc(CHUNK_PIXELS * 2, MALLOC_CAP_DMA);
+  if (!_fill) return false;
+  for (int i = 0; i < CHUNK_PIXELS; i++) _fill[i] = 0;
+  _fillColor = 0;
+
+  pinMode(_dc, OUTPUT);
+  digitalWrite(_dc, HIGH);
+
+  spi_bus_config_t bus = {};
+  bus.mosi_io_num = _mosi;
+  bus.miso_io_num = -1;
+  bus.sclk_io_num = _sck;
+  bus.quadwp_io_num = -1;
+  bus.quadhd_io_num = -1;
+  bus.max_transfer_sz = CHUNK_PIXELS * 2;
+  if (spi_bus_initialize(DISPLAY_SPI_HOST, &bus, SPI_DMA_CH_AUTO) != ESP_OK) return false;
+
+  spi_device_interface_config_t device = {};
+  device.clock_speed_hz = _clockHz;
+  device.mode = dataMode == GFX_NOT_DEFINED ? 0 : dataMode;
+  device.spics_io_num = _cs;
+  device.queue_size = QUEUE_DEPTH;
+  device.pre_cb = _preTransfer;
+  if (spi_bus_add_device(DISPLAY_SPI_HOST, &device, &_device) != ESP_OK) {
+    _device = nullptr;
+    spi_bus_free(DISPLAY_SPI_HOST); // Or the next try cannot initialize it again
+    return false;
+  }
+
+  // Nothing else shares this bus, so keep it for good instead of per write.
+  spi_device_acquire_bus(_device, portMAX_DELAY);
+  return true;
+}
+
+// A transaction's user field carries the D/C pin and the level it needs:
+// (pin << 1) | 1 for data, (pin << 1) for a command.
+void* DmaSpiBus::_dcLevel(bool isData) const {
+  return (void*)(((uintptr_t)_dc << 1) | (isData ? 1 : 0));
+}
+
+void IRAM_ATTR DmaSpiBus::_preTransfer(spi_transaction_t* t) {
+  uintptr_t info = (uintptr_t)t->user;
+  gpio_set_level((gpio_num_t)(info >> 1), info & 1);
+}
+
+// Arduino_GFX brackets every drawing call with these. Ending a write must
+// not wait for the queue: that is the whole point of this bus.
+void DmaSpiBus::beginWrite() {}
+void DmaSpiBus::endWrite() {}
+
+spi_transaction_t* DmaSpiBus::_nextSlot() {
+  if (_queued - _done >= QUEUE_DEPTH) {
+    _stalls++;
+    _reclaimOne();
+  }
+  spi_transaction_t* t = &_slots[_queued % QUEUE_DEPTH];
+  memset(t, 0, sizeof(*t));
+  return t;
+}
+
+void DmaSpiBus::_queue(spi_transaction_t* t) {
+  spi_device_queue_trans(_device, t, portMAX_DELAY);
+  _queued++;
+  _bytesSent += t->length / 8;
+}
+
+// Transactions of one device finish in the order they were queued.
+void DmaSpiBus::_reclaimOne() {
+  spi_transaction_t* finished;
+  spi_device_get_trans_result(_device, &finished, portMAX_DELAY);
+  _done++;
+}
+
+void DmaSpiBus::_waitFor(uint32_t sequence) {
+  if (_done < sequence) _stalls++;
+  while (_done < sequence) _reclaimOne();
+}
+
+void DmaSpiBus::waitIdle() {
+  _waitFor(_queued);
+}
+
+void DmaSpiBus::_queueSmall(const uint8_t* data, int length, bool isData) {
+  spi_transaction_t* t = _nextSlot();
+  t->flags = SPI_TRANS_USE_TXDATA;
+  t->length = length * 8;
+  memcpy(t->tx_data, data, length);
+  t->user = _dcLevel(isData);
+  _queue(t);
+}
+
+void DmaSpiBus::writeCommand(uint8_t c) {
+  _queueSmall(&c, 1, false);
+}
+
+void DmaSpiBus::writeCommand16(uint16_t c) {
+  uint8_t bytes[2] = {(uint8_t)(c >> 8), (uint8_t)c};
+  _queueSmall(bytes, 2, false);
+}
+
+void DmaSpiBus::write(uint8_t d) {
+  _queueSmall(&d, 1, true);
+}
+
+void DmaSpiBus::write16(uint16_t d) {
+  uint8_t bytes[2] = {(uint8_t)(d >> 8), (uint8_t)d};
+  _queueSmall(bytes, 2, true);
+}
+
+// The address window commands: two transactions instead of three.
+void DmaSpiBus::writeC8D16D16(uint8_t c, uint16_t d1, uint16_t d2) {
+  _queueSmall(&c, 1, false);
+  uint8_t bytes[4] = {(uint8_t)(d1 >> 8), (uint8_t)d1, (uint8_t)(d2 >> 8), (uint8_t)d2};
+  _queueSmall(bytes, 4, true);
+}
+
+void DmaSpiBus::writeRepeat(uint16_t p, uint32_t len) {
+  uint16_t swapped = (p >> 8) | (p << 8);
+  if (swapped != _fillColor) {
+    // The fill buffer may still be on the wire with the old colour
+    _waitFor(_fillSequence);
+    for (int i = 0; i < CHUNK_PIXELS; i++) _fill[i] = swapped;
+    _fillColor = swapped;
+  }
+
+  while (len > 0) {
+    uint32_t n = min(len, (uint32_t)CHUNK_PIXELS);
+    spi_transaction_t* t = _nextSlot();
+    t->length = n * 16;
+    t->tx_buffer = _fill;
+    t->user = _dcLevel(true);
+    _queue(t);
+    _fillSequence = _queued;
+    len -= n;
+  }
+}
+
+void DmaSpiBus::writePixels(uint16_t* data, uint32_t len) {
+  while (len > 0) {
+    uint32_t n = min(len, (uint32_t)CHUNK_PIXELS);
+    int b = _nextBounce;
+    _nextBounce = (_nextBounce + 1) % BOUNCE_BUFFERS;
+    _waitFor(_bounceSequence[b]);
+
+    uint16_t* out = _bounce[b];
+    for (uint32_t i = 0; i < n; i++) {
+      uint16_t p = data[i];
+      out[i] = (p >> 8) | (p << 8);
+    }
+
+    spi_transaction_t* t = _nextSlot();
+    t->length = n * 16;
+    t->tx_buffer = out;
+    t->user = _dcLevel(true);
+    _queue(t);
+    _bounceSequence[b] = _queued;
+
+    data += n;
+    len -= n;
+  }
+}
+
+void DmaSpiBus::writeBytes(uint8_t* data, uint32_t len) {
+  const uint32_t chunkBytes = CHUNK_PIXELS * 2;
+  while (len > 0) {
+    uint32_t n = min(len, chunkBytes);
+    int b = _nextBounce;
+    _nextBounce = (_nextBounce + 1) % BOUNCE_BUFFERS;
+    _waitFor(_bounceSequence[b]);
+    memcpy(_bounce[b], data, n);
+
+    spi_transaction_t* t = _nextSlot();
+    t->length = n * 8;
+    t->tx_buffer = _bounce[b];
+    t->user = _dcLevel(true);
+    _queue(t);
+    _bounceSequence[b] = _queued;
+
+    data += n;
+    len -= n;
+  }
+}
+
+void DmaSpiBus::writePattern(uint8_t* data, uint8_t len, uint32_t repeat) {
+  while (repeat-- > 0) {
+    writeBytes(data, len);
+  }
+}
+
+uint32_t DmaSpiBus::clockHz() const {
+  return _clockHz;
+}
+
+void DmaSpiBus::dumpStats(Print& out) {
+  out.printf("SCREEN dma clock_hz=%lu transactions=%lu bytes=%lu stalls=%lu\n",
+             (unsigned long)_clockHz, (unsigned long)_queued, (unsigned long)_bytesSent,
+             (unsigned long)_stalls);
+}
@@ -0,0 +1,77 @@
+// lib/ScreenController/DmaSpiBus.h
+
+#ifndef DMA_SPI_BUS_H
+#define DMA_SPI_BUS_H
+
+#include <Arduino_GFX_Library.h>
+#include "driver/spi_master.h"
+
+// An Arduino_GFX data bus on the ESP-IDF SPI master driver that does not
+// wait for its transfers.
+//
+// Every command, parameter and pixel write is queued as an SPI transaction
+// and the call returns straight away; the DMA engine sends them in order
+// while the CPU goes on to draw the next thing. Pixels are byte-swapped
+// into one of two DMA bounce buffers on the way in, so the caller's buffer
+// is free again as soon as writePixels() returns. The CPU only blocks when
+// both bounce buffers are still on the wire.
+//
+// Commands go out with D/C low: a pre-transaction callback sets the pin
+// from each transaction's user field.
+class DmaSpiBus : public Arduino_DataBus {
+public:
+  DmaSpiBus(int8_t dc, int8_t cs, int8_t sck, int8_t mosi);
+
+  bool begin(int32_t speed = GFX_NOT_DEFINED, int8_t dataMode = GFX_NOT_DEFINED) override;
+  void beginWrite() override;
+  void endWrite() override;
+  void writeCommand(uint8_t c) override;
+  void writeCommand16(uint16_t c) override;
+  void write(uint8_t d) override;
+  void write16(uint16_t d) override;
+  void writeC8D16D16(uint8_t c, uint16_t d1, uint16_t d2) override;
+  void writeRepeat(uint16_t p, uint32_t len) override;
+  void writePixels(uint16_t* data, uint32_t len) override;
+  void writeBytes(uint8_t* data, uint32_t len) override;
+  void writePattern(uint8_t* data, uint8_t len, uint32_t repeat) override;
+
+  // Blocks until everything queued has been sent.
+  void waitIdle();
+
+  uint32_t clockHz() const;
+  void dumpStats(Print& out);
+
+private:
+  static const int QUEUE_DEPTH = 8;     // Transactions in flight, small ones included
+  static const int BOUNCE_BUFFERS = 2;
+  static const int CHUNK_PIXELS = 4096; // Pixels per DMA transaction (8 KB)
+
+  static void _preTransfer(spi_transaction_t* t);
+
+  void* _dcLevel(bool isData) const;
+  spi_transaction_t* _nextSlot();
+  void _queue(spi_transaction_t* t);
+  void _queueSmall(const uint8_t* data, int length, bool isData);
+  void _reclaimOne();
+  void _waitFor(uint32_t sequence);
+
+  int8_t _dc, _cs, _sck, _mosi;
+  uint32_t _clockHz;
+  spi_device_handle_t _device;
+
+  spi_transaction_t _slots[QUEUE_DEPTH];
+  uint32_t _queued; // Transactions queued so far
+  uint32_t _done;   // Transactions known to be finished
+
+  uint16_t* _bounce[BOUNCE_BUFFERS];
+  uint32_t _bounceSequence[BOUNCE_BUFFERS]; // Free once _done reaches this
+  int _nextBounce;
+  uint16_t* _fill;
+  uint16_t _fillColor;
+  uint32_t _fillSequence;
+
+  uint32_t _bytesSent;
+  uint32_t _stalls; // Times the CPU had to wait for a buffer or slot
+};
+
+#endif // DMA_SPI_BUS_H
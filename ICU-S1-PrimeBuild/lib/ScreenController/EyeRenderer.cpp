@@ -0,0 +1,235 @@
+// lib/ScreenController/EyeRenderer.cpp
+
+#include "EyeRenderer.h"
+#include <math.h>
+
+static uint16_t rgb565(int r, int g, int b) {
+  return ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3);
+}
+
+// 'alpha' of 'front' over 'back', 0..255
+static uint16_t blend565(uint16_t back, uint16_t front, uint8_t alpha) {
+  uint32_t a = alpha + 1;
+  uint32_t r = ((front >> 11) * a + (back >> 11) * (256 - a)) >> 8;
+  uint32_t g = (((front >> 5) & 0x3F) * a + ((back >> 5) & 0x3F) * (256 - a)) >> 8;
+  uint32_t b = ((front & 0x1F) * a + (back & 0x1F) * (256 - a)) >> 8;
+  return (r << 11) | (g << 5) | b;
+}
+
+static uint8_t coverage(float edge) {
+  if (edge <= 0) return 0;
+  if (edge >= 1) return 255;
+  return (uint8_t)(edge * 255);
+}
+
+const uint16_t SCLERA_COLOR = rgb565(230, 226, 214);
+const uint16_t LID_COLOR = rgb565(40, 44, 52);
+const uint16_t LASH_COLOR = rgb565(8, 8, 10);
+const int LASH_ROWS = 3;  // Darker band along each lid edge
+const int PUPIL_RADIUS = 17;
+const int LIMBAL_WIDTH = 4; // Dark ring around the outside of the iris
+const int HIGHLIGHT_OFFSET = -14; // From the iris centre, up and to the left
+
+EyeRenderer::EyeRenderer(const RoundSpans& spans) : _spans(spans) {
+  _renderIris();
+  _renderHighlight();
+  _gazeX = 0;
+  _gazeY = 0;
+  _openness = 255;
+  _valid = false;
+  _irisX = 0;
+  _irisY = 0;
+  _highlightX = 0;
+  _highlightY = 0;
+  _lidTop = 0;
+  _lidBottom = SIZE;
+}
+
+void EyeRenderer::_renderIris() {
+  const float centre = (IRIS_SPRITE - 1) / 2.0f;
+  for (int y = 0; y < IRIS_SPRITE; y++) {
+    for (int x = 0; x < IRIS_SPRITE; x++) {
+      float dx = x - centre;
+      float dy = y - centre;
+      float d = sqrtf(dx * dx + dy * dy);
+
+      // Teal fading outwards, with radial fibres and a dark limbal ring
+      float t = (d - PUPIL_RADIUS) / (IRIS_RADIUS - PUPIL_RADIUS);
+      if (t < 0) t = 0;
+      if (t > 1) t = 1;
+      float fibres = 0.85f + 0.15f * sinf(atan2f(dy, dx) * 23.0f);
+      float shade = fibres * (d > IRIS_RADIUS - LIMBAL_WIDTH ? 0.45f : 1.0f);
+      uint16_t iris = rgb565((int)((60 - 50 * t) * shade), (int)((200 - 140 * t) * shade),
+                             (int)((255 - 135 * t) * shade));
+
+      uint8_t pupil = coverage(PUPIL_RADIUS + 0.5f - d);
+      _iris[y * IRIS_SPRITE + x] = blend565(iris, rgb565(4, 4, 6), pupil);
+      _irisAlpha[y * IRIS_SPRITE + x] = coverage(IRIS_RADIUS + 0.5f - d);
+    }
+  }
+}
+
+void EyeRenderer::_renderHighlight() {
+  const float centre = (HIGHLIGHT_SPRITE - 1) / 2.0f;
+  const float radius = HIGHLIGHT_SPRITE / 2.0f - 1;
+  for (int y = 0; y < HIGHLIGHT_SPRITE; y++) {
+    for (int x = 0; x < HIGHLIGHT_SPRITE; x++) {
+      float dx = x - centre;
+      float dy = y - centre;
+      float d = sqrtf(dx * dx + dy * dy);
+      _highlight[y * HIGHLIGHT_SPRITE + x] = rgb565(255, 255, 255);
+      // Soft edge, and never fully opaque
+      _highlightAlpha[y * HIGHLIGHT_SPRITE + x] = coverage((radius + 0.5f - d) / 3.0f) * 7 / 8;
+    }
+  }
+}
+
+void EyeRenderer::setGaze(int offsetX, int offsetY) {
+  long squared = (long)offsetX * offsetX + (long)offsetY * offsetY;
+  if (squared > (long)TRAVEL * TRAVEL) {
+    float scale = TRAVEL / sqrtf((float)squared);
+    offsetX = (int)(offsetX * scale);
+    offsetY = (int)(offsetY * scale);
+  }
+  _gazeX = offsetX;
+  _gazeY = offsetY;
+}
+
+void EyeRenderer::setOpenness(uint8_t openness) {
+  _openness = openness;
+}
+
+void EyeRenderer::invalidate() {
+  _valid = false;
+}
+
+void EyeRenderer::_lidRows(uint8_t openness, int& top, int& bottom) const {
+  int half = (SIZE / 2) * openness / 255;
+  top = SIZE / 2 - half;
+  bottom = SIZE / 2 + half;
+}
+
+// Rows [from, to), as wide as the disc is anywhere in them
+void EyeRenderer::_addRows(int from, int to, EyeRect* dirty, int& count) const {
+  if (from < 0) from = 0;
+  if (to > SIZE) to = SIZE;
+  if (from >= to) return;
+  // The disc is widest at the row nearest the centre
+  int widest = from >= SIZE / 2 ? from : (to <= SIZE / 2 ? to - 1 : SIZE / 2);
+  int x = _spans.spanX(widest);
+  dirty[count++] = {(int16_t)x, (int16_t)from, (int16_t)_spans.spanWidth(widest), (int16_t)(to - from)};
+}
+
+static EyeRect clipToPanel(int x, int y, int w, int h, int size) {
+  int right = x + w, bottom = y + h;
+  if (x < 0) x = 0;
+  if (y < 0) y = 0;
+  if (right > size) right = size;
+  if (bottom > size) bottom = size;
+  return {(int16_t)x, (int16_t)y, (int16_t)(right - x), (int16_t)(bottom - y)};
+}
+
+int EyeRenderer::nextFrame(EyeRect* dirty) {
+  const int centre = SIZE / 2 - IRIS_SPRITE / 2;
+  int irisX = centre + _gazeX;
+  int irisY = centre + _gazeY;
+  // The highlight slides a little against the iris, as a reflection would
+  int highlightX = irisX + IRIS_SPRITE / 2 + HIGHLIGHT_OFFSET - HIGHLIGHT_SPRITE / 2 - _gazeX / 4;
+  int highlightY = irisY + IRIS_SPRITE / 2 + HIGHLIGHT_OFFSET - HIGHLIGHT_SPRITE / 2 - _gazeY / 4;
+  int lidTop, lidBottom;
+  _lidRows(_openness, lidTop, lidBottom);
+
+  int count = 0;
+  if (!_valid) {
+    dirty[count++] = {0, 0, SIZE, SIZE};
+  } else {
+    // The highlight never leaves the iris sprite, so the iris rects cover it
+    if (irisX != _irisX || irisY != _irisY) {
+      int dx = irisX - _irisX, dy = irisY - _irisY;
+      if (dx < IRIS_SPRITE && dx > -IRIS_SPRITE && dy < IRIS_SPRITE && dy > -IRIS_SPRITE) {
+        // Overlapping: one rect over both positions
+        int x = irisX < _irisX ? irisX : _irisX;
+        int y = irisY < _irisY ? irisY : _irisY;
+        dirty[count++] = clipToPanel(x, y, IRIS_SPRITE + (dx < 0 ? -dx : dx), IRIS_SPRITE + (dy < 0 ? -dy : dy), SIZE);
+      } else {
+        dirty[count++] = clipToPanel(_irisX, _irisY, IRIS_SPRITE, IRIS_SPRITE, SIZE);
+        dirty[count++] = clipToPanel(irisX, irisY, IRIS_SPRITE, IRIS_SPRITE, SIZE);
+      }
+    }
+    // Lid edges, including the lash band that moves with them
+    if (lidTop != _lidTop) {
+      int from = lidTop < _lidTop ? lidTop : _lidTop;
+      int to = lidTop < _lidTop ? _lidTop : lidTop;
+      _addRows(from - LASH_ROWS, to, dirty, count);
+    }
+    if (lidBottom != _lidBottom) {
+      int from = lidBottom < _lidBottom ? lidBottom : _lidBottom;
+      int to = lidBottom < _lidBottom ? _lidBottom : lidBottom;
+      _addRows(from, to + LASH_ROWS, dirty, count);
+    }
+  }
+
+  _valid = true;
+  _irisX = irisX;
+  _irisY = irisY;
+  _highlightX = highlightX;
+  _highlightY = highlightY;
+  _lidTop = lidTop;
+  _lidBottom = lidBottom;
+  return count;
+}
+
+void EyeRenderer::compose(const EyeRect& rect, uint16_t* out) const {
+  for (int row = 0; row < rect.h; row++) {
+    int y = rect.y + row;
+    int spanStart = _spans.spanX(y);
+    int spanEnd = spanStart + _spans.spanWidth(y);
+
+    // Rows under a lid are one colour all the way across
+    uint16_t lid = 0;
+    bool underLid = false;
+    if (y < _lidTop) {
+      underLid = true;
+      lid = y >= _lidTop - LASH_ROWS ? LASH_COLOR : LID_COLOR;
+    } else if (y >= _lidBottom) {
+      underLid = true;
+      lid = y < _lidBottom + LASH_ROWS ? LASH_COLOR : LID_COLOR;
+    }
+
+    int irisRow = y - _irisY;
+    bool irisOnRow = irisRow >= 0 && irisRow < IRIS_SPRITE;
+    int highlightRow = y - _highlightY;
+    bool highlightOnRow = highlightRow >= 0 && highlightRow < HIGHLIGHT_SPRITE;
+
+    uint16_t* line = out + row * rect.w;
+    for (int column = 0; column < rect.w; column++) {
+      int x = rect.x + column;
+      if (x < spanStart || x >= spanEnd) {
+        line[column] = 0;
+        continue;
+      }
+      if (underLid) {
+        line[column] = lid;
+        continue;
+      }
+
+      uint16_t colour = SCLERA_COLOR;
+      int irisColumn = x - _irisX;
+      if (irisOnRow && irisColumn >= 0 && irisColumn < IRIS_SPRITE) {
+        int i = irisRow * IRIS_SPRITE + irisColumn;
+        uint8_t alpha = _irisAlpha[i];
+        if (alpha == 255) {
+          colour = _iris[i];
+        } else if (alpha) {
+          colour = blend565(colour, _iris[i], alpha);
+        }
+      }
+      int highlightColumn = x - _highlightX;
+      if (highlightOnRow && highlightColumn >= 0 && highlightColumn < HIGHLIGHT_SPRITE) {
+        int i = highlightRow * HIGHLIGHT_SPRITE + highlightColumn;
+        if (_highlightAlpha[i]) colour = blend565(colour, _highlight[i], _highlightAlpha[i]);
+      }
+      line[column] = colour;
+    }
+  }
+}
@@ -0,0 +1,79 @@
+// lib/ScreenController/EyeRenderer.h
+
+#ifndef EYE_RENDERER_H
+#define EYE_RENDERER_H
+
+#include <stdint.h>
+#include "RoundSpans.h"
+
+struct EyeRect {
+  int16_t x;
+  int16_t y;
+  int16_t w;
+  int16_t h;
+};
+
+// Draws the panel as an eyeball: sclera, an iris with its pupil and
+// highlight, and an upper and lower lid.
+//
+// The iris and highlight are rendered once, in the constructor, into
+// sprites with an alpha channel. A frame is then only the pixels that
+// changed: nextFrame() hands out the rectangles the iris and the lid edges
+// moved through since the last frame, and compose() fills one rectangle by
+// stacking sclera, sprites and lids, so the screen is never redrawn whole.
+//
+// tools/screen_bench runs it on the host, inside ScreenController.
+class EyeRenderer {
+public:
+  static const int SIZE = RoundSpans::SIZE;
+  static const int IRIS_RADIUS = 44;
+  static const int IRIS_SPRITE = 2 * IRIS_RADIUS + 2;
+  static const int HIGHLIGHT_SPRITE = 16;
+  // Furthest the iris centre gets from the panel centre
+  static const int TRAVEL = SIZE / 2 - IRIS_RADIUS - 16;
+  static const int MAX_DIRTY = 4;
+
+  explicit EyeRenderer(const RoundSpans& spans);
+
+  // Iris centre as an offset from the panel centre, in pixels. Anything
+  // beyond TRAVEL is pulled back onto that circle.
+  void setGaze(int offsetX, int offsetY);
+  // 0 is shut, 255 wide open.
+  void setOpenness(uint8_t openness);
+  // Forces the next frame to repaint the whole panel.
+  void invalidate();
+
+  // Takes the current gaze and lids as drawn and writes the rectangles that
+  // need repainting into 'dirty' (MAX_DIRTY at most). Returns how many.
+  int nextFrame(EyeRect* dirty);
+
+  // Fills 'out' (w * h RGB565 pixels, row by row) with the eye as drawn.
+  // Pixels outside the visible disc come out black.
+  void compose(const EyeRect& rect, uint16_t* out) const;
+
+private:
+  void _renderIris();
+  void _renderHighlight();
+  void _lidRows(uint8_t openness, int& top, int& bottom) const;
+  void _addRows(int from, int to, EyeRect* dirty, int& count) const;
+
+  const RoundSpans& _spans;
+
+  uint16_t _iris[IRIS_SPRITE * IRIS_SPRITE];
+  uint8_t _irisAlpha[IRIS_SPRITE * IRIS_SPRITE];
+  uint16_t _highlight[HIGHLIGHT_SPRITE * HIGHLIGHT_SPRITE];
+  uint8_t _highlightAlpha[HIGHLIGHT_SPRITE * HIGHLIGHT_SPRITE];
+
+  // Requested state
+  int _gazeX, _gazeY;
+  uint8_t _openness;
+
+  // State of the last frame handed out; compose() draws this
+  bool _valid;
+  int _irisX, _irisY;           // Top left of the iris sprite
+  int _highlightX, _highlightY; // Top left of the highlight sprite
+  int _lidTop;                  // First row below the upper lid
+  int _lidBottom;               // First row of the lower lid
+};
+
+#endif // EYE_RENDERER_H
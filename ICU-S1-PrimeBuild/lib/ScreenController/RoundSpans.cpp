@@ -0,0 +1,36 @@
+// lib/ScreenController/RoundSpans.cpp
+
+#include "RoundSpans.h"
+#include <math.h>
+
+RoundSpans::RoundSpans() {
+  const float radius = SIZE / 2.0f;
+  _visiblePixels = 0;
+
+  for (int y = 0; y < SIZE; y++) {
+    float dy = y + 0.5f - radius;
+    float half = sqrtf(radius * radius - dy * dy);
+    // First and last pixel whose centre is inside the circle
+    int first = (int)ceilf(radius - half - 0.5f);
+    int last = (int)floorf(radius + half - 0.5f);
+    if (first < 0) first = 0;
+    if (last > SIZE - 1) last = SIZE - 1;
+    _spanX[y] = first;
+    _spanWidth[y] = last >= first ? last - first + 1 : 0;
+    _visiblePixels += _spanWidth[y];
+  }
+
+  // Merge rows with identical spans into one run each
+  _runCount = 0;
+  for (int y = 0; y < SIZE; y++) {
+    if (_spanWidth[y] == 0) continue;
+    if (_runCount > 0) {
+      SpanRun& last = _runs[_runCount - 1];
+      if (last.y + last.rows == y && last.x == _spanX[y] && last.width == _spanWidth[y]) {
+        last.rows++;
+        continue;
+      }
+    }
+    _runs[_runCount++] = {(uint8_t)y, 1, _spanX[y], _spanWidth[y]};
+  }
+}
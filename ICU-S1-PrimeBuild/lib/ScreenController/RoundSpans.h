@@ -0,0 +1,47 @@
+// lib/ScreenController/RoundSpans.h
+
+#ifndef ROUND_SPANS_H
+#define ROUND_SPANS_H
+
+#include <stdint.h>
+
+// A run of consecutive rows that all have the same visible span. The panel
+// wraps writes inside its address window, so each run is one window.
+struct SpanRun {
+  uint8_t y;
+  uint8_t rows;
+  uint8_t x;
+  uint8_t width;
+};
+
+// The visible disc of the round GC9A01 panel, as one span per row and as
+// the fewest address windows that cover it exactly.
+//
+// A pixel is visible when its centre lies inside the circle inscribed in
+// the square panel. The table is built once, in the constructor.
+//
+// tools/screen_bench builds it on the host along with the rest of the screen code.
+class RoundSpans {
+public:
+  static const int SIZE = 240; // Panel width and height
+  static const int MAX_RUNS = SIZE;
+
+  RoundSpans();
+
+  int spanX(int y) const { return _spanX[y]; }
+  int spanWidth(int y) const { return _spanWidth[y]; }
+
+  int runCount() const { return _runCount; }
+  const SpanRun& run(int index) const { return _runs[index]; }
+
+  uint32_t visiblePixels() const { return _visiblePixels; }
+
+private:
+  uint8_t _spanX[SIZE];
+  uint8_t _spanWidth[SIZE];
+  SpanRun _runs[MAX_RUNS];
+  int _runCount;
+  uint32_t _visiblePixels;
+};
+
+#endif // ROUND_SPANS_H
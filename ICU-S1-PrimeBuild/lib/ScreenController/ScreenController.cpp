@@ -1,4 +1,9 @@
 #include "ScreenController.h"
+#include "LoopProfiler.h"
+#include "HeapGuard.h"
+#include "GazeTable.h"
+#include "ThumbCodec.h"
+#include "esp_heap_caps.h"
 
 // --- PIN DEFINITIONS ---
 #define TFT_SCLK 36
@@ -15,8 +20,29 @@ const unsigned long NAPPING_DURATION = 10000;
 const unsigned long FULLSLEEP_DURATION = 10000;
 const unsigned long SCANNING_TEXT_DURATION = 5000;
 const unsigned long SCANNING_ANIM_DURATION = 10000;
+const unsigned long SLEEP_PANEL_OFF_DELAY = 3000; // NAPPING/FULL_ASLEEP text stays up this long, then the panel sleeps
 int outterRingWidth = 10;
 
+// Bytes of GC9A01 commands per address window: CASET + 4, RASET + 4, RAMWR
+const int ADDRESS_WINDOW_BYTES = 11;
+const int BENCHMARK_CLEARS = 20;
+const int BENCHMARK_FRAMES = 20;
+// Eye mode
+const unsigned long EYE_FRAME_US = 16667; // 60 frames per second at most
+const float EYE_EASING = 0.35f;           // Share of the way to the target covered per frame
+const int EYE_SCRATCH_PIXELS = RoundSpans::SIZE * 36;
+// The eye faces the viewer and the camera faces the same way, so a face on
+// the left of the image is on the viewer's right of the panel.
+const bool EYE_MIRROR_X = true;
+// Camera view: the thumbnail drawn THUMB_VIEW_SCALE times over in the
+// middle of the panel, mirrored like the eye. Its corners are behind the bezel.
+const int THUMB_VIEW_SCALE = 4;
+const int THUMB_VIEW_ORIGIN = (RoundSpans::SIZE - THUMB_SIZE * THUMB_VIEW_SCALE) / 2;
+const int THUMB_VIEW_BAND_ROWS = 9; // Thumbnail rows composed per blit, 36 panel rows
+const uint16_t THUMB_BOX_COLOR = 0x07E0; // Green
+
+const int BENCHMARK_PARTIAL_SIZE = 64; // Side of the square redrawn by a partial update, about an eye's pupil
+
 // --- MESSAGES ---
 const char *scanningMessages[] = {
     "..SCANNING..", "WHERE ARE\nTHE HUMANS?", "COME OUT\nCOME OUT...", "I SEE YOU...", "DON'T BE SHY"};
@@ -35,8 +61,11 @@ int16_t getCenterX(Arduino_GFX *gfx, const char *text, uint8_t size) {
 }
 
 // Constructor
-ScreenController::ScreenController() {
+ScreenController::ScreenController() : _eye(_spans) {
   _bus = nullptr;
+#if ICU_DISPLAY_DMA
+  _dmaBus = nullptr;
+#endif
   _gfx = nullptr;
   _isInitialized = false; // Set to false on creation
   _currentState = SystemState::WAKE_UP;
@@ -48,12 +77,39 @@ ScreenController::ScreenController() {
   _detectionSubState = DisplaySubState::SHOWING_TEXT;
   _detectionLastSubStateChangeTime = 0;
   _detectionMessageIndex = 0;
+  _panelOn = true;
+  _eyeScratch = nullptr;
+  _eyeMode = false;
+  _eyeX = 0;
+  _eyeY = 0;
+  _eyeTargetX = 0;
+  _eyeTargetY = 0;
+  _lastEyeFrameUs = 0;
+  _cameraView = false;
+  _thumbPixels = nullptr;
+  _thumbDirtyFirst = THUMB_SIZE;
+  _thumbDirtyLast = -1;
+  _thumbBoxX = _thumbBoxY = _thumbBoxW = _thumbBoxH = 0;
 }
 
 // begin() method
 bool ScreenController::begin() {
-  _bus = new Arduino_ESP32SPI(TFT_DC, TFT_CS, TFT_SCLK, TFT_MOSI);
-  _gfx = new Arduino_GC9A01(_bus, TFT_RST);
+  // The SPI host is claimed once for good, so the bus outlives a return to WAKE_UP.
+  if (!_bus) {
+#if ICU_DISPLAY_DMA
+    _dmaBus = new DmaSpiBus(TFT_DC, TFT_CS, TFT_SCLK, TFT_MOSI);
+    _bus = _dmaBus;
+#else
+    _bus = new Arduino_ESP32SPI(TFT_DC, TFT_CS, TFT_SCLK, TFT_MOSI);
+#endif
+  }
+  if (!_gfx) {
+    _gfx = new Arduino_GC9A01(_bus, TFT_RST); // begin() runs again on every WAKE_UP
+  }
+  if (!_eyeScratch) {
+    // Internal RAM: compose() writes every pixel of it each frame
+    _eyeScratch = (uint16_t*)heap_caps_malloc(EYE_SCRATCH_PIXELS * 2, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+  }
 
 
   Serial.println("ScreenController initializing GFX...");
@@ -80,6 +136,8 @@ bool ScreenController::isInitialized() {
 
 // update() method with guard clause
 void ScreenController::update() {
+  PROFILE_SCOPE(ProfileSite::SCREEN_UPDATE);
+  HEAP_SCOPE(HeapSubsystem::SCREEN);
   if (!_isInitialized) {
     return; // Do nothing if begin() has not succeeded
   }
@@ -91,12 +149,28 @@ bool ScreenController::isWakeUpComplete() {
 }
 
 void ScreenController::setState(SystemState newState) {
+  PROFILE_SCOPE(ProfileSite::SCREEN_SET_STATE);
+  HEAP_SCOPE(HeapSubsystem::SCREEN);
   if (!_isInitialized) {
     return; // Don't try to change state on an uninitialized screen
   }
   _currentState = newState;
   _stateEnterTime = millis();
-  _gfx->fillScreen(BLACK);
+  if (!_panelOn) {
+    _gfx->displayOn();
+    _panelOn = true;
+  }
+  if (_cameraView && _showsCamera(newState)) {
+    _fillDisc(BLACK); // The bezel ring around the picture stays black
+    _thumbDirtyFirst = 0;
+    _thumbDirtyLast = THUMB_SIZE - 1;
+    return;
+  }
+  if (_eyeMode && _showsEye(newState)) {
+    _eye.invalidate(); // Repainted whole on the next update
+    return;
+  }
+  _fillDisc(BLACK);
 
   if (newState == SystemState::WAKE_UP) {
     _isWakeUpCompleteFlag = false;
@@ -123,6 +197,14 @@ void ScreenController::setState(SystemState newState) {
 }
 
 void ScreenController::runUpdate() {
+  if (_cameraView && _showsCamera(_currentState)) {
+    _drawThumbnail();
+    return;
+  }
+  if (_eyeMode && _showsEye(_currentState)) {
+    _updateEye();
+    return;
+  }
   switch (_currentState) {
     case SystemState::WAKE_UP:    _updateWakeUp();    break;
     case SystemState::SCANNING:   _updateScanning();  break;
@@ -133,15 +215,17 @@ void ScreenController::runUpdate() {
   }
 }
 
-void ScreenController::_drawCenteredMultiLineText(const String &text, int y_center, uint8_t size) {
+// Lines are copied out one at a time into a stack buffer, so no String (and
+// no heap) is involved. Longer lines than the buffer are cut, but at text
+// size 3 the panel only has room for about 13 characters anyway.
+void ScreenController::_drawCenteredMultiLineText(const char *text, int y_center, uint8_t size) {
   _gfx->setTextSize(size);
   int16_t x;
-  String line;
-  String remaining_text = text;
+  char line[32];
   int current_line = 0;
   int line_count = 1;
-  for (unsigned int i = 0; i < text.length(); i++) {
-    if (text.charAt(i) == '\n') line_count++;
+  for (const char *c = text; *c; c++) {
+    if (*c == '\n') line_count++;
   }
   int16_t x1, y1;
   uint16_t w, h;
@@ -149,16 +233,15 @@ void ScreenController::_drawCenteredMultiLineText(const String &text, int y_cent
   int total_height = h * line_count + (4 * (line_count - 1));
   int start_y = y_center - (total_height / 2);
 
-  while (remaining_text.length() > 0) {
-    int newline_index = remaining_text.indexOf('\n');
-    if (newline_index == -1) {
-      line = remaining_text;
-      remaining_text = "";
-    } else {
-      line = remaining_text.substring(0, newline_index);
-      remaining_text = remaining_text.substring(newline_index + 1);
-    }
-    x = getCenterX(_gfx, line.c_str(), size);
+  const char *remaining_text = text;
+  while (*remaining_text) {
+    const char *newline = strchr(remaining_text, '\n');
+    size_t length = newline ? (size_t)(newline - remaining_text) : strlen(remaining_text);
+    size_t kept = min(length, sizeof(line) - 1);
+    memcpy(line, remaining_text, kept);
+    line[kept] = '\0';
+    remaining_text += newline ? length + 1 : length;
+    x = getCenterX(_gfx, line, size);
     _gfx->setCursor(x, start_y + (current_line * (h + 4)));
     _gfx->println(line);
     current_line++;
@@ -186,7 +269,7 @@ void ScreenController::_updateScanning() {
     if (now - _scanningLastSubStateChangeTime > SCANNING_TEXT_DURATION) {
       _scanningSubState = DisplaySubState::SHOWING_ANIMATION;
       _scanningLastSubStateChangeTime = now;
-      _gfx->fillScreen(BLACK);
+      _fillDisc(BLACK);
     }
   } else if (_scanningSubState == DisplaySubState::SHOWING_ANIMATION) {
     int centerX = _gfx->width() / 2;
@@ -205,7 +288,7 @@ void ScreenController::_updateScanning() {
     if (now - _scanningLastSubStateChangeTime > SCANNING_ANIM_DURATION) {
       _scanningSubState = DisplaySubState::SHOWING_TEXT;
       _scanningLastSubStateChangeTime = now;
-      _gfx->fillScreen(BLACK);
+      _fillDisc(BLACK);
       _scanningMessageIndex = (_scanningMessageIndex + 1) % numScanningMessages;
       _gfx->setTextColor(CYAN);
       _drawCenteredMultiLineText(scanningMessages[_scanningMessageIndex], 120, 3);
@@ -225,7 +308,7 @@ void ScreenController::_updateDetection() {
   }
   if (now - _detectionLastSubStateChangeTime > DETECTION_TEXT_DURATION) {
     _detectionLastSubStateChangeTime = now;
-    _gfx->fillScreen(BLACK);
+    _fillDisc(BLACK);
     _detectionMessageIndex = (_detectionMessageIndex + 1) % numDetectionMessages;
     _gfx->setTextColor(RED);
     _drawCenteredMultiLineText(detectionMessages[_detectionMessageIndex], 120, 3);
@@ -233,6 +316,7 @@ void ScreenController::_updateDetection() {
 }
 
 void ScreenController::_updateNapping() {
+  if (_sleepPanel()) return;
   unsigned long now = millis();
   float pulse = (sin(now / 800.0f) + 1.0f) / 2.0f;
   uint8_t blueValue = 20 + (180 * pulse);
@@ -245,6 +329,7 @@ void ScreenController::_updateNapping() {
 }
 
 void ScreenController::_updateFullSleep() {
+  if (_sleepPanel()) return;
   unsigned long now = millis();
   float pulse = (sin(now / 800.0f) + 1.0f) / 2.0f;
   uint8_t blueValue = 20 + (180 * pulse);
@@ -257,12 +342,305 @@ void ScreenController::_updateFullSleep() {
   }
 }
 
-void ScreenController::_updateError(const String &text) {
+bool ScreenController::isPanelOn() {
+  return _panelOn;
+}
+
+// Once the sleep text has been up for a while, blank the panel and put it to
+// sleep. Returns true while the panel is off, so nothing more is drawn.
+bool ScreenController::_sleepPanel() {
+  if (!_panelOn) return true;
+  if (millis() - _stateEnterTime < SLEEP_PANEL_OFF_DELAY) return false;
+  _fillDisc(BLACK);
+  _waitForPanel();
+  _gfx->displayOff();
+  _panelOn = false;
+  return true;
+}
+
+void ScreenController::_updateError(const char *text) {
   unsigned long now = millis();
   float pulse = (sin(now / 200.0f) + 1.0f) / 2.0f;
   uint8_t redValue = 100 + (155 * pulse);
   uint16_t pulseColor = _gfx->color565(redValue, 0, 0);
-  _gfx->fillScreen(pulseColor);
+  _fillDisc(pulseColor);
   _gfx->setTextColor(WHITE);
-  _drawCenteredMultiLineText("ERROR\n" + text, 120, 3);
-}
\ No newline at end of file
+  char message[32];
+  snprintf(message, sizeof(message), "ERROR\n%s", text);
+  _drawCenteredMultiLineText(message, 120, 3);
+}
+void ScreenController::setEyeMode(bool enabled) {
+  if (enabled == _eyeMode || (enabled && !_eyeScratch)) return;
+  _eyeMode = enabled;
+  _eye.invalidate();
+  if (_isInitialized) {
+    setState(_currentState); // Back to the state's own drawing when leaving
+  }
+}
+
+bool ScreenController::isEyeMode() {
+  return _eyeMode;
+}
+
+void ScreenController::setGaze(int imageX, int imageY) {
+  const int half = GAZE_IMAGE_SIZE / 2;
+  int dx = EYE_MIRROR_X ? half - imageX : imageX - half;
+  _eyeTargetX = dx * EyeRenderer::TRAVEL / half;
+  _eyeTargetY = (imageY - half) * EyeRenderer::TRAVEL / half;
+}
+
+void ScreenController::setEyelid(uint8_t openness) {
+  _eye.setOpenness(openness);
+}
+
+void ScreenController::setCameraView(bool enabled) {
+  if (enabled == _cameraView || (enabled && !_eyeScratch)) return;
+  _cameraView = enabled;
+  _eye.invalidate();
+  if (_isInitialized) {
+    setState(_currentState); // Repaints whatever the state now shows
+  }
+}
+
+bool ScreenController::isCameraView() {
+  return _cameraView;
+}
+
+void ScreenController::showThumbnail(const uint8_t* pixels, int firstRow, int lastRow, int boxX, int boxY,
+                                     int boxW, int boxH) {
+  _thumbPixels = pixels;
+  // The rows the old box was drawn on need drawing without it
+  if (_thumbBoxW > 0 && (boxX != _thumbBoxX || boxY != _thumbBoxY || boxW != _thumbBoxW || boxH != _thumbBoxH)) {
+    firstRow = min(firstRow, _thumbBoxY);
+    lastRow = max(lastRow, _thumbBoxY + _thumbBoxH - 1);
+  }
+  if (boxW > 0) {
+    firstRow = min(firstRow, boxY);
+    lastRow = max(lastRow, boxY + boxH - 1);
+  }
+  _thumbBoxX = boxX;
+  _thumbBoxY = boxY;
+  _thumbBoxW = boxW;
+  _thumbBoxH = boxH;
+  _thumbDirtyFirst = max(0, min(_thumbDirtyFirst, firstRow));
+  _thumbDirtyLast = min(THUMB_SIZE - 1, max(_thumbDirtyLast, lastRow));
+}
+
+bool ScreenController::_showsCamera(SystemState state) {
+  return _showsEye(state);
+}
+
+// Only the rows that changed are sent, a band at a time through the eye's
+// scratch buffer: a few bands per thumbnail at most, instead of the panel.
+void ScreenController::_drawThumbnail() {
+  if (!_thumbPixels || _thumbDirtyFirst > _thumbDirtyLast) return;
+  uint16_t palette[THUMB_LEVELS];
+  for (int i = 0; i < THUMB_LEVELS; i++) {
+    int v = i * 255 / (THUMB_LEVELS - 1);
+    palette[i] = _gfx->color565(v, v, v);
+  }
+  const int width = THUMB_SIZE * THUMB_VIEW_SCALE;
+  bool box = _thumbBoxW > 0;
+  int boxLeft = _thumbBoxX, boxRight = _thumbBoxX + _thumbBoxW - 1;
+  int boxTop = _thumbBoxY, boxBottom = _thumbBoxY + _thumbBoxH - 1;
+
+  for (int row = _thumbDirtyFirst; row <= _thumbDirtyLast; row += THUMB_VIEW_BAND_ROWS) {
+    int rows = min(THUMB_VIEW_BAND_ROWS, _thumbDirtyLast + 1 - row);
+    for (int r = 0; r < rows; r++) {
+      int ty = row + r;
+      uint16_t* line = _eyeScratch + r * THUMB_VIEW_SCALE * width;
+      bool boxEdgeRow = box && (ty == boxTop || ty == boxBottom) && boxLeft <= boxRight;
+      bool boxRow = box && ty >= boxTop && ty <= boxBottom;
+      for (int sx = 0; sx < THUMB_SIZE; sx++) {
+        int tx = EYE_MIRROR_X ? THUMB_SIZE - 1 - sx : sx;
+        uint16_t colour = palette[_thumbPixels[ty * THUMB_SIZE + tx] & 0x0F];
+        if ((boxEdgeRow && tx >= boxLeft && tx <= boxRight) || (boxRow && (tx == boxLeft || tx == boxRight))) {
+          colour = THUMB_BOX_COLOR;
+        }
+        for (int k = 0; k < THUMB_VIEW_SCALE; k++) line[sx * THUMB_VIEW_SCALE + k] = colour;
+      }
+      for (int k = 1; k < THUMB_VIEW_SCALE; k++) {
+        memcpy(line + k * width, line, width * sizeof(uint16_t));
+      }
+    }
+    _gfx->draw16bitRGBBitmap(THUMB_VIEW_ORIGIN, THUMB_VIEW_ORIGIN + row * THUMB_VIEW_SCALE, _eyeScratch, width,
+                             rows * THUMB_VIEW_SCALE);
+  }
+  _thumbDirtyFirst = THUMB_SIZE;
+  _thumbDirtyLast = -1;
+}
+
+bool ScreenController::_showsEye(SystemState state) {
+  return state == SystemState::SCANNING || state == SystemState::DETECTION;
+}
+
+void ScreenController::_updateEye() {
+  unsigned long now = micros();
+  if (now - _lastEyeFrameUs < EYE_FRAME_US) return;
+  _lastEyeFrameUs = now;
+
+  // Detections come at the camera's rate; easing fills in the frames between
+  _eyeX += (_eyeTargetX - _eyeX) * EYE_EASING;
+  _eyeY += (_eyeTargetY - _eyeY) * EYE_EASING;
+  _eye.setGaze(lroundf(_eyeX), lroundf(_eyeY));
+  _drawEyeFrame();
+}
+
+uint32_t ScreenController::_drawEyeFrame() {
+  EyeRect dirty[EyeRenderer::MAX_DIRTY];
+  int count = _eye.nextFrame(dirty);
+  uint32_t pixels = 0;
+  for (int i = 0; i < count; i++) {
+    const EyeRect& rect = dirty[i];
+    if (rect.w <= 0 || rect.h <= 0) continue;
+    // The bus has copied the pixels once draw16bitRGBBitmap() returns, so
+    // the scratch buffer can be refilled straight away
+    int bandRows = EYE_SCRATCH_PIXELS / rect.w;
+    for (int y = 0; y < rect.h; y += bandRows) {
+      EyeRect band = {rect.x, (int16_t)(rect.y + y), rect.w, (int16_t)min(bandRows, rect.h - y)};
+      _eye.compose(band, _eyeScratch);
+      _gfx->draw16bitRGBBitmap(band.x, band.y, _eyeScratch, band.w, band.h);
+      pixels += (uint32_t)band.w * band.h;
+    }
+  }
+  return pixels;
+}
+
+// Clears only what can be seen: one address window per run of identical
+// spans, instead of pushing the 21% of the square hidden behind the bezel.
+void ScreenController::_fillDisc(uint16_t color) {
+  _gfx->startWrite();
+  for (int i = 0; i < _spans.runCount(); i++) {
+    const SpanRun& run = _spans.run(i);
+    _gfx->writeAddrWindow(run.x, run.y, run.width, run.rows);
+    _bus->writeRepeat(color, (uint32_t)run.width * run.rows);
+  }
+  _gfx->endWrite();
+}
+
+void ScreenController::_blitDisc(const uint16_t* pixels) {
+  _gfx->startWrite();
+  for (int i = 0; i < _spans.runCount(); i++) {
+    const SpanRun& run = _spans.run(i);
+    _gfx->writeAddrWindow(run.x, run.y, run.width, run.rows);
+    // The window wraps at its own width, so the rows of a run follow each other.
+    for (int row = 0; row < run.rows; row++) {
+      _bus->writePixels((uint16_t*)pixels + (run.y + row) * RoundSpans::SIZE + run.x, run.width);
+    }
+  }
+  _gfx->endWrite();
+}
+
+void ScreenController::_waitForPanel() {
+#if ICU_DISPLAY_DMA
+  _dmaBus->waitIdle();
+#endif
+}
+
+void ScreenController::benchmark(Print& out) {
+  if (!_isInitialized) {
+    out.println("SCREEN not initialized");
+    return;
+  }
+
+#if ICU_DISPLAY_DMA
+  out.println("SCREEN bus=dma");
+#else
+  out.println("SCREEN bus=esp32spi");
+#endif
+
+  unsigned long start = micros();
+  for (int i = 0; i < BENCHMARK_CLEARS; i++) {
+    _gfx->fillScreen(BLACK);
+  }
+  _waitForPanel();
+  unsigned long fullUs = (micros() - start) / BENCHMARK_CLEARS;
+
+  start = micros();
+  for (int i = 0; i < BENCHMARK_CLEARS; i++) {
+    _fillDisc(BLACK);
+  }
+  _waitForPanel();
+  unsigned long discUs = (micros() - start) / BENCHMARK_CLEARS;
+
+  uint32_t fullPixels = (uint32_t)RoundSpans::SIZE * RoundSpans::SIZE;
+  uint32_t discPixels = _spans.visiblePixels();
+  out.printf("SCREEN full_clear pixels=%lu bytes=%lu windows=1 us=%lu\n",
+             (unsigned long)fullPixels, (unsigned long)(fullPixels * 2 + ADDRESS_WINDOW_BYTES), fullUs);
+  out.printf("SCREEN disc_clear pixels=%lu bytes=%lu windows=%d us=%lu\n",
+             (unsigned long)discPixels, (unsigned long)(discPixels * 2 + _spans.runCount() * ADDRESS_WINDOW_BYTES),
+             _spans.runCount(), discUs);
+
+  // A frame's worth of source pixels, as an eye renderer would hold it
+  uint16_t* frame = (uint16_t*)ps_malloc(fullPixels * 2);
+  if (!frame) {
+    out.println("SCREEN no memory for a benchmark frame");
+    setState(_currentState);
+    return;
+  }
+  for (uint32_t i = 0; i < fullPixels; i++) {
+    frame[i] = (uint16_t)(i * 37);
+  }
+
+  start = micros();
+  for (int i = 0; i < BENCHMARK_FRAMES; i++) {
+    _gfx->draw16bitRGBBitmap(0, 0, frame, RoundSpans::SIZE, RoundSpans::SIZE);
+  }
+  _waitForPanel();
+  unsigned long frameUs = (micros() - start) / BENCHMARK_FRAMES;
+
+  start = micros();
+  for (int i = 0; i < BENCHMARK_FRAMES; i++) {
+    _blitDisc(frame);
+  }
+  _waitForPanel();
+  unsigned long discFrameUs = (micros() - start) / BENCHMARK_FRAMES;
+
+  // Partial updates land at a different spot each time, as a moving pupil would
+  const int partial = BENCHMARK_PARTIAL_SIZE;
+  const int travel = RoundSpans::SIZE - partial;
+  start = micros();
+  for (int i = 0; i < BENCHMARK_FRAMES; i++) {
+    int16_t x = (i * 29) % travel;
+    int16_t y = (i * 17) % travel;
+    _gfx->draw16bitRGBBitmap(x, y, frame, partial, partial);
+  }
+  _waitForPanel();
+  unsigned long partialUs = (micros() - start) / BENCHMARK_FRAMES;
+
+  free(frame);
+
+  // Eye frames with the iris sweeping round at tracking speed
+  uint32_t eyePixels = 0;
+  unsigned long eyeUs = 0;
+  if (_eyeScratch) {
+    _eye.invalidate();
+    _eye.setGaze(EyeRenderer::TRAVEL, 0);
+    _drawEyeFrame();
+    start = micros();
+    for (int i = 1; i <= BENCHMARK_FRAMES; i++) {
+      float angle = i * 0.15f;
+      _eye.setGaze(lroundf(EyeRenderer::TRAVEL * cosf(angle)), lroundf(EyeRenderer::TRAVEL * sinf(angle)));
+      eyePixels += _drawEyeFrame();
+    }
+    _waitForPanel();
+    eyeUs = (micros() - start) / BENCHMARK_FRAMES;
+    _eye.setGaze(lroundf(_eyeX), lroundf(_eyeY));
+    _eye.invalidate();
+  }
+
+  out.printf("SCREEN full_frame pixels=%lu us=%lu fps=%lu\n",
+             (unsigned long)fullPixels, frameUs, frameUs ? 1000000UL / frameUs : 0);
+  out.printf("SCREEN disc_frame pixels=%lu us=%lu fps=%lu\n",
+             (unsigned long)discPixels, discFrameUs, discFrameUs ? 1000000UL / discFrameUs : 0);
+  out.printf("SCREEN partial_frame pixels=%lu us=%lu fps=%lu\n",
+             (unsigned long)(partial * partial), partialUs, partialUs ? 1000000UL / partialUs : 0);
+  out.printf("SCREEN eye_frame pixels=%lu us=%lu fps=%lu\n",
+             (unsigned long)(eyePixels / BENCHMARK_FRAMES), eyeUs, eyeUs ? 1000000UL / eyeUs : 0);
+#if ICU_DISPLAY_DMA
+  _dmaBus->dumpStats(out);
+#endif
+
+  // Leave the screen as the current state expects it
+  setState(_currentState);
+}
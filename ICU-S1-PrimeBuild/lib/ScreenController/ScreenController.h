@@ -3,6 +3,21 @@
 
 #include <Arduino_GFX_Library.h>
 #include "ProjectState.h"
+#include "RoundSpans.h"
+#include "EyeRenderer.h"
+
+// Set to 1 to drive the panel through the queued DMA bus (DmaSpiBus) instead
+// of Arduino_ESP32SPI, which waits for every transfer. Off until the bench
+// firmware's figures for both on the robot say otherwise: DmaSpiBus queues
+// a transaction per GFX call, and the text and circles are drawn a pixel at
+// a time.
+#ifndef ICU_DISPLAY_DMA
+#define ICU_DISPLAY_DMA 0
+#endif
+
+#if ICU_DISPLAY_DMA
+#include "DmaSpiBus.h"
+#endif
 
 enum class DisplaySubState {
   SHOWING_TEXT,
@@ -20,11 +35,68 @@ public:
   // New public method to check if begin() has been run successfully
   bool isInitialized();
 
+  // Draws SCANNING and DETECTION as an eye that follows setGaze(), instead
+  // of text and rings. Only the region the iris or lids moved through is
+  // repainted, at up to 60 frames per second.
+  void setEyeMode(bool enabled);
+  bool isEyeMode();
+  // Where the face is, in the XIAO's 240x240 full-field image. Only stores
+  // the target, so the control loop can call it every tick.
+  void setGaze(int imageX, int imageY);
+  // 0 (shut) to 255 (open), normally ServoController::eyelidOpenness().
+  void setEyelid(uint8_t openness);
+
+  // Draws SCANNING and DETECTION as the XIAO's camera thumbnail, scaled up
+  // in grey with the face box in green. Takes precedence over the eye.
+  void setCameraView(bool enabled);
+  bool isCameraView();
+  // Call when XiaoFaceDetector::thumbnail() changed. 'pixels' must stay
+  // valid; rows firstRow..lastRow changed, and the box is in thumbnail pixels.
+  void showThumbnail(const uint8_t* pixels, int firstRow, int lastRow, int boxX, int boxY, int boxW, int boxH);
+
+  // False while the panel is asleep, in NAPPING or FULL_ASLEEP; the next
+  // setState() turns it back on.
+  bool isPanelOn();
+
+  // Times full-panel clears against visible-disc clears, then full-frame and
+  // partial-frame blits, and prints pixels, bytes, address windows and the
+  // time per operation. Each timed run ends once the last pixel is on the
+  // panel, not just queued.
+  void benchmark(Print& out);
+
 private:
   void runUpdate();
 
+  // Span-based drawing, clipped to the visible disc of the round panel
+  void _fillDisc(uint16_t color);
+  void _blitDisc(const uint16_t* pixels); // A full RoundSpans::SIZE square RGB565 frame
+  void _waitForPanel(); // Returns once every queued write has been sent
+  bool _sleepPanel();
+
+  bool _showsEye(SystemState state);
+  void _updateEye();
+  uint32_t _drawEyeFrame(); // Returns the pixels sent
+  bool _showsCamera(SystemState state);
+  void _drawThumbnail();
+
   Arduino_DataBus* _bus;
+#if ICU_DISPLAY_DMA
+  DmaSpiBus* _dmaBus; // Same object as _bus, for the calls GFX doesn't know about
+#endif
   Arduino_GFX* _gfx;
+  RoundSpans _spans;
+  bool _panelOn;
+  EyeRenderer _eye;
+  uint16_t* _eyeScratch; // Composition buffer for one band of a dirty rect
+  bool _eyeMode;
+  float _eyeX, _eyeY;          // Iris offset being drawn, eased toward the target
+  int _eyeTargetX, _eyeTargetY;
+  unsigned long _lastEyeFrameUs;
+  bool _cameraView;
+  const uint8_t* _thumbPixels; // nullptr until the first thumbnail
+  int _thumbDirtyFirst;        // Thumbnail rows still to draw; first > last for none
+  int _thumbDirtyLast;
+  int _thumbBoxX, _thumbBoxY, _thumbBoxW, _thumbBoxH;
   
   // New private flag to track initialization status
   bool _isInitialized;
@@ -46,8 +118,8 @@ private:
   void _updateDetection();
   void _updateNapping();
   void _updateFullSleep();
-  void _updateError(const String& text);
-  void _drawCenteredMultiLineText(const String& text, int y_center, uint8_t size);
+  void _updateError(const char* text);
+  void _drawCenteredMultiLineText(const char* text, int y_center, uint8_t size);
 };
 
 #endif // SCREEN_CONTROLLER_H
\ No newline at end of file
@@ -1,5 +1,9 @@
 #include "ServoController.h"
 #include <Wire.h>
+#include <Preferences.h>
+#include "LoopProfiler.h"
+#include "HeapGuard.h"
+#include "DeferredLog.h"
 
 // =================================================================
 // == SERVO CALIBRATION & CONFIGURATION                          ==
@@ -14,30 +18,37 @@
 const int PULSE_EYELID_OPEN   = map(2390, 0, 4095, PWM_MIN, PWM_MAX);
 const int PULSE_EYELID_CLOSED = map(3500, 0, 4095, PWM_MIN, PWM_MAX);
 
-const int PULSE_EYE_X_MIDDLE = 370;
-const int PULSE_EYE_X_LEFT   = 420;
-const int PULSE_EYE_X_RIGHT  = 350;
-
-const int PULSE_EYE_Y_MIDDLE = 370;
-const int PULSE_EYE_Y_UP     = 383; // <-- ADJUSTED VALUE
-const int PULSE_EYE_Y_DOWN   = 315;
+// The eye's PULSE_EYE_* limits are in GazeTable.h, with the default calibration they make
 
 // Animation Timing
 const int MIN_TIME_BETWEEN_BLINKS = 500;
 const int MAX_TIME_BETWEEN_BLINKS = 5000;
-const int MIN_TIME_BETWEEN_EYE_MOVES = 800;  // ms
-const int MAX_TIME_BETWEEN_EYE_MOVES = 3000; // ms
 const int BLINK_SHUT_DURATION = 190;
 const int SLOW_CLOSE_SPEED_DELAY = 10;
+const unsigned long SERVO_SETTLE_TIME = 300; // ms for the eye to reach the sleep position before the outputs are released
+
+// Gaze calibration storage. Bump the version if GazePulse or the grid sizes change.
+const char* GAZE_NVS_NAMESPACE = "gaze";
+const uint8_t GAZE_NVS_VERSION = 1;
+
+// Scan heatmap storage. Saved on going to sleep, and every so often while
+// scanning in case the power goes first; NVS wears, so no more often.
+const char* SCAN_NVS_NAMESPACE = "scan";
+const uint8_t SCAN_NVS_VERSION = 1;
+const unsigned long SCAN_HEAT_SAVE_INTERVAL = 30UL * 60 * 1000; // ms
 // =================================================================
 
-ServoController::ServoController() : _pwm(Adafruit_PWMServoDriver()) {
+ServoController::ServoController() : _pwm(Adafruit_PWMServoDriver()), _output(_pwm) {
   _isInitialized = false;
   _currentState = SystemState::WAKE_UP;
+  _held = false;
   _lastBlinkTime = 0;
   _nextBlinkInterval = 0;
-  _lastEyeMoveTime = 0;
-  _nextEyeMoveInterval = 0;
+  _blinkShut = false;
+  _eyelidPulse = PULSE_EYELID_CLOSED;
+  _releasePending = false;
+  _releaseFrom = 0;
+  _lastHeatSave = 0;
 }
 
 bool ServoController::isInitialized() {
@@ -49,24 +60,32 @@ bool ServoController::begin() {
   Wire.begin(8, 9);
   
   _pwm.begin();
-  _pwm.setPWMFreq(SERVO_FREQ);
+  _output.begin(SERVO_FREQ);
 
   Serial.println("ServoController: Setting servos to 'Asleep' position.");
-  _pwm.setPWM(EYELID_CHANNEL, 0, PULSE_EYELID_CLOSED);
-  _pwm.setPWM(EYE_X_CHANNEL, 0, PULSE_EYE_X_MIDDLE);
-  _pwm.setPWM(EYE_Y_CHANNEL, 0, PULSE_EYE_Y_DOWN);
+  _setEyelid(PULSE_EYELID_CLOSED);
+  _output.set(EYE_X_CHANNEL, PULSE_EYE_X_MIDDLE);
+  _output.set(EYE_Y_CHANNEL, PULSE_EYE_Y_DOWN);
+  _output.flush();
+
+  _loadGazeTable();
+  _loadScanHeat();
+  _lastHeatSave = millis();
 
   _isInitialized = true;
   return true;
 }
 
 void ServoController::setState(SystemState newState) {
+  PROFILE_SCOPE(ProfileSite::SERVO_SET_STATE);
+  HEAP_SCOPE(HeapSubsystem::SERVO);
   if (!_isInitialized) return;
 
 
   _currentState = newState;
-  Serial.print("ServoController: New State -> ");
-  Serial.println((int)newState);
+  deferredLog.log(LOG_SERVO_NEW_STATE, (int)newState);
+  _releasePending = false; // Whatever comes next drives the servos again
+  if (_held) return;
 
   switch (_currentState) {
     case SystemState::WAKE_UP:
@@ -76,10 +95,10 @@ void ServoController::setState(SystemState newState) {
 
     case SystemState::SCANNING:
       // Initialize timers for both blinking and eye movement
+      _blinkShut = false;
       _lastBlinkTime = millis();
       _nextBlinkInterval = random(MIN_TIME_BETWEEN_BLINKS, MAX_TIME_BETWEEN_BLINKS);
-      _lastEyeMoveTime = millis();
-      _nextEyeMoveInterval = random(MIN_TIME_BETWEEN_EYE_MOVES, MAX_TIME_BETWEEN_EYE_MOVES);
+      _scanPlanner.restart(millis());
       break;
       
     case SystemState::DETECTION:
@@ -92,6 +111,11 @@ void ServoController::setState(SystemState newState) {
     case SystemState::FULL_ASLEEP:
       _closeEyelids();
       _moveEyeTo(PULSE_EYE_X_MIDDLE, PULSE_EYE_Y_DOWN);
+      _output.flush();
+      // Released from update() once the move has had time to finish under power
+      _releasePending = true;
+      _releaseFrom = millis();
+      _saveScanHeat();
       break;
     
     default:
@@ -100,63 +124,214 @@ void ServoController::setState(SystemState newState) {
 }
 
 void ServoController::update() {
+  PROFILE_SCOPE(ProfileSite::SERVO_UPDATE);
+  HEAP_SCOPE(HeapSubsystem::SERVO);
   if (!_isInitialized) return;
 
-  
+  if (_releasePending && millis() - _releaseFrom >= SERVO_SETTLE_TIME) {
+    _releasePending = false;
+    _releaseServos();
+  }
 
-  // The update loop is for continuous actions within a state
+  // The update loop is for continuous actions within a state; a held eye has none
   switch (_currentState) {
     case SystemState::SCANNING:
-      _handleScanningState();
+      if (!_held) _handleScanningState();
       break;
     default:
       break;
   }
+
+  // Whatever changed this loop goes out as one frame, in time for the next PWM period
+  _output.service();
 }
 
 void ServoController::_openEyelids(bool instantly) {
   if (instantly) {
-    _pwm.setPWM(EYELID_CHANNEL, 0, PULSE_EYELID_OPEN); return;
-  }
-  for (int p = PULSE_EYELID_CLOSED; p >= PULSE_EYELID_OPEN; p--) {
-    _pwm.setPWM(EYELID_CHANNEL, 0, p); delay(SLOW_CLOSE_SPEED_DELAY / 2);
+    _setEyelid(PULSE_EYELID_OPEN); return;
   }
+  _rampEyelid(PULSE_EYELID_CLOSED, PULSE_EYELID_OPEN, (PULSE_EYELID_CLOSED - PULSE_EYELID_OPEN) * SLOW_CLOSE_SPEED_DELAY / 2);
 }
 
 void ServoController::_closeEyelids(bool instantly) {
   if (instantly) {
-    _pwm.setPWM(EYELID_CHANNEL, 0, PULSE_EYELID_CLOSED); return;
+    _setEyelid(PULSE_EYELID_CLOSED); return;
   }
-  for (int p = PULSE_EYELID_OPEN; p <= PULSE_EYELID_CLOSED; p++) {
-    _pwm.setPWM(EYELID_CHANNEL, 0, p); delay(SLOW_CLOSE_SPEED_DELAY);
+  _rampEyelid(PULSE_EYELID_OPEN, PULSE_EYELID_CLOSED, (PULSE_EYELID_CLOSED - PULSE_EYELID_OPEN) * SLOW_CLOSE_SPEED_DELAY);
+}
+
+// Slow eyelid movement, interpolated here one step per PWM period: the servo
+// cannot see finer steps than that, so there is no point writing them.
+void ServoController::_rampEyelid(int from, int to, unsigned long durationMs) {
+  unsigned long start = millis();
+  unsigned long elapsed;
+  while ((elapsed = millis() - start) < durationMs) {
+    _setEyelid(from + (long)(to - from) * (long)elapsed / (long)durationMs);
+    _output.flush();
   }
+  _setEyelid(to);
+  _output.flush();
+}
+
+void ServoController::_setEyelid(int pulse) {
+  _eyelidPulse = pulse;
+  _output.set(EYELID_CHANNEL, pulse);
+}
+
+// Once the lid is shut and the eye is down nothing needs holding, so the
+// outputs go full-off and the servos stop drawing holding current. The next
+// set() on a channel drives it again.
+void ServoController::_releaseServos() {
+  _output.set(EYELID_CHANNEL, ServoOutput::FULL_OFF);
+  _output.set(EYE_X_CHANNEL, ServoOutput::FULL_OFF);
+  _output.set(EYE_Y_CHANNEL, ServoOutput::FULL_OFF);
+  _output.flush();
+}
+
+uint8_t ServoController::eyelidOpenness() const {
+  long openness = map(_eyelidPulse, PULSE_EYELID_CLOSED, PULSE_EYELID_OPEN, 0, 255);
+  return constrain(openness, 0, 255);
 }
 
 void ServoController::_moveEyeTo(int pulseX, int pulseY) {
-  _pwm.setPWM(EYE_X_CHANNEL, 0, pulseX);
-  _pwm.setPWM(EYE_Y_CHANNEL, 0, pulseY);
+  _output.set(EYE_X_CHANNEL, pulseX);
+  _output.set(EYE_Y_CHANNEL, pulseY);
+}
+
+void ServoController::dumpOutputStats(Print& out) {
+  _output.dumpStats(out);
+}
+
+void ServoController::moveEyeTo(int pulseX, int pulseY) {
+  if (!_isInitialized) return;
+  _moveEyeTo(constrain(pulseX, PWM_MIN, PWM_MAX), constrain(pulseY, PWM_MIN, PWM_MAX));
+}
+
+void ServoController::holdForCalibration(bool held) {
+  if (!_isInitialized || held == _held) return;
+  _held = held;
+  if (held) {
+    _releasePending = false;
+    _openEyelids(true);
+    _moveEyeTo(PULSE_EYE_X_MIDDLE, PULSE_EYE_Y_MIDDLE);
+  } else {
+    setState(_currentState);
+  }
+}
+
+void ServoController::lookAt(int imageX, int imageY) {
+  if (!_isInitialized) return;
+  GazePulse pulse = _gazeTable.lookup(imageX, imageY);
+  _moveEyeTo(pulse.x, pulse.y);
+}
+
+const GazePulse* ServoController::getGazeCalibration() const {
+  return _gazeCalibration;
+}
+
+bool ServoController::saveGazeCalibration(const GazePulse* points) {
+  memcpy(_gazeCalibration, points, sizeof(_gazeCalibration));
+  _gazeTable.generate(_gazeCalibration);
+
+  Preferences prefs;
+  if (!prefs.begin(GAZE_NVS_NAMESPACE, false)) return false;
+  bool saved = prefs.putBytes("cal", _gazeCalibration, sizeof(_gazeCalibration)) == sizeof(_gazeCalibration) &&
+               prefs.putBytes("lut", _gazeTable.nodes(), sizeof(GazePulse) * GAZE_LUT_NODES * GAZE_LUT_NODES) > 0 &&
+               prefs.putUChar("ver", GAZE_NVS_VERSION) == 1;
+  prefs.end();
+  return saved;
+}
+
+// Loads the stored gaze table. A table from an older layout is regenerated from
+// its calibration points; with no calibration at all the hand-tuned limits are used.
+void ServoController::_loadGazeTable() {
+  const size_t lutSize = sizeof(GazePulse) * GAZE_LUT_NODES * GAZE_LUT_NODES;
+
+  Preferences prefs;
+  bool haveCalibration = false;
+  bool haveTable = false;
+  if (prefs.begin(GAZE_NVS_NAMESPACE, true)) {
+    haveCalibration = prefs.getBytesLength("cal") == sizeof(_gazeCalibration) &&
+                      prefs.getBytes("cal", _gazeCalibration, sizeof(_gazeCalibration)) == sizeof(_gazeCalibration);
+    haveTable = haveCalibration && prefs.getUChar("ver", 0) == GAZE_NVS_VERSION &&
+                prefs.getBytesLength("lut") == lutSize &&
+                prefs.getBytes("lut", _gazeTable.nodes(), lutSize) == lutSize;
+    prefs.end();
+  }
+
+  if (!haveCalibration) {
+    GazeTable::defaultCalibration(_gazeCalibration);
+  }
+  if (!haveTable) {
+    _gazeTable.generate(_gazeCalibration);
+  }
+  Serial.printf("ServoController: Gaze table %s.\n",
+                haveTable ? "loaded" : (haveCalibration ? "regenerated from calibration" : "using default limits"));
+}
+
+void ServoController::recordFace(int imageX, int imageY) {
+  _scanPlanner.recordFace(imageX, imageY);
+}
+
+void ServoController::_loadScanHeat() {
+  uint16_t heat[ScanPlanner::HEAT_CELLS];
+  bool loaded = false;
+  Preferences prefs;
+  if (prefs.begin(SCAN_NVS_NAMESPACE, true)) {
+    loaded = prefs.getUChar("ver", 0) == SCAN_NVS_VERSION &&
+             prefs.getBytesLength("heat") == sizeof(heat) &&
+             prefs.getBytes("heat", heat, sizeof(heat)) == sizeof(heat) &&
+             _scanPlanner.load(heat, ScanPlanner::HEAT_CELLS);
+    prefs.end();
+  }
+  if (loaded) {
+    Serial.printf("ServoController: Scan heatmap loaded, %.1f faces.\n", _scanPlanner.heatMass());
+  } else {
+    Serial.println("ServoController: No scan heatmap yet, sweeping evenly.");
+  }
+}
+
+// Only writes when faces have been recorded since the last save.
+void ServoController::_saveScanHeat() {
+  _lastHeatSave = millis();
+  if (!_scanPlanner.isDirty()) return;
+
+  const size_t size = sizeof(uint16_t) * ScanPlanner::HEAT_CELLS;
+  Preferences prefs;
+  if (!prefs.begin(SCAN_NVS_NAMESPACE, false)) return;
+  bool saved = prefs.putBytes("heat", _scanPlanner.heat(), size) == size &&
+               prefs.putUChar("ver", SCAN_NVS_VERSION) == 1;
+  prefs.end();
+  if (saved) {
+    _scanPlanner.clearDirty();
+    deferredLog.log(LOG_SERVO_SCAN_HEAT, _scanPlanner.heatMass(), _scanPlanner.bias());
+  }
 }
 
 void ServoController::_handleScanningState() {
-  // Check for blinking
-  if (millis() - _lastBlinkTime >= _nextBlinkInterval) {
-    _pwm.setPWM(EYELID_CHANNEL, 0, PULSE_EYELID_CLOSED);
-    delay(BLINK_SHUT_DURATION);
-    _pwm.setPWM(EYELID_CHANNEL, 0, PULSE_EYELID_OPEN);
-    
+  // Check for blinking. The lid stays shut across loop passes rather than
+  // in a delay(), so the screen can draw the blink while it happens.
+  if (_blinkShut) {
+    if (millis() - _lastBlinkTime >= BLINK_SHUT_DURATION) {
+      _setEyelid(PULSE_EYELID_OPEN);
+      _blinkShut = false;
+      _lastBlinkTime = millis();
+      _nextBlinkInterval = random(MIN_TIME_BETWEEN_BLINKS, MAX_TIME_BETWEEN_BLINKS);
+    }
+  } else if (millis() - _lastBlinkTime >= _nextBlinkInterval) {
+    _setEyelid(PULSE_EYELID_CLOSED);
+    _blinkShut = true;
     _lastBlinkTime = millis();
-    _nextBlinkInterval = random(MIN_TIME_BETWEEN_BLINKS, MAX_TIME_BETWEEN_BLINKS);
   }
 
-  // Check for random eye movement
-  if (millis() - _lastEyeMoveTime >= _nextEyeMoveInterval) {
-    //Serial.println("ServoController: Moving eye to new random position.");
-    // Pick a new random target within the calibrated safe zones
-    int newX = random(PULSE_EYE_X_RIGHT, PULSE_EYE_X_LEFT);
-    int newY = random(PULSE_EYE_Y_DOWN, PULSE_EYE_Y_UP);
-    _moveEyeTo(newX, newY);
+  // Move on along the scan once the eye has had long enough to look
+  int imageX, imageY;
+  if (_scanPlanner.update(millis(), imageX, imageY)) {
+    GazePulse pulse = _gazeTable.lookup(imageX, imageY);
+    _moveEyeTo(pulse.x, pulse.y);
+  }
 
-    _lastEyeMoveTime = millis();
-    _nextEyeMoveInterval = random(MIN_TIME_BETWEEN_EYE_MOVES, MAX_TIME_BETWEEN_EYE_MOVES);
+  if (millis() - _lastHeatSave >= SCAN_HEAT_SAVE_INTERVAL) {
+    _saveScanHeat();
   }
 }
\ No newline at end of file
@@ -3,6 +3,9 @@
 
 #include <Adafruit_PWMServoDriver.h>
 #include <ProjectState.h>
+#include "GazeTable.h"
+#include "ScanPlanner.h"
+#include "ServoOutput.h"
 
 class ServoController {
 public:
@@ -12,26 +15,65 @@ public:
   void setState(SystemState newState);
   bool isInitialized();
 
+  // Aims the eye at a point in the XIAO's 240x240 full-field image,
+  // through the calibrated gaze table.
+  void lookAt(int imageX, int imageY);
+  // Drives the eye servos directly, for calibration.
+  void moveEyeTo(int pulseX, int pulseY);
+  // While held the eyelids stay open and the eye only moves when told to;
+  // states set meanwhile are remembered, and the last one is applied again
+  // on release.
+  void holdForCalibration(bool held);
+
+  // How far open the eyelid was last commanded, 0 (shut) to 255 (open), so
+  // the screen can draw its lids in step with the servo.
+  uint8_t eyelidOpenness() const;
+
+  // The calibration points the gaze table was generated from.
+  const GazePulse* getGazeCalibration() const;
+  // Regenerates the gaze table from new calibration points and stores both in NVS.
+  bool saveGazeCalibration(const GazePulse* points);
+
+  // Teaches the scan where faces turn up: call with the centre of every
+  // confirmed face, in image pixels.
+  void recordFace(int imageX, int imageY);
+
+  // Prints output frame counters (frames, I2C writes, coalesced and dropped targets).
+  void dumpOutputStats(Print& out);
+
 private:
   // Internal action methods
   void _openEyelids(bool instantly = false);
   void _closeEyelids(bool instantly = false);
   void _moveEyeTo(int pulseX, int pulseY);
+  void _setEyelid(int pulse);
+  void _releaseServos();
+  void _rampEyelid(int from, int to, unsigned long durationMs);
+  void _loadGazeTable();
+  void _loadScanHeat();
+  void _saveScanHeat();
 
   // Animation handling
   void _handleScanningState();
 
   Adafruit_PWMServoDriver _pwm;
+  ServoOutput _output;
   bool _isInitialized;
+  GazeTable _gazeTable;
+  GazePulse _gazeCalibration[GAZE_CAL_POINTS];
   SystemState _currentState;
+  bool _held;
 
   // Timers for animations
   unsigned long _lastBlinkTime;
   unsigned long _nextBlinkInterval;
-  
-  // New timers for random eye movement
-  unsigned long _lastEyeMoveTime;
-  unsigned long _nextEyeMoveInterval;
+  bool _blinkShut;   // Mid-blink; _lastBlinkTime is when the lid shut
+  int _eyelidPulse;  // Last pulse sent to the eyelid
+  bool _releasePending;        // Going to sleep; release once the last move has settled
+  unsigned long _releaseFrom;  // millis() of that last move
+
+  ScanPlanner _scanPlanner;
+  unsigned long _lastHeatSave;
 };
 
 #endif // SERVO_CONTROLLER_H
\ No newline at end of file
@@ -0,0 +1,219 @@
+// lib/ServoController/ServoOutput.cpp
+
+#include "ServoOutput.h"
+
+// The Adafruit library's nominal figure; real chips are often a few percent fast.
+const uint32_t PCA9685_OSCILLATOR_HZ = 25000000;
+// Commit this long before the next period starts. It has to cover writing
+// every channel over I2C (about 0.6 ms each at 100 kHz).
+const unsigned long COMMIT_LEAD_US = 4000;
+// Sync edges timed at begin() to measure the oscillator, and how long to
+// wait for them before deciding the pin is not wired
+const uint32_t SYNC_MEASURE_PERIODS = 16;
+const unsigned long SYNC_TIMEOUT_MS = 1000;
+const uint16_t SYNC_PULSE = 2048; // High for the first half of every period
+
+// Written by the sync pin's interrupt
+static volatile uint32_t syncEdgeUs = 0;
+static volatile uint32_t syncEdges = 0;
+
+ServoOutput::ServoOutput(Adafruit_PWMServoDriver& pwm) : _pwm(pwm) {
+  _periodUs = 20000;
+  _phaseLocked = false;
+  _anchorUs = 0;
+  _anchorPeriod = 0;
+  _oscillatorHz = PCA9685_OSCILLATOR_HZ;
+  for (int i = 0; i < CHANNELS; i++) {
+    _target[i] = 0;
+    _committed[i] = 0;
+  }
+  _dirty = 0;
+  _known = 0;
+  _pendingPeriod = 0;
+  _lastCommitPeriod = 0;
+  _everCommitted = false;
+  _frames = 0;
+  _writes = 0;
+  _coalesced = 0;
+  _dropped = 0;
+  _late = 0;
+}
+
+void ServoOutput::begin(float frequency) {
+  _oscillatorHz = PCA9685_OSCILLATOR_HZ;
+  _pwm.setOscillatorFrequency(_oscillatorHz);
+  _pwm.setPWMFreq(frequency);
+  // The period the chip runs at, from the prescaler the library chose
+  _periodUs = (unsigned long)((uint64_t)(_pwm.readPrescale() + 1) * 4096 * 1000000 / _oscillatorHz);
+
+  _phaseLocked = false;
+#if ICU_PCA9685_SYNC_PIN >= 0
+  _phaseLocked = _measureOscillator(frequency);
+  Serial.printf("ServoOutput: %s\n",
+                _phaseLocked ? "Phase locked to the sync pin." : "No edges on the sync pin, frames unaligned.");
+#endif
+  if (!_phaseLocked) {
+    _anchorUs = micros();
+    _anchorPeriod = 0;
+  }
+
+  _dirty = 0;
+  _known = 0;
+  _everCommitted = false;
+}
+
+void IRAM_ATTR ServoOutput::_onSyncEdge() {
+  syncEdgeUs = micros();
+  syncEdges = syncEdges + 1;
+}
+
+// Times whole periods between sync edges, works out the oscillator that
+// gives them, and sets the prescaler again from it.
+bool ServoOutput::_measureOscillator(float frequency) {
+#if ICU_PCA9685_SYNC_PIN >= 0
+  _pwm.setPWM(SYNC_CHANNEL, 0, SYNC_PULSE);
+  pinMode(ICU_PCA9685_SYNC_PIN, INPUT);
+  attachInterrupt(digitalPinToInterrupt(ICU_PCA9685_SYNC_PIN), _onSyncEdge, RISING);
+
+  unsigned long start = millis();
+  uint32_t edges = syncEdges;
+  while (syncEdges == edges) {
+    if (millis() - start >= SYNC_TIMEOUT_MS) return false;
+  }
+  noInterrupts();
+  uint32_t firstUs = syncEdgeUs;
+  uint32_t firstEdges = syncEdges;
+  interrupts();
+  while (syncEdges - firstEdges < SYNC_MEASURE_PERIODS) {
+    if (millis() - start >= SYNC_TIMEOUT_MS) return false;
+  }
+  noInterrupts();
+  uint32_t lastUs = syncEdgeUs;
+  uint32_t lastEdges = syncEdges;
+  interrupts();
+
+  // The counter takes (prescale + 1) * 4096 oscillator cycles per period
+  uint64_t cycles = (uint64_t)(_pwm.readPrescale() + 1) * 4096 * (lastEdges - firstEdges);
+  _oscillatorHz = (uint32_t)(cycles * 1000000 / (lastUs - firstUs));
+  _pwm.setOscillatorFrequency(_oscillatorHz);
+  _pwm.setPWMFreq(frequency);
+  _periodUs = (unsigned long)((uint64_t)(_pwm.readPrescale() + 1) * 4096 * 1000000 / _oscillatorHz);
+
+  // setPWMFreq() restarted the counter; anchor on its first edge after that
+  edges = syncEdges;
+  start = millis();
+  while (syncEdges == edges) {
+    if (millis() - start >= SYNC_TIMEOUT_MS) return false;
+  }
+  return true;
+#else
+  (void)frequency;
+  return false;
+#endif
+}
+
+unsigned long ServoOutput::periodUs() const {
+  return _periodUs;
+}
+
+bool ServoOutput::isPhaseLocked() const {
+  return _phaseLocked;
+}
+
+void ServoOutput::set(uint8_t channel, uint16_t pulse) {
+  if (channel >= CHANNELS) return;
+  uint16_t bit = 1 << channel;
+
+  if (_dirty & bit) {
+    _coalesced++; // The earlier target never reaches the bus
+    if ((_known & bit) && pulse == _committed[channel]) {
+      _dirty &= ~bit; // Changed back before it went out
+      _target[channel] = pulse;
+      return;
+    }
+  } else if ((_known & bit) && pulse == _committed[channel]) {
+    _dropped++;
+    return;
+  }
+
+  if (_dirty == 0) _pendingPeriod = _periodIndex(micros());
+  _target[channel] = pulse;
+  _dirty |= bit;
+}
+
+// Phase locked, every sync edge is a fresh anchor. Otherwise the anchor
+// steps forward a whole number of periods, so the subtraction stays short of
+// wrapping however long the robot runs.
+uint32_t ServoOutput::_periodIndex(unsigned long nowUs) {
+  if (_phaseLocked) {
+    noInterrupts();
+    _anchorUs = syncEdgeUs;
+    _anchorPeriod = syncEdges;
+    interrupts();
+    if ((int32_t)(nowUs - _anchorUs) < 0) return _anchorPeriod; // An edge since nowUs was read
+  }
+  uint32_t periods = (uint32_t)(nowUs - _anchorUs) / _periodUs;
+  if (!_phaseLocked) {
+    _anchorUs += periods * _periodUs;
+    _anchorPeriod += periods;
+    return _anchorPeriod;
+  }
+  return _anchorPeriod + periods;
+}
+
+// Call after _periodIndex(), which moves the anchor up to date.
+bool ServoOutput::_inCommitWindow(unsigned long nowUs) const {
+  if (!_phaseLocked) return true;
+  int32_t sinceAnchor = (int32_t)(nowUs - _anchorUs);
+  if (sinceAnchor < 0) return false;
+  return (uint32_t)sinceAnchor % _periodUs >= _periodUs - COMMIT_LEAD_US;
+}
+
+bool ServoOutput::service() {
+  unsigned long now = micros();
+  uint32_t period = _periodIndex(now); // Keeps the anchor moving while idle
+  if (_dirty == 0) return false;
+  if (!_inCommitWindow(now)) return false;
+  if (_everCommitted && period == _lastCommitPeriod) return false;
+
+  _commit(period);
+  return true;
+}
+
+void ServoOutput::flush() {
+  if (_dirty == 0) return;
+
+  for (;;) {
+    unsigned long now = micros();
+    uint32_t period = _periodIndex(now);
+    if (_inCommitWindow(now) && (!_everCommitted || period != _lastCommitPeriod)) {
+      _commit(period);
+      return;
+    }
+    delayMicroseconds(200);
+  }
+}
+
+void ServoOutput::_commit(uint32_t period) {
+  if (period - _pendingPeriod > 1) _late++;
+
+  for (int channel = 0; channel < CHANNELS; channel++) {
+    uint16_t bit = 1 << channel;
+    if (!(_dirty & bit)) continue;
+    _pwm.setPWM(channel, 0, _target[channel]);
+    _committed[channel] = _target[channel];
+    _known |= bit;
+    _writes++;
+  }
+
+  _dirty = 0;
+  _lastCommitPeriod = period;
+  _everCommitted = true;
+  _frames++;
+}
+
+void ServoOutput::dumpStats(Print& out) {
+  out.printf("SERVO period_us=%lu osc_hz=%lu locked=%d frames=%lu writes=%lu coalesced=%lu dropped=%lu late=%lu\n",
+             _periodUs, (unsigned long)_oscillatorHz, _phaseLocked ? 1 : 0, (unsigned long)_frames, (unsigned long)_writes, (unsigned long)_coalesced,
+             (unsigned long)_dropped, (unsigned long)_late);
+}
@@ -0,0 +1,82 @@
+// lib/ServoController/ServoOutput.h
+
+#ifndef SERVO_OUTPUT_H
+#define SERVO_OUTPUT_H
+
+#include <Arduino.h>
+#include <Adafruit_PWMServoDriver.h>
+
+// A PCA9685 output wired back to a GPIO lets the output layer see the chip's
+// period start. Set to that GPIO to write frames in phase with the PWM
+// period; -1 leaves them unaligned.
+#ifndef ICU_PCA9685_SYNC_PIN
+#define ICU_PCA9685_SYNC_PIN -1
+#endif
+
+// The output layer between ServoController's motion code and the PCA9685.
+//
+// set() only records the target pulse for a channel. Pending targets are
+// written as one frame, at most once per PWM period.
+//
+// With ICU_PCA9685_SYNC_PIN wired, SYNC_CHANNEL drives a pulse that starts
+// every period, and an interrupt timestamps its rising edge. begin() times
+// those edges to measure the chip's real oscillator, and each edge then
+// re-anchors the period boundaries, so a frame goes out in the last few
+// milliseconds before the next period starts: after every servo pulse has
+// ended, so a write can never cut a pulse short or stretch it. Without the
+// pin the PCA9685's own oscillator (a few percent off nominal) gives nothing
+// to align to, so frames go out as soon as their period allows.
+class ServoOutput {
+public:
+  static const int CHANNELS = 16;
+  // A pulse that holds the channel low: the servo stops holding its position
+  static const uint16_t FULL_OFF = 4096;
+  static const uint8_t SYNC_CHANNEL = 15; // Drives ICU_PCA9685_SYNC_PIN when it is wired
+
+  explicit ServoOutput(Adafruit_PWMServoDriver& pwm);
+  void begin(float frequency);
+
+  void set(uint8_t channel, uint16_t pulse);
+
+  // Commits the pending frame if we are in this period's commit window.
+  // Call every loop; returns true if a frame was written.
+  bool service();
+  // Waits for the next commit window and commits, for blocking animations.
+  void flush();
+
+  unsigned long periodUs() const;
+  bool isPhaseLocked() const; // Frames are being timed from the sync pin
+  void dumpStats(Print& out);
+
+private:
+  static void IRAM_ATTR _onSyncEdge();
+  bool _measureOscillator(float frequency);
+  uint32_t _periodIndex(unsigned long nowUs);
+  bool _inCommitWindow(unsigned long nowUs) const;
+  void _commit(uint32_t period);
+
+  Adafruit_PWMServoDriver& _pwm;
+  unsigned long _periodUs;
+  bool _phaseLocked;
+  // A known period boundary, moved forward as time passes so that
+  // nowUs - _anchorUs stays well short of wrapping
+  unsigned long _anchorUs;
+  uint32_t _anchorPeriod;     // Periods counted up to _anchorUs
+  uint32_t _oscillatorHz;     // Measured, or the nominal figure
+
+  uint16_t _target[CHANNELS];
+  uint16_t _committed[CHANNELS];
+  uint16_t _dirty;            // One bit per channel with a pending change
+  uint16_t _known;            // One bit per channel the PCA9685 has been written
+  uint32_t _pendingPeriod;    // Period in which the current frame started collecting
+  uint32_t _lastCommitPeriod;
+  bool _everCommitted;
+
+  uint32_t _frames;           // Frames written
+  uint32_t _writes;           // Channel writes that reached the I2C bus
+  uint32_t _coalesced;        // Targets replaced before their frame went out
+  uint32_t _dropped;          // Targets equal to what the PCA9685 already has
+  uint32_t _late;             // Frames that missed at least one whole commit window
+};
+
+#endif // SERVO_OUTPUT_H
@@ -1,53 +1,513 @@
 // lib/XiaoFaceDetector/XiaoFaceDetector.cpp
 
 #include "XiaoFaceDetector.h"
+#include "LinkRecorder.h"
+#include "esp_timer.h"
+#include "esp_sleep.h"
+#include "driver/gpio.h"
+#include "DeferredLog.h"
+#include "HeapGuard.h"
 
 // We still use IO6 as the safe pin for receiving data
 #define RECEIVER_RX_PIN 6
-#define RECEIVER_TX_PIN 5 // Not used, but required by begin()
+#define RECEIVER_TX_PIN 5 // Carries baud negotiation requests to the XIAO
+#define LINK_UART UART_NUM_1
+
+const int UART_RX_BUFFER_SIZE = 4096;
+const int UART_TX_BUFFER_SIZE = 512;
+const int UART_EVENT_QUEUE_LENGTH = 32;
+const int PATTERN_QUEUE_LENGTH = 32;
+const int LINE_QUEUE_LENGTH = 8;
+const int RX_TASK_STACK_SIZE = 4096;
+const int RX_TASK_PRIORITY = 10;
+
+const unsigned long BAUD_REQUEST_INTERVAL = 1000; // ms between requests until the XIAO acks
+const int PARSE_ERRORS_BEFORE_FALLBACK = 5;       // At the fast rate, assume the XIAO rebooted
+
+const unsigned long PING_INTERVAL = 2000;         // ms between clock sync pings
+const unsigned long STARTUP_PING_INTERVAL = 250;  // Until the first filter window is full
+const uint32_t STARTUP_PINGS = 8;
+
+const unsigned long POWER_REQUEST_INTERVAL = 5000; // ms between requests until a heartbeat confirms
+const unsigned long SETTING_REQUEST_INTERVAL = 1000; // ms between resends of unanswered settings
+
+// Latencies go into unsigned histograms; a small negative value is clock sync error.
+static uint32_t elapsedUs(int64_t fromUs, int64_t toUs) {
+  return toUs > fromUs ? (uint32_t)(toUs - fromUs) : 0;
+}
 
 XiaoFaceDetector::XiaoFaceDetector() {
-  // Point our internal serial object to the hardware Serial1 port
-  _serial = &Serial1;
+  _isInitialized = false;
+  _driverInstalled = false;
+  _recorder = nullptr;
+  _uartEvents = nullptr;
+  _lines = nullptr;
+  _baud = LINK_DEFAULT_BAUD;
+  _fastBaudRefused = false;
+  _lastBaudRequest = 0;
+  _consecutiveParseErrors = 0;
+  _pingSeq = 0;
+  _pingSentUs = 0;
+  _lastPing = 0;
+  _powerMode = LINK_POWER_ACTIVE;
+  _powerConfirmed = true; // The XIAO boots active
+  _lastPowerRequest = 0;
+  for (int i = 0; i < LINK_SETTING_COUNT; i++) {
+    _settings[i] = LINK_SETTINGS[i].defaultValue;
+    _settingSeq[i] = 0;
+    _settingSentUs[i] = 0;
+  }
+  _nextSettingSeq = 0;
+  _lastAnsweredSeq = 0;
+  _lastSettingRequest = 0;
+  _settingsSent = 0;
+  _settingsRejected = 0;
+  _settingResyncs = 0;
+  _linkUp = true;
+  _lastHeartbeat = 0;
+  _linkDowns = 0;
+  _lastThumbDump = 0;
+  _thumbMessagesAtDump = 0;
+  _thumbCompletedAtDump = 0;
+  _thumbBytesAtDump = 0;
+  _linesReceived = 0;
+  _overflows = 0;
+  _droppedLines = 0;
+  _rxFlushRequested.store(false);
 }
 
 void XiaoFaceDetector::begin() {
-  long baud_rate = 115200;
-  _serial->begin(baud_rate, SERIAL_8N1, RECEIVER_RX_PIN, RECEIVER_TX_PIN);
+  if (!_driverInstalled) {
+    uart_config_t config = {};
+    config.baud_rate = LINK_DEFAULT_BAUD;
+    config.data_bits = UART_DATA_8_BITS;
+    config.parity = UART_PARITY_DISABLE;
+    config.stop_bits = UART_STOP_BITS_1;
+    config.flow_ctrl = UART_HW_FLOWCTRL_DISABLE;
+    config.source_clk = UART_SCLK_APB;
+
+    uart_driver_install(LINK_UART, UART_RX_BUFFER_SIZE, UART_TX_BUFFER_SIZE, UART_EVENT_QUEUE_LENGTH, &_uartEvents, 0);
+    uart_param_config(LINK_UART, &config);
+    uart_enable_pattern_det_baud_intr(LINK_UART, '\n', 1, 9, 0, 0);
+    uart_pattern_queue_reset(LINK_UART, PATTERN_QUEUE_LENGTH);
+
+    _lines = xQueueCreate(LINE_QUEUE_LENGTH, sizeof(RxLine));
+    xTaskCreatePinnedToCore(_rxTask, "xiaoRx", RX_TASK_STACK_SIZE, this, RX_TASK_PRIORITY, nullptr, 0);
+    _driverInstalled = true;
+  }
+
+  // Claim the pins on every begin(): LedController::begin() reconfigures IO6.
+  // The negotiated baud rate is kept, the XIAO has not changed its rate.
+  uart_set_pin(LINK_UART, RECEIVER_TX_PIN, RECEIVER_RX_PIN, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE);
+  // Wake from light sleep on a start bit. The UART is not clocked while we
+  // sleep, so the first byte of that line is lost, but the rest arrives.
+  gpio_wakeup_enable((gpio_num_t)RECEIVER_RX_PIN, GPIO_INTR_LOW_LEVEL);
+  esp_sleep_enable_gpio_wakeup();
+  // The XIAO gets a full timeout to send its first heartbeat
+  _linkUp = true;
+  _lastHeartbeat = millis();
+  _isInitialized = true;
+}
+
+bool XiaoFaceDetector::isInitialized() {
+  return _isInitialized;
+}
+
+void XiaoFaceDetector::setRecorder(LinkRecorder* recorder) {
+  _recorder = recorder;
+}
+
+const XiaoHealth& XiaoFaceDetector::getHealth() const {
+  return _parser.getHealth();
+}
+
+const ClockSync& XiaoFaceDetector::getClockSync() const {
+  return _clock;
+}
+
+ThumbDecoder& XiaoFaceDetector::thumbnail() {
+  return _parser.thumbnail();
 }
 
-// This is the core of the new logic.
 XiaoMessage XiaoFaceDetector::update() {
-  XiaoMessage message; // Create a new message, its type is NONE by default
+  HEAP_SCOPE(HeapSubsystem::LINK);
+  _maintainBaud();
+  _maintainPowerMode();
+  _maintainSettings();
+  if (_powerMode == LINK_POWER_ACTIVE) {
+    _maintainClockSync();
+  }
+
+  RxLine line;
+  if (xQueueReceive(_lines, &line, 0) != pdTRUE) {
+    // Nothing was received, so the message type is NONE.
+    _watchHeartbeat(NONE);
+    return XiaoMessage();
+  }
 
-  if (_serial->available()) {
-    String line = _serial->readStringUntil('\n');
-    
-    DeserializationError error = deserializeJson(doc, line);
+  _consumeLatencyUs.record((uint32_t)(esp_timer_get_time() - line.arrivalUs));
+  if (_recorder) {
+    _recorder->record((uint32_t)line.arrivalUs, (const uint8_t*)line.text, line.length);
+  }
 
-    if (error) {
-      // If JSON parsing fails, report it
-      message.type = PARSE_ERROR;
-      message.data = line; // Return the junk data for logging
+  XiaoMessage message = _parser.parseLine(line.text);
+  message.arrivalUs = line.arrivalUs;
+
+  if (message.type == PARSE_ERROR) {
+    // A run of garbage at the fast rate means the XIAO restarted at the default rate.
+    // Outside the active mode it means lines cut short by waking up, so it is ignored.
+    if (_powerMode == LINK_POWER_ACTIVE && ++_consecutiveParseErrors >= PARSE_ERRORS_BEFORE_FALLBACK &&
+        _baud != LINK_DEFAULT_BAUD) {
+      _setBaud(LINK_DEFAULT_BAUD);
+    }
+  } else {
+    _consecutiveParseErrors = 0;
+  }
+
+  if (message.type == BAUD_ACK) {
+    unsigned long acked = strtoul(message.data, nullptr, 10);
+    if (acked == LINK_FAST_BAUD) {
+      _setBaud(acked);
     } else {
-      // If JSON parsing succeeds, extract the action and data
-      const char* action = doc["action"];
-      const char* data_payload = doc["data"];
-      message.data = data_payload; // Store the data payload
-
-      // Convert the string "action" into our efficient enum type
-      if (strcmp(action, "detection") == 0) {
-        message.type = DETECTION;
-      } else if (strcmp(action, "alive") == 0) {
-        message.type = HEARTBEAT;
-      } else if (strcmp(action, "error") == 0) {
-        message.type = ERROR_XIAO;
-      } else {
-        message.type = UNKNOWN_ACTION;
-      }
+      _fastBaudRefused = true; // The XIAO answered with a rate it can't leave
     }
   }
-  
-  // Return the message. If nothing was received, its type will be NONE.
+
+  if (message.type == HEARTBEAT) {
+    // A XIAO that restarted is back in the active mode and has to be asked again.
+    // One without power modes reports none, and asking again would not help.
+    const char* requested = _parser.getHealth().powerRequested;
+    bool confirmed = requested[0] == '\0' || strcmp(requested, LINK_POWER_MODE_NAMES[_powerMode]) == 0;
+    if (!confirmed && _powerConfirmed) _lastPowerRequest = 0;
+    _powerConfirmed = confirmed;
+    _checkSettingsInSync();
+  }
+
+  if (message.type == SET_ACK) {
+    _handleSetAck(message, line.arrivalUs);
+  }
+
+  _watchHeartbeat(message.type);
+
+  if (message.type == PONG) {
+    _handlePong(message, line.arrivalUs);
+  }
+
+  if (message.type == DETECTION && message.hasCaptureTime && _clock.isSynced()) {
+    message.captureUs = _clock.xiaoToLocal(message.xiaoCaptureUs);
+    _captureToReceiveUs.record(elapsedUs(message.captureUs, message.arrivalUs));
+  }
+
   return message;
-}
\ No newline at end of file
+}
+
+bool XiaoFaceDetector::isLinkUp() const {
+  return _linkUp;
+}
+
+// Outside the active mode a heartbeat that lost its first byte to a wakeup
+// still shows the XIAO is alive.
+void XiaoFaceDetector::_watchHeartbeat(XiaoEventType received) {
+  if (received == HEARTBEAT || (received == PARSE_ERROR && _powerMode != LINK_POWER_ACTIVE)) {
+    _lastHeartbeat = millis();
+    if (!_linkUp) {
+      _linkUp = true;
+      deferredLog.log(LOG_LINK_UP);
+    }
+  } else if (_linkUp && millis() - _lastHeartbeat >= LINK_DOWN_TIMEOUT_MS) {
+    _linkUp = false;
+    _linkDowns++;
+    deferredLog.log(LOG_LINK_DOWN, (uint32_t)(millis() - _lastHeartbeat));
+  }
+}
+
+void XiaoFaceDetector::recordStateChange(const XiaoMessage& detection) {
+  int64_t now = esp_timer_get_time();
+  if (detection.arrivalUs != 0) _arrivalToStateUs.record(elapsedUs(detection.arrivalUs, now));
+  if (detection.captureUs != 0) _captureToStateUs.record(elapsedUs(detection.captureUs, now));
+}
+
+void XiaoFaceDetector::recordServoCommand(const XiaoMessage& detection) {
+  if (detection.captureUs == 0) return;
+  _captureToServoUs.record(elapsedUs(detection.captureUs, esp_timer_get_time()));
+}
+
+void XiaoFaceDetector::setPowerMode(LinkPowerMode mode) {
+  if (mode == _powerMode) return;
+  _powerMode = mode;
+  _powerConfirmed = false;
+  _lastPowerRequest = 0;
+  _maintainPowerMode();
+}
+
+void XiaoFaceDetector::_maintainPowerMode() {
+  if (_powerConfirmed || !_driverInstalled) return;
+  if (_lastPowerRequest != 0 && millis() - _lastPowerRequest < POWER_REQUEST_INTERVAL) return;
+  _lastPowerRequest = millis();
+
+  char request[48];
+  int length = snprintf(request, sizeof(request), "{\"action\":\"power\",\"data\":\"%s\"}\n",
+                        LINK_POWER_MODE_NAMES[_powerMode]);
+  uart_write_bytes(LINK_UART, request, length);
+}
+
+void XiaoFaceDetector::setDetectorSetting(LinkSetting setting, float value) {
+  _settings[setting] = value;
+  _sendSetting(setting);
+}
+
+float XiaoFaceDetector::detectorSetting(LinkSetting setting) const {
+  return _settings[setting];
+}
+
+void XiaoFaceDetector::_sendSetting(LinkSetting setting) {
+  // A resend gets a new seq, so a late answer to the old one is not mistaken for it.
+  // Before begin() the request just waits for _maintainSettings().
+  _settingSeq[setting] = ++_nextSettingSeq;
+  if (!_driverInstalled) return;
+  _settingSentUs[setting] = esp_timer_get_time();
+  _settingsSent++;
+
+  char request[64];
+  int length = snprintf(request, sizeof(request), "{\"action\":\"set\",\"data\":\"%lu,%s,%g\"}\n",
+                        (unsigned long)_settingSeq[setting], LINK_SETTINGS[setting].name, _settings[setting]);
+  uart_write_bytes(LINK_UART, request, length);
+}
+
+void XiaoFaceDetector::_maintainSettings() {
+  if (_lastSettingRequest != 0 && millis() - _lastSettingRequest < SETTING_REQUEST_INTERVAL) return;
+  _lastSettingRequest = millis();
+  for (int i = 0; i < LINK_SETTING_COUNT; i++) {
+    if (_settingSeq[i] != 0 && i != LINK_SET_PAUSE_MS) _sendSetting((LinkSetting)i);
+  }
+}
+
+// The set_ack's data is "seq,status".
+void XiaoFaceDetector::_handleSetAck(const XiaoMessage& message, int64_t arrivalUs) {
+  unsigned long seq = 0;
+  char status[8] = "";
+  if (sscanf(message.data, "%lu,%7s", &seq, status) != 2) return;
+  _lastAnsweredSeq = seq;
+  for (int i = 0; i < LINK_SETTING_COUNT; i++) {
+    if (_settingSeq[i] != seq) continue;
+    _settingSeq[i] = 0;
+    _settingAckUs.record(elapsedUs(_settingSentUs[i], arrivalUs));
+    if (strcmp(status, "ok") != 0) {
+      // Retrying would only be refused again
+      _settingsRejected++;
+      deferredLog.log(LOG_LINK_SETTING_REFUSED, i);
+    }
+  }
+}
+
+// The heartbeat carries the seq of the last setting the XIAO answered. If
+// that is not the last one we heard answered, and nothing is on its way,
+// the XIAO restarted with its defaults or we did with ours: send them all.
+void XiaoFaceDetector::_checkSettingsInSync() {
+  int64_t xiaoSeq = _parser.getHealth().configSeq;
+  if (xiaoSeq < 0 || xiaoSeq == _lastAnsweredSeq) return; // No settings on that firmware, or in sync
+  for (int i = 0; i < LINK_SETTING_COUNT; i++) {
+    if (_settingSeq[i] != 0 && i != LINK_SET_PAUSE_MS) return;
+  }
+  _settingResyncs++;
+  for (int i = 0; i < LINK_SETTING_COUNT; i++) {
+    if (i != LINK_SET_PAUSE_MS) _sendSetting((LinkSetting)i);
+  }
+  _lastSettingRequest = millis();
+}
+
+// Pings quickly until the clock sync has a full window, then every couple of seconds
+// to follow the drift. A ping whose pong never comes is simply replaced by the next.
+void XiaoFaceDetector::_maintainClockSync() {
+  unsigned long interval = _clock.sampleCount() < STARTUP_PINGS ? STARTUP_PING_INTERVAL : PING_INTERVAL;
+  if (_lastPing != 0 && millis() - _lastPing < interval) return;
+  _lastPing = millis();
+
+  char ping[48];
+  int length = snprintf(ping, sizeof(ping), "{\"action\":\"ping\",\"data\":\"%lu\"}\n", (unsigned long)++_pingSeq);
+  _pingSentUs = esp_timer_get_time(); // t1, as close to the write as we can get
+  uart_write_bytes(LINK_UART, ping, length);
+}
+
+// The pong's data is "seq,t2,t3": when the XIAO received our ping and when it
+// sent the answer, on its clock. Our arrival timestamp is t4.
+void XiaoFaceDetector::_handlePong(const XiaoMessage& message, int64_t arrivalUs) {
+  unsigned long seq = 0, t2 = 0, t3 = 0;
+  if (sscanf(message.data, "%lu,%lu,%lu", &seq, &t2, &t3) != 3) return;
+  if (_pingSentUs == 0 || seq != _pingSeq) return; // Stale or unexpected
+
+  _clock.addSample(_pingSentUs, (uint32_t)t2, (uint32_t)t3, arrivalUs);
+  _pingSentUs = 0;
+}
+
+// Until the XIAO has agreed to the fast rate, keep asking once a second.
+// It boots (and reboots) at the default rate, so there is no need to wait for it.
+void XiaoFaceDetector::_maintainBaud() {
+  if (_baud != LINK_DEFAULT_BAUD || _fastBaudRefused || LINK_FAST_BAUD == LINK_DEFAULT_BAUD) return;
+  if (_lastBaudRequest != 0 && millis() - _lastBaudRequest < BAUD_REQUEST_INTERVAL) return;
+  _lastBaudRequest = millis();
+
+  char request[48];
+  int length = snprintf(request, sizeof(request), "{\"action\":\"baud\",\"data\":\"%lu\"}\n", LINK_FAST_BAUD);
+  uart_write_bytes(LINK_UART, request, length);
+}
+
+void XiaoFaceDetector::_setBaud(unsigned long baud) {
+  uart_wait_tx_done(LINK_UART, pdMS_TO_TICKS(20));
+  uart_set_baudrate(LINK_UART, baud);
+  // Wake the RX task ahead of anything queued, so it drops the old rate's
+  // bytes before it reads any of the new one's
+  _rxFlushRequested.store(true);
+  uart_event_t wake = {};
+  wake.type = UART_EVENT_MAX;
+  xQueueSendToFront(_uartEvents, &wake, 0); // A full queue wakes it anyway
+  _baud = baud;
+  _consecutiveParseErrors = 0;
+  _lastBaudRequest = 0;
+}
+
+void XiaoFaceDetector::_rxTask(void* arg) {
+  XiaoFaceDetector* self = (XiaoFaceDetector*)arg;
+  uart_event_t event;
+
+  for (;;) {
+    if (xQueueReceive(self->_uartEvents, &event, portMAX_DELAY) != pdTRUE) continue;
+    if (self->_rxFlushRequested.exchange(false)) {
+      // Everything queued so far belongs to the old rate
+      self->_resyncRx();
+      continue;
+    }
+
+    switch (event.type) {
+      case UART_PATTERN_DET:
+        self->_readPatternLine();
+        break;
+
+      case UART_FIFO_OVF:
+      case UART_BUFFER_FULL:
+        // We fell behind: drop what is buffered and resynchronise on the next newline.
+        self->_resyncRx();
+        self->_overflows++;
+        break;
+
+      default:
+        // Plain UART_DATA events are ignored, the pattern interrupt marks complete lines.
+        // So is a wake from _setBaud() whose flush an earlier event already did.
+        break;
+    }
+  }
+}
+
+// Drops every buffered byte, the line ends recorded in them and the events
+// about them. The driver's flush leaves the pattern positions behind, and
+// they would cut the next lines in the wrong places. RX task only.
+void XiaoFaceDetector::_resyncRx() {
+  uart_flush_input(LINK_UART);
+  uart_pattern_queue_reset(LINK_UART, PATTERN_QUEUE_LENGTH);
+  xQueueReset(_uartEvents);
+}
+
+void XiaoFaceDetector::_readPatternLine() {
+  RxLine line;
+  line.arrivalUs = esp_timer_get_time();
+
+  int position = uart_pattern_pop_pos(LINK_UART);
+  if (position < 0) {
+    // The pattern position queue overflowed, so line boundaries are unknown.
+    _resyncRx();
+    _overflows++;
+    return;
+  }
+
+  size_t keep = min((size_t)position, sizeof(line.text) - 1);
+  int received = uart_read_bytes(LINK_UART, (uint8_t*)line.text, keep, pdMS_TO_TICKS(10));
+  line.length = received > 0 ? received : 0;
+  if (line.length > 0 && line.text[line.length - 1] == '\r') line.length--;
+  line.text[line.length] = '\0';
+
+  // Throw away the part of an over-long line that did not fit, and the '\n' itself.
+  uint8_t discard[32];
+  size_t remaining = position - keep + 1;
+  while (remaining > 0) {
+    int n = uart_read_bytes(LINK_UART, discard, min(remaining, sizeof(discard)), pdMS_TO_TICKS(10));
+    if (n <= 0) break;
+    remaining -= n;
+  }
+
+  _linesReceived++;
+  if (xQueueSend(_lines, &line, 0) != pdTRUE) {
+    _droppedLines++;
+  }
+}
+
+void XiaoFaceDetector::dumpLinkStats(Print& out) {
+  if (!_driverInstalled) {
+    out.println("LINK not started");
+    return;
+  }
+  out.printf("LINK baud=%lu lines=%lu overflows=%lu dropped=%lu queued=%u\n",
+             _baud, (unsigned long)_linesReceived, (unsigned long)_overflows,
+             (unsigned long)_droppedLines, (unsigned)uxQueueMessagesWaiting(_lines));
+  out.printf("LINK arrival_to_consume_us n=%lu p50=%lu p99=%lu max=%lu\n",
+             (unsigned long)_consumeLatencyUs.count(),
+             (unsigned long)_consumeLatencyUs.percentile(50),
+             (unsigned long)_consumeLatencyUs.percentile(99),
+             (unsigned long)_consumeLatencyUs.max());
+  out.printf("LINK json_arena high=%lu capacity=%lu failures=%lu\n", (unsigned long)_parser.arena().highWater(),
+             (unsigned long)_parser.arena().capacity(), (unsigned long)_parser.arena().failures());
+  out.printf("EMIT xiao_bytes_per_s=%lu saved_per_s=%ld\n", (unsigned long)_parser.getHealth().emitBytesPerSec,
+             (long)_parser.getHealth().emitSavedPerSec);
+  ThumbDecoder& thumb = _parser.thumbnail();
+  float thumbSeconds = (millis() - _lastThumbDump) / 1000.0f;
+  if (thumbSeconds <= 0) thumbSeconds = 1;
+  out.printf("THUMB msgs_per_s=%.1f thumbs_per_s=%.1f bytes_per_s=%lu synced=%s resyncs=%lu xiao_fps=%.1f xiao_bps=%lu\n",
+             (thumb.applied() - _thumbMessagesAtDump) / thumbSeconds,
+             (thumb.completed() - _thumbCompletedAtDump) / thumbSeconds,
+             (unsigned long)((_parser.thumbnailBytes() - _thumbBytesAtDump) / thumbSeconds),
+             thumb.isSynced() ? "yes" : "no", (unsigned long)thumb.resyncs(),
+             _parser.getHealth().thumbFps, (unsigned long)_parser.getHealth().thumbBytesPerSec);
+  _lastThumbDump = millis();
+  _thumbMessagesAtDump = thumb.applied();
+  _thumbCompletedAtDump = thumb.completed();
+  _thumbBytesAtDump = _parser.thumbnailBytes();
+  out.printf("LINK heartbeat=%s last_ms_ago=%lu downs=%lu power=%s%s\n", _linkUp ? "up" : "down",
+             (unsigned long)(millis() - _lastHeartbeat), (unsigned long)_linkDowns,
+             LINK_POWER_MODE_NAMES[_powerMode], _powerConfirmed ? "" : " (unconfirmed)");
+  int pending = 0;
+  for (int i = 0; i < LINK_SETTING_COUNT; i++) {
+    if (_settingSeq[i] != 0 && i != LINK_SET_PAUSE_MS) pending++;
+  }
+  out.printf("CONFIG sent=%lu refused=%lu pending=%d resyncs=%lu xiao_seq=%lld ack_us p50=%lu p99=%lu max=%lu\n",
+             (unsigned long)_settingsSent, (unsigned long)_settingsRejected, pending,
+             (unsigned long)_settingResyncs, (long long)_parser.getHealth().configSeq,
+             (unsigned long)_settingAckUs.percentile(50), (unsigned long)_settingAckUs.percentile(99),
+             (unsigned long)_settingAckUs.max());
+  out.printf("REACTION arrival_to_state_us n=%lu p50=%lu p99=%lu max=%lu\n",
+             (unsigned long)_arrivalToStateUs.count(),
+             (unsigned long)_arrivalToStateUs.percentile(50),
+             (unsigned long)_arrivalToStateUs.percentile(99),
+             (unsigned long)_arrivalToStateUs.max());
+
+  if (!_clock.isSynced()) {
+    out.println("SYNC waiting for first pong");
+    return;
+  }
+  out.printf("SYNC offset_us=%lld drift_ppm=%.2f rtt_us=%lu best_rtt_us=%lu samples=%lu\n",
+             (long long)_clock.offsetUs(), _clock.driftPpm(), (unsigned long)_clock.lastRttUs(),
+             (unsigned long)_clock.bestRttUs(), (unsigned long)_clock.sampleCount());
+  out.printf("LATENCY capture_to_receive_us n=%lu p50=%lu p99=%lu max=%lu\n",
+             (unsigned long)_captureToReceiveUs.count(),
+             (unsigned long)_captureToReceiveUs.percentile(50),
+             (unsigned long)_captureToReceiveUs.percentile(99),
+             (unsigned long)_captureToReceiveUs.max());
+  out.printf("LATENCY capture_to_servo_us n=%lu p50=%lu p99=%lu max=%lu\n",
+             (unsigned long)_captureToServoUs.count(),
+             (unsigned long)_captureToServoUs.percentile(50),
+             (unsigned long)_captureToServoUs.percentile(99),
+             (unsigned long)_captureToServoUs.max());
+  out.printf("REACTION capture_to_state_us n=%lu p50=%lu p99=%lu max=%lu\n",
+             (unsigned long)_captureToStateUs.count(),
+             (unsigned long)_captureToStateUs.percentile(50),
+             (unsigned long)_captureToStateUs.percentile(99),
+             (unsigned long)_captureToStateUs.max());
+}
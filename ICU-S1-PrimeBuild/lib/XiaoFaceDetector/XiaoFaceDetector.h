@@ -4,37 +4,159 @@
 #define XIAO_FACE_DETECTOR_H
 
 #include <Arduino.h>
-#include <ArduinoJson.h> // The class now needs this to parse JSON
-
-// An enumeration to easily identify the type of message received.
-// This is much more efficient than comparing strings in the main loop.
-enum XiaoEventType {
-  NONE,           // No new message
-  DETECTION,      // A face was detected
-  HEARTBEAT,      // The "alive" heartbeat message
-  ERROR_XIAO,     // An error reported by the XIAO
-  PARSE_ERROR,    // The received data was not valid JSON
-  UNKNOWN_ACTION  // Valid JSON, but the "action" was not recognized
-};
+#include <atomic>
+#include "driver/uart.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "ClockSync.h"
+#include "LinkProtocol.h"
+#include "Log2Histogram.h"
+#include "XiaoMessageParser.h"
 
-// A structure to hold the data from a single parsed message.
-struct XiaoMessage {
-  XiaoEventType type = NONE; // The type of event
-  String data = "";          // The data payload as a string
-};
+class LinkRecorder;
 
+// Receives messages from the XIAO over UART1.
+//
+// Reception is event driven: the ESP-IDF UART driver raises a pattern
+// interrupt on every '\n', and a small task on core 0 pulls the finished
+// line out of the driver and timestamps it straight away. update() only
+// picks up lines that are already complete, so a loop() stalled by an
+// eyelid animation delays consuming a detection but never loses its
+// arrival time (or the detection itself, unless the queue overflows).
+//
+// It also pings the XIAO every few seconds to keep a ClockSync estimate of
+// the XIAO's clock, so the capture time carried by each detection can be
+// turned into end-to-end latency on our own clock.
+//
+// Outside the active power mode the pings stop, and the link is allowed to
+// lose the start of a line: we wake from light sleep on the XIAO's first
+// start bit, too late to receive that byte.
 class XiaoFaceDetector {
 public:
   XiaoFaceDetector();
   void begin();
-  
+  bool isInitialized();
+
   // The update function now returns a XiaoMessage structure
   XiaoMessage update();
 
+  // Every received line is also handed to this recorder (nullptr to disable).
+  void setRecorder(LinkRecorder* recorder);
+
+  // The most recent heartbeat report from the XIAO
+  const XiaoHealth& getHealth() const;
+
+  // False once LINK_HEARTBEATS_MISSED heartbeats in a row have not arrived.
+  // The link counts as up from begin() until then.
+  bool isLinkUp() const;
+
+  // Call when a detection has been turned into a servo command, to record
+  // its capture-to-servo latency. Detections without a capture time are ignored.
+  void recordServoCommand(const XiaoMessage& detection);
+
+  // Call when a detection has changed the system state, to record the
+  // reaction latency from its arrival (and capture, when the clocks are synced).
+  void recordStateChange(const XiaoMessage& detection);
+
+  // Asks the XIAO for a camera power mode, and keeps asking every few
+  // seconds until a heartbeat says it has been applied.
+  void setPowerMode(LinkPowerMode mode);
+
+  // Changes one of the XIAO's detector settings. The request is resent
+  // every second until the XIAO acknowledges it, and all of them are sent
+  // again when its heartbeat shows either board has restarted. Pauses are
+  // the exception: one that arrives late would blind the camera at the
+  // wrong time, so they are sent once and simply expire on the XIAO.
+  void setDetectorSetting(LinkSetting setting, float value);
+  float detectorSetting(LinkSetting setting) const;
+
+  const ClockSync& getClockSync() const;
+
+  // The camera thumbnail, updated whenever update() returns a THUMBNAIL.
+  // It only streams while the thumb_hz setting is above 0.
+  ThumbDecoder& thumbnail();
+
+  // Prints baud rate, line/overflow counters, clock sync and latency histograms.
+  void dumpLinkStats(Print& out);
+
 private:
-  HardwareSerial* _serial;
-  // Keep a JSON document inside the class to reuse memory
-  JsonDocument doc;
+  // One complete line as handed from the RX task to update()
+  struct RxLine {
+    int64_t arrivalUs;
+    uint16_t length;
+    char text[LINK_MAX_LINE];
+  };
+
+  static void _rxTask(void* arg);
+  void _readPatternLine();
+  void _resyncRx();
+  void _maintainBaud();
+  void _maintainClockSync();
+  void _maintainPowerMode();
+  void _maintainSettings();
+  void _sendSetting(LinkSetting setting);
+  void _handleSetAck(const XiaoMessage& message, int64_t arrivalUs);
+  void _checkSettingsInSync();
+  void _watchHeartbeat(XiaoEventType received);
+  void _handlePong(const XiaoMessage& message, int64_t arrivalUs);
+  void _setBaud(unsigned long baud);
+
+  bool _isInitialized;
+  bool _driverInstalled;
+  LinkRecorder* _recorder;
+  XiaoMessageParser _parser;
+
+  QueueHandle_t _uartEvents; // Filled by the UART driver
+  QueueHandle_t _lines;      // RxLines, filled by _rxTask
+
+  unsigned long _baud;
+  bool _fastBaudRefused;
+  unsigned long _lastBaudRequest;
+  int _consecutiveParseErrors;
+
+  ClockSync _clock;
+  uint32_t _pingSeq;
+  int64_t _pingSentUs;       // 0 when no ping is outstanding
+  unsigned long _lastPing;
+
+  LinkPowerMode _powerMode;
+  bool _powerConfirmed;
+  unsigned long _lastPowerRequest;
+
+  float _settings[LINK_SETTING_COUNT];
+  uint32_t _settingSeq[LINK_SETTING_COUNT];   // seq of the unanswered request, 0 once answered
+  int64_t _settingSentUs[LINK_SETTING_COUNT];
+  uint32_t _nextSettingSeq;
+  uint32_t _lastAnsweredSeq;
+  unsigned long _lastSettingRequest;
+  uint32_t _settingsSent;
+  uint32_t _settingsRejected;
+  uint32_t _settingResyncs;
+  Log2Histogram _settingAckUs; // Request to set_ack
+
+  bool _linkUp;
+  unsigned long _lastHeartbeat; // millis() of the last heartbeat, or of begin()
+  uint32_t _linkDowns;
+
+  // Thumbnail counters at the last dumpLinkStats(), for its rates
+  unsigned long _lastThumbDump;
+  uint32_t _thumbMessagesAtDump;
+  uint32_t _thumbCompletedAtDump;
+  uint32_t _thumbBytesAtDump;
+
+  // Set by _setBaud(); the RX task flushes what arrived at the old rate, as
+  // only it may while it could be inside uart_read_bytes()
+  std::atomic<bool> _rxFlushRequested;
+
+  // Written by the RX task, read by dumpLinkStats()
+  volatile uint32_t _linesReceived;
+  volatile uint32_t _overflows;
+  volatile uint32_t _droppedLines;
+  Log2Histogram _consumeLatencyUs; // Pattern interrupt to update()
+  Log2Histogram _captureToReceiveUs;
+  Log2Histogram _captureToServoUs;
+  Log2Histogram _arrivalToStateUs;
+  Log2Histogram _captureToStateUs;
 };
 
-#endif // XIAO_FACE_DETECTOR_H
\ No newline at end of file
+#endif // XIAO_FACE_DETECTOR_H
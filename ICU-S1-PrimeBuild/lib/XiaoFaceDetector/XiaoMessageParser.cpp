@@ -0,0 +1,181 @@
+// lib/XiaoFaceDetector/XiaoMessageParser.cpp
+
+#include "XiaoMessageParser.h"
+
+XiaoMessageParser::XiaoMessageParser() : doc(&_arena) {
+  _haveLastDetection = false;
+  _thumbBytes = 0;
+}
+
+const JsonArena& XiaoMessageParser::arena() const {
+  return _arena;
+}
+
+// This is the core of the new logic.
+XiaoMessage XiaoMessageParser::parseLine(const char* line) {
+  XiaoMessage message; // Create a new message, its type is NONE by default
+
+  DeserializationError error = deserializeJson(doc, line);
+
+  if (error) {
+    // If JSON parsing fails, report it
+    message.type = PARSE_ERROR;
+    strlcpy(message.data, line, sizeof(message.data)); // Return the start of the junk for logging
+  } else {
+    // If JSON parsing succeeds, extract the action and data
+    const char* action = doc["action"] | "";
+    // Structured payloads (the heartbeat report) are unpacked below instead
+    if (!doc["data"].is<JsonObject>()) {
+      strlcpy(message.data, doc["data"] | "", sizeof(message.data));
+    }
+
+    // Convert the string "action" into our efficient enum type
+    if (strcmp(action, "detection") == 0) {
+      message.type = DETECTION;
+      _parseDetection(message);
+      _lastDetection = message;
+      _haveLastDetection = true;
+    } else if (strcmp(action, "delta") == 0) {
+      // Meaningless without the detection it changes, which a restart or a
+      // lost line takes away; the XIAO resends in full at least every keep-alive.
+      message.type = _applyDelta(message) ? DETECTION : UNKNOWN_ACTION;
+    } else if (strcmp(action, "lost") == 0) {
+      message.type = FACE_LOST;
+      _haveLastDetection = false;
+    } else if (strcmp(action, "alive") == 0) {
+      message.type = HEARTBEAT;
+      if (doc["data"].is<JsonObject>()) {
+        _parseHealth(doc["data"]);
+      }
+    } else if (strcmp(action, "error") == 0) {
+      message.type = ERROR_XIAO;
+    } else if (strcmp(action, "baud_ack") == 0) {
+      message.type = BAUD_ACK;
+    } else if (strcmp(action, "pong") == 0) {
+      message.type = PONG;
+    } else if (strcmp(action, "set_ack") == 0) {
+      message.type = SET_ACK;
+    } else if (strcmp(action, "thumb") == 0) {
+      // message.data only holds the start of it; the image is in the document
+      message.type = _parseThumbnail(message, doc["data"] | "") ? THUMBNAIL : UNKNOWN_ACTION;
+    } else {
+      message.type = UNKNOWN_ACTION;
+    }
+  }
+
+  return message;
+}
+
+const XiaoHealth& XiaoMessageParser::getHealth() const {
+  return _health;
+}
+
+ThumbDecoder& XiaoMessageParser::thumbnail() {
+  return _thumb;
+}
+
+uint32_t XiaoMessageParser::thumbnailBytes() const {
+  return _thumbBytes;
+}
+
+// Detection payloads are "x,y,w,h,captureUs,track,person"; older XIAO
+// firmware stops after the box or after the capture time.
+void XiaoMessageParser::_parseDetection(XiaoMessage& message) {
+  unsigned long captureUs = 0;
+  unsigned int trackId = 0;
+  int fields = sscanf(message.data, "%d,%d,%d,%d,%lu,%u,%d",
+                      &message.x, &message.y, &message.w, &message.h, &captureUs,
+                      &trackId, &message.personId);
+  message.hasCaptureTime = fields >= 5;
+  message.xiaoCaptureUs = (uint32_t)captureUs;
+  message.hasIdentity = fields == 7;
+  message.trackId = (uint16_t)trackId;
+  if (!message.hasIdentity) message.personId = -1;
+}
+
+// Delta payloads are "dx,dy,dw,dh,dCaptureUs" against the last detection.
+bool XiaoMessageParser::_applyDelta(XiaoMessage& message) {
+  int dx, dy, dw, dh;
+  unsigned long dCaptureUs;
+  if (!_haveLastDetection ||
+      sscanf(message.data, "%d,%d,%d,%d,%lu", &dx, &dy, &dw, &dh, &dCaptureUs) != 5) {
+    return false;
+  }
+  XiaoMessage& last = _lastDetection;
+  last.x += dx;
+  last.y += dy;
+  last.w += dw;
+  last.h += dh;
+  last.xiaoCaptureUs += (uint32_t)dCaptureUs;
+
+  char data[XIAO_MESSAGE_DATA];
+  strlcpy(data, message.data, sizeof(data));
+  message = last;
+  strlcpy(message.data, data, sizeof(message.data));
+  message.isDelta = true;
+  return true;
+}
+
+// Thumbnail payloads are "seq,flags,start,x,y,w,h,<base64>". A message the
+// decoder cannot use (one after a lost line, until the next key) is not an event.
+bool XiaoMessageParser::_parseThumbnail(XiaoMessage& message, const char* data) {
+  unsigned int seq, flags, start;
+  int consumed = 0;
+  if (sscanf(data, "%u,%u,%u,%d,%d,%d,%d,%n", &seq, &flags, &start,
+             &message.x, &message.y, &message.w, &message.h, &consumed) != 7 || consumed == 0) {
+    return false;
+  }
+  uint8_t encoded[THUMB_MAX_BYTES];
+  int length = thumbBase64Decode(data + consumed, encoded, sizeof(encoded));
+  if (length < 0) return false;
+  _thumbBytes += length;
+
+  ThumbHeader header;
+  header.seq = (uint16_t)seq;
+  header.flags = (uint8_t)flags;
+  header.start = (uint16_t)start;
+  return _thumb.apply(header, encoded, length);
+}
+
+// Unpacks the heartbeat report written by the XIAO's PipelineProfiler.
+// Each entry under "us" is [p50, p99, max] for one pipeline stage.
+void XiaoMessageParser::_parseHealth(JsonObject report) {
+  _health.valid = true;
+  _health.receivedAt = millis();
+  _health.fps = report["fps"] | 0.0f;
+  _health.hitRate = report["hit"] | 0.0f;
+  _health.freeHeap = report["heap"] | 0;
+  _health.minFreeHeap = report["minHeap"] | 0;
+  _health.freePsram = report["psram"] | 0;
+  _health.largestFreeBlock = report["blk"] | 0;
+  _health.steadyAllocations = report["allocs"] | 0;
+  _health.configSeq = report["cfg"].is<uint32_t>() ? (int64_t)report["cfg"].as<uint32_t>() : -1;
+
+  JsonObject stages = report["us"];
+  _health.captureP99Us = stages["cap"][1] | 0;
+  _health.inferenceP99Us = (uint32_t)(stages["msr"][1] | 0) + (uint32_t)(stages["mnp"][1] | 0) +
+                           (uint32_t)(stages["rec"][1] | 0);
+  _health.linkP99Us = (uint32_t)(stages["ser"][1] | 0) + (uint32_t)(stages["uart"][1] | 0);
+
+  strlcpy(_health.bound, report["bound"] | "", sizeof(_health.bound));
+
+  JsonObject gate = report["gate"];
+  _health.gateIdle = gate["idle"] | false;
+  _health.skippedFrames = gate["skip"] | 0;
+  _health.motionReactP99Us = gate["react"][1] | 0;
+
+  JsonObject emit = report["emit"];
+  _health.emitBytesPerSec = emit["bps"] | 0;
+  _health.emitSavedPerSec = emit["saved"] | 0;
+
+  JsonObject thumb = report["thumb"];
+  _health.thumbFps = thumb["fps"] | 0.0f;
+  _health.thumbBytesPerSec = thumb["bps"] | 0;
+
+  JsonObject power = report["pwr"];
+  strlcpy(_health.powerMode, power["mode"] | "", sizeof(_health.powerMode));
+  strlcpy(_health.powerRequested, power["req"] | "", sizeof(_health.powerRequested));
+  for (int i = 0; i < LINK_POWER_MODE_COUNT; i++) {
+    _health.powerMs[i] = power["ms"][i] | 0;
+  }
+}
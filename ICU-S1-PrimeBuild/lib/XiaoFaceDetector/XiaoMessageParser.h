@@ -0,0 +1,116 @@
+// lib/XiaoFaceDetector/XiaoMessageParser.h
+
+#ifndef XIAO_MESSAGE_PARSER_H
+#define XIAO_MESSAGE_PARSER_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h> // The class now needs this to parse JSON
+#include "LinkProtocol.h"
+#include "JsonArena.h"
+#include "ThumbCodec.h"
+
+// An enumeration to easily identify the type of message received.
+// This is much more efficient than comparing strings in the main loop.
+enum XiaoEventType {
+  NONE,           // No new message
+  DETECTION,      // A face was detected (sent in full, or as a change to the last one)
+  HEARTBEAT,      // The "alive" heartbeat message
+  ERROR_XIAO,     // An error reported by the XIAO
+  PARSE_ERROR,    // The received data was not valid JSON
+  UNKNOWN_ACTION, // Valid JSON, but the "action" was not recognized
+  BAUD_ACK,       // The XIAO accepted a link baud rate change
+  PONG,           // The XIAO's answer to a clock sync ping
+  SET_ACK,        // The XIAO's answer to a detector setting
+  FACE_LOST,      // The face in the last detection is gone
+  THUMBNAIL       // The camera thumbnail changed (see XiaoMessageParser::thumbnail())
+};
+
+// Longest text payload kept in a XiaoMessage. Detections, acks, pongs and
+// errors fit; the heartbeat's report only goes into XiaoHealth.
+const int XIAO_MESSAGE_DATA = 48;
+
+// A structure to hold the data from a single parsed message. It owns no
+// heap memory, so returning it by value every loop costs only a copy.
+struct XiaoMessage {
+  XiaoEventType type = NONE;          // The type of event
+  char data[XIAO_MESSAGE_DATA] = "";  // The data payload as text, cut to fit
+
+  // Filled in for DETECTION messages only; THUMBNAIL messages carry the
+  // face box in thumbnail pixels (w = 0 for none)
+  int x = 0, y = 0, w = 0, h = 0; // Bounding box in camera pixels
+  bool hasCaptureTime = false;    // Older XIAO firmware only sends "x,y,w,h"
+  uint32_t xiaoCaptureUs = 0;     // When the frame was captured, XIAO clock
+  bool hasIdentity = false;       // Sent by XIAO firmware with face tracking
+  uint16_t trackId = 0;           // Same for as long as the XIAO follows the same face
+  int personId = -1;              // Enrolled person on the XIAO, -1 for not (yet) recognised
+  bool isDelta = false;           // Rebuilt from a "delta" against the previous detection
+
+  // Filled in by XiaoFaceDetector, on our esp_timer clock (0 = unknown)
+  int64_t arrivalUs = 0; // The line's '\n' reached our UART
+  int64_t captureUs = 0; // xiaoCaptureUs translated through the clock sync
+};
+
+// The health and performance report carried by every XIAO heartbeat.
+// Times are the worst-case (p99) per frame, in microseconds.
+struct XiaoHealth {
+  bool valid = false;           // False until the first report arrives
+  unsigned long receivedAt = 0; // millis() when it arrived
+  float fps = 0;
+  float hitRate = 0;            // Fraction of frames that contained a face
+  uint32_t freeHeap = 0;
+  uint32_t minFreeHeap = 0;
+  uint32_t freePsram = 0;
+  uint32_t captureP99Us = 0;    // esp_camera_fb_get()
+  uint32_t inferenceP99Us = 0;  // MSR01 + MNP01 + recognition
+  uint32_t linkP99Us = 0;       // Serialize + UART write
+  char bound[8] = "";           // "compute", "camera", "link" or "idle"
+  bool gateIdle = false;        // The motion gate is throttling inference
+  uint32_t skippedFrames = 0;   // Frames the motion gate did not run inference on
+  uint32_t motionReactP99Us = 0; // Last still frame to inference on the first moving one
+  uint32_t largestFreeBlock = 0; // Internal heap; well below freeHeap means fragmentation
+  uint32_t steadyAllocations = 0; // Heap allocations since the XIAO reached its steady state
+  uint32_t emitBytesPerSec = 0;  // Detection traffic the XIAO sent...
+  int32_t emitSavedPerSec = 0;   // ...and saved against sending every face frame in full
+  float thumbFps = 0;            // Whole camera thumbnails the XIAO sent per second...
+  uint32_t thumbBytesPerSec = 0; // ...and the link traffic they cost
+  char powerMode[8] = "";       // LINK_POWER_MODE_NAMES; empty from firmware without power modes
+  char powerRequested[8] = "";  // The mode last asked for, which the camera may not support
+  uint32_t powerMs[LINK_POWER_MODE_COUNT] = {}; // Time spent in each mode since boot
+  int64_t configSeq = -1;       // Last detector setting answered; -1 from firmware without settings
+};
+
+// Turns lines received from the XIAO into messages. It has no hardware
+// dependencies, so tools/link_replay.cpp runs recorded traffic through the
+// exact same code on a PC.
+class XiaoMessageParser {
+public:
+  XiaoMessageParser();
+  XiaoMessage parseLine(const char* line);
+
+  // The most recent heartbeat report from the XIAO
+  const XiaoHealth& getHealth() const;
+  const JsonArena& arena() const;
+
+  // The camera thumbnail as built from THUMBNAIL messages so far
+  ThumbDecoder& thumbnail();
+  uint32_t thumbnailBytes() const; // Encoded bytes received, for rate statistics
+
+private:
+  static const size_t XIAO_JSON_ARENA_SIZE = 8192; // A heartbeat report needs about a third of it
+
+  void _parseDetection(XiaoMessage& message);
+  bool _applyDelta(XiaoMessage& message);
+  bool _parseThumbnail(XiaoMessage& message, const char* data);
+  void _parseHealth(JsonObject report);
+
+  // The document lives in the arena, so parsing never touches the heap
+  StaticJsonArena<XIAO_JSON_ARENA_SIZE> _arena;
+  JsonDocument doc;
+  XiaoHealth _health;
+  XiaoMessage _lastDetection; // What deltas apply to
+  bool _haveLastDetection;
+  ThumbDecoder _thumb;
+  uint32_t _thumbBytes;
+};
+
+#endif // XIAO_MESSAGE_PARSER_H
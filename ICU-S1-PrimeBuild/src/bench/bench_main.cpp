@@ -0,0 +1,256 @@
+// src/bench/bench_main.cpp - Benchmark firmware for the ProS3
+//
+// Built instead of src/main.cpp by the um_feathers3_bench environment.
+// Measures what the robot's budget is made of on real hardware and prints
+// one "BENCH {...}" line (see Common/MicroBench):
+//   i2c     PCA9685 register writes and reads per second at each I2C clock
+//   spi     GC9A01 fill and blit throughput on the display bus in use, and
+//           pixels drawn one at a time, as the text and circles are
+//   uart    round trip and throughput to the XIAO at each link rate; the
+//           XIAO must be running its own bench firmware (the echo side)
+//   memcpy  internal RAM and PSRAM bandwidth
+//
+// Send any character over USB serial to run it again.
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <Wire.h>
+#include <Adafruit_PWMServoDriver.h>
+#include <Arduino_GFX_Library.h>
+#include "esp_heap_caps.h"
+#include "LinkProtocol.h"
+#include "Log2Histogram.h"
+#include "MicroBench.h"
+#include "ScreenController.h" // ICU_DISPLAY_DMA and DmaSpiBus
+
+// Same pins as ServoController, ScreenController and XiaoFaceDetector
+#define I2C_SDA_PIN 8
+#define I2C_SCL_PIN 9
+#define TFT_SCLK 36
+#define TFT_MOSI 35
+#define TFT_CS   1
+#define TFT_DC   10
+#define TFT_RST  14
+#define LINK_RX_PIN 6
+#define LINK_TX_PIN 5
+
+const int BENCH_PWM_CHANNEL = 15;          // The servos use 0-2
+const int I2C_WRITES = 200;
+const uint32_t I2C_CLOCKS[] = {100000, 400000, 1000000};
+const int SCREEN_SIZE = 240;
+const int PARTIAL_SIZE = 64;               // About the size of one eye redraw
+const int SPI_REPEATS = 20;
+const int SINGLE_PIXELS = 2000;            // drawPixel() calls per repeat
+const unsigned long UART_RATES[] = {LINK_DEFAULT_BAUD, LINK_FAST_BAUD, 2000000};
+const int UART_PINGS = 100;
+const int UART_BURST_LINES = 64;
+const int UART_BURST_LINE_BYTES = 128;     // Newline included, about one detection message
+const unsigned long UART_TIMEOUT_MS = 3000;
+
+Adafruit_PWMServoDriver pwm;
+Arduino_DataBus* bus = nullptr;
+Arduino_GFX* gfx = nullptr;
+uint16_t* blitBuffer = nullptr;
+HardwareSerial& linkSerial = Serial1;
+char lineBuffer[LINK_MAX_LINE];
+
+static void benchI2c(JsonObject data) {
+  Wire.begin(I2C_SDA_PIN, I2C_SCL_PIN);
+  pwm.begin();
+  JsonArray runs = data["runs"].to<JsonArray>();
+  for (uint32_t clock : I2C_CLOCKS) {
+    Wire.setClock(clock);
+    unsigned long start = micros();
+    for (int i = 0; i < I2C_WRITES; i++) {
+      pwm.setPWM(BENCH_PWM_CHANNEL, 0, 4096); // Full off
+    }
+    unsigned long writeUs = micros() - start;
+    start = micros();
+    uint8_t prescale = 0;
+    for (int i = 0; i < I2C_WRITES; i++) {
+      prescale = pwm.readPrescale();
+    }
+    unsigned long readUs = micros() - start;
+
+    JsonObject run = runs.add<JsonObject>();
+    run["clock_hz"] = clock;
+    run["writes_per_s"] = writeUs ? (uint32_t)(I2C_WRITES * 1000000ULL / writeUs) : 0;
+    run["reads_per_s"] = readUs ? (uint32_t)(I2C_WRITES * 1000000ULL / readUs) : 0;
+    run["ok"] = prescale != 0; // 0 reads back when nothing answers
+  }
+  Wire.setClock(100000);
+}
+
+// Waits for the DMA bus so each figure counts the pixels actually sent.
+static void waitForScreen() {
+#if ICU_DISPLAY_DMA
+  ((DmaSpiBus*)bus)->waitIdle();
+#endif
+}
+
+// Pixels per second for 'repeats' calls of 'draw', written as <key>_mpx_s.
+template <typename Draw>
+static void timeDraw(JsonObject data, const char* key, uint32_t pixels, Draw draw) {
+  unsigned long start = micros();
+  for (int i = 0; i < SPI_REPEATS; i++) draw(i);
+  waitForScreen();
+  unsigned long elapsed = micros() - start;
+  data[key] = elapsed ? roundf((float)pixels * SPI_REPEATS / elapsed * 100.0f) / 100.0f : 0; // px/us == Mpx/s
+}
+
+static void benchSpi(JsonObject data) {
+  if (!bus) {
+#if ICU_DISPLAY_DMA
+    bus = new DmaSpiBus(TFT_DC, TFT_CS, TFT_SCLK, TFT_MOSI);
+#else
+    bus = new Arduino_ESP32SPI(TFT_DC, TFT_CS, TFT_SCLK, TFT_MOSI);
+#endif
+    gfx = new Arduino_GC9A01(bus, TFT_RST);
+    gfx->begin();
+    gfx->invertDisplay(true);
+    blitBuffer = (uint16_t*)heap_caps_malloc(SCREEN_SIZE * SCREEN_SIZE * 2, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+  }
+  data["bus"] = ICU_DISPLAY_DMA ? "dma" : "blocking";
+#if ICU_DISPLAY_DMA
+  data["clock_hz"] = ((DmaSpiBus*)bus)->clockHz();
+#endif
+  const uint32_t full = SCREEN_SIZE * SCREEN_SIZE;
+  timeDraw(data, "fill_mpx_s", full, [](int i) { gfx->fillScreen(i & 1 ? 0xFFFF : 0x0000); });
+  if (!blitBuffer) {
+    data["error"] = "no PSRAM for the blit buffer";
+    return;
+  }
+  for (uint32_t i = 0; i < full; i++) blitBuffer[i] = (uint16_t)(i * 37);
+  timeDraw(data, "blit_mpx_s", full, [](int) {
+    gfx->draw16bitRGBBitmap(0, 0, blitBuffer, SCREEN_SIZE, SCREEN_SIZE);
+  });
+  timeDraw(data, "partial_mpx_s", PARTIAL_SIZE * PARTIAL_SIZE, [](int i) {
+    int offset = (i % 4) * 32;
+    gfx->draw16bitRGBBitmap(offset + 24, offset + 24, blitBuffer, PARTIAL_SIZE, PARTIAL_SIZE);
+  });
+  timeDraw(data, "pixel_mpx_s", SINGLE_PIXELS, [](int i) {
+    for (int p = 0; p < SINGLE_PIXELS; p++) {
+      gfx->drawPixel((p * 7) % SCREEN_SIZE, (p * 13 + i) % SCREEN_SIZE, (uint16_t)(p * 37));
+    }
+  });
+  gfx->fillScreen(0x0000);
+}
+
+// Reads one line into lineBuffer, or returns false after the timeout.
+static bool readLine(unsigned long timeoutMs) {
+  unsigned long start = millis();
+  int length = 0;
+  while (millis() - start < timeoutMs) {
+    while (linkSerial.available()) {
+      char c = linkSerial.read();
+      if (c == '\n') {
+        lineBuffer[length] = '\0';
+        return true;
+      }
+      if (c != '\r' && length < LINK_MAX_LINE - 1) lineBuffer[length++] = c;
+    }
+    delay(0);
+  }
+  return false;
+}
+
+// Sends "hello" until the XIAO echoes it, dropping anything else it sent first.
+static bool syncLink() {
+  unsigned long start = millis();
+  while (millis() - start < UART_TIMEOUT_MS) {
+    linkSerial.println("hello");
+    if (readLine(200) && strcmp(lineBuffer, "hello") == 0) return true;
+  }
+  return false;
+}
+
+// Asks the XIAO to move to 'rate'; it answers at the old rate, then switches.
+static bool setLinkRate(unsigned long rate) {
+  linkSerial.printf("baud %lu\n", rate);
+  if (!readLine(UART_TIMEOUT_MS) || strncmp(lineBuffer, "baud", 4) != 0) return false;
+  linkSerial.flush();
+  linkSerial.updateBaudRate(rate);
+  delay(20);
+  while (linkSerial.available()) linkSerial.read();
+  return syncLink();
+}
+
+static void benchUartRate(JsonObject run, unsigned long rate) {
+  run["baud"] = rate;
+  if (!setLinkRate(rate)) {
+    run["error"] = "no echo";
+    return;
+  }
+
+  Log2Histogram rttUs;
+  for (int i = 0; i < UART_PINGS; i++) {
+    unsigned long start = micros();
+    linkSerial.printf("p%d\n", i);
+    if (!readLine(UART_TIMEOUT_MS)) break;
+    rttUs.record(micros() - start);
+  }
+  run["rtt_us_p50"] = rttUs.percentile(50);
+  run["rtt_us_p99"] = rttUs.percentile(99);
+  run["rtt_us_max"] = rttUs.max();
+
+  // Pipelined: the XIAO echoes while we are still sending, so this is the
+  // rate the link sustains in both directions at once.
+  char payload[UART_BURST_LINE_BYTES];
+  memset(payload, 'x', sizeof(payload) - 1);
+  payload[sizeof(payload) - 1] = '\0';
+  int echoed = 0;
+  unsigned long start = micros();
+  for (int i = 0; i < UART_BURST_LINES; i++) {
+    linkSerial.println(payload + 1); // println adds "\r\n": 128 bytes a line
+    while (linkSerial.available() >= UART_BURST_LINE_BYTES && readLine(1)) echoed++;
+  }
+  while (echoed < UART_BURST_LINES && readLine(UART_TIMEOUT_MS)) echoed++;
+  unsigned long elapsed = micros() - start;
+  run["lines"] = echoed;
+  run["bytes_per_s"] = elapsed ? (uint32_t)((uint64_t)echoed * UART_BURST_LINE_BYTES * 1000000ULL / elapsed) : 0;
+}
+
+static void benchUart(JsonObject data) {
+  linkSerial.setRxBufferSize(4096);
+  linkSerial.begin(LINK_DEFAULT_BAUD, SERIAL_8N1, LINK_RX_PIN, LINK_TX_PIN);
+  if (!syncLink()) {
+    data["error"] = "XIAO bench firmware not answering";
+    return;
+  }
+  JsonArray runs = data["runs"].to<JsonArray>();
+  for (unsigned long rate : UART_RATES) {
+    benchUartRate(runs.add<JsonObject>(), rate);
+  }
+  // Back to the default rate, where the next run expects to find the XIAO
+  setLinkRate(LINK_DEFAULT_BAUD);
+}
+
+void runBenchmarks() {
+  JsonDocument report;
+  writeBoardInfo(report["board"].to<JsonObject>(), "pros3");
+  Serial.println("Bench: memcpy...");
+  benchMemcpy(report["memcpy"].to<JsonObject>());
+  Serial.println("Bench: I2C...");
+  benchI2c(report["i2c"].to<JsonObject>());
+  Serial.println("Bench: SPI...");
+  benchSpi(report["spi"].to<JsonObject>());
+  Serial.println("Bench: UART...");
+  benchUart(report["uart"].to<JsonObject>());
+  printBenchReport(report, Serial);
+}
+
+void setup() {
+  Serial.begin(115200);
+  unsigned long startTime = millis();
+  while (!Serial && millis() - startTime < 4000);
+  Serial.println("--- ProS3 benchmark firmware ---");
+  runBenchmarks();
+}
+
+void loop() {
+  if (Serial.available()) {
+    while (Serial.available()) Serial.read();
+    runBenchmarks();
+  }
+  delay(10);
+}
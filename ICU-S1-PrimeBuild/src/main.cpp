@@ -3,11 +3,24 @@
 #include "ScreenController.h"
 #include "ServoController.h"
 #include "LedController.h"
+#include "XiaoFaceDetector.h"
+#include "LinkRecorder.h"
+#include "GazeCalibrator.h"
+#include "LoopProfiler.h"
+#include "DeferredLog.h"
+#include "FaceFollower.h"
+#include "PowerManager.h"
+#include "HeapGuard.h"
+#include "FlashLog.h"
+#include "esp_system.h"
 
 // --- Global pointers to our component controllers
 ScreenController *screenController = nullptr;
 ServoController *servoController = nullptr;
 LedController *ledController = nullptr;
+XiaoFaceDetector *faceDetector = nullptr;
+LinkRecorder *linkRecorder = nullptr;
+GazeCalibrator *gazeCalibrator = nullptr;
 
 // --- Timings for the Demonstration Cycle (in milliseconds) ---
 const unsigned long SCAN_DURATION_1 = 20000;  // 20 seconds
@@ -18,6 +31,56 @@ const unsigned long DETECT_DURATION = 7000;   // 7 seconds
 const unsigned long SCAN_DURATION_3 = 20000;  // 20 seconds
 const unsigned long SLEEP_DURATION = 15000;   // 15 seconds (long pause before looping)
 
+// --- Production mode: the XIAO's detections drive SCANNING <-> DETECTION ---
+const uint8_t LID_SHUT_OPENNESS = 40;         // Below this the camera behind the lid sees nothing useful
+const float BLINK_PAUSE_MS = 400;             // Longest a blink pauses inference, should the reopening be missed
+const float THUMB_VIEW_HZ = 5;                // Camera thumbnail messages asked for while the 'v' view is on
+
+// What drives the states once WAKE_UP is done: the XIAO's detections, or
+// the fixed demo timers below. Build with -D ICU_DEMO_CYCLE=1 to start in
+// the demo, or switch at run time with the 'm' command.
+#ifndef ICU_DEMO_CYCLE
+#define ICU_DEMO_CYCLE 0
+#endif
+enum class RunMode {
+  PRODUCTION,
+  DEMO
+};
+RunMode runMode = ICU_DEMO_CYCLE ? RunMode::DEMO : RunMode::PRODUCTION;
+
+FaceFollower faces;       // Confirms and loses faces, and decides when to nap
+XiaoMessage lastDetection; // The detection that confirms a face is the one acted on
+
+// Light sleep while NAPPING or FULL_ASLEEP, and the XIAO's camera power mode to match
+PowerManager powerManager;
+
+// XIAO detector trade-offs, cycled with the 'q' command. A smaller MSR01
+// input scale and fewer candidates run faster but miss small and partly
+// hidden faces; the thorough preset also stops shrinking the frame.
+struct DetectorPreset {
+  const char* name;
+  float msrScore;
+  float msrResize;
+  float msrTopK;
+  float mnpTopK;
+  float capture;
+};
+const DetectorPreset DETECTOR_PRESETS[] = {
+  {"default",  0.1f,  0.2f,  10, 5, 0},
+  {"fast",     0.2f,  0.15f, 5,  2, 0},
+  {"thorough", 0.05f, 0.3f,  20, 5, 1},
+};
+const int DETECTOR_PRESET_COUNT = sizeof(DETECTOR_PRESETS) / sizeof(DETECTOR_PRESETS[0]);
+int detectorPreset = 0;
+bool blinkPaused = false; // Inference on the XIAO is paused for a blink
+
+// Telemetry kept in flash across reboots (see lib/FlashLog, 't' dumps it)
+const unsigned long TELEMETRY_INTERVAL = 60000; // One sample a minute
+unsigned long lastTelemetrySample = 0;
+uint32_t telemetryDetections = 0; // Since the last sample
+uint32_t telemetryConfirmed = 0;
+uint32_t longestLoopUs = 0;
+
 // This new state machine manages the overall demonstration sequence
 enum class DemoState {
   IDLE, // An initial state before the demo begins
@@ -41,26 +104,282 @@ enum class WakeUpStep {
   INITIALIZE_SCREEN,
   AWAIT_SCREEN_READY,
   INITIALIZE_SERVOS,  
+  INITIALIZE_DETECTOR,
   COMPLETE
 };
 WakeUpStep currentWakeUpStep = WakeUpStep::INITIALIZE_LEDS;
 
-// Helper function to set the state on all components at once
+// Helper function to set the state on all components at once, in the order
+// PowerPolicy gives
 void setGlobalState(SystemState newState) {
+  SystemState previous = currentState;
   currentState = newState;
-  screenController->setState(newState);
-  servoController->setState(newState);
-  ledController->setState(newState);
+  TransitionStep order[TRANSITION_STEPS];
+  transitionOrder(previous, newState, order);
+  for (TransitionStep step : order) {
+    switch (step) {
+      case TransitionStep::RECORD:
+        flashLog.log(LOG_TELEMETRY_STATE, (int)previous, (int)newState);
+        flashLog.flush();
+        break;
+      case TransitionStep::OUTPUTS:
+        screenController->setState(newState);
+        servoController->setState(newState);
+        ledController->setState(newState);
+        break;
+      case TransitionStep::POWER:
+        powerManager.setSystemState(newState);
+        faceDetector->setPowerMode(powerManager.xiaoMode());
+        break;
+      case TransitionStep::GUARDS:
+        // Rerunning the start-up sequence begins the controllers again, which may allocate
+        heapGuard.setSteady(newState != SystemState::WAKE_UP && newState != SystemState::ERROR);
+        // A sector erase stalls both cores; keep it away from an eye that is following someone
+        flashLog.setEraseAllowed(newState != SystemState::DETECTION);
+        break;
+    }
+  }
+}
+
+// Enters the first state of the current run mode after WAKE_UP.
+void startRunMode() {
+  faces.start(millis());
+  if (runMode == RunMode::DEMO) {
+    currentDemoState = DemoState::DEMO_SCAN_1; // Start the demo
+    demoStateStartTime = millis();             // Start the timer
+  }
+  setGlobalState(SystemState::SCANNING);
+}
+
+void handleDetection(const XiaoMessage& message) {
+  int centerX = message.x + message.w / 2;
+  int centerY = message.y + message.h / 2;
+  faces.onDetection(millis(), (uint32_t)faceDetector->detectorSetting(LINK_SET_EMIT_KEEP));
+  telemetryDetections++;
+  if (message.hasIdentity &&
+      (message.trackId != lastDetection.trackId || message.personId != lastDetection.personId)) {
+    deferredLog.log(LOG_MAIN_FACE_IDENTITY, (uint32_t)message.trackId, message.personId);
+  }
+  lastDetection = message;
+  screenController->setGaze(centerX, centerY);
+  gazeCalibrator->onDetection(message, Serial);
+
+  // While staring someone down, follow them
+  if (runMode == RunMode::PRODUCTION && currentState == SystemState::DETECTION && !gazeCalibrator->isActive()) {
+    servoController->lookAt(centerX, centerY);
+    faceDetector->recordServoCommand(message);
+  }
+}
+
+// Acts on FaceFollower's decisions.
+void updateProduction() {
+  switch (faces.update(currentState, faceDetector->isLinkUp(), millis())) {
+    case FaceEvent::CONFIRMED: {
+      deferredLog.log(LOG_MAIN_FACE_CONFIRMED, faces.recentHits());
+      telemetryConfirmed++;
+      setGlobalState(SystemState::DETECTION);
+      faceDetector->recordStateChange(lastDetection);
+      int faceX = lastDetection.x + lastDetection.w / 2;
+      int faceY = lastDetection.y + lastDetection.h / 2;
+      servoController->recordFace(faceX, faceY);
+      servoController->lookAt(faceX, faceY);
+      faceDetector->recordServoCommand(lastDetection);
+      break;
+    }
+    case FaceEvent::LOST:
+      deferredLog.log(LOG_MAIN_FACE_LOST, (uint32_t)faces.lossTimeout());
+      setGlobalState(SystemState::SCANNING);
+      break;
+    case FaceEvent::LINK_DOWN:
+      setGlobalState(SystemState::SCANNING);
+      break;
+    case FaceEvent::NAP:
+      deferredLog.log(LOG_MAIN_FACE_NAP, (uint32_t)(millis() - faces.lastFaceMs()));
+      setGlobalState(SystemState::NAPPING);
+      break;
+    default:
+      break;
+  }
+}
+
+void dumpPowerStats() {
+  powerManager.dumpStats(Serial);
+  const XiaoHealth& health = faceDetector->getHealth();
+  if (!health.valid || !health.powerMode[0]) {
+    Serial.println("POWER xiao no report yet");
+    return;
+  }
+  Serial.printf("POWER xiao mode=%s active_ms=%lu low_ms=%lu standby_ms=%lu (%lu ms ago)\n", health.powerMode,
+                (unsigned long)health.powerMs[LINK_POWER_ACTIVE], (unsigned long)health.powerMs[LINK_POWER_LOW],
+                (unsigned long)health.powerMs[LINK_POWER_STANDBY], (unsigned long)(millis() - health.receivedAt));
+}
+
+void dumpHeapStats() {
+  heapGuard.dump(Serial);
+  const XiaoHealth& health = faceDetector->getHealth();
+  if (!health.valid) {
+    Serial.println("HEAP xiao no report yet");
+    return;
+  }
+  Serial.printf("HEAP xiao free=%lu min=%lu largest=%lu steady_allocs=%lu (%lu ms ago)\n",
+                (unsigned long)health.freeHeap, (unsigned long)health.minFreeHeap,
+                (unsigned long)health.largestFreeBlock, (unsigned long)health.steadyAllocations,
+                (unsigned long)(millis() - health.receivedAt));
+}
+
+// Writes a telemetry sample to flash once every TELEMETRY_INTERVAL.
+void logTelemetrySample() {
+  unsigned long now = millis();
+  if (now - lastTelemetrySample < TELEMETRY_INTERVAL) return;
+  lastTelemetrySample = now;
+  flashLog.log(LOG_TELEMETRY_SAMPLE, telemetryDetections, telemetryConfirmed, longestLoopUs, ESP.getFreeHeap());
+  const XiaoHealth& health = faceDetector->getHealth();
+  if (health.valid) {
+    flashLog.log(LOG_TELEMETRY_XIAO, health.fps, health.hitRate, health.inferenceP99Us,
+                 (int)((now - health.receivedAt) / 1000));
+  }
+  telemetryDetections = 0;
+  telemetryConfirmed = 0;
+  longestLoopUs = 0;
+}
+
+void applyDetectorPreset(int index) {
+  const DetectorPreset& preset = DETECTOR_PRESETS[index];
+  detectorPreset = index;
+  faceDetector->setDetectorSetting(LINK_SET_MSR_SCORE, preset.msrScore);
+  faceDetector->setDetectorSetting(LINK_SET_MSR_RESIZE, preset.msrResize);
+  faceDetector->setDetectorSetting(LINK_SET_MSR_TOP_K, preset.msrTopK);
+  faceDetector->setDetectorSetting(LINK_SET_MNP_TOP_K, preset.mnpTopK);
+  faceDetector->setDetectorSetting(LINK_SET_CAPTURE, preset.capture);
+}
+
+// The XIAO's camera looks out through the eye, so a blink only feeds it
+// darkness. Pause its inference while the lid is shut; the pause runs out
+// on its own if the request to resume is lost.
+void updateBlinkPause() {
+  bool watching = currentState == SystemState::SCANNING || currentState == SystemState::DETECTION;
+  bool shut = watching && servoController->eyelidOpenness() < LID_SHUT_OPENNESS;
+  if (shut == blinkPaused) return;
+  blinkPaused = shut;
+  faceDetector->setDetectorSetting(LINK_SET_PAUSE_MS, shut ? BLINK_PAUSE_MS : 0);
+}
+
+// --- Serial Debug Commands ---
+// Single-character commands typed into the serial monitor.
+//   p : print loop profiling statistics
+//   r : reset loop profiling statistics
+//   c : start/stop capturing the XIAO link
+//   d : dump the captured XIAO link traffic (for tools/link_replay)
+//   l : print XIAO link statistics (baud, overflows, heartbeat watchdog, reaction latency)
+//   s : print servo output frame statistics (frames, coalesced and dropped writes)
+//   b : benchmark screen clears and full/partial frame rates
+//   e : toggle the screen between status text and the animated eye
+//   m : switch between production (detection driven) and the demo cycle
+//   w : print time in each power state, on this board and the XIAO
+//   h : print heap free/low-water/largest block and steady-state allocations, on both boards
+//   g : start gaze calibration (keys are then handled by GazeCalibrator until it finishes)
+//   q : cycle the XIAO's detector preset (default, fast, thorough)
+//   t : dump the flash telemetry log (for tools/tlog_decode)
+//   v : toggle the camera view on the screen (the XIAO streams a thumbnail while it is on)
+void handleSerialCommands() {
+  HEAP_SCOPE(HeapSubsystem::COMMANDS);
+  while (Serial.available()) {
+    char command = Serial.read();
+    if (gazeCalibrator->isActive()) {
+      gazeCalibrator->handleKey(command, Serial);
+      continue;
+    }
+    switch (command) {
+      case 'p':
+#if ICU_LOOP_PROFILING
+        loopProfiler.dump(Serial);
+#else
+        Serial.println("Loop profiling is compiled out. Build with -D ICU_LOOP_PROFILING=1.");
+#endif
+        break;
+      case 'r':
+#if ICU_LOOP_PROFILING
+        loopProfiler.reset();
+        Serial.println("Loop profiling statistics reset.");
+#endif
+        break;
+      case 'c':
+        if (linkRecorder->isRecording()) {
+          linkRecorder->stop();
+          Serial.println("LinkRecorder: Capture stopped.");
+        } else {
+          linkRecorder->clear();
+          linkRecorder->start();
+          Serial.println(linkRecorder->isRecording() ? "LinkRecorder: Capture started." : "LinkRecorder: No capture buffer.");
+        }
+        break;
+      case 'd':
+        linkRecorder->dump(Serial);
+        break;
+      case 'l':
+        faceDetector->dumpLinkStats(Serial);
+        break;
+      case 's':
+        servoController->dumpOutputStats(Serial);
+        break;
+      case 'b':
+        screenController->benchmark(Serial);
+        break;
+      case 'e':
+        screenController->setEyeMode(!screenController->isEyeMode());
+        Serial.println(screenController->isEyeMode() ? "Screen: eye mode." : "Screen: status mode.");
+        break;
+      case 'm':
+        runMode = runMode == RunMode::PRODUCTION ? RunMode::DEMO : RunMode::PRODUCTION;
+        Serial.println(runMode == RunMode::PRODUCTION ? "Mode: production." : "Mode: demo cycle.");
+        if (currentState != SystemState::WAKE_UP && currentState != SystemState::ERROR) {
+          startRunMode();
+        }
+        break;
+      case 'w':
+        dumpPowerStats();
+        break;
+      case 'h':
+        dumpHeapStats();
+        break;
+      case 'g':
+        gazeCalibrator->start(Serial);
+        break;
+      case 'q':
+        applyDetectorPreset((detectorPreset + 1) % DETECTOR_PRESET_COUNT);
+        Serial.printf("XIAO detector preset: %s.\n", DETECTOR_PRESETS[detectorPreset].name);
+        break;
+      case 't':
+        flashLog.dump(Serial);
+        break;
+      case 'v':
+        screenController->setCameraView(!screenController->isCameraView());
+        faceDetector->setDetectorSetting(LINK_SET_THUMB_HZ, screenController->isCameraView() ? THUMB_VIEW_HZ : 0);
+        Serial.println(screenController->isCameraView() ? "Screen: camera view." : "Screen: camera view off.");
+        break;
+      default:
+        break;
+    }
+  }
 }
 
 void setup() {
   Serial.begin(115200);
   delay(2000);
   Serial.println("FeatherS3 Robot - Main Control Program Initializing...");
+  heapGuard.begin();
+  flashLog.begin();
+  flashLog.log(LOG_TELEMETRY_BOOT, (int)esp_reset_reason());
+  flashLog.flush(); // A boot that crashes early still shows up
 
   screenController = new ScreenController();
   servoController = new ServoController();
   ledController = new LedController();
+  faceDetector = new XiaoFaceDetector();
+  linkRecorder = new LinkRecorder();
+  linkRecorder->begin();
+  faceDetector->setRecorder(linkRecorder);
+  gazeCalibrator = new GazeCalibrator(*servoController);
   
   randomSeed(analogRead(A3));
   
@@ -68,15 +387,45 @@ void setup() {
 }
 
 void loop() {
+  PROFILE_LOOP_START();
+  uint32_t loopStartUs = micros();
+
   // --- Component Update Section (FROM YOUR WORKING CODE) ---
   if (ledController && ledController->isInitialized()) {
     ledController->update();
   }
+  if (servoController && servoController->isInitialized()) {
+    servoController->update();
+  }
   if (screenController && screenController->isInitialized()) {
+    if (servoController && servoController->isInitialized()) {
+      screenController->setEyelid(servoController->eyelidOpenness());
+    }
     screenController->update();
   }
-  if (servoController && servoController->isInitialized()) {
-    servoController->update();
+  if (faceDetector && faceDetector->isInitialized()) {
+    if (servoController && servoController->isInitialized()) {
+      updateBlinkPause();
+    }
+    // Take everything that arrived since the last pass, so a slow pass
+    // never leaves detections queued behind each other.
+    for (XiaoMessage message = faceDetector->update(); message.type != NONE; message = faceDetector->update()) {
+      // More of what woke us is probably on its way
+      powerManager.holdAwake(LINK_AWAKE_HOLD);
+      if (message.type == DETECTION) {
+        handleDetection(message);
+      } else if (message.type == FACE_LOST) {
+        faces.onFaceLost();
+      } else if (message.type == THUMBNAIL) {
+        ThumbDecoder& thumb = faceDetector->thumbnail();
+        int firstRow, lastRow;
+        if (!thumb.takeDirtyRows(firstRow, lastRow)) {
+          firstRow = THUMB_SIZE; // Only the box moved
+          lastRow = -1;
+        }
+        screenController->showThumbnail(thumb.pixels(), firstRow, lastRow, message.x, message.y, message.w, message.h);
+      }
+    }
   }
 
   // --- Main State Machine Logic ---
@@ -111,23 +460,28 @@ void loop() {
 
         case WakeUpStep::INITIALIZE_SERVOS:
           if (servoController->begin()) {
-            Serial.println("All components online. Performing awakening sequence...");
+            deferredLog.log(LOG_MAIN_SERVOS_ONLINE);
             servoController->setState(SystemState::WAKE_UP); 
             delay(1000); // Give components time to animate
-            Serial.println("Awakening complete.");
-            currentWakeUpStep = WakeUpStep::COMPLETE;
+            deferredLog.log(LOG_MAIN_AWAKE);
+            currentWakeUpStep = WakeUpStep::INITIALIZE_DETECTOR;
             
           } else { 
             currentState = SystemState::ERROR;          
           }
           break;
 
+        case WakeUpStep::INITIALIZE_DETECTOR:
+          // The XIAO link's RX pin is IO6, the same pin LedController::begin()
+          // drives, so the link has to be (re)started after the LEDs on every wake-up.
+          faceDetector->begin();
+          currentWakeUpStep = WakeUpStep::COMPLETE;
+          break;
+
         case WakeUpStep::COMPLETE:
-          Serial.println("WAKE_UP state is fully complete. Transitioning to SCANNING.");
-          // --- HANDOFF TO THE DEMO CYCLE ---
-          currentDemoState = DemoState::DEMO_SCAN_1; // Start the demo
-          demoStateStartTime = millis();             // Start the timer
-          setGlobalState(SystemState::SCANNING);     // Set the first state
+          deferredLog.log(LOG_MAIN_WAKE_COMPLETE);
+          // --- HANDOFF TO PRODUCTION OR THE DEMO CYCLE ---
+          startRunMode();
 
           break;
       }
@@ -141,10 +495,19 @@ void loop() {
     case SystemState::FULL_ASLEEP:
       {
         unsigned long now = millis();
+        if (gazeCalibrator->isActive()) {
+          // Hold the demo where it is while the eye is being calibrated.
+          demoStateStartTime = now;
+          break;
+        }
+        if (runMode == RunMode::PRODUCTION) {
+          updateProduction();
+          break;
+        }
         switch (currentDemoState) {
           case DemoState::DEMO_SCAN_1:
             if (now - demoStateStartTime > SCAN_DURATION_1) {
-              Serial.println("DEMO: Scan 1 complete. Napping...");
+              deferredLog.log(LOG_DEMO_SCAN_1_DONE);
               currentDemoState = DemoState::DEMO_DETECT;
               demoStateStartTime = now;
               setGlobalState(SystemState::DETECTION);
@@ -182,7 +545,7 @@ void loop() {
           
           case DemoState::DEMO_DETECT:
             if (now - demoStateStartTime > DETECT_DURATION) {
-              Serial.println("DEMO: Detection hold finished. Resuming scan...");
+              deferredLog.log(LOG_DEMO_DETECT_DONE);
               currentDemoState = DemoState::DEMO_SCAN_3;
               demoStateStartTime = now;
               setGlobalState(SystemState::SCANNING);
@@ -190,7 +553,7 @@ void loop() {
             break;
           case DemoState::DEMO_SCAN_3:
             if (now - demoStateStartTime > SCAN_DURATION_3) {
-              Serial.println("DEMO: Final scan complete. Going to sleep.");
+              deferredLog.log(LOG_DEMO_SCAN_3_DONE);
               currentDemoState = DemoState::DEMO_SLEEP;
               demoStateStartTime = now;
               setGlobalState(SystemState::FULL_ASLEEP);
@@ -198,7 +561,7 @@ void loop() {
             break;
           case DemoState::DEMO_SLEEP:
             if (now - demoStateStartTime > SLEEP_DURATION) {
-              Serial.println("DEMO: Sleep period over. Restarting cycle.");
+              deferredLog.log(LOG_DEMO_SLEEP_DONE);
               // To restart the whole cycle, we reset the startup state machine and go to WAKE_UP
               currentWakeUpStep = WakeUpStep::INITIALIZE_LEDS; // Reset startup sequence
               setGlobalState(SystemState::WAKE_UP);
@@ -211,4 +574,18 @@ void loop() {
     case SystemState::ERROR:
       break;
   }
+
+  handleSerialCommands();
+  heapGuard.update();
+
+  // Idle time: flush buffered log records without blocking.
+  deferredLog.drain(Serial);
+  logTelemetrySample();
+  flashLog.update();
+
+  uint32_t loopUs = micros() - loopStartUs;
+  if (loopUs > longestLoopUs) longestLoopUs = loopUs;
+
+  // Sleep until the next scheduled wakeup, if nothing else is busy
+  powerManager.idle({screenController->isPanelOn(), flashLog.isWriting()});
 }
\ No newline at end of file
@@ -0,0 +1,105 @@
+// lib/CameraPower/CameraPower.cpp
+
+#include "CameraPower.h"
+#include "DeferredLog.h"
+
+const unsigned long LOW_FRAME_INTERVAL = 500; // ms, 2 frames per second while still
+const uint32_t ACTIVE_CPU_MHZ = 240;
+// The UART keeps its baud rate down to 80 MHz, where APB stops following the CPU
+const uint32_t STANDBY_CPU_MHZ = 80;
+
+// Software power-down bits
+const int OV2640_COM2 = 0x109; // Sensor bank (bit 8) register 0x09
+const int OV2640_COM2_STANDBY = 0x10;
+const int OV5640_SYSTEM_CTROL0 = 0x3008;
+const int OV5640_POWER_DOWN = 0x40;
+
+CameraPower::CameraPower() {
+  _sensor = nullptr;
+  _mode = LINK_POWER_ACTIVE;
+  _requested = LINK_POWER_ACTIVE;
+  _modeSince = 0;
+  for (int i = 0; i < LINK_POWER_MODE_COUNT; i++) _msIn[i] = 0;
+  _lastFrame = 0;
+  _minFrameInterval = 0;
+}
+
+void CameraPower::begin() {
+  _sensor = esp_camera_sensor_get();
+  _modeSince = millis();
+}
+
+void CameraPower::setMode(LinkPowerMode mode) {
+  _requested = mode;
+  if (mode == _mode) return;
+  _account();
+
+  bool standby = mode == LINK_POWER_STANDBY;
+  if (standby != (_mode == LINK_POWER_STANDBY)) {
+    if (_setSensorStandby(standby)) {
+      setCpuFrequencyMhz(standby ? STANDBY_CPU_MHZ : ACTIVE_CPU_MHZ);
+    } else if (standby) {
+      mode = LINK_POWER_LOW; // No way to stop this sensor, so settle for the low frame rate
+    } else {
+      setCpuFrequencyMhz(ACTIVE_CPU_MHZ);
+    }
+  }
+  if (mode == _mode) return;
+  deferredLog.log(LOG_XIAO_POWER_MODE, (int)_mode, (int)mode);
+  _mode = mode;
+}
+
+LinkPowerMode CameraPower::mode() const {
+  return _mode;
+}
+
+LinkPowerMode CameraPower::requestedMode() const {
+  return _requested;
+}
+
+bool CameraPower::_setSensorStandby(bool standby) {
+  if (!_sensor || !_sensor->set_reg) return false;
+  switch (_sensor->id.PID) {
+    case OV2640_PID:
+      return _sensor->set_reg(_sensor, OV2640_COM2, OV2640_COM2_STANDBY, standby ? OV2640_COM2_STANDBY : 0) == 0;
+    case OV5640_PID:
+      return _sensor->set_reg(_sensor, OV5640_SYSTEM_CTROL0, OV5640_POWER_DOWN, standby ? OV5640_POWER_DOWN : 0) == 0;
+    default:
+      return false;
+  }
+}
+
+void CameraPower::setMaxFps(float fps) {
+  _minFrameInterval = fps > 0 ? (unsigned long)(1000.0f / fps) : 0;
+}
+
+bool CameraPower::frameDue(bool motionIdle) {
+  if (_minFrameInterval && millis() - _lastFrame < _minFrameInterval) return false;
+  switch (_mode) {
+    case LINK_POWER_STANDBY:
+      return false;
+    case LINK_POWER_LOW:
+      if (motionIdle && millis() - _lastFrame < LOW_FRAME_INTERVAL) return false;
+      break;
+    default:
+      break;
+  }
+  _lastFrame = millis();
+  return true;
+}
+
+void CameraPower::_account() {
+  unsigned long now = millis();
+  _msIn[_mode] += now - _modeSince;
+  _modeSince = now;
+}
+
+void CameraPower::writeReport(JsonObject data) {
+  _account();
+  data["mode"] = LINK_POWER_MODE_NAMES[_mode];
+  data["req"] = LINK_POWER_MODE_NAMES[_requested];
+  JsonArray ms = data["ms"].to<JsonArray>();
+  for (int i = 0; i < LINK_POWER_MODE_COUNT; i++) {
+    ms.add(_msIn[i]);
+  }
+}
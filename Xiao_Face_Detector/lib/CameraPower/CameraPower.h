@@ -0,0 +1,52 @@
+// lib/CameraPower/CameraPower.h
+
+#ifndef CAMERA_POWER_H
+#define CAMERA_POWER_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "esp_camera.h"
+#include "LinkProtocol.h"
+
+// Puts the camera pipeline into the power mode the ProS3 asked for.
+//
+// In low mode frames are only taken every LOW_FRAME_INTERVAL while the
+// motion gate is idle; as soon as it sees motion the loop runs at full rate
+// again, so a person walking in is still found quickly. In standby the
+// sensor is put into its software power-down (the XIAO's camera has no
+// PWDN pin) and the CPU clock is lowered until another mode is asked for.
+class CameraPower {
+public:
+  static const unsigned long IDLE_POLL_MS = 20; // Loop sleep while no frame is due
+
+  CameraPower();
+  // Call after esp_camera_init().
+  void begin();
+
+  void setMode(LinkPowerMode mode);
+  LinkPowerMode mode() const;          // The mode in effect
+  LinkPowerMode requestedMode() const; // The last mode asked for, which the sensor may not support
+
+  // Caps the frame rate in every mode; 0 lifts the cap.
+  void setMaxFps(float fps);
+
+  // Whether to capture a frame now. 'motionIdle' is MotionGate::isIdle().
+  bool frameDue(bool motionIdle);
+
+  // Writes the modes and the milliseconds spent in each mode into 'data'.
+  void writeReport(JsonObject data);
+
+private:
+  void _account();
+  bool _setSensorStandby(bool standby);
+
+  sensor_t* _sensor;
+  LinkPowerMode _mode;
+  LinkPowerMode _requested;
+  unsigned long _modeSince;   // millis() of the last accounting
+  uint32_t _msIn[LINK_POWER_MODE_COUNT];
+  unsigned long _lastFrame;
+  unsigned long _minFrameInterval; // ms, from setMaxFps()
+};
+
+#endif // CAMERA_POWER_H
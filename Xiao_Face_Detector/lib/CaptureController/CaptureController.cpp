@@ -0,0 +1,179 @@
+// lib/CaptureController/CaptureController.cpp
+
+#include "CaptureController.h"
+
+const framesize_t SEARCH_FRAME_SIZE = FRAMESIZE_240X240; // Must stay the size the camera was initialised with
+const framesize_t SMALL_FRAME_SIZE = FRAMESIZE_128X128;  // Used for NEAR and ROI
+const int SMALL_FRAME_PIXELS = 128;
+
+const int LARGE_FACE = 80;        // Full-frame pixels: a face this big is easy to find at 128x128
+const int ROI_SCALE = 3;          // The window is this many times the face size...
+const int MIN_ROI = 64;           // ...but never smaller than this (full-frame pixels)
+const int RECENTER_MARGIN = 4;    // Move the window once the face centre is within 1/4 of its edge
+const int FRAMES_BEFORE_SEARCH = 3; // Inferred frames without a face before going back to full field
+
+// The OV5640 driver's 1:1 sensor window, which FRAMESIZE_240X240 and
+// FRAMESIZE_128X128 both read out (esp32-camera ov5640.c, ratio_table).
+// The ISP crops OFFSET pixels off each side before scaling.
+const int SENSOR_START_X = 320;
+const int SENSOR_START_Y = 0;
+const int SENSOR_OFFSET_X = 32;
+const int SENSOR_OFFSET_Y = 16;
+const int SENSOR_ACTIVE_W = 2160;
+const int SENSOR_ACTIVE_H = 1920;
+const int SENSOR_TOTAL_X = 2684;
+const int SENSOR_VBLANK = 16;     // Lines of vertical blanking on top of the window
+
+CaptureController::CaptureController() {
+  _sensor = nullptr;
+  _canWindow = false;
+  _adaptive = true;
+  _mode = CaptureMode::SEARCH;
+  _windowX = 0;
+  _windowY = 0;
+  _windowSize = FULL_FRAME_SIZE;
+  _missedFrames = 0;
+  _discard = 0;
+  _switches = 0;
+  _discarded = 0;
+}
+
+void CaptureController::begin() {
+  _sensor = esp_camera_sensor_get();
+  _canWindow = _sensor && _sensor->id.PID == OV5640_PID && _sensor->set_res_raw;
+  Serial.printf("CaptureController: sensor PID 0x%x, windowing %s\n",
+                _sensor ? _sensor->id.PID : 0, _canWindow ? "on" : "off");
+}
+
+bool CaptureController::discardFrame() {
+  if (_discard == 0) return false;
+  _discard--;
+  _discarded++;
+  return true;
+}
+
+void CaptureController::toFullFrame(int& x, int& y, int& w, int& h, int frameWidth, int frameHeight) const {
+  x = _windowX + x * _windowSize / frameWidth;
+  y = _windowY + y * _windowSize / frameHeight;
+  w = w * _windowSize / frameWidth;
+  h = h * _windowSize / frameHeight;
+}
+
+void CaptureController::setAdaptive(bool adaptive) {
+  _adaptive = adaptive;
+  if (!adaptive && _sensor) {
+    _apply(CaptureMode::SEARCH, 0, 0, FULL_FRAME_SIZE);
+  }
+}
+
+void CaptureController::update(bool found, int x, int y, int w, int h) {
+  if (!_sensor || !_adaptive) return;
+
+  if (!found) {
+    if (_mode != CaptureMode::SEARCH && ++_missedFrames >= FRAMES_BEFORE_SEARCH) {
+      _apply(CaptureMode::SEARCH, 0, 0, FULL_FRAME_SIZE);
+    }
+    return;
+  }
+  _missedFrames = 0;
+
+  // Some hysteresis so a face right at the threshold does not flip the frame size every frame
+  int faceSize = max(w, h);
+  int largeFace = _mode == CaptureMode::NEAR ? LARGE_FACE * 3 / 4 : LARGE_FACE;
+  if (faceSize >= largeFace) {
+    _apply(CaptureMode::NEAR, 0, 0, FULL_FRAME_SIZE);
+    return;
+  }
+  if (!_canWindow) {
+    _apply(CaptureMode::SEARCH, 0, 0, FULL_FRAME_SIZE);
+    return;
+  }
+
+  // A small face: keep a window around it, moving it only when the face
+  // drifts towards its edge or no longer fits comfortably.
+  int size = constrain(faceSize * ROI_SCALE, MIN_ROI, FULL_FRAME_SIZE);
+  int centerX = x + w / 2;
+  int centerY = y + h / 2;
+  if (_mode == CaptureMode::ROI) {
+    int margin = _windowSize / RECENTER_MARGIN;
+    bool centered = centerX > _windowX + margin && centerX < _windowX + _windowSize - margin &&
+                    centerY > _windowY + margin && centerY < _windowY + _windowSize - margin;
+    bool sized = size <= _windowSize && size * 2 > _windowSize;
+    if (centered && sized) return;
+  }
+  int windowX = constrain(centerX - size / 2, 0, FULL_FRAME_SIZE - size);
+  int windowY = constrain(centerY - size / 2, 0, FULL_FRAME_SIZE - size);
+  _apply(CaptureMode::ROI, windowX, windowY, size);
+}
+
+void CaptureController::_apply(CaptureMode mode, int windowX, int windowY, int windowSize) {
+  if (mode == _mode && windowX == _windowX && windowY == _windowY && windowSize == _windowSize) return;
+
+  framesize_t frameSize = mode == CaptureMode::SEARCH ? SEARCH_FRAME_SIZE : SMALL_FRAME_SIZE;
+  bool leavingRoi = _mode == CaptureMode::ROI && mode != CaptureMode::ROI;
+  if (_sensor->status.framesize != frameSize || leavingRoi) {
+    // set_framesize() also restores the driver's full-field sensor window.
+    if (_sensor->set_framesize(_sensor, frameSize) != 0) return;
+  }
+  if (mode == CaptureMode::ROI && !_setSensorWindow(windowX, windowY, windowSize)) {
+    // Stay on the full field rather than report boxes against the wrong window.
+    mode = CaptureMode::NEAR;
+    windowX = 0;
+    windowY = 0;
+    windowSize = FULL_FRAME_SIZE;
+  }
+
+  _mode = mode;
+  _windowX = windowX;
+  _windowY = windowY;
+  _windowSize = windowSize;
+  _missedFrames = 0;
+  _discard = 1;
+  _switches++;
+}
+
+// Reads out only the part of the sensor behind the window. Fewer lines per
+// frame means a shorter frame time, and the scaler gives small faces more
+// pixels than they had in the full-field frame.
+bool CaptureController::_setSensorWindow(int windowX, int windowY, int windowSize) {
+  // Active sensor area of the window, on even pixel boundaries
+  int activeX = SENSOR_START_X + SENSOR_OFFSET_X + ((windowX * SENSOR_ACTIVE_W / FULL_FRAME_SIZE) & ~1);
+  int activeY = SENSOR_START_Y + SENSOR_OFFSET_Y + ((windowY * SENSOR_ACTIVE_H / FULL_FRAME_SIZE) & ~1);
+  int activeW = (windowSize * SENSOR_ACTIVE_W / FULL_FRAME_SIZE) & ~1;
+  int activeH = (windowSize * SENSOR_ACTIVE_H / FULL_FRAME_SIZE) & ~1;
+
+  int startX = activeX - SENSOR_OFFSET_X;
+  int startY = activeY - SENSOR_OFFSET_Y;
+  int endX = activeX + activeW + SENSOR_OFFSET_X - 1;
+  int endY = activeY + activeH + SENSOR_OFFSET_Y - 1;
+  int totalY = endY - startY + 1 + SENSOR_VBLANK;
+  // Same rule as the driver's set_framesize(): bin 2x2 when the output is at most half the window
+  bool binning = activeW >= 2 * SMALL_FRAME_PIXELS && activeH >= 2 * SMALL_FRAME_PIXELS;
+
+  return _sensor->set_res_raw(_sensor, startX, startY, endX, endY, SENSOR_OFFSET_X, SENSOR_OFFSET_Y,
+                              SENSOR_TOTAL_X, totalY, SMALL_FRAME_PIXELS, SMALL_FRAME_PIXELS,
+                              true, binning) == 0;
+}
+
+CaptureMode CaptureController::mode() const {
+  return _mode;
+}
+
+void CaptureController::window(int& x, int& y, int& size) const {
+  x = _windowX;
+  y = _windowY;
+  size = _windowSize;
+}
+
+void CaptureController::writeReport(JsonObject data) {
+  static const char* modeNames[] = {"search", "near", "roi"};
+  data["mode"] = modeNames[(int)_mode];
+  JsonArray window = data["win"].to<JsonArray>();
+  window.add(_windowX);
+  window.add(_windowY);
+  window.add(_windowSize);
+  data["sw"] = _switches;
+  data["drop"] = _discarded;
+  _switches = 0;
+  _discarded = 0;
+}
@@ -0,0 +1,67 @@
+// lib/CaptureController/CaptureController.h
+
+#ifndef CAPTURE_CONTROLLER_H
+#define CAPTURE_CONTROLLER_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "esp_camera.h"
+
+// Every box sent to the ProS3 is in this coordinate system: the full field of
+// view as the original fixed FRAMESIZE_240X240 capture saw it.
+const int FULL_FRAME_SIZE = 240;
+
+enum class CaptureMode : uint8_t {
+  SEARCH, // Full field at 240x240, while no face is known
+  NEAR,   // Full field at 128x128: the face is big enough to find in a small frame
+  ROI     // OV5640 only: a window around the last face, read out at 128x128
+};
+
+// Picks the camera frame size and sensor window for the next frames from
+// where the last face was, and maps boxes back to full-frame coordinates.
+//
+// Every reconfiguration costs the frame that was already on its way, so
+// the window only moves when the face leaves its middle, and the first
+// frame after a change is thrown away (see discardFrame()).
+class CaptureController {
+public:
+  CaptureController();
+  // Call after esp_camera_init(). Windowing is only used on an OV5640.
+  void begin();
+
+  // True if this frame was captured before the last reconfiguration took effect.
+  bool discardFrame();
+
+  // Converts a box from the current frame's pixels to full-frame coordinates.
+  void toFullFrame(int& x, int& y, int& w, int& h, int frameWidth, int frameHeight) const;
+  // Feed the result of every inferred frame, in full-frame coordinates.
+  void update(bool found, int x, int y, int w, int h);
+
+  // With adaptive capture off, every frame is the full field at 240x240.
+  void setAdaptive(bool adaptive);
+
+  CaptureMode mode() const;
+  // The part of the full frame the current frames show, in full-frame coordinates.
+  void window(int& x, int& y, int& size) const;
+
+  // Writes the mode, window and switch count into 'data' and starts a new window.
+  void writeReport(JsonObject data);
+
+private:
+  void _apply(CaptureMode mode, int windowX, int windowY, int windowSize);
+  bool _setSensorWindow(int windowX, int windowY, int windowSize);
+
+  sensor_t* _sensor;
+  bool _canWindow;
+  bool _adaptive;
+  CaptureMode _mode;
+  int _windowX;    // Current window, in full-frame coordinates
+  int _windowY;
+  int _windowSize;
+  int _missedFrames;
+  int _discard;
+  uint32_t _switches;
+  uint32_t _discarded;
+};
+
+#endif // CAPTURE_CONTROLLER_H
@@ -0,0 +1,119 @@
+// lib/DetectionEmitter/DetectionEmitter.cpp
+
+#include "DetectionEmitter.h"
+
+// {"action":"","data":""} and the println() line ending around every message
+const int MESSAGE_OVERHEAD = 25;
+
+DetectionEmitter::DetectionEmitter() {
+  configure((int)LINK_SETTINGS[LINK_SET_EMIT_PX].defaultValue,
+            (unsigned long)LINK_SETTINGS[LINK_SET_EMIT_KEEP].defaultValue,
+            LINK_SETTINGS[LINK_SET_EMIT_HZ].defaultValue);
+  _shown = false;
+  _lastSent = 0;
+  _misses = 0;
+  _framesShown = 0;
+  _action = "";
+  _data[0] = '\0';
+  _windowStart = 0;
+  _sentBytes = 0;
+  _everyFrameBytes = 0;
+  _messages = 0;
+  _unchanged = 0;
+  _rateCapped = 0;
+}
+
+void DetectionEmitter::configure(int minChangePx, unsigned long keepAliveMs, float maxRateHz) {
+  _minChangePx = minChangePx;
+  _keepAliveMs = keepAliveMs;
+  _minIntervalMs = maxRateHz > 0 ? (unsigned long)(1000.0f / maxRateHz) : 0;
+}
+
+const char* DetectionEmitter::action() const {
+  return _action;
+}
+
+const char* DetectionEmitter::data() const {
+  return _data;
+}
+
+EmitKind DetectionEmitter::update(bool found, const DetectionBox& box, unsigned long nowMs) {
+  if (!found) {
+    if (_shown && ++_misses >= LOSS_FRAMES) {
+      _shown = false;
+      return _emit(EmitKind::LOST, _sent, nowMs);
+    }
+    return EmitKind::NONE;
+  }
+  _misses = 0;
+
+  char full[48];
+  int fullLength = snprintf(full, sizeof(full), "%d,%d,%d,%d,%lu,%u,%d", box.x, box.y, box.w, box.h,
+                            (unsigned long)box.captureUs, (unsigned)box.track, box.person);
+  _everyFrameBytes += MESSAGE_OVERHEAD + strlen("detection") + fullLength;
+
+  if (!_shown || box.track != _sent.track || box.person != _sent.person) {
+    if (!_shown) _framesShown = 0;
+    _shown = true;
+    _framesShown++;
+    return _emit(EmitKind::FULL, box, nowMs);
+  }
+
+  bool confirming = _framesShown < CONFIRM_FRAMES;
+  if (confirming) _framesShown++;
+  int moved = max(max(abs(box.x - _sent.x), abs(box.y - _sent.y)), max(abs(box.w - _sent.w), abs(box.h - _sent.h)));
+  bool keepAlive = nowMs - _lastSent >= _keepAliveMs;
+  if (moved < _minChangePx && !keepAlive && !confirming) {
+    _unchanged++;
+    return EmitKind::NONE;
+  }
+  if (nowMs - _lastSent < _minIntervalMs) {
+    _rateCapped++;
+    return EmitKind::NONE;
+  }
+  return _emit(keepAlive ? EmitKind::FULL : EmitKind::DELTA, box, nowMs);
+}
+
+EmitKind DetectionEmitter::_emit(EmitKind kind, const DetectionBox& box, unsigned long nowMs) {
+  switch (kind) {
+    case EmitKind::FULL:
+      _action = "detection";
+      snprintf(_data, sizeof(_data), "%d,%d,%d,%d,%lu,%u,%d", box.x, box.y, box.w, box.h,
+               (unsigned long)box.captureUs, (unsigned)box.track, box.person);
+      break;
+    case EmitKind::DELTA:
+      _action = "delta";
+      snprintf(_data, sizeof(_data), "%d,%d,%d,%d,%lu", box.x - _sent.x, box.y - _sent.y, box.w - _sent.w,
+               box.h - _sent.h, (unsigned long)(box.captureUs - _sent.captureUs));
+      break;
+    case EmitKind::LOST:
+      _action = "lost";
+      snprintf(_data, sizeof(_data), "%u", (unsigned)box.track);
+      break;
+    default:
+      return EmitKind::NONE;
+  }
+  _sent = box;
+  _lastSent = nowMs;
+  _messages++;
+  _sentBytes += MESSAGE_OVERHEAD + strlen(_action) + strlen(_data);
+  return kind;
+}
+
+void DetectionEmitter::writeReport(JsonObject data) {
+  unsigned long windowMs = millis() - _windowStart;
+  float seconds = windowMs > 0 ? windowMs / 1000.0f : 1.0f;
+  data["bps"] = (uint32_t)(_sentBytes / seconds);
+  // Negative when faces come and go faster than they are held, since losses cost a message
+  data["saved"] = (int32_t)(((int64_t)_everyFrameBytes - _sentBytes) / seconds);
+  data["n"] = _messages;
+  data["same"] = _unchanged;
+  data["cap"] = _rateCapped;
+
+  _windowStart = millis();
+  _sentBytes = 0;
+  _everyFrameBytes = 0;
+  _messages = 0;
+  _unchanged = 0;
+  _rateCapped = 0;
+}
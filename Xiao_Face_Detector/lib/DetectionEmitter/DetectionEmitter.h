@@ -0,0 +1,80 @@
+// lib/DetectionEmitter/DetectionEmitter.h
+
+#ifndef DETECTION_EMITTER_H
+#define DETECTION_EMITTER_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "LinkProtocol.h"
+
+// One frame's face, as it would go to the ProS3.
+struct DetectionBox {
+  int x = 0, y = 0, w = 0, h = 0; // Full-field coordinates
+  uint32_t captureUs = 0;
+  uint16_t track = 0;
+  int person = -1;
+};
+
+// What, if anything, to send to the ProS3 for this frame.
+enum class EmitKind : uint8_t {
+  NONE,
+  FULL,  // "detection": x,y,w,h,captureUs,track,person
+  DELTA, // "delta": dx,dy,dw,dh,dCaptureUs against the last box sent
+  LOST   // "lost": track
+};
+
+// Decides which detections are worth the link's time.
+//
+// A face that has just appeared, or a new track or identity, is sent in
+// full straight away, and so is the loss of a face after LOSS_FRAMES
+// inferred frames without it. In between, a box is only sent when it has
+// moved by at least the configured number of pixels, or when the
+// keep-alive period runs out, and never faster than the rate cap. Moves go
+// out as deltas against the last box sent; keep-alives go out in full, so
+// a line lost on the way only leaves the ProS3 off until the next one.
+//
+// The ProS3 confirms a face from how many frames it was seen in, so the
+// first CONFIRM_FRAMES frames of a face are all sent, moved or not.
+class DetectionEmitter {
+public:
+  static const int LOSS_FRAMES = 2;
+  static const int CONFIRM_FRAMES = 5; // The ProS3's FACE_CONFIRM_WINDOW
+
+  DetectionEmitter();
+  // 'minChangePx' 0 sends every frame (still subject to the rate cap).
+  void configure(int minChangePx, unsigned long keepAliveMs, float maxRateHz);
+
+  // Call after every inferred frame. 'box' is ignored when no face was found.
+  EmitKind update(bool found, const DetectionBox& box, unsigned long nowMs);
+  // The message for the last update() that returned something other than NONE
+  const char* action() const;
+  const char* data() const;
+
+  // Writes bytes per second sent and saved against sending every face frame
+  // in full, with the suppression counts, into 'data' and starts a new window.
+  void writeReport(JsonObject data);
+
+private:
+  EmitKind _emit(EmitKind kind, const DetectionBox& box, unsigned long nowMs);
+
+  int _minChangePx;
+  unsigned long _keepAliveMs;
+  unsigned long _minIntervalMs;
+
+  bool _shown;           // The last message sent said a face was there
+  DetectionBox _sent;    // The box the ProS3 has now
+  unsigned long _lastSent;
+  int _misses;
+  int _framesShown;      // Frames of this face so far, up to CONFIRM_FRAMES
+  const char* _action;
+  char _data[48];
+
+  unsigned long _windowStart;
+  uint32_t _sentBytes;
+  uint32_t _everyFrameBytes; // What sending every face frame in full would have cost
+  uint32_t _messages;
+  uint32_t _unchanged;       // Frames held back because the box had not moved enough
+  uint32_t _rateCapped;      // Frames held back by the rate cap
+};
+
+#endif // DETECTION_EMITTER_H
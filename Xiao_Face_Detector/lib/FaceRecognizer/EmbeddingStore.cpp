@@ -0,0 +1,90 @@
+// lib/FaceRecognizer/EmbeddingStore.cpp
+
+#include "EmbeddingStore.h"
+#include <math.h>
+#include <string.h>
+
+EmbeddingStore::EmbeddingStore() {
+  _cache = nullptr;
+  _count = 0;
+}
+
+void EmbeddingStore::begin(float* cache) {
+  _cache = cache;
+  _count = 0;
+}
+
+int EmbeddingStore::count() const {
+  return _count;
+}
+
+const char* EmbeddingStore::name(int person) const {
+  return person >= 0 && person < _count ? _names[person] : "";
+}
+
+float* EmbeddingStore::_embedding(int person) const {
+  return _cache + person * DIMS;
+}
+
+int EmbeddingStore::add(const char* name, const float* embedding) {
+  if (!_cache || _count >= MAX_PEOPLE) return -1;
+
+  float norm = 0;
+  for (int i = 0; i < DIMS; i++) norm += embedding[i] * embedding[i];
+  norm = sqrtf(norm);
+  if (norm == 0) return -1;
+
+  float* stored = _embedding(_count);
+  for (int i = 0; i < DIMS; i++) stored[i] = embedding[i] / norm;
+  strncpy(_names[_count], name, PackedFace::NAME_LENGTH - 1);
+  _names[_count][PackedFace::NAME_LENGTH - 1] = '\0';
+  return _count++;
+}
+
+int EmbeddingStore::addPacked(const PackedFace& face) {
+  float embedding[DIMS];
+  for (int i = 0; i < DIMS; i++) embedding[i] = face.values[i] * face.scale / 127.0f;
+  char name[PackedFace::NAME_LENGTH];
+  memcpy(name, face.name, sizeof(name));
+  name[sizeof(name) - 1] = '\0';
+  return add(name, embedding);
+}
+
+void EmbeddingStore::pack(int person, PackedFace& face) const {
+  memset(&face, 0, sizeof(face));
+  if (person < 0 || person >= _count) return;
+
+  const float* stored = _embedding(person);
+  float largest = 0;
+  for (int i = 0; i < DIMS; i++) largest = fmaxf(largest, fabsf(stored[i]));
+  face.scale = largest;
+  for (int i = 0; i < DIMS; i++) {
+    face.values[i] = largest > 0 ? (int8_t)lroundf(stored[i] / largest * 127.0f) : 0;
+  }
+  memcpy(face.name, _names[person], sizeof(face.name));
+}
+
+void EmbeddingStore::clear() {
+  _count = 0;
+}
+
+int EmbeddingStore::match(const float* embedding, float threshold, float* similarity) const {
+  float norm = 0;
+  for (int i = 0; i < DIMS; i++) norm += embedding[i] * embedding[i];
+  norm = sqrtf(norm);
+
+  int best = -1;
+  float bestSimilarity = -1.0f;
+  for (int person = 0; person < _count && norm > 0; person++) {
+    const float* stored = _embedding(person);
+    float dot = 0;
+    for (int i = 0; i < DIMS; i++) dot += stored[i] * embedding[i];
+    float cosine = dot / norm;
+    if (cosine > bestSimilarity) {
+      bestSimilarity = cosine;
+      best = person;
+    }
+  }
+  if (similarity) *similarity = bestSimilarity;
+  return bestSimilarity >= threshold ? best : -1;
+}
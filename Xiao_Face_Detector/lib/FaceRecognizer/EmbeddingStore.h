@@ -0,0 +1,56 @@
+// lib/FaceRecognizer/EmbeddingStore.h
+
+#ifndef EMBEDDING_STORE_H
+#define EMBEDDING_STORE_H
+
+#include <stdint.h>
+
+// One enrolled person as kept in flash: the embedding quantised to 8 bits
+// against its own largest component, about a quarter of the float size.
+struct PackedFace {
+  static const int NAME_LENGTH = 16;
+  static const int DIMS = 512; // FaceRecognition112V1S8's embedding size
+
+  char name[NAME_LENGTH];
+  float scale;                 // Component value of +127
+  int8_t values[DIMS];
+};
+
+// The enrolled people, matched by cosine similarity.
+//
+// The embeddings live in a float cache the caller provides (in PSRAM on the
+// XIAO), unit-length so a match is one dot product per person. People keep
+// their index for as long as they stay enrolled; that index is the identity
+// sent to the ProS3.
+class EmbeddingStore {
+public:
+  static const int MAX_PEOPLE = 8;
+  static const int DIMS = PackedFace::DIMS;
+
+  EmbeddingStore();
+  // 'cache' holds MAX_PEOPLE * DIMS floats.
+  void begin(float* cache);
+
+  int count() const;
+  const char* name(int person) const;
+
+  // Adds a person and returns their index, or -1 when the store is full.
+  int add(const char* name, const float* embedding);
+  // The same, from the flash form.
+  int addPacked(const PackedFace& face);
+  void pack(int person, PackedFace& face) const;
+  void clear();
+
+  // The closest enrolled person, or -1 if nobody reaches 'threshold'.
+  // 'similarity' gets the best cosine similarity either way.
+  int match(const float* embedding, float threshold, float* similarity) const;
+
+private:
+  float* _embedding(int person) const;
+
+  float* _cache;
+  int _count;
+  char _names[MAX_PEOPLE][PackedFace::NAME_LENGTH];
+};
+
+#endif // EMBEDDING_STORE_H
@@ -0,0 +1,118 @@
+// lib/FaceRecognizer/FaceRecognizer.cpp
+
+#include "FaceRecognizer.h"
+
+#if ICU_FACE_RECOGNITION
+
+#include <Preferences.h>
+
+// Cosine similarity a face needs to be taken as an enrolled person
+const float MATCH_THRESHOLD = 0.55f;
+
+// Enrolled people storage. Bump the version if PackedFace changes.
+const char* FACES_NVS_NAMESPACE = "faces";
+const uint8_t FACES_NVS_VERSION = 1;
+
+FaceRecognizer::FaceRecognizer() {
+  _cache = nullptr;
+  _isInitialized = false;
+}
+
+bool FaceRecognizer::begin() {
+  if (!_cache) {
+    _cache = (float*)ps_malloc(EmbeddingStore::MAX_PEOPLE * EmbeddingStore::DIMS * sizeof(float));
+  }
+  if (!_cache) {
+    Serial.println("FaceRecognizer: No PSRAM for the embedding cache, recognition off.");
+    return false;
+  }
+  _store.begin(_cache);
+  _load();
+  _isInitialized = true;
+  Serial.printf("FaceRecognizer: %d enrolled.\n", _store.count());
+  return true;
+}
+
+bool FaceRecognizer::isInitialized() const {
+  return _isInitialized;
+}
+
+const EmbeddingStore& FaceRecognizer::store() const {
+  return _store;
+}
+
+const float* FaceRecognizer::_embed(const camera_fb_t* fb, std::vector<int>& landmarks) {
+  dl::Tensor<float>& embedding =
+      _model.get_face_emb((uint16_t*)fb->buf, {(int)fb->height, (int)fb->width, 3}, landmarks);
+  if (embedding.get_size() != EmbeddingStore::DIMS) return nullptr;
+  return embedding.element;
+}
+
+int FaceRecognizer::recognize(const camera_fb_t* fb, std::vector<int>& landmarks, float* similarity) {
+  if (similarity) *similarity = 0;
+  if (!_isInitialized || _store.count() == 0) return -1; // Nobody to be: skip the model
+  const float* embedding = _embed(fb, landmarks);
+  if (!embedding) return -1;
+  return _store.match(embedding, MATCH_THRESHOLD, similarity);
+}
+
+int FaceRecognizer::enroll(const camera_fb_t* fb, std::vector<int>& landmarks, const char* name) {
+  if (!_isInitialized) return -1;
+  const float* embedding = _embed(fb, landmarks);
+  if (!embedding) return -1;
+  int person = _store.add(name, embedding);
+  if (person >= 0 && !_save(person)) {
+    Serial.println("FaceRecognizer: Enrolled until the next reboot, saving failed.");
+  }
+  return person;
+}
+
+void FaceRecognizer::forgetAll() {
+  _store.clear();
+  Preferences prefs;
+  if (prefs.begin(FACES_NVS_NAMESPACE, false)) {
+    prefs.clear();
+    prefs.end();
+  }
+}
+
+void FaceRecognizer::list(Print& out) {
+  out.printf("FACES enrolled=%d max=%d\n", _store.count(), EmbeddingStore::MAX_PEOPLE);
+  for (int person = 0; person < _store.count(); person++) {
+    out.printf("FACES %d %s\n", person, _store.name(person));
+  }
+}
+
+// Each person is one blob, "p<index>", so enrolling writes only the new one.
+void FaceRecognizer::_load() {
+  Preferences prefs;
+  if (!prefs.begin(FACES_NVS_NAMESPACE, true)) return;
+  if (prefs.getUChar("ver", 0) == FACES_NVS_VERSION) {
+    int count = prefs.getUChar("n", 0);
+    PackedFace face;
+    char key[8];
+    for (int person = 0; person < count && person < EmbeddingStore::MAX_PEOPLE; person++) {
+      snprintf(key, sizeof(key), "p%d", person);
+      if (prefs.getBytes(key, &face, sizeof(face)) != sizeof(face)) break;
+      _store.addPacked(face);
+    }
+  }
+  prefs.end();
+}
+
+bool FaceRecognizer::_save(int person) {
+  PackedFace face;
+  _store.pack(person, face);
+  char key[8];
+  snprintf(key, sizeof(key), "p%d", person);
+
+  Preferences prefs;
+  if (!prefs.begin(FACES_NVS_NAMESPACE, false)) return false;
+  bool saved = prefs.putBytes(key, &face, sizeof(face)) == sizeof(face) &&
+               prefs.putUChar("n", _store.count()) == 1 &&
+               prefs.putUChar("ver", FACES_NVS_VERSION) == 1;
+  prefs.end();
+  return saved;
+}
+
+#endif // ICU_FACE_RECOGNITION
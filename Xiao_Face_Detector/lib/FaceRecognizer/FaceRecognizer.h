@@ -0,0 +1,57 @@
+// lib/FaceRecognizer/FaceRecognizer.h
+
+#ifndef FACE_RECOGNIZER_H
+#define FACE_RECOGNIZER_H
+
+#include <Arduino.h>
+#include <vector>
+#include "esp_camera.h"
+#include "EmbeddingStore.h"
+#include "FaceTracker.h"
+
+// Build with -D ICU_FACE_RECOGNITION=1 to recognise enrolled people. It
+// links in the ESP-DL recognition model (about 1 MB of flash). Without it
+// detections still carry a track ID, with the identity always -1.
+#ifndef ICU_FACE_RECOGNITION
+#define ICU_FACE_RECOGNITION 0
+#endif
+
+#if ICU_FACE_RECOGNITION
+
+#include "face_recognition_112_v1_s8.hpp"
+
+// Turns a detected face into an identity with the ESP-DL recognition model.
+//
+// Enrolled people are kept in NVS, packed to 8 bits, and expanded at boot
+// into a float cache in PSRAM that EmbeddingStore matches against. The
+// model's own id store (and its flash partition) is not used.
+class FaceRecognizer {
+public:
+  FaceRecognizer();
+  bool begin();
+  bool isInitialized() const;
+
+  // Embeds the face with these MNP01 landmarks and matches it. Returns the
+  // person, or -1 for nobody enrolled; 'similarity' gets the best match.
+  int recognize(const camera_fb_t* fb, std::vector<int>& landmarks, float* similarity);
+  // Embeds the face and enrols it under 'name'. Returns the person, or -1.
+  int enroll(const camera_fb_t* fb, std::vector<int>& landmarks, const char* name);
+  void forgetAll();
+
+  const EmbeddingStore& store() const;
+  void list(Print& out);
+
+private:
+  const float* _embed(const camera_fb_t* fb, std::vector<int>& landmarks);
+  void _load();
+  bool _save(int person);
+
+  FaceRecognition112V1S8 _model;
+  EmbeddingStore _store;
+  float* _cache;
+  bool _isInitialized;
+};
+
+#endif // ICU_FACE_RECOGNITION
+
+#endif // FACE_RECOGNIZER_H
@@ -0,0 +1,59 @@
+// lib/FaceRecognizer/FaceTracker.cpp
+
+#include "FaceTracker.h"
+
+FaceTracker::FaceTracker(float minOverlap, uint32_t lostMs, uint32_t refreshMs) {
+  _minOverlap = minOverlap;
+  _lostMs = lostMs;
+  _refreshMs = refreshMs;
+  _nextId = 1;
+  _tracksStarted = 0;
+}
+
+float FaceTracker::_overlap(const FaceTrack& track, int x, int y, int w, int h) {
+  int left = x > track.x ? x : track.x;
+  int top = y > track.y ? y : track.y;
+  int right = x + w < track.x + track.w ? x + w : track.x + track.w;
+  int bottom = y + h < track.y + track.h ? y + h : track.y + track.h;
+  if (right <= left || bottom <= top) return 0.0f;
+  float intersection = (float)(right - left) * (bottom - top);
+  float total = (float)w * h + (float)track.w * track.h - intersection;
+  return total > 0 ? intersection / total : 0.0f;
+}
+
+const FaceTrack& FaceTracker::update(int x, int y, int w, int h, uint32_t nowMs) {
+  bool continues = _track.id != 0 && nowMs - _track.lastSeenMs < _lostMs &&
+                   _overlap(_track, x, y, w, h) >= _minOverlap;
+  if (!continues) {
+    _track = FaceTrack();
+    _track.id = _nextId++;
+    if (_nextId == 0) _nextId = 1; // 0 means no track
+    _tracksStarted++;
+  }
+  _track.x = x;
+  _track.y = y;
+  _track.w = w;
+  _track.h = h;
+  _track.lastSeenMs = nowMs;
+  return _track;
+}
+
+bool FaceTracker::needsRecognition(uint32_t nowMs) const {
+  if (_track.id == 0) return false;
+  return !_track.recognised || nowMs - _track.recognisedMs >= _refreshMs;
+}
+
+void FaceTracker::setIdentity(int16_t person, float similarity, uint32_t nowMs) {
+  _track.recognised = true;
+  _track.person = person;
+  _track.similarity = similarity;
+  _track.recognisedMs = nowMs;
+}
+
+const FaceTrack& FaceTracker::current() const {
+  return _track;
+}
+
+uint32_t FaceTracker::tracksStarted() const {
+  return _tracksStarted;
+}
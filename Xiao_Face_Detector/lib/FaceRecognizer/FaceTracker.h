@@ -0,0 +1,51 @@
+// lib/FaceRecognizer/FaceTracker.h
+
+#ifndef FACE_TRACKER_H
+#define FACE_TRACKER_H
+
+#include <stdint.h>
+
+// The face currently being followed, with whoever it was recognised as.
+struct FaceTrack {
+  uint16_t id = 0;           // 0 until the first face; then 1, 2, ... per new track
+  int x = 0, y = 0, w = 0, h = 0; // Last box, full-field coordinates
+  uint32_t lastSeenMs = 0;
+  bool recognised = false;   // An identity has been looked up for this track
+  int16_t person = -1;       // EmbeddingStore index, or -1 for nobody enrolled
+  float similarity = 0;
+  uint32_t recognisedMs = 0;
+};
+
+// Follows one face from frame to frame, like the rest of the pipeline, and
+// decides when it is worth running recognition on it.
+//
+// A box continues the current track if it overlaps the last one by at
+// least 'minOverlap' (intersection over union) and the track has not gone
+// unseen for 'lostMs'; anything else starts a new track. Recognition is
+// due once at the start of each track and then every 'refreshMs', so an
+// identity that was read from a bad angle gets corrected without paying
+// for recognition on every frame.
+class FaceTracker {
+public:
+  FaceTracker(float minOverlap, uint32_t lostMs, uint32_t refreshMs);
+
+  // Assigns a detected box to a track and returns it.
+  const FaceTrack& update(int x, int y, int w, int h, uint32_t nowMs);
+  bool needsRecognition(uint32_t nowMs) const;
+  void setIdentity(int16_t person, float similarity, uint32_t nowMs);
+
+  const FaceTrack& current() const;
+  uint32_t tracksStarted() const;
+
+private:
+  static float _overlap(const FaceTrack& track, int x, int y, int w, int h);
+
+  float _minOverlap;
+  uint32_t _lostMs;
+  uint32_t _refreshMs;
+  FaceTrack _track;
+  uint16_t _nextId;
+  uint32_t _tracksStarted;
+};
+
+#endif // FACE_TRACKER_H
@@ -0,0 +1,68 @@
+// lib/FaceRecognizer/RecognitionBench.cpp
+
+#include "RecognitionBench.h"
+
+const char* policyNames[] = {"off", "tracked", "every"};
+
+RecognitionBench::RecognitionBench() {
+  _isRunning = false;
+  _phase = 0;
+  _frames = 0;
+  _phaseStart = 0;
+}
+
+void RecognitionBench::start() {
+  _isRunning = true;
+  _phase = 0;
+  _frames = 0;
+  _phaseStart = millis();
+  for (int i = 0; i < (int)RecognitionPolicy::COUNT; i++) {
+    _fps[i] = 0;
+    _recognitions[i] = 0;
+  }
+  _recognitionUs.reset();
+}
+
+bool RecognitionBench::isRunning() const {
+  return _isRunning;
+}
+
+RecognitionPolicy RecognitionBench::policy() const {
+  return _isRunning ? (RecognitionPolicy)_phase : RecognitionPolicy::TRACKED;
+}
+
+void RecognitionBench::frameDone(uint32_t recognitionUs, Print& out) {
+  if (!_isRunning) return;
+  if (recognitionUs > 0) {
+    _recognitions[_phase]++;
+    _recognitionUs.record(recognitionUs);
+  }
+  if (++_frames < FRAMES_PER_PHASE) return;
+
+  unsigned long elapsed = millis() - _phaseStart;
+  _fps[_phase] = elapsed > 0 ? (_frames * 1000.0f) / elapsed : 0.0f;
+  out.printf("RECOG phase=%s frames=%lu fps=%.2f recognitions=%lu\n", policyNames[_phase],
+             (unsigned long)_frames, _fps[_phase], (unsigned long)_recognitions[_phase]);
+
+  _frames = 0;
+  _phaseStart = millis();
+  if (++_phase == (int)RecognitionPolicy::COUNT) {
+    _isRunning = false;
+    _report(out);
+  }
+}
+
+void RecognitionBench::_report(Print& out) {
+  float baseline = _fps[(int)RecognitionPolicy::OFF];
+  for (int i = (int)RecognitionPolicy::TRACKED; i < (int)RecognitionPolicy::COUNT; i++) {
+    float impact = baseline > 0 ? (baseline - _fps[i]) * 100.0f / baseline : 0.0f;
+    out.printf("RECOG policy=%s fps_impact_pct=%.1f\n", policyNames[i], impact);
+  }
+  if (_recognitionUs.count() == 0) {
+    out.println("RECOG per_track_us none (no face seen, or nobody enrolled)");
+    return;
+  }
+  out.printf("RECOG per_track_us p50=%lu p99=%lu max=%lu n=%lu\n",
+             (unsigned long)_recognitionUs.percentile(50), (unsigned long)_recognitionUs.percentile(99),
+             (unsigned long)_recognitionUs.max(), (unsigned long)_recognitionUs.count());
+}
@@ -0,0 +1,49 @@
+// lib/FaceRecognizer/RecognitionBench.h
+
+#ifndef RECOGNITION_BENCH_H
+#define RECOGNITION_BENCH_H
+
+#include <Arduino.h>
+#include "Log2Histogram.h"
+
+// When recognition runs on a frame with a face in it.
+enum class RecognitionPolicy : uint8_t {
+  OFF,         // Never: detection only
+  TRACKED,     // Once per new track, then at the tracker's refresh rate
+  EVERY_FRAME, // Every face, every frame
+  COUNT
+};
+
+// Measures what recognition costs, started with the 'b' command.
+//
+// Runs the detection loop for FRAMES_PER_PHASE inferred frames under each
+// policy in turn, with a face in view, then prints one RECOG key=value line
+// per result: the frame rate under each policy, how much of the
+// detection-only rate each one gives up, and the cost of one recognition,
+// which is what every new track pays.
+class RecognitionBench {
+public:
+  static const uint32_t FRAMES_PER_PHASE = 60;
+
+  RecognitionBench();
+  void start();
+  bool isRunning() const;
+  // The policy to use this frame: TRACKED when no benchmark is running.
+  RecognitionPolicy policy() const;
+
+  // Called after each inferred frame with the time spent recognising in it (0 for none).
+  void frameDone(uint32_t recognitionUs, Print& out);
+
+private:
+  void _report(Print& out);
+
+  bool _isRunning;
+  int _phase;
+  uint32_t _frames;
+  unsigned long _phaseStart;
+  float _fps[(int)RecognitionPolicy::COUNT];
+  uint32_t _recognitions[(int)RecognitionPolicy::COUNT];
+  Log2Histogram _recognitionUs;
+};
+
+#endif // RECOGNITION_BENCH_H
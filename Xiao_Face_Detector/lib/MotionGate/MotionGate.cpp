@@ -0,0 +1,162 @@
+// lib/MotionGate/MotionGate.cpp
+
+#include "MotionGate.h"
+#include <string.h>
+#include "DeferredLog.h"
+
+const int CELL_THRESHOLD = 14;          // Luma change (0-255) that counts a cell as changed; above sensor noise
+const int MIN_MOTION_CELLS = 4;         // Never call fewer changed cells than this motion...
+const int MOTION_CELL_PERCENT = 1;      // ...or less than this share of the grid
+const unsigned long MOTION_HOLD = 3000;           // ms of full rate after the last motion
+const unsigned long FACE_HOLD = 5000;             // ms of full rate after the last face
+const unsigned long IDLE_INFER_INTERVAL = 1000;   // ms between inferences while nothing moves
+const unsigned long REFERENCE_SETTLE = 2000;      // ms a changed scene must hold still to become the reference
+
+// Approximate BT.601 luma of one big-endian RGB565 pixel, in integers only.
+static inline uint32_t luma(const uint8_t* pixel) {
+  uint32_t r = pixel[0] & 0xF8;
+  uint32_t g = ((pixel[0] & 0x07) << 5) | ((pixel[1] & 0xE0) >> 3);
+  uint32_t b = (pixel[1] & 0x1F) << 3;
+  return (77 * r + 150 * g + 29 * b) >> 8;
+}
+
+MotionGate::MotionGate() {
+  _current = 0;
+  _gridWidth = 0;
+  _gridHeight = 0;
+  _haveReference = false;
+  _lastChange = 0;
+  _idle = false;
+  _lastMotion = 0;
+  _lastFace = 0;
+  _lastInference = 0;
+  _lastStillCaptureUs = 0;
+  _skipped = 0;
+  _inferred = 0;
+  _motionEvents = 0;
+  _referenceUpdates = 0;
+}
+
+bool MotionGate::shouldInfer(const uint8_t* rgb565, int width, int height, uint32_t captureUs) {
+  unsigned long start = micros();
+  unsigned long now = millis();
+
+  int next = 1 - _current;
+  int cells = _downsample(rgb565, width, height, _grids[next]);
+  int needed = max(MIN_MOTION_CELLS, cells * MOTION_CELL_PERCENT / 100);
+  // The first frame (or the first after a frame size change) has nothing to
+  // compare with, and becomes the reference.
+  bool motion = true;
+  if (_haveReference) {
+    motion = _changedCells(_grids[next], _reference, cells) >= needed;
+    if (_changedCells(_grids[next], _grids[_current], cells) >= needed) {
+      _lastChange = now;
+    } else if (motion && now - _lastChange >= REFERENCE_SETTLE) {
+      memcpy(_reference, _grids[next], cells);
+      _referenceUpdates++;
+    }
+  } else {
+    memcpy(_reference, _grids[next], cells);
+    _lastChange = now;
+  }
+  _current = next;
+  _haveReference = true;
+
+  if (motion) {
+    _lastMotion = now;
+  } else {
+    _lastStillCaptureUs = captureUs;
+  }
+
+  bool infer;
+  if (now - _lastMotion < MOTION_HOLD || now - _lastFace < FACE_HOLD) {
+    if (_idle && motion) {
+      // Motion began somewhere after the last still frame was captured.
+      _reactionUs.record(micros() - _lastStillCaptureUs);
+      _motionEvents++;
+      deferredLog.log(LOG_XIAO_GATE_ACTIVE, (unsigned)_skipped);
+    }
+    _idle = false;
+    infer = true;
+  } else {
+    if (!_idle) deferredLog.log(LOG_XIAO_GATE_IDLE);
+    _idle = true;
+    infer = now - _lastInference >= IDLE_INFER_INTERVAL;
+  }
+
+  if (infer) {
+    _inferred++;
+    _lastInference = now;
+  } else {
+    _skipped++;
+  }
+  _gateUs.record(micros() - start);
+  return infer;
+}
+
+void MotionGate::faceResult(bool found) {
+  if (found) _lastFace = millis();
+}
+
+bool MotionGate::isIdle() const {
+  return _idle;
+}
+
+// Averages four pixels from each cell into one luma byte. Returns the number of cells.
+int MotionGate::_downsample(const uint8_t* rgb565, int width, int height, uint8_t* grid) {
+  int cellSize = CELL;
+  while ((width / cellSize) * (height / cellSize) > MAX_CELLS) cellSize *= 2;
+  int gridWidth = width / cellSize;
+  int gridHeight = height / cellSize;
+  if (gridWidth != _gridWidth || gridHeight != _gridHeight) {
+    _gridWidth = gridWidth;
+    _gridHeight = gridHeight;
+    _haveReference = false;
+  }
+
+  int near = cellSize / 4;
+  int far = cellSize - 1 - near;
+  size_t stride = (size_t)width * 2;
+  uint8_t* out = grid;
+  for (int gy = 0; gy < gridHeight; gy++) {
+    const uint8_t* top = rgb565 + (size_t)(gy * cellSize + near) * stride;
+    const uint8_t* bottom = rgb565 + (size_t)(gy * cellSize + far) * stride;
+    for (int gx = 0; gx < gridWidth; gx++) {
+      int left = (gx * cellSize + near) * 2;
+      int right = (gx * cellSize + far) * 2;
+      *out++ = (luma(top + left) + luma(top + right) + luma(bottom + left) + luma(bottom + right)) >> 2;
+    }
+  }
+  return gridWidth * gridHeight;
+}
+
+int MotionGate::_changedCells(const uint8_t* grid, const uint8_t* against, int cells) const {
+  int changed = 0;
+  for (int i = 0; i < cells; i++) {
+    int delta = (int)grid[i] - (int)against[i];
+    if (delta > CELL_THRESHOLD || delta < -CELL_THRESHOLD) changed++;
+  }
+  return changed;
+}
+
+void MotionGate::writeReport(JsonObject data) {
+  data["run"] = _inferred;
+  data["skip"] = _skipped;
+  data["motion"] = _motionEvents;
+  data["ref"] = _referenceUpdates; // Changed scenes taken as the new reference
+  data["idle"] = _idle;
+  data["us"] = _gateUs.percentile(99);
+
+  // Reaction to motion: [p50, p99, max] in microseconds
+  JsonArray react = data["react"].to<JsonArray>();
+  react.add(_reactionUs.percentile(50));
+  react.add(_reactionUs.percentile(99));
+  react.add(_reactionUs.max());
+
+  _skipped = 0;
+  _inferred = 0;
+  _motionEvents = 0;
+  _referenceUpdates = 0;
+  _gateUs.reset();
+  _reactionUs.reset();
+}
@@ -0,0 +1,65 @@
+// lib/MotionGate/MotionGate.h
+
+#ifndef MOTION_GATE_H
+#define MOTION_GATE_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "Log2Histogram.h"
+
+// Decides whether a frame is worth running the face cascade on.
+//
+// Each frame is reduced to a coarse grid of luma values (one per 8x8 block,
+// from four sampled pixels) and compared with a reference grid of the still
+// scene, so someone approaching too slowly to show between two frames still
+// adds up to motion. The reference is only replaced once a change has held
+// still from frame to frame for REFERENCE_SETTLE: a moved chair stops
+// counting as motion, something still creeping closer never does for long.
+// While the grid matches it, inference only runs once every
+// IDLE_INFER_INTERVAL so a motionless face is still found eventually. Motion,
+// or a face found in the last few seconds, brings back full rate.
+class MotionGate {
+public:
+  MotionGate();
+
+  // 'rgb565' is a camera frame buffer (big-endian RGB565, as the OV sensors
+  // deliver it). 'captureUs' is the frame's capture time on the micros() clock.
+  bool shouldInfer(const uint8_t* rgb565, int width, int height, uint32_t captureUs);
+  // Tell the gate whether the last inferred frame contained a face.
+  void faceResult(bool found);
+
+  bool isIdle() const; // True while inference is being throttled
+
+  // Writes skip counts and motion reaction times into 'data' and starts a new window.
+  void writeReport(JsonObject data);
+
+private:
+  static const int CELL = 8;           // Pixels per grid cell side, doubled for big frames
+  static const int MAX_CELLS = 80 * 60; // A 640x480 frame at 8x8 cells
+
+  int _downsample(const uint8_t* rgb565, int width, int height, uint8_t* grid);
+  int _changedCells(const uint8_t* grid, const uint8_t* against, int cells) const;
+
+  uint8_t _grids[2][MAX_CELLS];
+  int _current;          // Index of the grid holding the newest frame
+  uint8_t _reference[MAX_CELLS]; // The still scene motion is measured against
+  int _gridWidth;
+  int _gridHeight;
+  bool _haveReference;
+  unsigned long _lastChange; // millis() of the last change from one frame to the next
+
+  bool _idle;
+  unsigned long _lastMotion;    // millis()
+  unsigned long _lastFace;      // millis()
+  unsigned long _lastInference; // millis()
+  uint32_t _lastStillCaptureUs; // Capture time of the last frame without motion
+
+  uint32_t _skipped;
+  uint32_t _inferred;
+  uint32_t _motionEvents;
+  uint32_t _referenceUpdates;
+  Log2Histogram _gateUs;     // Time spent in shouldInfer()
+  Log2Histogram _reactionUs; // Last still frame to inference on the first moving one
+};
+
+#endif // MOTION_GATE_H
@@ -0,0 +1,66 @@
+// lib/PipelineProfiler/PipelineProfiler.cpp
+
+#include "PipelineProfiler.h"
+
+// Short keys keep the heartbeat line small on the 115200 baud link.
+const char *stageKeys[] = {"cap", "msr", "mnp", "rec", "ser", "uart"};
+
+PipelineProfiler::PipelineProfiler() {
+  _reset();
+}
+
+void PipelineProfiler::recordStage(PipelineStage stage, unsigned long stageStartUs) {
+  _stages[(int)stage].record(micros() - stageStartUs);
+}
+
+void PipelineProfiler::frameDone(bool faceFound) {
+  _frames++;
+  if (faceFound) _hits++;
+}
+
+void PipelineProfiler::writeReport(JsonObject data) {
+  unsigned long windowMs = millis() - _windowStart;
+  float fps = windowMs > 0 ? (_frames * 1000.0f) / windowMs : 0.0f;
+
+  data["fps"] = roundf(fps * 10.0f) / 10.0f;
+  data["frames"] = _frames;
+  data["hit"] = _frames ? roundf(_hits * 100.0f / _frames) / 100.0f : 0.0f;
+  data["heap"] = ESP.getFreeHeap();
+  data["minHeap"] = ESP.getMinFreeHeap();
+  data["psram"] = ESP.getFreePsram();
+
+  // Per-stage [p50, p99, max] in microseconds
+  JsonObject stages = data["us"].to<JsonObject>();
+  for (int i = 0; i < (int)PipelineStage::COUNT; i++) {
+    JsonArray stats = stages[stageKeys[i]].to<JsonArray>();
+    stats.add(_stages[i].percentile(50));
+    stats.add(_stages[i].percentile(99));
+    stats.add(_stages[i].max());
+  }
+
+  // Whichever part of the pipeline took the most total time is what limits the frame rate.
+  uint64_t cameraUs = _stages[(int)PipelineStage::CAPTURE].sum();
+  uint64_t computeUs = _stages[(int)PipelineStage::DETECT_MSR01].sum() + _stages[(int)PipelineStage::DETECT_MNP01].sum() +
+                       _stages[(int)PipelineStage::RECOGNIZE].sum();
+  uint64_t linkUs = _stages[(int)PipelineStage::SERIALIZE].sum() + _stages[(int)PipelineStage::UART_WRITE].sum();
+  if (_frames == 0) {
+    data["bound"] = "idle";
+  } else if (computeUs >= cameraUs && computeUs >= linkUs) {
+    data["bound"] = "compute";
+  } else if (cameraUs >= linkUs) {
+    data["bound"] = "camera";
+  } else {
+    data["bound"] = "link";
+  }
+
+  _reset();
+}
+
+void PipelineProfiler::_reset() {
+  for (int i = 0; i < (int)PipelineStage::COUNT; i++) {
+    _stages[i].reset();
+  }
+  _frames = 0;
+  _hits = 0;
+  _windowStart = millis();
+}
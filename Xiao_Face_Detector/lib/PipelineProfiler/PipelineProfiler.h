@@ -0,0 +1,45 @@
+// lib/PipelineProfiler/PipelineProfiler.h
+
+#ifndef PIPELINE_PROFILER_H
+#define PIPELINE_PROFILER_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "Log2Histogram.h"
+
+// The stages of one pass through the detection loop, in order.
+enum class PipelineStage : uint8_t {
+  CAPTURE,      // esp_camera_fb_get()
+  DETECT_MSR01, // First-stage candidate inference
+  DETECT_MNP01, // Second-stage refinement inference
+  RECOGNIZE,    // Face embedding and identity match (new tracks only)
+  SERIALIZE,    // Building the JSON message
+  UART_WRITE,   // Pushing it out to the ProS3
+  COUNT
+};
+
+// Times every stage of every frame and summarises them for the heartbeat.
+// Statistics cover the window since the last report, so each heartbeat
+// describes the last HEARTBEAT_INTERVAL of running.
+class PipelineProfiler {
+public:
+  PipelineProfiler();
+
+  // Records the time since 'stageStartUs' (a micros() value) against a stage.
+  void recordStage(PipelineStage stage, unsigned long stageStartUs);
+  // Marks the end of one frame and whether a face was found in it.
+  void frameDone(bool faceFound);
+
+  // Writes the health and performance report into 'data' and starts a new window.
+  void writeReport(JsonObject data);
+
+private:
+  void _reset();
+
+  Log2Histogram _stages[(int)PipelineStage::COUNT];
+  uint32_t _frames;
+  uint32_t _hits;
+  unsigned long _windowStart;
+};
+
+#endif // PIPELINE_PROFILER_H
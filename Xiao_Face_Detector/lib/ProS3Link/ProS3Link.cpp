@@ -0,0 +1,163 @@
+// lib/ProS3Link/ProS3Link.cpp
+
+#include "ProS3Link.h"
+
+// Rates we are willing to switch to. Anything else is refused by acking the current rate.
+const unsigned long SUPPORTED_BAUD_RATES[] = {115200, 230400, 460800, 921600, 1000000, 2000000};
+// Room for a heartbeat or a thumbnail line, so sending one never waits for the wire
+const int TX_BUFFER_SIZE = 1024;
+
+ProS3Link::ProS3Link(HardwareSerial& serial) : _serial(serial), _doc(&_arena) {
+  _length = 0;
+  _overflowed = false;
+  _baud = LINK_DEFAULT_BAUD;
+  _powerMode = LINK_POWER_ACTIVE;
+  for (int i = 0; i < LINK_SETTING_COUNT; i++) {
+    _settings[i] = LINK_SETTINGS[i].defaultValue;
+  }
+  _settingsVersion = 0;
+  _configSeq = 0;
+  _pauseStart = 0;
+  _lastRxUs = 0;
+}
+
+void ProS3Link::begin(int rxPin, int txPin) {
+  _baud = LINK_DEFAULT_BAUD;
+  _serial.setTxBufferSize(TX_BUFFER_SIZE);
+  _serial.begin(_baud, SERIAL_8N1, rxPin, txPin);
+  // The loop only polls between frames, far too late to timestamp a ping.
+  // The driver's receive callback fires as soon as a short line goes quiet.
+  _serial.onReceive([this]() { _lastRxUs = micros(); });
+}
+
+unsigned long ProS3Link::baudRate() const {
+  return _baud;
+}
+
+LinkPowerMode ProS3Link::powerMode() const {
+  return _powerMode;
+}
+
+float ProS3Link::setting(LinkSetting setting) const {
+  return _settings[setting];
+}
+
+uint32_t ProS3Link::settingsVersion() const {
+  return _settingsVersion;
+}
+
+uint32_t ProS3Link::configSeq() const {
+  return _configSeq;
+}
+
+bool ProS3Link::isInferencePaused() const {
+  return millis() - _pauseStart < (unsigned long)_settings[LINK_SET_PAUSE_MS];
+}
+
+void ProS3Link::poll() {
+  while (_serial.available()) {
+    char c = _serial.read();
+    if (c == '\n') {
+      _line[_length] = '\0';
+      if (!_overflowed) {
+        _handleLine();
+      } else if (_baud != LINK_DEFAULT_BAUD) {
+        // A long run without newlines at the fast rate is the ProS3 talking at
+        // the default rate (it restarted), so go back and wait to be asked again.
+        _switchBaud(LINK_DEFAULT_BAUD);
+      }
+      _length = 0;
+      _overflowed = false;
+    } else if (c != '\r') {
+      if (_length < sizeof(_line) - 1) {
+        _line[_length++] = c;
+      } else {
+        _overflowed = true;
+      }
+    }
+  }
+}
+
+void ProS3Link::_handleLine() {
+  if (_length == 0) return;
+
+  DeserializationError error = deserializeJson(_doc, _line);
+  if (error) {
+    if (_baud != LINK_DEFAULT_BAUD) {
+      _switchBaud(LINK_DEFAULT_BAUD);
+    }
+    return;
+  }
+
+  const char* action = _doc["action"] | "";
+  if (strcmp(action, "baud") == 0) {
+    _handleBaudRequest(strtoul(_doc["data"] | "0", nullptr, 10));
+  } else if (strcmp(action, "ping") == 0) {
+    _handlePing(_doc["data"] | "0");
+  } else if (strcmp(action, "power") == 0) {
+    _powerMode = linkPowerModeFromName(_doc["data"] | "");
+  } else if (strcmp(action, "set") == 0) {
+    _handleSet(_doc["data"] | "");
+  }
+}
+
+void ProS3Link::_handleBaudRequest(unsigned long requested) {
+  unsigned long accepted = _baud;
+  for (unsigned long rate : SUPPORTED_BAUD_RATES) {
+    if (rate == requested) accepted = requested;
+  }
+
+  // The ack goes out at the current rate; the ProS3 switches when it reads it.
+  char ack[48];
+  int length = snprintf(ack, sizeof(ack), "{\"action\":\"baud_ack\",\"data\":\"%lu\"}\n", accepted);
+  _serial.write((const uint8_t*)ack, length);
+
+  if (accepted != _baud) {
+    _switchBaud(accepted);
+  }
+}
+
+// The ProS3 pings one line at a time and waits for the answer, so the last
+// receive timestamp belongs to this ping.
+void ProS3Link::_handlePing(const char* seq) {
+  uint32_t receivedUs = _lastRxUs;
+  char pong[80];
+  int length = snprintf(pong, sizeof(pong), "{\"action\":\"pong\",\"data\":\"%.12s,%lu,%lu\"}\n",
+                        seq, (unsigned long)receivedUs, (unsigned long)micros());
+  _serial.write((const uint8_t*)pong, length);
+}
+
+// "seq,name,value". Every request is answered, even one that makes no sense,
+// so the ProS3 never waits on a request it will have to give up on.
+void ProS3Link::_handleSet(const char* data) {
+  unsigned long seq = 0;
+  char name[16] = "";
+  float value = 0;
+  const char* status = "unknown";
+  if (sscanf(data, "%lu,%15[^,],%f", &seq, name, &value) == 3) {
+    LinkSetting setting = linkSettingFromName(name);
+    if (setting == LINK_SETTING_COUNT) {
+      status = "unknown";
+    } else if (!(value >= LINK_SETTINGS[setting].min && value <= LINK_SETTINGS[setting].max)) {
+      status = "range";
+    } else {
+      status = "ok";
+      _settings[setting] = value;
+      _settingsVersion++;
+      if (setting == LINK_SET_PAUSE_MS) _pauseStart = millis();
+    }
+  }
+  _configSeq = seq;
+
+  char ack[48];
+  int length = snprintf(ack, sizeof(ack), "{\"action\":\"set_ack\",\"data\":\"%lu,%s\"}\n", seq, status);
+  _serial.write((const uint8_t*)ack, length);
+}
+
+void ProS3Link::_switchBaud(unsigned long baud) {
+  _serial.flush(); // Let the ack finish at the old rate
+  _serial.updateBaudRate(baud);
+  _baud = baud;
+  _length = 0;
+  _overflowed = false;
+}
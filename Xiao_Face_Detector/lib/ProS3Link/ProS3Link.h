@@ -0,0 +1,61 @@
+// lib/ProS3Link/ProS3Link.h
+
+#ifndef PROS3_LINK_H
+#define PROS3_LINK_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "LinkProtocol.h"
+#include "JsonArena.h"
+
+// The receive side of the UART link to the ProS3.
+//
+// poll() never blocks: it takes whatever bytes have arrived, collects them
+// into lines and handles each complete line. The ProS3 sends four requests:
+// a baud rate change, which is acknowledged at the current rate before
+// switching; clock sync pings, which are answered with a pong carrying
+// when the ping arrived and when the pong left, on our micros() clock;
+// power mode changes; and detector settings, which are checked and
+// acknowledged here. Both of the last two are only recorded for the loop
+// to apply.
+class ProS3Link {
+public:
+  explicit ProS3Link(HardwareSerial& serial);
+  void begin(int rxPin, int txPin);
+  void poll();
+
+  unsigned long baudRate() const;
+  LinkPowerMode powerMode() const; // The mode the ProS3 last asked for
+
+  // The detector settings, starting from LINK_SETTINGS' defaults
+  float setting(LinkSetting setting) const;
+  // Changes every time a setting is accepted, so the loop can tell when to reapply them.
+  uint32_t settingsVersion() const;
+  // The seq of the last "set" answered, for the heartbeat's "cfg"
+  uint32_t configSeq() const;
+  // True while a pause_ms request is running
+  bool isInferencePaused() const;
+
+private:
+  void _handleLine();
+  void _handleBaudRequest(unsigned long requested);
+  void _handlePing(const char* seq);
+  void _handleSet(const char* data);
+  void _switchBaud(unsigned long baud);
+
+  HardwareSerial& _serial;
+  char _line[LINK_MAX_LINE];
+  size_t _length;
+  bool _overflowed;
+  unsigned long _baud;
+  LinkPowerMode _powerMode;
+  float _settings[LINK_SETTING_COUNT];
+  uint32_t _settingsVersion;
+  uint32_t _configSeq;
+  unsigned long _pauseStart;
+  volatile uint32_t _lastRxUs; // micros() of the latest received bytes, set by the UART driver
+  StaticJsonArena<1024> _arena; // Requests are short; the document never touches the heap
+  JsonDocument _doc;
+};
+
+#endif // PROS3_LINK_H
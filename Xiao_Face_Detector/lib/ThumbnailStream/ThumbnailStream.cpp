@@ -0,0 +1,87 @@
+// lib/ThumbnailStream/ThumbnailStream.cpp
+
+#include "ThumbnailStream.h"
+
+// {"action":"thumb","data":""} and the line ending around every message
+const int MESSAGE_OVERHEAD = 30;
+
+ThumbnailStream::ThumbnailStream() {
+  _minIntervalMs = 0;
+  _lastSent = 0;
+  _windowX = _windowY = 0;
+  _windowSize = _fieldSize = 0; // The whole frame, until setWindow()
+  _boxX = _boxY = _boxW = _boxH = 0;
+  memset(_pixels, 0, sizeof(_pixels));
+  _data[0] = '\0';
+  _windowStart = 0;
+  _messages = 0;
+  _complete = 0;
+  _bytes = 0;
+}
+
+void ThumbnailStream::setRate(float hz) {
+  unsigned long interval = hz > 0 ? (unsigned long)(1000.0f / hz) : 0;
+  if (interval != 0 && _minIntervalMs == 0) {
+    _encoder.reset(); // The ProS3 has been showing something else
+  }
+  _minIntervalMs = interval;
+}
+
+bool ThumbnailStream::isDue(unsigned long nowMs) const {
+  return _minIntervalMs != 0 && nowMs - _lastSent >= _minIntervalMs;
+}
+
+void ThumbnailStream::setWindow(int x, int y, int size, int fieldSize) {
+  _windowX = x;
+  _windowY = y;
+  _windowSize = size;
+  _fieldSize = fieldSize;
+}
+
+void ThumbnailStream::setBox(int x, int y, int w, int h) {
+  if (w <= 0 || _fieldSize <= 0) {
+    _boxW = _boxH = 0;
+    return;
+  }
+  _boxX = x * THUMB_SIZE / _fieldSize;
+  _boxY = y * THUMB_SIZE / _fieldSize;
+  _boxW = max(1, w * THUMB_SIZE / _fieldSize);
+  _boxH = max(1, h * THUMB_SIZE / _fieldSize);
+}
+
+bool ThumbnailStream::update(const uint8_t* rgb565, int width, int height, unsigned long nowMs) {
+  if (_fieldSize > 0 && _windowSize < _fieldSize) {
+    thumbFromRgb565Window(rgb565, width, height, _windowX, _windowY, _windowSize, _fieldSize, _pixels);
+  } else {
+    thumbFromRgb565(rgb565, width, height, _pixels);
+  }
+  ThumbHeader header;
+  int length = _encoder.encode(_pixels, _encoded, sizeof(_encoded), header);
+  _lastSent = nowMs; // A still picture is looked at again at the same rate
+  if (length == 0 && !(header.flags & THUMB_KEY)) return false;
+
+  int written = snprintf(_data, sizeof(_data), "%u,%u,%u,%d,%d,%d,%d,", (unsigned)header.seq,
+                         (unsigned)header.flags, (unsigned)header.start, _boxX, _boxY, _boxW, _boxH);
+  thumbBase64Encode(_encoded, length, _data + written, sizeof(_data) - written);
+  _messages++;
+  if (header.flags & THUMB_COMPLETE) _complete++;
+  _bytes += strlen(_data) + MESSAGE_OVERHEAD;
+  return true;
+}
+
+const char* ThumbnailStream::data() const {
+  return _data;
+}
+
+void ThumbnailStream::writeReport(JsonObject data) {
+  unsigned long windowMs = millis() - _windowStart;
+  float seconds = windowMs > 0 ? windowMs / 1000.0f : 1.0f;
+  data["n"] = _messages;
+  data["fps"] = roundf(_complete / seconds * 10.0f) / 10.0f;
+  data["bps"] = (uint32_t)(_bytes / seconds);
+
+  _windowStart = millis();
+  _messages = 0;
+  _complete = 0;
+  _bytes = 0;
+}
@@ -0,0 +1,57 @@
+// lib/ThumbnailStream/ThumbnailStream.h
+
+#ifndef THUMBNAIL_STREAM_H
+#define THUMBNAIL_STREAM_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "ThumbCodec.h"
+
+// Sends the ProS3 a small grey picture of what the camera sees, with the
+// last face box, so the robot's own screen can show it (see the "thumb"
+// message in LinkProtocol.h).
+//
+// Only what changed since the last message is sent, a byte budget per
+// message keeps every line short, and the rate is capped by the ProS3's
+// thumb_hz setting, so the stream fits next to the detections.
+class ThumbnailStream {
+public:
+  ThumbnailStream();
+  // Messages per second; 0 stops the stream. Restarting it begins with a key.
+  void setRate(float hz);
+  bool isDue(unsigned long nowMs) const;
+
+  // The thumbnail always shows the whole fieldSize square field of view.
+  // While the camera only reads a window of it, say where that window is:
+  // only its part of the thumbnail is updated, and the rest stays as the
+  // camera last saw it, so nothing jumps when the capture mode changes.
+  void setWindow(int x, int y, int size, int fieldSize);
+  // The face box to draw, in field coordinates; w = 0 for none.
+  void setBox(int x, int y, int w, int h);
+
+  // Samples the frame (the current window) and builds the next message.
+  // Returns false if there is nothing to send: the picture has not changed.
+  bool update(const uint8_t* rgb565, int width, int height, unsigned long nowMs);
+  const char* data() const; // The "thumb" message's data
+
+  // Writes messages, whole thumbnails per second and bytes per second into
+  // 'data' and starts a new window.
+  void writeReport(JsonObject data);
+
+private:
+  ThumbEncoder _encoder;
+  unsigned long _minIntervalMs; // 0 while stopped
+  unsigned long _lastSent;
+  int _windowX, _windowY, _windowSize, _fieldSize; // Field coordinates
+  int _boxX, _boxY, _boxW, _boxH; // Thumbnail pixels
+  uint8_t _pixels[THUMB_PIXELS];
+  uint8_t _encoded[THUMB_MAX_BYTES];
+  char _data[64 + THUMB_MAX_BYTES * 4 / 3];
+
+  unsigned long _windowStart;
+  uint32_t _messages;
+  uint32_t _complete;
+  uint32_t _bytes;
+};
+
+#endif // THUMBNAIL_STREAM_H
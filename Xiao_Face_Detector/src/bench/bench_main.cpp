@@ -0,0 +1,167 @@
+// src/bench/bench_main.cpp - Benchmark firmware for the XIAO
+//
+// Built instead of src/main.cpp by the seeed_xiao_esp32s3_bench environment.
+// Measures memcpy bandwidth and the camera's capture rate at each frame
+// size, prints one "BENCH {...}" line (see Common/MicroBench), and then
+// answers the ProS3 bench firmware's UART round-trip and throughput tests:
+//   "baud <rate>"  answered at the old rate, then the link moves to <rate>
+//   anything else  echoed back as it came
+//
+// Send any character over USB serial to measure again.
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "esp_camera.h"
+#include "HardwareSerial.h"
+#include "LinkProtocol.h"
+#include "MicroBench.h"
+
+// Same pins as src/main.cpp
+#define PWDN_GPIO_NUM     -1
+#define RESET_GPIO_NUM    -1
+#define XCLK_GPIO_NUM     10
+#define SIOD_GPIO_NUM     40
+#define SIOC_GPIO_NUM     39
+#define Y9_GPIO_NUM       48
+#define Y8_GPIO_NUM       11
+#define Y7_GPIO_NUM       12
+#define Y6_GPIO_NUM       14
+#define Y5_GPIO_NUM       16
+#define Y4_GPIO_NUM       18
+#define Y3_GPIO_NUM       17
+#define Y2_GPIO_NUM       15
+#define VSYNC_GPIO_NUM    38
+#define HREF_GPIO_NUM     47
+#define PCLK_GPIO_NUM     13
+#define UART_TX_PIN 43
+#define UART_RX_PIN 44
+
+const int CAMERA_WARMUP_FRAMES = 2; // Still at the old size, or still settling exposure
+const int CAMERA_FRAMES = 30;
+
+struct BenchFrameSize {
+  framesize_t size;
+  const char* name;
+};
+
+// Smallest first; the frame buffer is allocated for the largest at init.
+const BenchFrameSize FRAME_SIZES[] = {
+  {FRAMESIZE_96X96, "96x96"},
+  {FRAMESIZE_QQVGA, "160x120"},
+  {FRAMESIZE_128X128, "128x128"},
+  {FRAMESIZE_240X240, "240x240"},
+  {FRAMESIZE_QVGA, "320x240"},
+  {FRAMESIZE_CIF, "400x296"},
+  {FRAMESIZE_VGA, "640x480"},
+};
+
+HardwareSerial& UartToProS3 = Serial1;
+char lineBuffer[LINK_MAX_LINE];
+int lineLength = 0;
+bool cameraReady = false;
+
+static bool initCamera() {
+  camera_config_t config;
+  config.ledc_channel = LEDC_CHANNEL_0;
+  config.ledc_timer = LEDC_TIMER_0;
+  config.pin_d0 = Y2_GPIO_NUM; config.pin_d1 = Y3_GPIO_NUM; config.pin_d2 = Y4_GPIO_NUM;
+  config.pin_d3 = Y5_GPIO_NUM; config.pin_d4 = Y6_GPIO_NUM; config.pin_d5 = Y7_GPIO_NUM;
+  config.pin_d6 = Y8_GPIO_NUM; config.pin_d7 = Y9_GPIO_NUM; config.pin_xclk = XCLK_GPIO_NUM;
+  config.pin_pclk = PCLK_GPIO_NUM; config.pin_vsync = VSYNC_GPIO_NUM; config.pin_href = HREF_GPIO_NUM;
+  config.pin_sccb_sda = SIOD_GPIO_NUM; config.pin_sccb_scl = SIOC_GPIO_NUM;
+  config.pin_pwdn = PWDN_GPIO_NUM; config.pin_reset = RESET_GPIO_NUM;
+  config.xclk_freq_hz = 20000000;
+  config.frame_size = FRAMESIZE_VGA;
+  config.pixel_format = PIXFORMAT_RGB565; // What the detector runs on
+  config.grab_mode = CAMERA_GRAB_WHEN_EMPTY;
+  config.fb_location = CAMERA_FB_IN_PSRAM;
+  config.jpeg_quality = 12;
+  config.fb_count = 1;
+  return esp_camera_init(&config) == ESP_OK;
+}
+
+static void benchCamera(JsonObject data) {
+  if (!cameraReady) cameraReady = initCamera();
+  if (!cameraReady) {
+    data["error"] = "camera init failed";
+    return;
+  }
+  sensor_t* sensor = esp_camera_sensor_get();
+  data["sensor_pid"] = sensor->id.PID;
+  data["xclk_hz"] = 20000000;
+  JsonArray runs = data["runs"].to<JsonArray>();
+  for (const BenchFrameSize& frameSize : FRAME_SIZES) {
+    JsonObject run = runs.add<JsonObject>();
+    run["size"] = frameSize.name;
+    if (sensor->set_framesize(sensor, frameSize.size) != 0) {
+      run["error"] = "not supported";
+      continue;
+    }
+    for (int i = 0; i < CAMERA_WARMUP_FRAMES; i++) {
+      camera_fb_t* fb = esp_camera_fb_get();
+      if (fb) esp_camera_fb_return(fb);
+    }
+    int frames = 0;
+    unsigned long start = micros();
+    for (int i = 0; i < CAMERA_FRAMES; i++) {
+      camera_fb_t* fb = esp_camera_fb_get();
+      if (!fb) continue;
+      frames++;
+      esp_camera_fb_return(fb);
+    }
+    unsigned long elapsed = micros() - start;
+    run["frames"] = frames;
+    run["fps"] = elapsed ? roundf(frames * 1e7f / elapsed) / 10.0f : 0;
+  }
+  sensor->set_framesize(sensor, FRAMESIZE_240X240);
+}
+
+void runBenchmarks() {
+  JsonDocument report;
+  writeBoardInfo(report["board"].to<JsonObject>(), "xiao");
+  Serial.println("Bench: memcpy...");
+  benchMemcpy(report["memcpy"].to<JsonObject>());
+  Serial.println("Bench: camera...");
+  benchCamera(report["camera"].to<JsonObject>());
+  printBenchReport(report, Serial);
+  Serial.println("Bench: answering the ProS3's UART tests.");
+}
+
+// The echo side of the ProS3 bench firmware's UART tests.
+static void handleLine() {
+  unsigned long rate = 0;
+  if (sscanf(lineBuffer, "baud %lu", &rate) == 1 && rate > 0) {
+    UartToProS3.println(lineBuffer);
+    UartToProS3.flush();
+    UartToProS3.updateBaudRate(rate);
+    return;
+  }
+  UartToProS3.println(lineBuffer);
+}
+
+void setup() {
+  Serial.begin(115200);
+  unsigned long startTime = millis();
+  while (!Serial && millis() - startTime < 4000);
+  Serial.println("--- XIAO benchmark firmware ---");
+  UartToProS3.setRxBufferSize(4096);
+  UartToProS3.begin(LINK_DEFAULT_BAUD, SERIAL_8N1, UART_RX_PIN, UART_TX_PIN);
+  runBenchmarks();
+}
+
+void loop() {
+  while (UartToProS3.available()) {
+    char c = UartToProS3.read();
+    if (c == '\n') {
+      lineBuffer[lineLength] = '\0';
+      handleLine();
+      lineLength = 0;
+    } else if (c != '\r' && lineLength < LINK_MAX_LINE - 1) {
+      lineBuffer[lineLength++] = c;
+    }
+  }
+  if (Serial.available()) {
+    while (Serial.available()) Serial.read();
+    runBenchmarks();
+  }
+}
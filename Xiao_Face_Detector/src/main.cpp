@@ -7,6 +7,19 @@
 #include "human_face_detect_mnp01.hpp"
 #include "HardwareSerial.h"
 #include <ArduinoJson.h> // The JSON library
+#include "CaptureController.h"
+#include "DeferredLog.h"
+#include "MotionGate.h"
+#include "PipelineProfiler.h"
+#include "ProS3Link.h"
+#include "CameraPower.h"
+#include "HeapGuard.h"
+#include "JsonArena.h"
+#include "FaceTracker.h"
+#include "FaceRecognizer.h"
+#include "RecognitionBench.h"
+#include "DetectionEmitter.h"
+#include "ThumbnailStream.h"
 
 // === PIN DEFINITIONS (Verified & Correct) ===
 #define PWDN_GPIO_NUM     -1
@@ -31,34 +44,250 @@
 #define UART_TX_PIN 43
 #define UART_RX_PIN 44
 HardwareSerial& UartToTinyS3 = Serial1;
+// Handles requests coming back from the ProS3 (baud rate, power mode, detector settings)
+ProS3Link proS3Link(UartToTinyS3);
 
 // --- Heartbeat Timer ---
-const long HEARTBEAT_INTERVAL = 30000; // 30 seconds
 unsigned long lastHeartbeatTime = 0;
 
-// Face detection models
-static HumanFaceDetectMSR01 s1(0.1F, 0.5F, 10, 0.2F);
-static HumanFaceDetectMNP01 s2(0.5F, 0.3F, 5);
+// Face detection models. ESP-DL fixes the thresholds at construction, so
+// they are rebuilt when the ProS3 changes one (see applyDetectorSettings()).
+static HumanFaceDetectMSR01 *s1 = nullptr;
+static HumanFaceDetectMNP01 *s2 = nullptr;
+// The ProS3Link::settingsVersion() the pipeline was last set up for
+uint32_t appliedSettingsVersion = 0;
+
+// Per-stage timing, reported in every heartbeat
+PipelineProfiler profiler;
+// Skips inference while the scene is still
+MotionGate motionGate;
+// Shrinks the frame (or windows the sensor) around a tracked face
+CaptureController capture;
+// Frame rate and sensor standby for the ProS3's power mode
+CameraPower cameraPower;
+// Gives each face a track ID and decides when to recognise it: a box that
+// overlaps the last by 30% is the same face, one unseen for a second is gone,
+// and a known face is looked at again every 5 seconds.
+FaceTracker faceTracker(0.3f, 1000, 5000);
+// Sends only the detections that tell the ProS3 something new
+DetectionEmitter emitter;
+// What the camera sees, for the ProS3's screen, while it asks for it
+ThumbnailStream thumbnails;
+// The cost of recognition, measured with the 'b' command
+RecognitionBench recognitionBench;
+#if ICU_FACE_RECOGNITION
+// Who each tracked face is
+FaceRecognizer faceRecognizer;
+// Set by the 'e' command: the name to enrol the next face under
+char pendingEnrollName[PackedFace::NAME_LENGTH] = "";
+#endif
+
+// The frame's capture time on the esp_timer clock, the same clock as micros().
+uint32_t frameCaptureUs(const camera_fb_t *fb) {
+  return (uint32_t)((uint64_t)fb->timestamp.tv_sec * 1000000ULL + fb->timestamp.tv_usec);
+}
+
+// Outgoing messages are built in documents that live in fixed arenas, so
+// sending never touches the heap.
+StaticJsonArena<512> messageArena;
+JsonDocument messageDoc(&messageArena);
+StaticJsonArena<6144> heartbeatArena;
+JsonDocument heartbeatDoc(&heartbeatArena);
 
 // Helper function to send a structured JSON message
 void sendJsonMessage(const char* action, const char* data) {
-  JsonDocument doc;
+  HEAP_SCOPE(HeapSubsystem::LINK);
+  unsigned long stageStart = micros();
+  JsonDocument& doc = messageDoc;
+  doc.clear();
   doc["action"] = action;
   doc["data"] = data;
-  
-  // Serialize the JSON object directly to the UART port
-  serializeJson(doc, UartToTinyS3);
+  char line[128];
+  size_t length = serializeJson(doc, line, sizeof(line));
+  profiler.recordStage(PipelineStage::SERIALIZE, stageStart);
+
   // serializeJson does not add a newline, so we must add it manually
+  stageStart = micros();
+  UartToTinyS3.write((const uint8_t *)line, length);
+  UartToTinyS3.println();
+  profiler.recordStage(PipelineStage::UART_WRITE, stageStart);
+}
+
+// Base64 needs no escaping, so the line is put together without a JSON
+// document (and without printf(), which allocates for long lines).
+void sendThumbnail() {
+  HEAP_SCOPE(HeapSubsystem::LINK);
+  UartToTinyS3.print("{\"action\":\"thumb\",\"data\":\"");
+  UartToTinyS3.print(thumbnails.data());
+  UartToTinyS3.println("\"}");
+}
+
+// Every frame is a candidate, inferred or not, so a still scene still shows.
+// Call once the frame's face box is set, so the two go out together.
+void updateThumbnail(const camera_fb_t *fb) {
+  if (thumbnails.isDue(millis()) && thumbnails.update(fb->buf, fb->width, fb->height, millis())) {
+    sendThumbnail();
+  }
+}
+
+// The heartbeat carries the profiler's health and performance report,
+// so the ProS3 can tell if we are compute-, camera- or link-bound.
+void sendHeartbeat() {
+  HEAP_SCOPE(HeapSubsystem::HEARTBEAT);
+  JsonDocument& doc = heartbeatDoc;
+  doc.clear();
+  doc["action"] = "alive";
+  JsonObject data = doc["data"].to<JsonObject>();
+  profiler.writeReport(data);
+  data["blk"] = HeapGuard::largestFreeBlock();
+  data["allocs"] = heapGuard.steadyAllocations();
+  data["cfg"] = proS3Link.configSeq();
+  motionGate.writeReport(data["gate"].to<JsonObject>());
+  capture.writeReport(data["cam"].to<JsonObject>());
+  emitter.writeReport(data["emit"].to<JsonObject>());
+  thumbnails.writeReport(data["thumb"].to<JsonObject>());
+  cameraPower.writeReport(data["pwr"].to<JsonObject>());
+  serializeJson(doc, UartToTinyS3);
   UartToTinyS3.println();
 }
 
+// --- Serial Debug Commands ---
+// Typed into the USB serial monitor.
+//   e<name> : enrol the next face seen under <name>
+//   f       : list the enrolled faces
+//   x       : forget every enrolled face
+//   b       : benchmark recognition (frame rate with it off, per track and every frame)
+void handleSerialCommands() {
+  HEAP_SCOPE(HeapSubsystem::COMMANDS);
+  static char command[PackedFace::NAME_LENGTH + 2];
+  static int length = 0;
+  while (Serial.available()) {
+    char c = Serial.read();
+    if (c != '\n' && c != '\r') {
+      if (length < (int)sizeof(command) - 1) command[length++] = c;
+      continue;
+    }
+    if (length == 0) continue;
+    command[length] = '\0';
+    length = 0;
+#if ICU_FACE_RECOGNITION
+    switch (command[0]) {
+      case 'e':
+        if (command[1] == '\0') {
+          Serial.println("Usage: e<name>");
+        } else {
+          strlcpy(pendingEnrollName, command + 1, sizeof(pendingEnrollName));
+          Serial.printf("FaceRecognizer: Enrolling the next face as '%s'.\n", pendingEnrollName);
+        }
+        break;
+      case 'f':
+        faceRecognizer.list(Serial);
+        break;
+      case 'x':
+        faceRecognizer.forgetAll();
+        Serial.println("FaceRecognizer: Forgot every enrolled face.");
+        break;
+      case 'b':
+        recognitionBench.start();
+        Serial.printf("RECOG Benchmark started: %lu frames per policy, keep a face in view.\n",
+                      (unsigned long)RecognitionBench::FRAMES_PER_PHASE);
+        break;
+    }
+#else
+    Serial.println("Face recognition is compiled out. Build with -D ICU_FACE_RECOGNITION=1.");
+#endif
+  }
+}
+
+// Builds the detection models from the current settings, keeping any whose
+// thresholds have not changed.
+void buildDetector() {
+  // Only on a settings change; the models are never rebuilt per frame
+  HEAP_SCOPE(HeapSubsystem::COMMANDS);
+  static float built[LINK_SETTING_COUNT];
+  bool msrChanged = !s1, mnpChanged = !s2;
+  for (int i = LINK_SET_MSR_SCORE; i <= LINK_SET_MNP_TOP_K; i++) {
+    if (built[i] == proS3Link.setting((LinkSetting)i)) continue;
+    built[i] = proS3Link.setting((LinkSetting)i);
+    if (i <= LINK_SET_MSR_RESIZE) msrChanged = true;
+    else mnpChanged = true;
+  }
+  if (msrChanged) {
+    delete s1;
+    s1 = new HumanFaceDetectMSR01(built[LINK_SET_MSR_SCORE], built[LINK_SET_MSR_NMS],
+                                  (int)built[LINK_SET_MSR_TOP_K], built[LINK_SET_MSR_RESIZE]);
+  }
+  if (mnpChanged) {
+    delete s2;
+    s2 = new HumanFaceDetectMNP01(built[LINK_SET_MNP_SCORE], built[LINK_SET_MNP_NMS],
+                                  (int)built[LINK_SET_MNP_TOP_K]);
+  }
+}
+
+// Puts the settings the ProS3 last sent into effect. A pause needs nothing
+// here, the loop asks ProS3Link about it every pass.
+void applyDetectorSettings() {
+  appliedSettingsVersion = proS3Link.settingsVersion();
+  buildDetector();
+  cameraPower.setMaxFps(proS3Link.setting(LINK_SET_MAX_FPS));
+  capture.setAdaptive(proS3Link.setting(LINK_SET_CAPTURE) == 0);
+  emitter.configure((int)proS3Link.setting(LINK_SET_EMIT_PX), (unsigned long)proS3Link.setting(LINK_SET_EMIT_KEEP),
+                    proS3Link.setting(LINK_SET_EMIT_HZ));
+  thumbnails.setRate(proS3Link.setting(LINK_SET_THUMB_HZ));
+}
+
+// Runs both detection stages on the frame. ESP-DL owns the returned list.
+std::list<dl::detect::result_t> &detectFaces(camera_fb_t *fb) {
+  // ESP-DL builds its result lists on the heap every frame, so this is the
+  // one scope HeapGuard counts without failing.
+  HEAP_SCOPE(HeapSubsystem::INFERENCE);
+  unsigned long stageStart = micros();
+  std::list<dl::detect::result_t> &candidates = s1->infer((uint16_t *)fb->buf, {(int)fb->height, (int)fb->width, 3});
+  profiler.recordStage(PipelineStage::DETECT_MSR01, stageStart);
+
+  stageStart = micros();
+  std::list<dl::detect::result_t> &results = s2->infer((uint16_t *)fb->buf, {(int)fb->height, (int)fb->width, 3}, candidates);
+  profiler.recordStage(PipelineStage::DETECT_MNP01, stageStart);
+  return results;
+}
+
+#if ICU_FACE_RECOGNITION
+// Enrols or recognises the tracked face when the policy says it is due.
+// The landmarks are in this frame's coordinates, which is what the model
+// aligns the face with. Returns the time spent, 0 if nothing ran.
+uint32_t recognizeFace(camera_fb_t *fb, std::vector<int> &landmarks) {
+  // The embedding tensor and the model's working buffers are allocated per call
+  HEAP_SCOPE(HeapSubsystem::INFERENCE);
+  unsigned long stageStart = micros();
+  if (pendingEnrollName[0]) {
+    int person = faceRecognizer.enroll(fb, landmarks, pendingEnrollName);
+    Serial.printf("FaceRecognizer: Enrolled '%s' as person %d.\n", pendingEnrollName, person);
+    pendingEnrollName[0] = '\0';
+    faceTracker.setIdentity(person, 1.0f, millis());
+    return micros() - stageStart;
+  }
+
+  RecognitionPolicy policy = recognitionBench.policy();
+  bool due = policy == RecognitionPolicy::EVERY_FRAME ||
+             (policy == RecognitionPolicy::TRACKED && faceTracker.needsRecognition(millis()));
+  if (!due || faceRecognizer.store().count() == 0) return 0;
+
+  float similarity;
+  int person = faceRecognizer.recognize(fb, landmarks, &similarity);
+  faceTracker.setIdentity(person, similarity, millis());
+  profiler.recordStage(PipelineStage::RECOGNIZE, stageStart);
+  return micros() - stageStart;
+}
+#endif
+
 void setup() {
   Serial.begin(115200);
   long startTime = millis();
   while (!Serial && millis() - startTime < 4000);
 
   Serial.println("--- XIAO JSON Sender ---");
-  UartToTinyS3.begin(115200, SERIAL_8N1, UART_RX_PIN, UART_TX_PIN);
+  heapGuard.begin();
+  proS3Link.begin(UART_RX_PIN, UART_TX_PIN);
   
   // --- Camera Initialization ---
   camera_config_t config;
@@ -84,44 +313,130 @@ void setup() {
     sendJsonMessage("error", "Camera init failed");
     return;
   }
+  capture.begin();
+  cameraPower.begin();
+  buildDetector();
+#if ICU_FACE_RECOGNITION
+  faceRecognizer.begin();
+#endif
   Serial.println("Camera Initialized. Starting detection loop.");
+  // Everything the loop needs is in place; from here on it should not allocate
+  heapGuard.setSteady(true);
 }
 
 void loop() {
+  // --- Requests from the ProS3 ---
+  {
+    HEAP_SCOPE(HeapSubsystem::LINK);
+    proS3Link.poll();
+  }
+  heapGuard.update();
+  handleSerialCommands();
+
+  // --- Power mode ---
+  // A change is confirmed with an early heartbeat, which carries the new mode.
+  bool powerChanged = proS3Link.powerMode() != cameraPower.requestedMode();
+  if (powerChanged) {
+    cameraPower.setMode(proS3Link.powerMode());
+  }
+
   // --- Heartbeat Logic ---
-  if (millis() - lastHeartbeatTime >= HEARTBEAT_INTERVAL) {
-    sendJsonMessage("alive", "XIAO is running");
-    Serial.println("Sent: Heartbeat");
+  if (powerChanged || millis() - lastHeartbeatTime >= LINK_HEARTBEAT_INTERVAL_MS) {
+    sendHeartbeat();
+    deferredLog.log(LOG_XIAO_HEARTBEAT_SENT);
     lastHeartbeatTime = millis(); // Reset the timer
   }
 
+  // --- Detector settings ---
+  if (proS3Link.settingsVersion() != appliedSettingsVersion) {
+    applyDetectorSettings();
+  }
+
+  if (proS3Link.isInferencePaused() || !cameraPower.frameDue(motionGate.isIdle())) {
+    deferredLog.drain(Serial);
+    delay(CameraPower::IDLE_POLL_MS);
+    return;
+  }
+
   // --- Face Detection Logic ---
+  HEAP_SCOPE(HeapSubsystem::CAMERA);
+  unsigned long stageStart = micros();
   camera_fb_t *fb = esp_camera_fb_get();
+  profiler.recordStage(PipelineStage::CAPTURE, stageStart);
   if (!fb) {
-    Serial.println("Camera frame capture failed");
+    deferredLog.log(LOG_XIAO_CAPTURE_FAILED);
     // Don't send an error every frame, that would be too much spam
+    deferredLog.drain(Serial);
+    return;
+  }
+
+  if (capture.discardFrame()) {
+    // Still in flight when the frame size or window changed
+    esp_camera_fb_return(fb);
+    deferredLog.drain(Serial);
     return;
   }
 
-  std::list<dl::detect::result_t> &candidates = s1.infer((uint16_t *)fb->buf, {(int)fb->height, (int)fb->width, 3});
-  std::list<dl::detect::result_t> &results = s2.infer((uint16_t *)fb->buf, {(int)fb->height, (int)fb->width, 3}, candidates);
+  // The window this frame was captured through, for the thumbnail and its box
+  int windowX, windowY, windowSize;
+  capture.window(windowX, windowY, windowSize);
+  thumbnails.setWindow(windowX, windowY, windowSize, FULL_FRAME_SIZE);
+
+  uint32_t captureUs = frameCaptureUs(fb);
+  if (!motionGate.shouldInfer(fb->buf, fb->width, fb->height, captureUs)) {
+    // Nothing moved and no face is being tracked: save the power and heat.
+    // The last box still stands, as nothing moved.
+    updateThumbnail(fb);
+    esp_camera_fb_return(fb);
+    deferredLog.drain(Serial);
+    return;
+  }
+
+  std::list<dl::detect::result_t> &results = detectFaces(fb);
 
-  if (results.size() > 0) {
+  bool found = results.size() > 0;
+  int x1 = 0, y1 = 0, w = 0, h = 0;
+  uint32_t recognitionUs = 0;
+  DetectionBox box;
+  if (found) {
     // For simplicity, we'll only send the first detected face per frame
     auto prediction = results.begin();
-    int x1 = (int)prediction->box[0]; int y1 = (int)prediction->box[1];
+    x1 = (int)prediction->box[0]; y1 = (int)prediction->box[1];
     int x2 = (int)prediction->box[2]; int y2 = (int)prediction->box[3];
-    int w = x2 - x1; int h = y2 - y1;
-
-    char bbox_data[20]; // Buffer to hold "x,y,w,h"
-    snprintf(bbox_data, sizeof(bbox_data), "%d,%d,%d,%d", x1, y1, w, h);
-    
-    sendJsonMessage("detection", bbox_data);
-    Serial.print("Sent Detection: ");
-    Serial.println(bbox_data);
+    w = x2 - x1; h = y2 - y1;
+    // The ProS3 always gets full-field 240x240 coordinates, whatever this frame was
+    capture.toFullFrame(x1, y1, w, h, fb->width, fb->height);
+    thumbnails.setBox(x1, y1, w, h);
+    const FaceTrack &track = faceTracker.update(x1, y1, w, h, millis());
+#if ICU_FACE_RECOGNITION
+    recognitionUs = recognizeFace(fb, prediction->keypoint);
+#endif
+
+    // The capture time lets the ProS3 measure how old the detection is by the time it moves the eye.
+    // The track ID stays the same while the face does; the person is -1 until it is recognised.
+    box.x = x1; box.y = y1; box.w = w; box.h = h;
+    box.captureUs = captureUs;
+    box.track = track.id;
+    box.person = track.person;
+  } else {
+    thumbnails.setBox(0, 0, 0, 0);
+  }
+  updateThumbnail(fb);
+
+  EmitKind emitted = emitter.update(found, box, millis());
+  if (emitted != EmitKind::NONE) {
+    sendJsonMessage(emitter.action(), emitter.data());
+    if (emitted != EmitKind::LOST) deferredLog.log(LOG_XIAO_DETECTION_SENT, x1, y1, w, h);
   }
 
   esp_camera_fb_return(fb);
+  profiler.frameDone(found);
+  recognitionBench.frameDone(recognitionUs, Serial);
+  motionGate.faceResult(found);
+  capture.update(found, x1, y1, w, h);
+
+  // Flush buffered log records to USB serial without blocking the next frame.
+  deferredLog.drain(Serial);
 }
 
 
@@ -0,0 +1,55 @@
+// tools/dlog_decode.cpp
+//
+// Host-side decoder for the DeferredLog binary records sent by both boards.
+// Plain text (anything printed with Serial.print) is passed through unchanged,
+// binary records are rendered with the shared format table.
+//
+// Build:  g++ -O2 -std=c++17 -I ../Common/DeferredLog -o dlog_decode dlog_decode.cpp
+// Use:    dlog_decode < capture.bin
+//         dlog_decode /dev/ttyACM0      (port already configured, e.g. with stty)
+
+#include <stdio.h>
+#include <string.h>
+#include "LogRecord.h"
+
+int main(int argc, char **argv) {
+  FILE *in = stdin;
+  if (argc > 1) {
+    in = fopen(argv[1], "rb");
+    if (!in) {
+      perror(argv[1]);
+      return 1;
+    }
+  }
+
+  unsigned long records = 0;
+  unsigned long unknown = 0;
+  int c;
+  while ((c = fgetc(in)) != EOF) {
+    if (c != LOG_SYNC_0) {
+      fputc(c, stdout);
+      continue;
+    }
+    int next = fgetc(in);
+    if (next != LOG_SYNC_1) {
+      // Not a record after all, pass both bytes through.
+      fputc(c, stdout);
+      if (next == EOF) break;
+      fputc(next, stdout);
+      continue;
+    }
+
+    LogRecord record;
+    if (fread(&record, sizeof(record), 1, in) != 1) break;
+    if (record.formatId >= LOG_FORMAT_COUNT) unknown++;
+
+    char text[256];
+    formatLogRecord(record, text, sizeof(text));
+    printf("[%10.6f] %s\n", record.timestampUs / 1e6, text);
+    records++;
+  }
+
+  fprintf(stderr, "dlog_decode: %lu records decoded, %lu with unknown format IDs\n", records, unknown);
+  if (in != stdin) fclose(in);
+  return 0;
+}
@@ -0,0 +1,143 @@
+// tools/gaze_table_test.cpp
+//
+// Checks ICU-S1-PrimeBuild/lib/GazeTable on the host. A made-up eye linkage,
+// a smooth curved surface from image position to servo pulses, is
+// "calibrated" at the 5x5 grid points, and the table generated from those is
+// compared with the surface it came from, reported as in host/HostCheck.h.
+//
+//   nodes      lookup() at every calibration point returns its pulses exactly
+//   surface    everywhere in between, lookup() stays within --tolerance
+//              pulses of the surface (the straight-line blend of the
+//              calibration points alone is printed for comparison)
+//   limits     image positions off the edges clamp to them, and no lookup
+//              leaves the range of pulses that were calibrated
+//
+// Build, from tools/:
+//   g++ -O2 -std=c++17 -I host -I ../ICU-S1-PrimeBuild/lib/GazeTable
+//       -o gaze_table_test gaze_table_test.cpp ../ICU-S1-PrimeBuild/lib/GazeTable/GazeTable.cpp
+//
+// Use:
+//   gaze_table_test                   the default linkage
+//   gaze_table_test --bend 20         a linkage that bends more
+//   gaze_table_test --tolerance 1     a tighter bound
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "GazeTable.h"
+#include "HostCheck.h"
+
+struct Options {
+  double bend = 8;        // Pulses the linkage's curve pulls the middle of the field off a straight line
+  // Pulses. They are whole numbers, rounded three times on the way (the
+  // calibration, the table nodes, the lookup), so half a pulse for each.
+  double tolerance = 1.5;
+};
+
+// The pulses that aim the made-up eye at an image position: the hand-tuned
+// limits from ServoController, joined by curves rather than straight lines,
+// with each axis leaning a little on the other.
+static void surface(const Options &options, double imageX, double imageY, double &pulseX, double &pulseY) {
+  double u = imageX / GAZE_IMAGE_SIZE, v = imageY / GAZE_IMAGE_SIZE;
+  pulseX = 420 - 70 * u + options.bend * sin(M_PI * u) + options.bend * 0.4 * (v - 0.5) * (v - 0.5);
+  pulseY = 383 - 68 * v + options.bend * sin(M_PI * v) * (0.8 + 0.4 * u);
+}
+
+// What joining the calibration points with straight lines would give
+static void bilinear(const GazePulse *points, double imageX, double imageY, double &pulseX, double &pulseY) {
+  double gx = imageX / GAZE_IMAGE_SIZE * (GAZE_CAL_GRID - 1), gy = imageY / GAZE_IMAGE_SIZE * (GAZE_CAL_GRID - 1);
+  int column = gx >= GAZE_CAL_GRID - 1 ? GAZE_CAL_GRID - 2 : (int)gx;
+  int row = gy >= GAZE_CAL_GRID - 1 ? GAZE_CAL_GRID - 2 : (int)gy;
+  double fx = gx - column, fy = gy - row;
+  const GazePulse &a = points[row * GAZE_CAL_GRID + column], &b = points[row * GAZE_CAL_GRID + column + 1];
+  const GazePulse &c = points[(row + 1) * GAZE_CAL_GRID + column], &d = points[(row + 1) * GAZE_CAL_GRID + column + 1];
+  pulseX = (a.x * (1 - fx) + b.x * fx) * (1 - fy) + (c.x * (1 - fx) + d.x * fx) * fy;
+  pulseY = (a.y * (1 - fx) + b.y * fx) * (1 - fy) + (c.y * (1 - fx) + d.y * fx) * fy;
+}
+
+int main(int argc, char **argv) {
+  Options options;
+  for (int i = 1; i < argc; i++) {
+    const char *arg = argv[i];
+    double value = i + 1 < argc ? atof(argv[i + 1]) : 0;
+    if (!strcmp(arg, "--bend")) options.bend = value, i++;
+    else if (!strcmp(arg, "--tolerance")) options.tolerance = value, i++;
+    else {
+      fprintf(stderr, "usage: %s [--bend PULSES] [--tolerance PULSES]\n", argv[0]);
+      return 2;
+    }
+  }
+
+  GazePulse points[GAZE_CAL_POINTS];
+  int lowX = 65535, highX = 0, lowY = 65535, highY = 0;
+  for (int row = 0; row < GAZE_CAL_GRID; row++) {
+    for (int column = 0; column < GAZE_CAL_GRID; column++) {
+      double x, y;
+      surface(options, GazeTable::calibrationCoordinate(column), GazeTable::calibrationCoordinate(row), x, y);
+      GazePulse &point = points[row * GAZE_CAL_GRID + column];
+      point = {(uint16_t)lround(x), (uint16_t)lround(y)};
+      if (point.x < lowX) lowX = point.x;
+      if (point.x > highX) highX = point.x;
+      if (point.y < lowY) lowY = point.y;
+      if (point.y > highY) highY = point.y;
+    }
+  }
+  GazeTable table;
+  table.generate(points);
+
+  // nodes
+  int exact = 0;
+  char detail[160];
+  for (int row = 0; row < GAZE_CAL_GRID; row++) {
+    for (int column = 0; column < GAZE_CAL_GRID; column++) {
+      GazePulse pulse = table.lookup(GazeTable::calibrationCoordinate(column), GazeTable::calibrationCoordinate(row));
+      const GazePulse &point = points[row * GAZE_CAL_GRID + column];
+      if (pulse.x == point.x && pulse.y == point.y) exact++;
+    }
+  }
+  snprintf(detail, sizeof(detail), "%d of %d calibration points exact", exact, GAZE_CAL_POINTS);
+  report("nodes", exact == GAZE_CAL_POINTS, detail);
+
+  // surface
+  double worst = 0, worstStraight = 0, sum = 0;
+  int worstX = 0, worstY = 0, samples = 0;
+  for (int y = 0; y <= GAZE_IMAGE_SIZE; y++) {
+    for (int x = 0; x <= GAZE_IMAGE_SIZE; x++) {
+      double refX, refY, lineX, lineY;
+      surface(options, x, y, refX, refY);
+      bilinear(points, x, y, lineX, lineY);
+      GazePulse pulse = table.lookup(x, y);
+      double error = fmax(fabs(pulse.x - refX), fabs(pulse.y - refY));
+      double straight = fmax(fabs(round(lineX) - refX), fabs(round(lineY) - refY));
+      if (error > worst) worst = error, worstX = x, worstY = y;
+      if (straight > worstStraight) worstStraight = straight;
+      sum += error;
+      samples++;
+    }
+  }
+  snprintf(detail, sizeof(detail), "worst %.2f pulses at (%d,%d), mean %.2f; straight lines worst %.2f", worst, worstX,
+           worstY, sum / samples, worstStraight);
+  report("surface", worst <= options.tolerance, detail);
+
+  // limits
+  bool clamped = true, inRange = true;
+  const int edges[][2] = {{-50, 120}, {300, 120}, {120, -50}, {120, 300}, {-10, -10}, {500, 500}};
+  for (const auto &edge : edges) {
+    int x = edge[0] < 0 ? 0 : edge[0] > GAZE_IMAGE_SIZE ? GAZE_IMAGE_SIZE : edge[0];
+    int y = edge[1] < 0 ? 0 : edge[1] > GAZE_IMAGE_SIZE ? GAZE_IMAGE_SIZE : edge[1];
+    GazePulse outside = table.lookup(edge[0], edge[1]), inside = table.lookup(x, y);
+    if (outside.x != inside.x || outside.y != inside.y) clamped = false;
+  }
+  for (int y = -20; y <= GAZE_IMAGE_SIZE + 20; y += 2) {
+    for (int x = -20; x <= GAZE_IMAGE_SIZE + 20; x += 2) {
+      GazePulse pulse = table.lookup(x, y);
+      if (pulse.x < lowX || pulse.x > highX || pulse.y < lowY || pulse.y > highY) inRange = false;
+    }
+  }
+  snprintf(detail, sizeof(detail), "off-image positions %s, pulses %s the calibrated %d-%d x %d-%d",
+           clamped ? "clamp to the edge" : "do not clamp", inRange ? "within" : "outside", lowX, highX, lowY, highY);
+  report("limits", clamped && inRange, detail);
+
+  return checkStatus();
+}
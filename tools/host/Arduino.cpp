@@ -0,0 +1,26 @@
+// tools/host/Arduino.cpp
+
+#include "Arduino.h"
+
+HardwareSerial Serial;
+HardwareSerial Serial1;
+EspClass ESP;
+
+static uint64_t hostMicros = 0;
+
+void hostSetMicros(uint64_t us) { hostMicros = us; }
+void hostAdvanceMicros(uint64_t us) { hostMicros += us; }
+unsigned long millis() { return (unsigned long)(hostMicros / 1000); }
+unsigned long micros() { return (unsigned long)hostMicros; }
+void delay(unsigned long ms) { hostMicros += (uint64_t)ms * 1000; }
+void delayMicroseconds(unsigned int us) { hostMicros += us; }
+
+long random(long howbig) { return howbig > 0 ? rand() % howbig : 0; }
+long random(long howsmall, long howbig) {
+  if (howsmall >= howbig) return howsmall;
+  return howsmall + random(howbig - howsmall);
+}
+void randomSeed(unsigned long seed) { srand((unsigned)seed); }
+long map(long x, long in_min, long in_max, long out_min, long out_max) {
+  return (x - in_min) * (out_max - out_min) / (in_max - in_min) + out_min;
+}
@@ -0,0 +1,237 @@
+// tools/host/Arduino.h
+//
+// A minimal stand-in for the Arduino core so firmware libraries can be built
+// into host-side tools (replay, simulations, benchmarks). Only what those
+// libraries actually use is here. Time is a virtual clock the tool drives
+// with hostSetMicros()/hostAdvanceMicros(), so timing logic is reproducible.
+
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <math.h>
+#include <deque>
+#include <string>
+#include <algorithm>
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+#define SERIAL_8N1 0x800001c
+#define A3 4
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+// --- Virtual clock ---
+void hostSetMicros(uint64_t us);
+void hostAdvanceMicros(uint64_t us);
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+long random(long howbig);
+long random(long howsmall, long howbig);
+void randomSeed(unsigned long seed);
+long map(long x, long in_min, long in_max, long out_min, long out_max);
+
+inline void pinMode(uint8_t, uint8_t) {}
+inline void digitalWrite(uint8_t, uint8_t) {}
+inline int digitalRead(uint8_t) { return LOW; }
+inline int analogRead(uint8_t) { return 0; }
+inline void noInterrupts() {}
+inline void interrupts() {}
+using std::min;
+using std::max;
+inline void *ps_malloc(size_t size) { return malloc(size); }
+
+#if defined(__GLIBC__) && (__GLIBC__ < 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ < 38))
+inline size_t strlcpy(char *dst, const char *src, size_t size) {
+  size_t len = strlen(src);
+  if (size) {
+    size_t n = len < size - 1 ? len : size - 1;
+    memcpy(dst, src, n);
+    dst[n] = '\0';
+  }
+  return len;
+}
+#endif
+
+// --- String ---
+class String {
+public:
+  String(const char *s = "") : _s(s ? s : "") {}
+  String(const std::string &s) : _s(s) {}
+  String(char c) : _s(1, c) {}
+  String(int v) : _s(std::to_string(v)) {}
+  String(unsigned v) : _s(std::to_string(v)) {}
+  String(long v) : _s(std::to_string(v)) {}
+  String(unsigned long v) : _s(std::to_string(v)) {}
+  String(float v, unsigned decimals = 2) { _fromFloat(v, decimals); }
+  String(double v, unsigned decimals = 2) { _fromFloat(v, decimals); }
+
+  String &operator=(const char *s) { _s = s ? s : ""; return *this; }
+  bool concat(const char *s) { if (s) _s += s; return true; }
+  bool concat(const char *s, size_t n) { if (s) _s.append(s, n); return true; }
+  bool concat(char c) { _s += c; return true; }
+  String &operator+=(const String &o) { _s += o._s; return *this; }
+  String &operator+=(const char *s) { concat(s); return *this; }
+  String &operator+=(char c) { _s += c; return *this; }
+  friend String operator+(const String &a, const String &b) { return String(a._s + b._s); }
+
+  bool operator==(const String &o) const { return _s == o._s; }
+  bool operator==(const char *s) const { return s && _s == s; }
+  bool operator!=(const String &o) const { return _s != o._s; }
+
+  const char *c_str() const { return _s.c_str(); }
+  unsigned int length() const { return (unsigned int)_s.size(); }
+  char charAt(unsigned int i) const { return i < _s.size() ? _s[i] : 0; }
+  char operator[](unsigned int i) const { return charAt(i); }
+  int indexOf(char c, unsigned int from = 0) const {
+    size_t p = _s.find(c, from);
+    return p == std::string::npos ? -1 : (int)p;
+  }
+  String substring(unsigned int from) const { return from < _s.size() ? String(_s.substr(from)) : String(); }
+  String substring(unsigned int from, unsigned int to) const {
+    if (from > _s.size()) return String();
+    return String(_s.substr(from, std::min<size_t>(to, _s.size()) - from));
+  }
+  void reserve(unsigned int n) { _s.reserve(n); }
+  void trim() {
+    size_t a = _s.find_first_not_of(" \t\r\n");
+    size_t b = _s.find_last_not_of(" \t\r\n");
+    _s = (a == std::string::npos) ? "" : _s.substr(a, b - a + 1);
+  }
+  long toInt() const { return strtol(_s.c_str(), nullptr, 10); }
+
+private:
+  void _fromFloat(double v, unsigned decimals) {
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%.*f", (int)decimals, v);
+    _s = buf;
+  }
+  std::string _s;
+};
+
+// --- Print / Stream ---
+class Print {
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t *buffer, size_t size) {
+    for (size_t i = 0; i < size; i++) write(buffer[i]);
+    return size;
+  }
+  size_t write(const char *s) { return write((const uint8_t *)s, strlen(s)); }
+  size_t write(const char *buffer, size_t size) { return write((const uint8_t *)buffer, size); }
+  virtual int availableForWrite() { return 1 << 20; }
+  virtual void flush() {}
+
+  size_t printf(const char *format, ...) __attribute__((format(printf, 2, 3))) {
+    char buf[512];
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(buf, sizeof(buf), format, args);
+    va_end(args);
+    if (n < 0) return 0;
+    return write((const uint8_t *)buf, std::min<size_t>((size_t)n, sizeof(buf) - 1));
+  }
+  size_t print(const String &s) { return write(s.c_str()); }
+  size_t print(const char *s) { return write(s); }
+  size_t print(char c) { return write((uint8_t)c); }
+  size_t print(int v, int base = 10) { return base == 16 ? printf("%x", v) : printf("%d", v); }
+  size_t print(unsigned v, int base = 10) { return base == 16 ? printf("%x", v) : printf("%u", v); }
+  size_t print(long v, int base = 10) { return base == 16 ? printf("%lx", v) : printf("%ld", v); }
+  size_t print(unsigned long v, int base = 10) { return base == 16 ? printf("%lx", v) : printf("%lu", v); }
+  size_t print(double v, int digits = 2) { return printf("%.*f", digits, v); }
+  size_t println() { return write((uint8_t)'\n'); }
+  template <typename T> size_t println(const T &v) { size_t n = print(v); return n + println(); }
+  template <typename T> size_t println(const T &v, int fmt) { size_t n = print(v, fmt); return n + println(); }
+};
+
+class Stream : public Print {
+public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+  void setTimeout(unsigned long) {}
+  size_t readBytes(uint8_t *buffer, size_t length) {
+    size_t n = 0;
+    while (n < length && available()) buffer[n++] = (uint8_t)read();
+    return n;
+  }
+  size_t readBytes(char *buffer, size_t length) { return readBytes((uint8_t *)buffer, length); }
+  String readStringUntil(char terminator) {
+    std::string s;
+    while (available()) {
+      int c = read();
+      if (c == terminator) break;
+      s += (char)c;
+    }
+    return String(s);
+  }
+};
+
+// A serial port backed by in-memory queues. Tools push bytes with inject()
+// to play the other board's role; anything written is kept in 'tx' (and
+// echoed to stdout if echo is set).
+class HardwareSerial : public Stream {
+public:
+  bool echo = false;
+  std::deque<uint8_t> rx;
+  std::string tx;
+
+  void begin(unsigned long baud, uint32_t config = SERIAL_8N1, int8_t rxPin = -1, int8_t txPin = -1) {
+    (void)config; (void)rxPin; (void)txPin;
+    _baud = baud;
+  }
+  void end() {}
+  void updateBaudRate(unsigned long baud) { _baud = baud; }
+  unsigned long baudRate() const { return _baud; }
+  operator bool() const { return true; }
+  void inject(const uint8_t *data, size_t len) { rx.insert(rx.end(), data, data + len); }
+
+  int available() override { return (int)rx.size(); }
+  int read() override {
+    if (rx.empty()) return -1;
+    int c = rx.front();
+    rx.pop_front();
+    return c;
+  }
+  int peek() override { return rx.empty() ? -1 : rx.front(); }
+  using Print::write;
+  size_t write(uint8_t c) override {
+    tx += (char)c;
+    if (echo) fputc(c, stdout);
+    return 1;
+  }
+
+private:
+  unsigned long _baud = 0;
+};
+
+extern HardwareSerial Serial;
+extern HardwareSerial Serial1;
+
+// --- ESP ---
+class EspClass {
+public:
+  uint32_t getCycleCount() { return (uint32_t)(micros() * 240UL); }
+  uint32_t getCpuFreqMHz() { return 240; }
+  uint32_t getFreeHeap() { return 200000; }
+  uint32_t getMinFreeHeap() { return 180000; }
+  uint32_t getMaxAllocHeap() { return 110000; }
+  uint32_t getFreePsram() { return 8000000; }
+};
+extern EspClass ESP;
+
+#endif // HOST_ARDUINO_H
@@ -0,0 +1,324 @@
+// tools/host/Arduino_GFX_Library.h
+//
+// A stand-in for GFX Library for Arduino (1.3.8) that draws nothing and
+// counts what the real library would send to a GC9A01 instead. Primitives
+// break down the way the library's do: a circle is one 1x1 address window
+// per pixel, a text pixel at size N is an N x N filled rect, and the
+// panel's address window only resends CASET/RASET when the column/row range
+// changes. Everything lands in hostGfxCounters, which tools read and reset.
+//
+// The fake has no font data. Every printable glyph is costed as the
+// built-in 5x7 font's 'S', whose 15 lit pixels are that font's average.
+
+#ifndef HOST_ARDUINO_GFX_LIBRARY_H
+#define HOST_ARDUINO_GFX_LIBRARY_H
+
+#include "Arduino.h"
+
+#define GFX_NOT_DEFINED -1
+
+#define BLACK 0x0000
+#define NAVY 0x000F
+#define DARKGREEN 0x03E0
+#define BLUE 0x001F
+#define GREEN 0x07E0
+#define CYAN 0x07FF
+#define RED 0xF800
+#define MAGENTA 0xF81F
+#define YELLOW 0xFFE0
+#define WHITE 0xFFFF
+#define ORANGE 0xFD20
+
+struct HostGfxCounters {
+  uint32_t calls;   // Drawing calls, plus pixel writes made straight to the bus
+  uint32_t windows; // Address windows opened
+  uint32_t pixels;  // Pixels pushed
+  uint32_t bytes;   // Bytes on the SPI bus: commands, parameters and pixels
+  int depth;        // > 0 while inside a drawing call
+};
+inline HostGfxCounters hostGfxCounters = {0, 0, 0, 0, 0};
+
+inline void hostResetGfxCounters() {
+  hostGfxCounters = {0, 0, 0, 0, 0};
+}
+
+class Arduino_DataBus {
+public:
+  virtual ~Arduino_DataBus() {}
+  virtual bool begin(int32_t speed = GFX_NOT_DEFINED, int8_t dataMode = GFX_NOT_DEFINED) = 0;
+  virtual void beginWrite() = 0;
+  virtual void endWrite() = 0;
+  virtual void writeCommand(uint8_t c) = 0;
+  virtual void writeCommand16(uint16_t c) = 0;
+  virtual void write(uint8_t d) = 0;
+  virtual void write16(uint16_t d) = 0;
+  virtual void writeC8D16D16(uint8_t c, uint16_t d1, uint16_t d2) {
+    writeCommand(c);
+    write16(d1);
+    write16(d2);
+  }
+  virtual void writeRepeat(uint16_t p, uint32_t len) = 0;
+  virtual void writePixels(uint16_t *data, uint32_t len) = 0;
+  virtual void writeBytes(uint8_t *data, uint32_t len) = 0;
+  virtual void writePattern(uint8_t *data, uint8_t len, uint32_t repeat) = 0;
+};
+
+class Arduino_ESP32SPI : public Arduino_DataBus {
+public:
+  Arduino_ESP32SPI(int8_t /* dc */, int8_t /* cs */ = GFX_NOT_DEFINED, int8_t /* sck */ = GFX_NOT_DEFINED,
+                   int8_t /* mosi */ = GFX_NOT_DEFINED, int8_t /* miso */ = GFX_NOT_DEFINED,
+                   uint8_t /* spi_num */ = 0, bool /* is_shared_interface */ = true) {}
+
+  bool begin(int32_t, int8_t) override { return true; }
+  void beginWrite() override {}
+  void endWrite() override {}
+  void writeCommand(uint8_t) override { hostGfxCounters.bytes += 1; }
+  void writeCommand16(uint16_t) override { hostGfxCounters.bytes += 2; }
+  void write(uint8_t) override { hostGfxCounters.bytes += 1; }
+  void write16(uint16_t) override { hostGfxCounters.bytes += 2; }
+  void writeRepeat(uint16_t, uint32_t len) override { _pixels(len); }
+  void writePixels(uint16_t *, uint32_t len) override { _pixels(len); }
+  void writeBytes(uint8_t *, uint32_t len) override { hostGfxCounters.bytes += len; }
+  void writePattern(uint8_t *, uint8_t len, uint32_t repeat) override { hostGfxCounters.bytes += len * repeat; }
+
+private:
+  void _pixels(uint32_t len) {
+    if (hostGfxCounters.depth == 0) hostGfxCounters.calls++;
+    hostGfxCounters.pixels += len;
+    hostGfxCounters.bytes += len * 2;
+  }
+};
+
+class Arduino_GFX : public Print {
+public:
+  Arduino_GFX(int16_t w, int16_t h) : _width(w), _height(h) {}
+  virtual ~Arduino_GFX() {}
+
+  virtual bool begin(int32_t speed = GFX_NOT_DEFINED) = 0;
+  virtual void writeAddrWindow(int16_t x, int16_t y, uint16_t w, uint16_t h) = 0;
+  virtual void invertDisplay(bool) = 0;
+  virtual void displayOn() = 0;
+  virtual void displayOff() = 0;
+
+  void setRotation(uint8_t) {}
+  int16_t width() const { return _width; }
+  int16_t height() const { return _height; }
+  uint16_t color565(uint8_t r, uint8_t g, uint8_t b) { return ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3); }
+
+  virtual void startWrite() { _bus->beginWrite(); }
+  virtual void endWrite() { _bus->endWrite(); }
+
+  void fillScreen(uint16_t color) { fillRect(0, 0, _width, _height, color); }
+
+  void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
+    Call call;
+    startWrite();
+    writeFillRect(x, y, w, h, color);
+    endWrite();
+  }
+
+  void drawPixel(int16_t x, int16_t y, uint16_t color) {
+    Call call;
+    startWrite();
+    writePixel(x, y, color);
+    endWrite();
+  }
+
+  void drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color) { fillRect(x, y, w, 1, color); }
+  void drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color) { fillRect(x, y, 1, h, color); }
+
+  // Bresenham's midpoint circle, one pixel at a time, as the library does
+  void drawCircle(int16_t x0, int16_t y0, int16_t r, uint16_t color) {
+    Call call;
+    startWrite();
+    int16_t f = 1 - r, ddF_x = 1, ddF_y = -2 * r, x = 0, y = r;
+    writePixel(x0, y0 + r, color);
+    writePixel(x0, y0 - r, color);
+    writePixel(x0 + r, y0, color);
+    writePixel(x0 - r, y0, color);
+    while (x < y) {
+      if (f >= 0) {
+        y--;
+        ddF_y += 2;
+        f += ddF_y;
+      }
+      x++;
+      ddF_x += 2;
+      f += ddF_x;
+      writePixel(x0 + x, y0 + y, color);
+      writePixel(x0 - x, y0 + y, color);
+      writePixel(x0 + x, y0 - y, color);
+      writePixel(x0 - x, y0 - y, color);
+      writePixel(x0 + y, y0 + x, color);
+      writePixel(x0 - y, y0 + x, color);
+      writePixel(x0 + y, y0 - x, color);
+      writePixel(x0 - y, y0 - x, color);
+    }
+    endWrite();
+  }
+
+  void fillCircle(int16_t x0, int16_t y0, int16_t r, uint16_t color) {
+    Call call;
+    startWrite();
+    for (int16_t dy = -r; dy <= r; dy++) {
+      int16_t half = (int16_t)sqrtf((float)(r * r - dy * dy));
+      writeFillRect(x0 - half, y0 + dy, 2 * half + 1, 1, color);
+    }
+    endWrite();
+  }
+
+  void draw16bitRGBBitmap(int16_t x, int16_t y, uint16_t *bitmap, int16_t w, int16_t h) {
+    Call call;
+    if (!_clip(x, y, w, h)) return;
+    startWrite();
+    writeAddrWindow(x, y, w, h);
+    _bus->writePixels(bitmap, (uint32_t)w * h);
+    endWrite();
+  }
+
+  // --- Text ---
+  void setCursor(int16_t x, int16_t y) {
+    _cursorX = x;
+    _cursorY = y;
+  }
+  void setTextSize(uint8_t size) { _textSize = size ? size : 1; }
+  void setTextColor(uint16_t color) { _textColor = _textBackground = color; }
+  void setTextColor(uint16_t color, uint16_t background) {
+    _textColor = color;
+    _textBackground = background;
+  }
+  void getTextBounds(const char *text, int16_t x, int16_t y, int16_t *x1, int16_t *y1, uint16_t *w, uint16_t *h) {
+    int longest = 0, current = 0, lines = 1;
+    for (const char *p = text; *p; p++) {
+      if (*p == '\n') {
+        lines++;
+        current = 0;
+      } else if (*p != '\r') {
+        current++;
+        if (current > longest) longest = current;
+      }
+    }
+    *x1 = x;
+    *y1 = y;
+    *w = longest * 6 * _textSize;
+    *h = lines * 8 * _textSize;
+  }
+  void getTextBounds(const String &text, int16_t x, int16_t y, int16_t *x1, int16_t *y1, uint16_t *w, uint16_t *h) {
+    getTextBounds(text.c_str(), x, y, x1, y1, w, h);
+  }
+
+  using Print::write;
+  size_t write(uint8_t c) override {
+    if (c == '\n') {
+      _cursorX = 0;
+      _cursorY += 8 * _textSize;
+    } else if (c != '\r') {
+      _drawChar(_cursorX, _cursorY, c);
+      _cursorX += 6 * _textSize;
+    }
+    return 1;
+  }
+
+protected:
+  // Marks a drawing call, so the bus writes it makes aren't counted again
+  struct Call {
+    Call() {
+      if (hostGfxCounters.depth++ == 0) hostGfxCounters.calls++;
+    }
+    ~Call() { hostGfxCounters.depth--; }
+  };
+
+  bool _clip(int16_t &x, int16_t &y, int16_t &w, int16_t &h) const {
+    if (x < 0) {
+      w += x;
+      x = 0;
+    }
+    if (y < 0) {
+      h += y;
+      y = 0;
+    }
+    if (x + w > _width) w = _width - x;
+    if (y + h > _height) h = _height - y;
+    return w > 0 && h > 0;
+  }
+
+  void writePixel(int16_t x, int16_t y, uint16_t color) {
+    if (x < 0 || y < 0 || x >= _width || y >= _height) return;
+    writeAddrWindow(x, y, 1, 1);
+    _bus->write16(color);
+    hostGfxCounters.pixels++;
+  }
+
+  void writeFillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
+    if (!_clip(x, y, w, h)) return;
+    writeAddrWindow(x, y, w, h);
+    _bus->writeRepeat(color, (uint32_t)w * h);
+  }
+
+  void _drawChar(int16_t x, int16_t y, unsigned char c) {
+    if (c == ' ') return;
+    Call call;
+    static const uint8_t GLYPH[5] = {0x46, 0x49, 0x49, 0x49, 0x31}; // 'S'
+    bool opaque = _textBackground != _textColor;
+    startWrite();
+    for (int8_t i = 0; i < 5; i++) {
+      for (int8_t j = 0; j < 8; j++) {
+        bool lit = GLYPH[i] & (1 << j);
+        if (!lit && !opaque) continue;
+        uint16_t color = lit ? _textColor : _textBackground;
+        if (_textSize == 1) {
+          writePixel(x + i, y + j, color);
+        } else {
+          writeFillRect(x + i * _textSize, y + j * _textSize, _textSize, _textSize, color);
+        }
+      }
+    }
+    if (opaque) {
+      writeFillRect(x + 5 * _textSize, y, _textSize, 8 * _textSize, _textBackground);
+    }
+    endWrite();
+  }
+
+  Arduino_DataBus *_bus = nullptr;
+  int16_t _width, _height;
+  int16_t _cursorX = 0, _cursorY = 0;
+  uint8_t _textSize = 1;
+  uint16_t _textColor = WHITE, _textBackground = WHITE;
+};
+
+class Arduino_GC9A01 : public Arduino_GFX {
+public:
+  Arduino_GC9A01(Arduino_DataBus *bus, int8_t /* rst */ = GFX_NOT_DEFINED, uint8_t /* r */ = 0, bool /* ips */ = false)
+      : Arduino_GFX(240, 240) {
+    _bus = bus;
+  }
+
+  bool begin(int32_t speed = GFX_NOT_DEFINED) override { return _bus->begin(speed); }
+
+  void invertDisplay(bool) override { _bus->writeCommand(0x21); }
+  // Sleep out + display on, display off + sleep in
+  void displayOn() override { _bus->writeCommand(0x11); _bus->writeCommand(0x29); }
+  void displayOff() override { _bus->writeCommand(0x28); _bus->writeCommand(0x10); }
+
+  // The panel remembers its column and row ranges, so only changed ones are resent
+  void writeAddrWindow(int16_t x, int16_t y, uint16_t w, uint16_t h) override {
+    hostGfxCounters.windows++;
+    if (x != _currentX || w != _currentW) {
+      _bus->writeC8D16D16(0x2A, x, x + w - 1); // CASET
+      _currentX = x;
+      _currentW = w;
+    }
+    if (y != _currentY || h != _currentH) {
+      _bus->writeC8D16D16(0x2B, y, y + h - 1); // RASET
+      _currentY = y;
+      _currentH = h;
+    }
+    _bus->writeCommand(0x2C); // RAMWR
+  }
+
+private:
+  int16_t _currentX = -1, _currentY = -1;
+  uint16_t _currentW = 0, _currentH = 0;
+};
+
+#endif // HOST_ARDUINO_GFX_LIBRARY_H
@@ -0,0 +1,26 @@
+// tools/host/HostCheck.h
+//
+// The reporting shared by the host-side tests (*_test.cpp). Every check
+// prints one line, its name, PASS or FAIL and what it measured, and main()
+// returns checkStatus(): 1 if any check failed, for scripts and CI.
+
+#ifndef HOST_CHECK_H
+#define HOST_CHECK_H
+
+#include <stdio.h>
+
+inline int &checkFailures() {
+  static int failures = 0;
+  return failures;
+}
+
+inline void report(const char *name, bool passed, const char *detail) {
+  printf("%-12s %s  %s\n", name, passed ? "PASS" : "FAIL", detail);
+  if (!passed) checkFailures()++;
+}
+
+inline int checkStatus() {
+  return checkFailures() ? 1 : 0;
+}
+
+#endif // HOST_CHECK_H
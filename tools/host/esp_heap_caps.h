@@ -0,0 +1,21 @@
+// tools/host/esp_heap_caps.h
+//
+// Host stand-in for ESP-IDF's capability-aware allocator. There is only one
+// kind of memory on a PC, so every request is plain malloc().
+
+#ifndef HOST_ESP_HEAP_CAPS_H
+#define HOST_ESP_HEAP_CAPS_H
+
+#include <stdlib.h>
+
+#define MALLOC_CAP_DMA (1 << 3)
+#define MALLOC_CAP_8BIT (1 << 2)
+#define MALLOC_CAP_INTERNAL (1 << 11)
+#define MALLOC_CAP_SPIRAM (1 << 10)
+
+inline void *heap_caps_malloc(size_t size, unsigned caps) {
+  (void)caps;
+  return malloc(size);
+}
+
+#endif // HOST_ESP_HEAP_CAPS_H
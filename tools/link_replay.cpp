@@ -0,0 +1,280 @@
+// tools/link_replay.cpp
+//
+// Plays a XIAO link capture (dumped from the ProS3 with the 'd' serial
+// command) back through the firmware's own XiaoMessageParser, so a
+// tracking problem seen in the field can be reproduced and timed on a PC.
+// The firmware clock (millis/micros) follows the recorded arrival times, so
+// anything timing-dependent behaves exactly as it did on the robot no matter
+// how fast the replay runs.
+//
+// The parsed messages then go to the firmware's FaceFollower, which makes
+// production mode's decisions: confirming and losing faces, faces held by
+// the XIAO's keep-alives, the link timing out, and napping. A confirmed
+// face goes into the ScanPlanner heatmap, and the eye's targets come out of
+// GazeTable::lookup() (with GazeTable::defaultCalibration()). The decisions
+// are printed one per line, in capture time, and nothing else in them
+// depends on the host, so the output of two captures (or of one capture
+// before and after a change) can be diffed:
+//   <s> confirm hits=N face=X,Y servo=PX,PY   SCANNING -> DETECTION
+//   <s> follow face=X,Y servo=PX,PY           the eye follows a detection
+//   <s> lost                                  DETECTION -> SCANNING
+//   <s> scan target=X,Y servo=PX,PY           the next SCANNING target
+//   <s> nap / link_down / link_up
+//
+// Build (ArduinoJson comes from the ProS3 project's .pio/libdeps), from tools/:
+//   g++ -O2 -std=c++17 -DARDUINOJSON_ENABLE_ARDUINO_STRING=1
+//       -I host -I ../Common/Log2Histogram -I ../Common/LinkProtocol -I <ArduinoJson>/src
+//       -I ../ICU-S1-PrimeBuild/lib/XiaoFaceDetector -I ../Common/JsonArena -I ../Common/ThumbCodec
+//       -I ../ICU-S1-PrimeBuild/include -I ../ICU-S1-PrimeBuild/lib/FaceFollower
+//       -I ../ICU-S1-PrimeBuild/lib/PresenceTracker -I ../ICU-S1-PrimeBuild/lib/PowerManager
+//       -I ../ICU-S1-PrimeBuild/lib/ScanPlanner -I ../ICU-S1-PrimeBuild/lib/GazeTable
+//       -o link_replay link_replay.cpp host/Arduino.cpp
+//       ../ICU-S1-PrimeBuild/lib/XiaoFaceDetector/XiaoMessageParser.cpp
+//       ../Common/JsonArena/JsonArena.cpp ../Common/ThumbCodec/ThumbCodec.cpp
+//       ../ICU-S1-PrimeBuild/lib/FaceFollower/FaceFollower.cpp
+//       ../ICU-S1-PrimeBuild/lib/PresenceTracker/PresenceTracker.cpp
+//       ../ICU-S1-PrimeBuild/lib/PowerManager/PowerPolicy.cpp
+//       ../ICU-S1-PrimeBuild/lib/ScanPlanner/ScanPlanner.cpp ../ICU-S1-PrimeBuild/lib/GazeTable/GazeTable.cpp
+//
+// Use:
+//   link_replay capture.txt              as fast as possible
+//   link_replay capture.txt --speed 1    real time (2 = twice as fast, ...)
+//   link_replay capture.txt --verbose    print every parsed message as well
+//   link_replay a.txt > a.out; link_replay b.txt > b.out; diff a.out b.out
+
+#include <Arduino.h>
+#include <chrono>
+#include <thread>
+#include "FaceFollower.h"
+#include "GazeTable.h"
+#include "Log2Histogram.h"
+#include "ScanPlanner.h"
+#include "XiaoMessageParser.h"
+
+static const char *typeNames[] = {"none", "detection", "heartbeat", "error", "parse_error", "unknown", "baud_ack", "pong", "set_ack", "face_lost", "thumbnail"};
+static const int NUM_TYPES = sizeof(typeNames) / sizeof(typeNames[0]);
+
+// The firmware loop runs many times between two lines; this often is close
+// enough for the timeouts and the scan
+const unsigned long LOOP_MS = 10;
+
+// main.cpp's production path, from the detections to the eye's targets.
+struct Tracker {
+  FaceFollower faces;
+  GazeTable gazeTable;
+  ScanPlanner scanPlanner;
+  SystemState state = SystemState::SCANNING;
+  XiaoMessage lastDetection;
+  bool linkUp = true;
+  unsigned long lastHeartbeat = 0;
+  unsigned long confirms = 0, losses = 0, follows = 0, scans = 0;
+};
+
+static void printAt(const char *event) {
+  printf("%12.6f %s\n", micros() / 1e6, event);
+}
+
+static void printTarget(const char *event, const char *name, int imageX, int imageY, const GazeTable &table) {
+  GazePulse pulse = table.lookup(imageX, imageY);
+  char text[96];
+  snprintf(text, sizeof(text), "%s %s=%d,%d servo=%u,%u", event, name, imageX, imageY, pulse.x, pulse.y);
+  printAt(text);
+}
+
+static void enterScanning(Tracker &tracker) {
+  tracker.state = SystemState::SCANNING;
+  tracker.scanPlanner.restart(millis());
+}
+
+// main.cpp's loop() and handleDetection(), for one message
+static void onMessage(Tracker &tracker, const XiaoMessage &message) {
+  if (message.type == HEARTBEAT) {
+    tracker.lastHeartbeat = millis();
+    if (!tracker.linkUp) {
+      tracker.linkUp = true;
+      printAt("link_up");
+    }
+  } else if (message.type == FACE_LOST) {
+    tracker.faces.onFaceLost();
+  } else if (message.type == DETECTION) {
+    int centerX = message.x + message.w / 2;
+    int centerY = message.y + message.h / 2;
+    tracker.faces.onDetection(millis(), (uint32_t)LINK_SETTINGS[LINK_SET_EMIT_KEEP].defaultValue);
+    tracker.lastDetection = message;
+    if (tracker.state == SystemState::DETECTION) {
+      printTarget("follow", "face", centerX, centerY, tracker.gazeTable);
+      tracker.follows++;
+    }
+  }
+}
+
+// XiaoFaceDetector's link timeout, main.cpp's updateProduction() and the
+// SCANNING part of ServoController::update()
+static void updateTracker(Tracker &tracker) {
+  if (tracker.linkUp && millis() - tracker.lastHeartbeat >= LINK_DOWN_TIMEOUT_MS) {
+    tracker.linkUp = false;
+    printAt("link_down");
+  }
+
+  switch (tracker.faces.update(tracker.state, tracker.linkUp, millis())) {
+    case FaceEvent::CONFIRMED: {
+      tracker.state = SystemState::DETECTION;
+      int faceX = tracker.lastDetection.x + tracker.lastDetection.w / 2;
+      int faceY = tracker.lastDetection.y + tracker.lastDetection.h / 2;
+      tracker.scanPlanner.recordFace(faceX, faceY);
+      char event[32];
+      snprintf(event, sizeof(event), "confirm hits=%d", tracker.faces.recentHits());
+      printTarget(event, "face", faceX, faceY, tracker.gazeTable);
+      tracker.confirms++;
+      break;
+    }
+    case FaceEvent::LOST:
+      printAt("lost");
+      tracker.losses++;
+      enterScanning(tracker);
+      break;
+    case FaceEvent::LINK_DOWN:
+      enterScanning(tracker);
+      break;
+    case FaceEvent::NAP:
+      printAt("nap");
+      tracker.state = SystemState::NAPPING;
+      break;
+    default:
+      break;
+  }
+
+  int imageX, imageY;
+  if (tracker.state == SystemState::SCANNING && tracker.scanPlanner.update(millis(), imageX, imageY)) {
+    printTarget("scan", "target", imageX, imageY, tracker.gazeTable);
+    tracker.scans++;
+  }
+}
+
+// Undoes LinkRecorder::dump()'s escaping.
+static std::string unescape(const char *text) {
+  std::string out;
+  for (const char *p = text; *p && *p != '\n' && *p != '\r'; p++) {
+    if (*p != '\\' || !p[1]) {
+      out += *p;
+      continue;
+    }
+    p++;
+    switch (*p) {
+      case 'n': out += '\n'; break;
+      case 'r': out += '\r'; break;
+      case 'x': {
+        char hex[3] = {p[1], p[1] ? p[2] : '\0', '\0'};
+        out += (char)strtol(hex, nullptr, 16);
+        p += 2;
+        break;
+      }
+      default: out += *p; break;
+    }
+  }
+  return out;
+}
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    fprintf(stderr, "usage: %s <capture.txt> [--speed N] [--verbose]\n", argv[0]);
+    return 1;
+  }
+  double speed = 0;
+  bool verbose = false;
+  for (int i = 2; i < argc; i++) {
+    if (!strcmp(argv[i], "--speed") && i + 1 < argc) speed = atof(argv[++i]);
+    else if (!strcmp(argv[i], "--verbose")) verbose = true;
+  }
+
+  FILE *in = fopen(argv[1], "r");
+  if (!in) {
+    perror(argv[1]);
+    return 1;
+  }
+
+  XiaoMessageParser parser;
+  Tracker tracker;
+  GazePulse calibration[GAZE_CAL_POINTS];
+  GazeTable::defaultCalibration(calibration);
+  tracker.gazeTable.generate(calibration);
+  Log2Histogram parseNs;       // Host time spent in parseLine()
+  Log2Histogram interArrivalUs; // Gaps between lines as recorded on the robot
+  unsigned long typeCounts[NUM_TYPES] = {0};
+
+  uint64_t clockUs = 0;
+  uint32_t lastStamp = 0;
+  bool first = true;
+  static char text[8192];
+  while (fgets(text, sizeof(text), in)) {
+    if (text[0] != '@') continue; // Comments and anything else in the dump
+
+    char *payload = nullptr;
+    uint32_t stamp = (uint32_t)strtoul(text + 1, &payload, 10);
+    if (*payload == ' ') payload++;
+
+    // Recorded timestamps are 32-bit micros(); unwrap them onto a 64-bit clock.
+    uint32_t delta = first ? 0 : stamp - lastStamp;
+    if (!first) interArrivalUs.record(delta);
+    clockUs += delta;
+    lastStamp = stamp;
+    if (speed > 0 && delta > 0) {
+      std::this_thread::sleep_for(std::chrono::microseconds((long long)(delta / speed)));
+    }
+    if (first) {
+      // The replay starts as the capture did: SCANNING, with the link up
+      hostSetMicros(clockUs);
+      tracker.lastHeartbeat = millis();
+      tracker.faces.start(millis());
+      enterScanning(tracker);
+      first = false;
+    }
+    // The loop passes since the last line
+    for (uint64_t loopUs = micros() + LOOP_MS * 1000; loopUs < clockUs; loopUs += LOOP_MS * 1000) {
+      hostSetMicros(loopUs);
+      updateTracker(tracker);
+    }
+    hostSetMicros(clockUs);
+
+    std::string line = unescape(payload);
+    auto start = std::chrono::steady_clock::now();
+    XiaoMessage message = parser.parseLine(line.c_str());
+    auto end = std::chrono::steady_clock::now();
+    parseNs.record((uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+
+    typeCounts[message.type]++;
+    if (verbose) {
+      printf("%12.6f %-11s %s\n", clockUs / 1e6, typeNames[message.type], message.data);
+    }
+    onMessage(tracker, message);
+    updateTracker(tracker);
+  }
+  fclose(in);
+
+  printf("lines=%lu span_s=%.3f\n", (unsigned long)parseNs.count(), clockUs / 1e6);
+  for (int i = 1; i < NUM_TYPES; i++) {
+    printf("  %-11s %lu\n", typeNames[i], typeCounts[i]);
+  }
+  printf("confirms=%lu losses=%lu follows=%lu scans=%lu\n", tracker.confirms, tracker.losses, tracker.follows,
+         tracker.scans);
+  printf("inter_arrival_us p50=%lu p99=%lu max=%lu\n",
+         (unsigned long)interArrivalUs.percentile(50), (unsigned long)interArrivalUs.percentile(99),
+         (unsigned long)interArrivalUs.max());
+  printf("parse_ns p50=%lu p99=%lu max=%lu\n",
+         (unsigned long)parseNs.percentile(50), (unsigned long)parseNs.percentile(99),
+         (unsigned long)parseNs.max());
+
+  const XiaoHealth &health = parser.getHealth();
+  if (health.valid) {
+    printf("last_xiao_health fps=%.1f hit=%.2f bound=%s gate_idle=%d skipped=%lu\n", health.fps, health.hitRate,
+           health.bound, health.gateIdle, (unsigned long)health.skippedFrames);
+    printf("last_xiao_emit bytes_per_s=%lu saved_per_s=%ld\n", (unsigned long)health.emitBytesPerSec,
+           (long)health.emitSavedPerSec);
+    if (health.powerMode[0]) {
+      printf("last_xiao_power mode=%s active_ms=%lu low_ms=%lu standby_ms=%lu\n", health.powerMode,
+             (unsigned long)health.powerMs[LINK_POWER_ACTIVE], (unsigned long)health.powerMs[LINK_POWER_LOW],
+             (unsigned long)health.powerMs[LINK_POWER_STANDBY]);
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,202 @@
+// tools/power_policy_test.cpp
+//
+// Checks the decisions PowerManager makes (lib/PowerManager/PowerPolicy) on
+// the host, with time from the host Arduino stub's virtual clock, reported
+// as in host/HostCheck.h.
+//
+//   mapping     every system state gets the power state and XIAO camera
+//               mode it should
+//   nap_timer   SCANNING naps after NAP_AFTER with no face and not before,
+//               never with a face tracked or in another state, and still
+//               across the 32-bit millis() wrap
+//   order       every state change records first and takes each step once;
+//               into a lower power state the outputs go before the power,
+//               out of one the power goes first
+//   gating      light sleep only while napping or asleep, for the right
+//               interval, never with light sleep built out, and never while
+//               the panel is on or the flash log is writing
+//   hold_awake  a line from the XIAO keeps the loop awake for the hold and
+//               no longer, a shorter hold never cuts a longer one short, and
+//               both still work across the 32-bit millis() wrap
+//
+// Build, from tools/:
+//   g++ -O2 -std=c++17 -I host -I ../ICU-S1-PrimeBuild/include -I ../ICU-S1-PrimeBuild/lib/PowerManager
+//       -I ../Common/LinkProtocol -o power_policy_test power_policy_test.cpp
+//       ../ICU-S1-PrimeBuild/lib/PowerManager/PowerPolicy.cpp host/Arduino.cpp
+//
+// Use:
+//   power_policy_test
+
+#include <Arduino.h>
+#include "HostCheck.h"
+#include "PowerPolicy.h"
+
+const uint32_t GIVE_UP_MS = 60000;    // A hold that never ends fails rather than hangs
+
+// millis() as the ESP32 sees it: 32 bits
+static uint32_t nowMs() {
+  return (uint32_t)millis();
+}
+
+static void testMapping() {
+  struct Expected {
+    SystemState state;
+    PowerState power;
+    LinkPowerMode xiao;
+  };
+  const Expected table[] = {
+      {SystemState::WAKE_UP, PowerState::ACTIVE, LINK_POWER_ACTIVE},
+      {SystemState::SCANNING, PowerState::ACTIVE, LINK_POWER_ACTIVE},
+      {SystemState::DETECTION, PowerState::ACTIVE, LINK_POWER_ACTIVE},
+      {SystemState::NAPPING, PowerState::NAP, LINK_POWER_LOW},
+      {SystemState::FULL_ASLEEP, PowerState::ASLEEP, LINK_POWER_STANDBY},
+      {SystemState::ERROR, PowerState::ACTIVE, LINK_POWER_ACTIVE},
+  };
+  int right = 0, total = 0;
+  for (const Expected &expected : table) {
+    PowerState power = powerStateFor(expected.state);
+    if (power == expected.power && xiaoModeFor(power) == expected.xiao) right++;
+    total++;
+  }
+  char detail[96];
+  snprintf(detail, sizeof(detail), "%d of %d system states", right, total);
+  report("mapping", right == total, detail);
+}
+
+static void testNapTimer() {
+  bool ok = true;
+  const SystemState others[] = {SystemState::WAKE_UP, SystemState::DETECTION, SystemState::NAPPING,
+                                SystemState::FULL_ASLEEP, SystemState::ERROR};
+  uint32_t napped[2];
+
+  for (int run = 0; run < 2; run++) {
+    // Mid-range, then with the face lost just before the wrap
+    hostSetMicros(run == 0 ? 20000000 : ((uint64_t)UINT32_MAX - 1000) * 1000);
+    uint32_t lastFace = nowMs();
+    uint32_t start = nowMs();
+    while (!shouldNap(SystemState::SCANNING, false, nowMs(), lastFace)) {
+      ok = ok && !shouldNap(SystemState::SCANNING, true, nowMs(), lastFace);
+      hostAdvanceMicros(1000);
+      if (nowMs() - start > NAP_AFTER + GIVE_UP_MS) break;
+    }
+    napped[run] = nowMs() - start;
+    ok = ok && napped[run] == NAP_AFTER && !shouldNap(SystemState::SCANNING, true, nowMs(), lastFace);
+    for (SystemState state : others) ok = ok && !shouldNap(state, false, nowMs(), lastFace);
+  }
+
+  char detail[128];
+  snprintf(detail, sizeof(detail), "napped after %u ms, %u ms across the wrap", (unsigned)napped[0],
+           (unsigned)napped[1]);
+  report("nap_timer", ok, detail);
+}
+
+// Where 'step' comes in 'order', or -1 if it does not
+static int stepAt(const TransitionStep order[TRANSITION_STEPS], TransitionStep step) {
+  for (int i = 0; i < TRANSITION_STEPS; i++) {
+    if (order[i] == step) return i;
+  }
+  return -1;
+}
+
+static void testOrder() {
+  const SystemState states[] = {SystemState::WAKE_UP, SystemState::SCANNING, SystemState::DETECTION,
+                                SystemState::NAPPING, SystemState::FULL_ASLEEP, SystemState::ERROR};
+  const TransitionStep steps[] = {TransitionStep::RECORD, TransitionStep::OUTPUTS, TransitionStep::POWER,
+                                  TransitionStep::GUARDS};
+  int right = 0, total = 0;
+  for (SystemState from : states) {
+    for (SystemState to : states) {
+      TransitionStep order[TRANSITION_STEPS];
+      transitionOrder(from, to, order);
+      bool ok = order[0] == TransitionStep::RECORD;
+      for (TransitionStep step : steps) {
+        int count = 0;
+        for (TransitionStep taken : order) count += taken == step;
+        ok = ok && count == 1;
+      }
+      int outputs = stepAt(order, TransitionStep::OUTPUTS), power = stepAt(order, TransitionStep::POWER);
+      if ((int)powerStateFor(to) > (int)powerStateFor(from)) ok = ok && outputs < power;
+      if ((int)powerStateFor(to) < (int)powerStateFor(from)) ok = ok && power < outputs;
+      right += ok;
+      total++;
+    }
+  }
+  char detail[96];
+  snprintf(detail, sizeof(detail), "%d of %d state changes", right, total);
+  report("order", right == total, detail);
+}
+
+static void testGating() {
+  hostSetMicros(5000000);
+  uint32_t past = nowMs() - 1;
+  const SleepBlockers quiet = {false, false};
+  uint32_t active = lightSleepMs(PowerState::ACTIVE, true, quiet, nowMs(), past);
+  uint32_t nap = lightSleepMs(PowerState::NAP, true, quiet, nowMs(), past);
+  uint32_t asleep = lightSleepMs(PowerState::ASLEEP, true, quiet, nowMs(), past);
+  uint32_t builtOut = lightSleepMs(PowerState::NAP, false, quiet, nowMs(), past) +
+                      lightSleepMs(PowerState::ASLEEP, false, quiet, nowMs(), past);
+  uint32_t blocked = 0;
+  const SleepBlockers busy[] = {{true, false}, {false, true}, {true, true}};
+  for (const SleepBlockers &blockers : busy) {
+    blocked += lightSleepMs(PowerState::NAP, true, blockers, nowMs(), past) +
+               lightSleepMs(PowerState::ASLEEP, true, blockers, nowMs(), past);
+  }
+  char detail[160];
+  snprintf(detail, sizeof(detail), "active %u ms, nap %u ms, asleep %u ms, built out %u ms, blocked %u ms",
+           (unsigned)active, (unsigned)nap, (unsigned)asleep, (unsigned)builtOut, (unsigned)blocked);
+  report("gating", active == 0 && nap > 0 && asleep > nap && builtOut == 0 && blocked == 0, detail);
+}
+
+// Holds awake at the current time, then steps the clock a millisecond at a
+// time until the loop may sleep. Returns how long that took.
+static uint32_t awakeFor(uint32_t &awakeUntil, uint32_t holdMs) {
+  awakeUntil = holdAwakeUntil(awakeUntil, nowMs(), holdMs);
+  uint32_t start = nowMs();
+  while (lightSleepMs(PowerState::NAP, true, {false, false}, nowMs(), awakeUntil) == 0) {
+    hostAdvanceMicros(1000);
+    if (nowMs() - start > GIVE_UP_MS) break;
+  }
+  return nowMs() - start;
+}
+
+static void testHoldAwake() {
+  bool ok = true;
+  uint32_t held[4];
+
+  // A fresh hold, in the middle of the clock's range
+  hostSetMicros(10000000);
+  uint32_t awakeUntil = nowMs();
+  held[0] = awakeFor(awakeUntil, LINK_AWAKE_HOLD);
+  ok = ok && held[0] == LINK_AWAKE_HOLD;
+
+  // A short hold arriving during a long one keeps the long one
+  awakeUntil = holdAwakeUntil(nowMs(), nowMs(), 2000);
+  hostAdvanceMicros(500000);
+  held[1] = awakeFor(awakeUntil, 100);
+  ok = ok && held[1] == 1500;
+
+  // Holds straddling the 32-bit millis() wrap
+  hostSetMicros(((uint64_t)UINT32_MAX - 100) * 1000);
+  awakeUntil = nowMs();
+  held[2] = awakeFor(awakeUntil, LINK_AWAKE_HOLD);
+  ok = ok && held[2] == LINK_AWAKE_HOLD;
+  hostSetMicros(((uint64_t)UINT32_MAX - 50) * 1000);
+  awakeUntil = holdAwakeUntil(nowMs(), nowMs(), 1000);
+  hostAdvanceMicros(200000);
+  held[3] = awakeFor(awakeUntil, 100);
+  ok = ok && held[3] == 800;
+
+  char detail[160];
+  snprintf(detail, sizeof(detail), "held %u ms, %u ms left of a longer hold, %u and %u ms across the wrap",
+           (unsigned)held[0], (unsigned)held[1], (unsigned)held[2], (unsigned)held[3]);
+  report("hold_awake", ok, detail);
+}
+
+int main() {
+  testMapping();
+  testNapTimer();
+  testOrder();
+  testGating();
+  testHoldAwake();
+  return checkStatus();
+}
@@ -0,0 +1,178 @@
+// tools/ring_clock_sim.cpp
+//
+// Simulates the three LED rings keeping time from the ProS3's SYNC frames
+// (Common/RingProtocol), to show how far out of phase they can get. Every
+// ring runs the real RingFrameParser and RingClock on a clock of its own:
+// an RC oscillator some percent off, wandering with temperature, read
+// through a 4 us micros(). The ProS3 writes millis() when its loop gets to
+// it, frames are occasionally corrupted or lost, and the ATTiny's receive
+// interrupt adds its own latency.
+//
+// Every --sample-ms of simulated time each ring's estimate of the ProS3's
+// clock is compared with the real one, and the rings with each other (the
+// phase error anyone watching would see). It exits with status 1 if either
+// goes past --bound-ms once --settle-s have passed; the first second or so,
+// before a ring has measured its rate, is reported separately.
+//
+// Build, from tools/:
+//   g++ -O2 -std=c++17 -I ../Common/RingProtocol -I ../Common/Log2Histogram
+//       -o ring_clock_sim ring_clock_sim.cpp ../Common/RingProtocol/RingProtocol.cpp
+//
+// Use:
+//   ring_clock_sim                          3 hours, the defaults below
+//   ring_clock_sim --hours 24 --ppm 20000   a day with rings 2% off
+//   ring_clock_sim --drop 0.3               lose 30% of the syncs
+//   ring_clock_sim --sync-ms 0              no syncs after the start-up ones, for comparison
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <random>
+#include "Log2Histogram.h"
+#include "RingProtocol.h"
+
+struct Ring {
+  RingFrameParser parser;
+  RingClock clock;
+  double ppm;        // How fast its oscillator runs
+  double localUs;    // Its own time, unquantised
+  uint32_t syncs;
+  int64_t worstUs;   // Largest error against the ProS3, once settled
+  int64_t worstStartupUs;
+  Log2Histogram errorUs;
+};
+
+int main(int argc, char **argv) {
+  double hours = 3;
+  double ppmSpread = 10000;    // Rings are up to this far off, either way
+  double wanderPpm = 200;      // Random walk per minute (temperature)
+  double syncMs = RING_SYNC_INTERVAL_MS; // 0 stops after the start-up syncs
+  double dropRate = 0.02;      // Frames lost outright
+  double corruptRate = 0.01;   // Frames with one byte flipped
+  double loopJitterUs = 2000;  // The ProS3's loop reaching the sync late
+  double isrJitterUs = 150;    // The ATTiny noticing the last byte late
+  double sampleMs = 10;
+  double boundMs = 5;
+  double settleS = 10;
+  for (int i = 1; i < argc; i++) {
+    const char *arg = argv[i];
+    double value = i + 1 < argc ? atof(argv[i + 1]) : 0;
+    if (!strcmp(arg, "--hours")) hours = value, i++;
+    else if (!strcmp(arg, "--ppm")) ppmSpread = value, i++;
+    else if (!strcmp(arg, "--wander")) wanderPpm = value, i++;
+    else if (!strcmp(arg, "--sync-ms")) syncMs = value, i++;
+    else if (!strcmp(arg, "--drop")) dropRate = value, i++;
+    else if (!strcmp(arg, "--corrupt")) corruptRate = value, i++;
+    else if (!strcmp(arg, "--sample-ms")) sampleMs = value, i++;
+    else if (!strcmp(arg, "--bound-ms")) boundMs = value, i++;
+    else if (!strcmp(arg, "--settle-s")) settleS = value, i++;
+    else {
+      fprintf(stderr, "usage: %s [--hours H] [--ppm P] [--wander P] [--sync-ms MS] [--drop F] [--corrupt F]\n"
+                      "          [--sample-ms MS] [--bound-ms MS] [--settle-s S]\n", argv[0]);
+      return 2;
+    }
+  }
+
+  std::mt19937 rng(12345);
+  std::uniform_real_distribution<double> unit(0, 1);
+  std::normal_distribution<double> normal(0, 1);
+
+  Ring rings[RING_COUNT];
+  for (int i = 0; i < RING_COUNT; i++) {
+    rings[i].ppm = (2 * unit(rng) - 1) * ppmSpread;
+    rings[i].localUs = unit(rng) * 1e9; // Each booted at a different time
+    rings[i].syncs = 0;
+    rings[i].worstUs = 0;
+    rings[i].worstStartupUs = 0;
+  }
+
+  const double endUs = hours * 3600e6;
+  const double stepUs = sampleMs * 1000;
+  double nextSyncUs = 100000 + unit(rng) * loopJitterUs;
+  double nextMinuteUs = 60e6;
+  int startupSyncs = 0;
+  Log2Histogram spreadUs; // Largest minus smallest ring estimate
+  int64_t worstSpreadUs = 0;
+  int64_t worstStartupSpreadUs = 0;
+  uint32_t sent = 0, lost = 0;
+
+  for (double nowUs = 0; nowUs < endUs; nowUs += stepUs) {
+    // The ProS3's millis() is the reference every ring is chasing
+    // Only syncs whose last byte is in by the end of this step
+    while (nextSyncUs + RING_SYNC_DELAY_US + isrJitterUs <= nowUs + stepUs) {
+      uint8_t frame[RING_MAX_FRAME_BYTES];
+      int length = ringEncodeSync((uint32_t)(uint64_t)(nextSyncUs / 1000), frame);
+      sent++;
+      for (Ring &ring : rings) {
+        if (unit(rng) < dropRate) {
+          lost++;
+          continue;
+        }
+        if (unit(rng) < corruptRate) frame[1 + (int)(unit(rng) * (length - 1))] ^= 0x10;
+        double arrivalUs = nextSyncUs + RING_SYNC_DELAY_US + unit(rng) * isrJitterUs;
+        double localArrival = ring.localUs + (arrivalUs - nowUs) * (1 + ring.ppm / 1e6);
+        uint32_t localStamp = (uint32_t)((uint64_t)localArrival & ~3ull); // micros() counts in 4s
+        for (int b = 0; b < length; b++) {
+          if (ring.parser.feed(frame[b]) && ring.parser.type() == RING_FRAME_SYNC) {
+            ring.clock.onSync(ring.parser.syncMs(), localStamp);
+            ring.syncs++;
+          }
+        }
+        ringEncodeSync((uint32_t)(uint64_t)(nextSyncUs / 1000), frame); // Undo the corruption
+      }
+      // LedController's schedule
+      double intervalMs = ++startupSyncs < RING_STARTUP_SYNCS ? RING_STARTUP_SYNC_INTERVAL_MS : syncMs;
+      nextSyncUs = intervalMs > 0 ? nextSyncUs + intervalMs * 1000 + (unit(rng) - 0.5) * loopJitterUs : endUs + 1;
+    }
+
+    if (nowUs >= nextMinuteUs) {
+      for (Ring &ring : rings) ring.ppm += normal(rng) * wanderPpm;
+      nextMinuteUs += 60e6;
+    }
+
+    bool settled = nowUs >= settleS * 1e6;
+    int64_t lowUs = INT64_MAX, highUs = INT64_MIN;
+    bool allSynced = true;
+    for (Ring &ring : rings) {
+      ring.localUs += stepUs * (1 + ring.ppm / 1e6);
+      if (!ring.clock.isSynced()) {
+        allSynced = false;
+        continue;
+      }
+      // masterMs() is what the ring animates with; compare in whole
+      // milliseconds, as that is all the animation sees
+      uint32_t estimate = ring.clock.masterMs((uint32_t)((uint64_t)ring.localUs & ~3ull));
+      int64_t errorUs = (int64_t)(int32_t)(estimate - (uint32_t)(uint64_t)((nowUs + stepUs) / 1000)) * 1000;
+      int64_t &worst = settled ? ring.worstUs : ring.worstStartupUs;
+      if (llabs(errorUs) > worst) worst = llabs(errorUs);
+      if (settled) ring.errorUs.record((uint32_t)llabs(errorUs));
+      if (errorUs < lowUs) lowUs = errorUs;
+      if (errorUs > highUs) highUs = errorUs;
+    }
+    if (allSynced) {
+      int64_t &worst = settled ? worstSpreadUs : worstStartupSpreadUs;
+      if (highUs - lowUs > worst) worst = highUs - lowUs;
+      if (settled) spreadUs.record((uint32_t)(highUs - lowUs));
+    }
+  }
+
+  printf("simulated_h=%.1f syncs_sent=%lu frames_lost=%lu sync_ms=%.0f\n", hours, (unsigned long)sent,
+         (unsigned long)lost, syncMs);
+  bool ok = true;
+  for (int i = 0; i < RING_COUNT; i++) {
+    Ring &ring = rings[i];
+    printf("ring %d oscillator_ppm=%+.0f trim_ppm=%+ld syncs=%lu bad_frames=%lu startup_max_us=%lld "
+           "error_us p50=%lu p99=%lu max=%lld\n",
+           i, ring.ppm, (long)ring.clock.trimPpm(), (unsigned long)ring.syncs,
+           (unsigned long)ring.parser.badFrames(), (long long)ring.worstStartupUs,
+           (unsigned long)ring.errorUs.percentile(50), (unsigned long)ring.errorUs.percentile(99),
+           (long long)ring.worstUs);
+    if (ring.worstUs > boundMs * 1000) ok = false;
+  }
+  printf("phase_spread_us startup_max=%lld p50=%lu p99=%lu max=%lld\n", (long long)worstStartupSpreadUs,
+         (unsigned long)spreadUs.percentile(50), (unsigned long)spreadUs.percentile(99), (long long)worstSpreadUs);
+  if (worstSpreadUs > boundMs * 1000) ok = false;
+  printf("%s: bound %.1f ms after %.0f s\n", ok ? "BOUNDED" : "EXCEEDED", boundMs, settleS);
+  return ok ? 0 : 1;
+}
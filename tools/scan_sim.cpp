@@ -0,0 +1,205 @@
+// tools/scan_sim.cpp
+//
+// Compares how the SCANNING eye moves with the firmware's ScanPlanner and
+// with the random walk it replaced (a uniformly random target every
+// 0.8-3 s).
+//
+// The camera is fixed to the body and always sees the whole field (the
+// 240x240 image GazeTable maps to eye pulses), so where the eye looks has
+// no effect on when a face is detected. The sweep only changes how the scan
+// looks, and that is all this measures:
+//   cover_s     time for the eye to rest once in every one of the
+//               ScanPlanner::HEAT_GRID x HEAT_GRID cells of the field
+//   gap_p90_s   how long a cell goes between rests (90th percentile, and
+//   gap_max_s   the longest)
+//   hot_share   share of the resting time spent within --near pixels of
+//               the two spots where most faces turn up
+//
+// The eye moves at --speed image pixels per second and then takes 60 ms to
+// settle; it rests once still. Faces turn up every 5-35 s, mostly around
+// two favourite spots (a doorway, a sofa) and otherwise anywhere; --hotspot
+// sets that share. The camera sees each one as it turns up, and the
+// learning planner is told about it, as the robot records confirmed faces,
+// so its heatmap builds up over the run.
+//
+// Build, from tools/:
+//   g++ -O2 -std=c++17 -I ../ICU-S1-PrimeBuild/lib/ScanPlanner -I ../ICU-S1-PrimeBuild/lib/GazeTable
+//       -o scan_sim scan_sim.cpp ../ICU-S1-PrimeBuild/lib/ScanPlanner/ScanPlanner.cpp
+//
+// Use:
+//   scan_sim                        4 simulated hours per strategy
+//   scan_sim --hours 1 --near 20    a shorter run, a tighter spot
+//   scan_sim --hotspot 0            faces anywhere, nothing to learn
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <random>
+#include <vector>
+#include "GazeTable.h"
+#include "ScanPlanner.h"
+
+const uint32_t STEP_MS = 10;
+const uint32_t SETTLE_MS = 60;
+const int CELL_PX = GAZE_IMAGE_SIZE / ScanPlanner::HEAT_GRID;
+
+struct Options {
+  double hours = 4;
+  double near = 30;
+  double speed = 400;
+  double hotspot = 0.7;
+};
+
+enum class Strategy { RANDOM_WALK, PLANNER, LEARNING_PLANNER };
+static const char *const strategyNames[] = {"random_walk", "planner", "planner_learning"};
+
+// Where most faces turn up
+struct Spot {
+  double x, y, spreadX, spreadY;
+};
+static const Spot DOORWAY = {55, 130, 15, 25};
+static const Spot SOFA = {180, 170, 25, 12};
+
+struct Eye {
+  double x = GAZE_IMAGE_SIZE / 2, y = GAZE_IMAGE_SIZE / 2;
+  double targetX = x, targetY = y;
+  uint32_t stillFor = 0; // ms since it arrived
+};
+
+static void moveEye(Eye &eye, double speed) {
+  double dx = eye.targetX - eye.x, dy = eye.targetY - eye.y;
+  double distance = hypot(dx, dy);
+  double step = speed * STEP_MS / 1000.0;
+  if (distance <= step) {
+    eye.x = eye.targetX;
+    eye.y = eye.targetY;
+    eye.stillFor += STEP_MS;
+  } else {
+    eye.x += dx * step / distance;
+    eye.y += dy * step / distance;
+    eye.stillFor = 0;
+  }
+}
+
+static void placeFace(std::mt19937 &rng, double hotspot, double &x, double &y) {
+  std::uniform_real_distribution<double> unit(0, 1);
+  std::normal_distribution<double> normal(0, 1);
+  double pick = unit(rng);
+  const Spot *spot = pick < hotspot * 0.6 ? &DOORWAY : pick < hotspot ? &SOFA : nullptr;
+  if (spot) {
+    x = spot->x + normal(rng) * spot->spreadX;
+    y = spot->y + normal(rng) * spot->spreadY;
+  } else {
+    x = unit(rng) * GAZE_IMAGE_SIZE;
+    y = unit(rng) * GAZE_IMAGE_SIZE;
+  }
+  x = std::min(std::max(x, 0.0), GAZE_IMAGE_SIZE - 1.0);
+  y = std::min(std::max(y, 0.0), GAZE_IMAGE_SIZE - 1.0);
+}
+
+static double percentile(std::vector<double> &values, int percent) {
+  if (values.empty()) return 0;
+  std::sort(values.begin(), values.end());
+  return values[std::min(values.size() - 1, values.size() * percent / 100)];
+}
+
+static void run(Strategy strategy, const Options &options) {
+  std::mt19937 rng(2024); // The same faces at the same times for every strategy
+  std::mt19937 walk(7);
+  std::uniform_real_distribution<double> unit(0, 1);
+  ScanPlanner planner;
+  planner.restart(0);
+  Eye eye;
+  uint32_t nextWalk = 0;
+  uint32_t nextFace = 5000;
+  const uint32_t endMs = (uint32_t)(options.hours * 3600000);
+
+  // Per cell: when the eye last rested there, -1 for not yet this cover
+  std::vector<int64_t> lastRest(ScanPlanner::HEAT_CELLS, -1);
+  std::vector<bool> covered(ScanPlanner::HEAT_CELLS, false);
+  int coveredCells = 0;
+  uint32_t coverStart = 0;
+  std::vector<double> covers, gaps;
+  uint64_t restMs = 0, hotMs = 0;
+  int faces = 0;
+
+  for (uint32_t now = 0; now < endMs; now += STEP_MS) {
+    if (now >= nextFace) {
+      double faceX, faceY;
+      placeFace(rng, options.hotspot, faceX, faceY);
+      if (strategy == Strategy::LEARNING_PLANNER) planner.recordFace((int)faceX, (int)faceY);
+      faces++;
+      nextFace = now + 5000 + (uint32_t)(unit(rng) * 30000);
+    }
+
+    int x, y;
+    if (strategy == Strategy::RANDOM_WALK) {
+      if (now >= nextWalk) {
+        eye.targetX = walk() % GAZE_IMAGE_SIZE;
+        eye.targetY = walk() % GAZE_IMAGE_SIZE;
+        nextWalk = now + 800 + walk() % 2200;
+      }
+    } else if (planner.update(now, x, y)) {
+      eye.targetX = x;
+      eye.targetY = y;
+    }
+    moveEye(eye, options.speed);
+    if (eye.stillFor < SETTLE_MS) continue;
+
+    restMs += STEP_MS;
+    if (hypot(eye.x - DOORWAY.x, eye.y - DOORWAY.y) <= options.near ||
+        hypot(eye.x - SOFA.x, eye.y - SOFA.y) <= options.near) {
+      hotMs += STEP_MS;
+    }
+
+    int column = std::min((int)eye.x / CELL_PX, ScanPlanner::HEAT_GRID - 1);
+    int row = std::min((int)eye.y / CELL_PX, ScanPlanner::HEAT_GRID - 1);
+    int cell = row * ScanPlanner::HEAT_GRID + column;
+    if (eye.stillFor == SETTLE_MS) { // Once per rest
+      if (lastRest[cell] >= 0) gaps.push_back((now - lastRest[cell]) / 1000.0);
+      if (!covered[cell]) {
+        covered[cell] = true;
+        if (++coveredCells == ScanPlanner::HEAT_CELLS) {
+          covers.push_back((now - coverStart) / 1000.0);
+          std::fill(covered.begin(), covered.end(), false);
+          coveredCells = 0;
+          coverStart = now;
+        }
+      }
+    }
+    lastRest[cell] = now;
+  }
+
+  double coverMean = 0;
+  for (double c : covers) coverMean += c;
+  coverMean = covers.empty() ? 0 : coverMean / covers.size();
+  printf("%-17s faces=%d covers=%zu cover_s=%.1f gap_p90_s=%.1f gap_max_s=%.1f hot_share=%.2f",
+         strategyNames[(int)strategy], faces, covers.size(), coverMean, percentile(gaps, 90), percentile(gaps, 100),
+         restMs ? (double)hotMs / restMs : 0);
+  if (strategy == Strategy::LEARNING_PLANNER) printf(" bias=%.2f", planner.bias());
+  printf("\n");
+}
+
+int main(int argc, char **argv) {
+  Options options;
+  for (int i = 1; i < argc; i++) {
+    const char *arg = argv[i];
+    double value = i + 1 < argc ? atof(argv[i + 1]) : 0;
+    if (!strcmp(arg, "--hours")) options.hours = value, i++;
+    else if (!strcmp(arg, "--near")) options.near = value, i++;
+    else if (!strcmp(arg, "--speed")) options.speed = value, i++;
+    else if (!strcmp(arg, "--hotspot")) options.hotspot = value, i++;
+    else {
+      fprintf(stderr, "usage: %s [--hours H] [--near PX] [--speed PX_PER_S] [--hotspot SHARE]\n", argv[0]);
+      return 2;
+    }
+  }
+  printf("hours=%.1f near_px=%.0f speed_px_s=%.0f hotspot_share=%.2f\n", options.hours, options.near, options.speed,
+         options.hotspot);
+  run(Strategy::RANDOM_WALK, options);
+  run(Strategy::PLANNER, options);
+  run(Strategy::LEARNING_PLANNER, options);
+  return 0;
+}
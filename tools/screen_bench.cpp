@@ -0,0 +1,116 @@
+// tools/screen_bench.cpp
+//
+// Runs the firmware's own ScreenController through every SystemState
+// against the counting GFX stand-in in host/, and reports what each state
+// costs on the SPI bus: drawing calls, pixels, address windows and bytes,
+// per state entry and per second of animation. One line per state, as
+// key=value pairs, so two commits' reports can be diffed directly.
+//
+// Time is virtual. After every update() the clock moves on by the time the
+// bytes it sent take on the wire at --spi-hz (the blocking bus, as built
+// with ICU_DISPLAY_DMA=0) plus --loop-us for the rest of the main loop, so
+// states that redraw every pass fill the bus the way they would on the robot.
+//
+// Build, from tools/:
+//   g++ -O2 -std=c++17 -DICU_DISPLAY_DMA=0
+//       -I host -I ../ICU-S1-PrimeBuild/include -I ../ICU-S1-PrimeBuild/lib/ScreenController
+//       -I ../ICU-S1-PrimeBuild/lib/LoopProfiler -I ../ICU-S1-PrimeBuild/lib/GazeTable -I ../Common/HeapGuard
+//       -I ../Common/ThumbCodec
+//       -o screen_bench screen_bench.cpp host/Arduino.cpp
+//       ../ICU-S1-PrimeBuild/lib/ScreenController/ScreenController.cpp
+//       ../ICU-S1-PrimeBuild/lib/ScreenController/RoundSpans.cpp
+//       ../ICU-S1-PrimeBuild/lib/ScreenController/EyeRenderer.cpp
+//
+// Use:
+//   screen_bench                                    10 s of every state
+//   screen_bench --seconds 30 --spi-hz 80000000     longer, faster bus
+//   screen_bench --loop-us 2000                     a busier main loop
+
+#include <Arduino.h>
+#include <Arduino_GFX_Library.h>
+#include "ScreenController.h"
+
+struct StateRun {
+  const char *name;
+  SystemState state;
+  bool eye;
+};
+
+static const StateRun RUNS[] = {
+    {"wake_up", SystemState::WAKE_UP, false},
+    {"scanning", SystemState::SCANNING, false},
+    {"detection", SystemState::DETECTION, false},
+    {"napping", SystemState::NAPPING, false},
+    {"full_asleep", SystemState::FULL_ASLEEP, false},
+    {"error", SystemState::ERROR, false},
+    {"scanning", SystemState::SCANNING, true},
+    {"detection", SystemState::DETECTION, true},
+};
+
+// In eye mode: a face wandering round the image, and a blink every 3 s
+static void driveEye(ScreenController &screen, unsigned long elapsedMs) {
+  float angle = elapsedMs / 4000.0f * 2 * (float)M_PI;
+  screen.setGaze(120 + (int)(70 * cosf(angle)), 120 + (int)(40 * sinf(angle)));
+  screen.setEyelid(elapsedMs % 3000 < 190 ? 0 : 255);
+}
+
+int main(int argc, char **argv) {
+  double seconds = 10;
+  double spiHz = 40000000;
+  unsigned long loopUs = 500;
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--seconds") && i + 1 < argc) seconds = atof(argv[++i]);
+    else if (!strcmp(argv[i], "--spi-hz") && i + 1 < argc) spiHz = atof(argv[++i]);
+    else if (!strcmp(argv[i], "--loop-us") && i + 1 < argc) loopUs = strtoul(argv[++i], nullptr, 10);
+    else {
+      fprintf(stderr, "usage: %s [--seconds N] [--spi-hz HZ] [--loop-us US]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  ScreenController screen;
+  if (!screen.begin()) {
+    fprintf(stderr, "ScreenController::begin() failed\n");
+    return 1;
+  }
+
+  printf("screen_bench seconds=%.1f spi_hz=%.0f loop_us=%lu\n", seconds, spiHz, loopUs);
+  const uint64_t runUs = (uint64_t)(seconds * 1e6);
+  for (const StateRun &run : RUNS) {
+    screen.setEyeMode(run.eye);
+
+    hostResetGfxCounters();
+    screen.setState(run.state);
+    HostGfxCounters enter = hostGfxCounters;
+
+    hostResetGfxCounters();
+    unsigned long updates = 0;
+    uint32_t maxUpdateBytes = 0;
+    uint64_t busUs = 0;
+    uint64_t elapsedUs = 0;
+    while (elapsedUs < runUs) {
+      if (run.eye) driveEye(screen, (unsigned long)(elapsedUs / 1000));
+      uint32_t before = hostGfxCounters.bytes;
+      screen.update();
+      uint32_t sent = hostGfxCounters.bytes - before;
+      if (sent > maxUpdateBytes) maxUpdateBytes = sent;
+
+      uint64_t wireUs = (uint64_t)(sent * 8.0 * 1e6 / spiHz);
+      busUs += wireUs;
+      hostAdvanceMicros(wireUs + loopUs);
+      elapsedUs += wireUs + loopUs;
+      updates++;
+    }
+    const HostGfxCounters &anim = hostGfxCounters;
+    double span = elapsedUs / 1e6;
+
+    printf("state=%s mode=%s enter_calls=%lu enter_pixels=%lu enter_windows=%lu enter_bytes=%lu "
+           "updates=%lu calls_per_s=%.0f pixels_per_s=%.0f windows_per_s=%.0f spi_bytes_per_s=%.0f "
+           "max_update_bytes=%lu bus_busy=%.3f\n",
+           run.name, run.eye ? "eye" : "status", (unsigned long)enter.calls, (unsigned long)enter.pixels,
+           (unsigned long)enter.windows, (unsigned long)enter.bytes, updates, anim.calls / span,
+           anim.pixels / span, anim.windows / span, anim.bytes / span, (unsigned long)maxUpdateBytes,
+           busUs / 1e6 / span);
+  }
+  return 0;
+}
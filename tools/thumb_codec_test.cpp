@@ -0,0 +1,343 @@
+// tools/thumb_codec_test.cpp
+//
+// Checks Common/ThumbCodec on the host: ThumbEncoder's messages decoded by
+// ThumbDecoder, as the XIAO and the ProS3 use them, reported as in
+// host/HostCheck.h.
+//
+//   round_trip    a busy scene, moving and with sensor noise: every time a
+//                 message completes a scan the decoder matches the scene to
+//                 within the tolerance, and base64 carries every message
+//   budget        no message is longer than its budget, for budgets from a
+//                 few bytes up to THUMB_MAX_BYTES
+//   key_refresh   a key leaves the pixels it has not reached yet as they were
+//   resync        a lost message stops the decoder until the next key, and
+//                 the key's refresh brings it back to the scene
+//   wraparound    messages that start late in the image and carry on from
+//                 its first pixel decode correctly
+//   window        a frame that only shows a sensor window of the field fills
+//                 the same thumbnail cells as the full field would, and
+//                 leaves the others alone
+//
+// Build, from tools/:
+//   g++ -O2 -std=c++17 -I host -I ../Common/ThumbCodec
+//       -o thumb_codec_test thumb_codec_test.cpp ../Common/ThumbCodec/ThumbCodec.cpp
+//
+// Use:
+//   thumb_codec_test
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <random>
+#include "HostCheck.h"
+#include "ThumbCodec.h"
+
+const int TOLERANCE = 1;
+const int KEY_INTERVAL = 40;
+
+// A scene with plenty of detail, drifting sideways by 'shift' pixels, plus
+// a level of noise either way on a third of the pixels.
+static void makeScene(int shift, std::mt19937 &rng, uint8_t *pixels) {
+  for (int y = 0; y < THUMB_SIZE; y++) {
+    for (int x = 0; x < THUMB_SIZE; x++) {
+      int level = ((x + shift) * 7 / 3 + y * 5 / 2 + ((x + shift) / 6 + y / 6) % 2 * 6) % THUMB_LEVELS;
+      int noise = (int)(rng() % 3) - 1;
+      level += rng() % 3 == 0 ? noise : 0;
+      pixels[y * THUMB_SIZE + x] = (uint8_t)(level < 0 ? 0 : level >= THUMB_LEVELS ? THUMB_LEVELS - 1 : level);
+    }
+  }
+}
+
+static int worstDifference(const uint8_t *a, const uint8_t *b) {
+  int worst = 0;
+  for (int i = 0; i < THUMB_PIXELS; i++) {
+    int difference = abs((int)a[i] - (int)b[i]);
+    if (difference > worst) worst = difference;
+  }
+  return worst;
+}
+
+// Pixels a message's tokens walk over, to see where it ends
+static int walkedBy(const uint8_t *data, int length) {
+  int walked = 0;
+  for (int i = 0; i < length;) {
+    uint8_t token = data[i++];
+    int count = (token & 0x7F) + 1;
+    walked += count;
+    if (token & 0x80) i += (count + 1) / 2;
+  }
+  return walked;
+}
+
+// Encodes 'scene' until a message completes a scan, applying each message.
+// Returns the messages it took, or -1 if the decoder refused one.
+static int refresh(ThumbEncoder &encoder, ThumbDecoder &decoder, const uint8_t *scene, int budget) {
+  uint8_t data[THUMB_MAX_BYTES];
+  for (int messages = 1; messages <= 1000; messages++) {
+    ThumbHeader header;
+    int length = encoder.encode(scene, data, budget, header);
+    if (length == 0 && !(header.flags & THUMB_KEY)) return messages - 1; // Nothing left to send
+    if (!decoder.apply(header, data, length)) return -1;
+    if (header.flags & THUMB_COMPLETE) return messages;
+  }
+  return -1;
+}
+
+static void testRoundTrip() {
+  std::mt19937 rng(1);
+  ThumbEncoder encoder(TOLERANCE, KEY_INTERVAL);
+  ThumbDecoder decoder;
+  uint8_t scene[THUMB_PIXELS];
+  uint8_t data[THUMB_MAX_BYTES];
+  char text[THUMB_MAX_BYTES * 4 / 3 + 4];
+  uint8_t carried[THUMB_MAX_BYTES];
+  int scans = 0, messages = 0, worst = 0;
+  bool base64Ok = true, applied = true;
+
+  for (int frame = 0; frame < 300; frame++) {
+    makeScene(frame / 10, rng, scene);
+    ThumbHeader header;
+    int length = encoder.encode(scene, data, THUMB_MAX_BYTES, header);
+    if (length == 0 && !(header.flags & THUMB_KEY)) continue;
+    messages++;
+
+    int textLength = thumbBase64Encode(data, length, text, sizeof(text));
+    int carriedLength = textLength < 0 ? -1 : thumbBase64Decode(text, carried, sizeof(carried));
+    if (carriedLength != length || memcmp(carried, data, length) != 0) base64Ok = false;
+
+    if (!decoder.apply(header, carried, carriedLength)) applied = false;
+    if (header.flags & THUMB_COMPLETE) {
+      scans++;
+      int difference = worstDifference(decoder.pixels(), scene);
+      if (difference > worst) worst = difference;
+    }
+  }
+
+  char detail[128];
+  snprintf(detail, sizeof(detail), "%d messages, %d complete scans, worst difference %d, base64 %s", messages, scans,
+           worst, base64Ok ? "ok" : "corrupted");
+  report("round_trip", applied && base64Ok && scans > 0 && worst <= TOLERANCE, detail);
+}
+
+static void testBudget() {
+  const int budgets[] = {4, 16, 64, 200, THUMB_MAX_BYTES};
+  std::mt19937 rng(2);
+  uint8_t scene[THUMB_PIXELS];
+  uint8_t data[THUMB_MAX_BYTES + 16];
+  int longest[sizeof(budgets) / sizeof(budgets[0])] = {0};
+  bool ok = true;
+
+  for (size_t b = 0; b < sizeof(budgets) / sizeof(budgets[0]); b++) {
+    ThumbEncoder encoder(TOLERANCE, KEY_INTERVAL);
+    ThumbDecoder decoder;
+    for (int frame = 0; frame < 200; frame++) {
+      makeScene(frame, rng, scene);
+      memset(data + budgets[b], 0xA5, 16); // Anything written past the budget shows up here
+      ThumbHeader header;
+      int length = encoder.encode(scene, data, budgets[b], header);
+      if (length > longest[b]) longest[b] = length;
+      for (int i = 0; i < 16; i++) {
+        if (data[budgets[b] + i] != 0xA5) ok = false;
+      }
+      if (length > budgets[b]) ok = false;
+      if (length > 0 || (header.flags & THUMB_KEY)) {
+        if (!decoder.apply(header, data, length)) ok = false;
+      }
+    }
+  }
+
+  char text[THUMB_MAX_BYTES * 4 / 3 + 4];
+  memset(data, 0xFF, THUMB_MAX_BYTES);
+  int textLength = thumbBase64Encode(data, THUMB_MAX_BYTES, text, sizeof(text));
+  char detail[160];
+  snprintf(detail, sizeof(detail), "longest %d/%d %d/%d %d/%d %d/%d %d/%d bytes, %d base64 characters at most",
+           longest[0], budgets[0], longest[1], budgets[1], longest[2], budgets[2], longest[3], budgets[3], longest[4],
+           budgets[4], textLength);
+  report("budget", ok && textLength == 512, detail);
+}
+
+static void testKeyRefresh() {
+  std::mt19937 rng(3);
+  ThumbEncoder encoder(TOLERANCE, KEY_INTERVAL);
+  ThumbDecoder decoder;
+  uint8_t scene[THUMB_PIXELS];
+  makeScene(0, rng, scene);
+  bool ok = refresh(encoder, decoder, scene, THUMB_MAX_BYTES) > 0;
+
+  // The next key, with a small budget so it covers only part of the image
+  uint8_t before[THUMB_PIXELS];
+  memcpy(before, decoder.pixels(), THUMB_PIXELS);
+  encoder.reset();
+  uint8_t data[THUMB_MAX_BYTES];
+  ThumbHeader header;
+  int length = encoder.encode(scene, data, 64, header);
+  ok = ok && (header.flags & THUMB_KEY) && !(header.flags & THUMB_COMPLETE);
+  ok = ok && decoder.apply(header, data, length);
+  int reached = walkedBy(data, length);
+  int unchanged = 0;
+  for (int i = reached; i < THUMB_PIXELS; i++) {
+    if (decoder.pixels()[i] == before[i]) unchanged++;
+  }
+  ok = ok && unchanged == THUMB_PIXELS - reached;
+
+  char detail[128];
+  snprintf(detail, sizeof(detail), "the key reached %d pixels, the other %d kept their levels", reached, unchanged);
+  report("key_refresh", ok, detail);
+}
+
+static void testResync() {
+  std::mt19937 rng(4);
+  ThumbEncoder encoder(TOLERANCE, KEY_INTERVAL);
+  ThumbDecoder decoder;
+  uint8_t scene[THUMB_PIXELS];
+  uint8_t data[THUMB_MAX_BYTES];
+  int rejected = 0, dropped = 0, untilKey = -1, worst = -1;
+  bool lost = false, backAtKey = false;
+
+  for (int frame = 0; frame < 400; frame++) {
+    makeScene(frame, rng, scene);
+    ThumbHeader header;
+    int length = encoder.encode(scene, data, THUMB_MAX_BYTES, header);
+    if (length == 0 && !(header.flags & THUMB_KEY)) continue;
+    if (frame == 100 && !(header.flags & THUMB_KEY)) {
+      dropped = header.seq; // Lost on the line
+      lost = true;
+      continue;
+    }
+    bool key = header.flags & THUMB_KEY;
+    bool accepted = decoder.apply(header, data, length);
+    if (lost && !backAtKey) {
+      if (key && accepted) {
+        backAtKey = true;
+        untilKey = rejected;
+      } else if (!accepted) {
+        rejected++;
+      }
+    }
+    if (backAtKey) break;
+  }
+  // Holding the scene still, the key's refresh catches the decoder up
+  if (backAtKey && refresh(encoder, decoder, scene, THUMB_MAX_BYTES) >= 0) {
+    worst = worstDifference(decoder.pixels(), scene);
+  }
+
+  char detail[160];
+  snprintf(detail, sizeof(detail), "lost message %d, %d rejected until the key, %u resync, worst difference %d after it",
+           dropped, untilKey, (unsigned)decoder.resyncs(), worst);
+  report("resync", lost && backAtKey && untilKey > 0 && decoder.resyncs() == 1 && worst >= 0 && worst <= TOLERANCE,
+         detail);
+}
+
+// Applies a message's tokens the simple way, index by index modulo the image.
+static void applyReference(const ThumbHeader &header, const uint8_t *data, int length, uint8_t *pixels) {
+  int walked = 0;
+  for (int i = 0; i < length;) {
+    uint8_t token = data[i++];
+    int count = (token & 0x7F) + 1;
+    if (token & 0x80) {
+      for (int k = 0; k < count; k++) {
+        uint8_t packed = data[i + k / 2];
+        pixels[(header.start + walked + k) % THUMB_PIXELS] = k % 2 == 0 ? packed >> 4 : packed & 0x0F;
+      }
+      i += (count + 1) / 2;
+    }
+    walked += count;
+  }
+}
+
+static void testWraparound() {
+  std::mt19937 rng(5);
+  ThumbEncoder encoder(TOLERANCE, 1000); // No keys after the first, so starts carry on round
+  ThumbDecoder decoder;
+  uint8_t scene[THUMB_PIXELS];
+  uint8_t data[THUMB_MAX_BYTES];
+  uint8_t expected[THUMB_PIXELS];
+  memset(expected, 0, sizeof(expected));
+  int wrapped = 0, mismatched = 0;
+  bool ok = true;
+
+  for (int frame = 0; frame < 300; frame++) {
+    makeScene(frame, rng, scene);
+    ThumbHeader header;
+    int length = encoder.encode(scene, data, 100, header);
+    if (length == 0 && !(header.flags & THUMB_KEY)) continue;
+    if (header.start >= THUMB_PIXELS) ok = false;
+    if (header.start + walkedBy(data, length) > THUMB_PIXELS) wrapped++;
+    if (!decoder.apply(header, data, length)) ok = false;
+    applyReference(header, data, length, expected);
+    if (memcmp(decoder.pixels(), expected, THUMB_PIXELS) != 0) mismatched++;
+  }
+  // Then the scene holds still until everything has gone out
+  int messages = refresh(encoder, decoder, scene, 100);
+  int settled = worstDifference(decoder.pixels(), scene);
+
+  char detail[160];
+  snprintf(detail, sizeof(detail), "%d messages ran past the last pixel, %d decoded differently, worst difference %d",
+           wrapped, mismatched, settled);
+  report("wraparound", ok && wrapped > 0 && mismatched == 0 && messages >= 0 && settled <= TOLERANCE, detail);
+}
+
+// One big-endian RGB565 grey pixel
+static void putGrey(uint8_t *pixel, int grey) {
+  uint16_t value = (uint16_t)(((grey >> 3) << 11) | ((grey >> 2) << 5) | (grey >> 3));
+  pixel[0] = (uint8_t)(value >> 8);
+  pixel[1] = (uint8_t)value;
+}
+
+static int fieldGrey(int x, int y) {
+  return (x * 255 / 239 + y * 2) / 3;
+}
+
+static void testWindow() {
+  const int FIELD = 240, WINDOW_X = 60, WINDOW_Y = 40, WINDOW_SIZE = 120, READOUT = 128;
+  static uint8_t field[FIELD * FIELD * 2], window[READOUT * READOUT * 2];
+  for (int y = 0; y < FIELD; y++) {
+    for (int x = 0; x < FIELD; x++) putGrey(field + (y * FIELD + x) * 2, fieldGrey(x, y));
+  }
+  // The window, read out at a different size, as the OV5640 does
+  for (int y = 0; y < READOUT; y++) {
+    for (int x = 0; x < READOUT; x++) {
+      putGrey(window + (y * READOUT + x) * 2,
+              fieldGrey(WINDOW_X + x * WINDOW_SIZE / READOUT, WINDOW_Y + y * WINDOW_SIZE / READOUT));
+    }
+  }
+
+  uint8_t whole[THUMB_PIXELS], windowed[THUMB_PIXELS];
+  thumbFromRgb565(field, FIELD, FIELD, whole);
+  memset(windowed, 0xEE, sizeof(windowed));
+  thumbFromRgb565Window(window, READOUT, READOUT, WINDOW_X, WINDOW_Y, WINDOW_SIZE, FIELD, windowed);
+
+  int inside = 0, worst = 0, touchedOutside = 0;
+  for (int gy = 0; gy < THUMB_SIZE; gy++) {
+    for (int gx = 0; gx < THUMB_SIZE; gx++) {
+      int cellX = gx * FIELD / THUMB_SIZE, cellY = gy * FIELD / THUMB_SIZE;
+      int cellSize = FIELD / THUMB_SIZE;
+      bool in = cellX >= WINDOW_X && cellX + cellSize <= WINDOW_X + WINDOW_SIZE && cellY >= WINDOW_Y &&
+                cellY + cellSize <= WINDOW_Y + WINDOW_SIZE;
+      int p = gy * THUMB_SIZE + gx;
+      if (in) {
+        inside++;
+        int difference = abs((int)windowed[p] - (int)whole[p]);
+        if (difference > worst) worst = difference;
+      } else if (windowed[p] != 0xEE) {
+        touchedOutside++;
+      }
+    }
+  }
+
+  char detail[128];
+  snprintf(detail, sizeof(detail), "%d cells in the window, worst difference %d, %d cells outside it touched", inside,
+           worst, touchedOutside);
+  int expected = (WINDOW_SIZE * THUMB_SIZE / FIELD) * (WINDOW_SIZE * THUMB_SIZE / FIELD);
+  report("window", inside == expected && worst <= TOLERANCE && touchedOutside == 0, detail);
+}
+
+int main() {
+  testRoundTrip();
+  testBudget();
+  testKeyRefresh();
+  testResync();
+  testWraparound();
+  testWindow();
+  return checkStatus();
+}
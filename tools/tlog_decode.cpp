@@ -0,0 +1,202 @@
+// tools/tlog_decode.cpp
+//
+// Decodes and summarises the ProS3's flash telemetry log (lib/FlashLog),
+// as dumped over USB serial with the 't' command. Everything before the
+// FLASHLOG BEGIN line (the statistics line, other serial output) is skipped.
+//
+// Build, from tools/:
+//   g++ -O2 -std=c++17 -I ../Common/DeferredLog -I ../ICU-S1-PrimeBuild/lib/FlashLog
+//       -I ../ICU-S1-PrimeBuild/include -o tlog_decode tlog_decode.cpp
+//
+// Use:
+//   tlog_decode dump.bin            every record, then the summary
+//   tlog_decode dump.bin --summary  the summary only
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <map>
+#include <vector>
+#include "FlashLogFormat.h"
+#include "ProjectState.h"
+
+static const char *const stateNames[] = {"WAKE_UP", "SCANNING", "DETECTION", "NAPPING", "FULL_ASLEEP", "ERROR"};
+static const int STATE_COUNT = sizeof(stateNames) / sizeof(stateNames[0]);
+
+struct Sector {
+  FlashLogSectorHeader header;
+  std::vector<uint8_t> bytes;
+};
+
+// One boot's worth of records
+struct Boot {
+  unsigned long records = 0;
+  uint32_t firstMs = 0;
+  uint32_t lastMs = 0;
+  int resetReason = -1;
+  int state = -1;          // From the last state change
+  uint32_t stateSince = 0;
+  double stateMs[STATE_COUNT] = {};
+};
+
+// Running range of one telemetry sample field
+struct Range {
+  unsigned long count = 0;
+  double sum = 0;
+  double min = 0;
+  double max = 0;
+
+  void add(double value) {
+    if (count == 0 || value < min) min = value;
+    if (count == 0 || value > max) max = value;
+    sum += value;
+    count++;
+  }
+  void print(const char *name) const {
+    if (count == 0) return;
+    printf("  %-20s min=%-10.1f avg=%-10.1f max=%.1f\n", name, min, sum / count, max);
+  }
+};
+
+static float argFloat(const LogRecord &record, int index) {
+  float value;
+  memcpy(&value, &record.args[index], sizeof(value));
+  return value;
+}
+
+// Finds the FLASHLOG BEGIN line and returns the sector count after it.
+static long findBegin(FILE *in) {
+  char line[256];
+  int length = 0;
+  int c;
+  while ((c = fgetc(in)) != EOF) {
+    if (c != '\n') {
+      if (length < (int)sizeof(line) - 1) line[length++] = (char)c;
+      continue;
+    }
+    line[length] = '\0';
+    length = 0;
+    if (strncmp(line, FLASH_LOG_DUMP_BEGIN " ", strlen(FLASH_LOG_DUMP_BEGIN) + 1) == 0) {
+      return atol(line + strlen(FLASH_LOG_DUMP_BEGIN) + 1);
+    }
+    if (strncmp(line, "FLASHLOG ", 9) == 0) fprintf(stderr, "%s\n", line); // The statistics line
+  }
+  return -1;
+}
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    fprintf(stderr, "usage: %s <dump.bin> [--summary]\n", argv[0]);
+    return 1;
+  }
+  bool listRecords = !(argc > 2 && !strcmp(argv[2], "--summary"));
+  FILE *in = fopen(argv[1], "rb");
+  if (!in) {
+    perror(argv[1]);
+    return 1;
+  }
+  long sectorCount = findBegin(in);
+  if (sectorCount < 0) {
+    fprintf(stderr, "tlog_decode: no " FLASH_LOG_DUMP_BEGIN " line in %s\n", argv[1]);
+    return 1;
+  }
+
+  std::vector<Sector> sectors;
+  for (long i = 0; i < sectorCount; i++) {
+    Sector sector;
+    sector.bytes.resize(FLASH_LOG_SECTOR_BYTES);
+    if (fread(sector.bytes.data(), 1, FLASH_LOG_SECTOR_BYTES, in) != FLASH_LOG_SECTOR_BYTES) {
+      fprintf(stderr, "tlog_decode: dump ends after %ld of %ld sectors\n", i, sectorCount);
+      break;
+    }
+    memcpy(&sector.header, sector.bytes.data(), sizeof(sector.header));
+    if (flashLogHeaderValid(sector.header)) sectors.push_back(std::move(sector));
+  }
+  fclose(in);
+  // The dump is already oldest first; sorting also copes with a hand-made one
+  std::stable_sort(sectors.begin(), sectors.end(), [](const Sector &a, const Sector &b) {
+    return (int32_t)(a.header.sequence - b.header.sequence) < 0;
+  });
+
+  std::map<uint16_t, Boot> boots;
+  unsigned long formatCounts[LOG_FORMAT_COUNT + 1] = {0}; // Last slot: unknown IDs
+  unsigned long records = 0;
+  unsigned long torn = 0;
+  Range detections, confirmed, longestLoop, freeHeap, xiaoFps, xiaoHitRate, xiaoInference;
+
+  for (const Sector &sector : sectors) {
+    for (uint32_t slot = FLASH_LOG_FIRST_RECORD_SLOT; slot < FLASH_LOG_SLOTS; slot++) {
+      const uint8_t *bytes = sector.bytes.data() + slot * FLASH_LOG_SLOT_BYTES;
+      if (flashLogSlotErased(bytes)) continue;
+      FlashLogRecord entry;
+      memcpy(&entry, bytes, sizeof(entry));
+      if (entry.check != flashLogCheck(entry)) {
+        torn++;
+        continue;
+      }
+      const LogRecord &record = entry.record;
+      records++;
+      formatCounts[std::min<uint16_t>(record.formatId, LOG_FORMAT_COUNT)]++;
+
+      Boot &boot = boots[entry.bootCount];
+      if (boot.records++ == 0) boot.firstMs = entry.uptimeMs;
+      // A state lasts until the next change or the boot's last record
+      if (boot.state >= 0 && boot.state < STATE_COUNT) boot.stateMs[boot.state] += entry.uptimeMs - boot.stateSince;
+      boot.stateSince = entry.uptimeMs;
+      boot.lastMs = entry.uptimeMs;
+
+      switch (record.formatId) {
+        case LOG_TELEMETRY_BOOT:
+          boot.resetReason = (int)record.args[0];
+          break;
+        case LOG_TELEMETRY_STATE:
+          boot.state = (int)record.args[1];
+          break;
+        case LOG_TELEMETRY_SAMPLE:
+          detections.add(record.args[0]);
+          confirmed.add(record.args[1]);
+          longestLoop.add(record.args[2]);
+          freeHeap.add(record.args[3]);
+          break;
+        case LOG_TELEMETRY_XIAO:
+          xiaoFps.add(argFloat(record, 0));
+          xiaoHitRate.add(argFloat(record, 1));
+          xiaoInference.add(record.args[2]);
+          break;
+        default:
+          break;
+      }
+
+      if (listRecords) {
+        char text[256];
+        formatLogRecord(record, text, sizeof(text));
+        printf("[boot %u %12.3f] %s\n", (unsigned)entry.bootCount, entry.uptimeMs / 1e3, text);
+      }
+    }
+  }
+
+  printf("sectors=%zu records=%lu torn=%lu boots=%zu\n", sectors.size(), records, torn, boots.size());
+  for (const auto &item : boots) {
+    const Boot &boot = item.second;
+    printf("boot %u: %lu records, %.1f s to %.1f s, reset reason %d\n", (unsigned)item.first, boot.records,
+           boot.firstMs / 1e3, boot.lastMs / 1e3, boot.resetReason);
+    for (int i = 0; i < STATE_COUNT; i++) {
+      if (boot.stateMs[i] > 0) printf("  %-12s %10.1f s\n", stateNames[i], boot.stateMs[i] / 1e3);
+    }
+  }
+  printf("records by format:\n");
+  for (int i = 0; i <= LOG_FORMAT_COUNT; i++) {
+    if (formatCounts[i] == 0) continue;
+    printf("  %8lu  %s\n", formatCounts[i], i < LOG_FORMAT_COUNT ? logFormatStrings[i] : "<unknown format>");
+  }
+  printf("samples:\n");
+  detections.print("detections/min");
+  confirmed.print("faces confirmed/min");
+  longestLoop.print("longest loop us");
+  freeHeap.print("free heap");
+  xiaoFps.print("xiao fps");
+  xiaoHitRate.print("xiao hit rate");
+  xiaoInference.print("xiao inference p99 us");
+  return 0;
+}